@@ -49,6 +49,8 @@ void setup(AppInfo* self,
            GtkIconTheme* icon_theme,
            std::unordered_map<uint, bool>& enabled_app_list);
 
-void update(AppInfo* self, NodeInfo node_info);
+// Only the widgets related to the node_change bits in changes are refreshed.
+
+void update(AppInfo* self, NodeInfo node_info, uint changes = node_change::all);
 
 }  // namespace ui::app_info
@@ -68,4 +68,7 @@ auto application_new() -> GApplication*;
 
 void hide_all_windows(GApplication* app);
 
+// True when the application quit because the output layout changed and main has to start it again.
+auto restart_requested() -> bool;
+
 }  // namespace app
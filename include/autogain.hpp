@@ -19,15 +19,19 @@
 
 #pragma once
 
-#include <ebur128.h>
 #include <sigc++/signal.h>
 #include <sys/types.h>
+#include <atomic>
+#include <cstdint>
 #include <span>
 #include <string>
-#include <thread>
+#include <utility>
 #include <vector>
+#include "loudness_meter.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "rt_state.hpp"
+#include "telemetry.hpp"
 
 class AutoGain : public PluginBase {
  public:
@@ -52,13 +56,15 @@ class AutoGain : public PluginBase {
     geometric_mean_si
   };
 
-  void setup() override;
+  void setup_engine(const uint& n_samples, const uint& rate) override;
 
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
                std::span<float>& right_out) override;
 
+  void process_channels(std::span<std::span<float>> in, std::span<std::span<float>> out) override;
+
   auto get_latency_seconds() -> float override;
 
   sigc::signal<void(const double,  // loudness
@@ -78,25 +84,48 @@ class AutoGain : public PluginBase {
   double loudness = 0.0;
 
  private:
-  bool ebur128_ready = false;
+  enum Meter : uint16_t { results_meter = telemetry::first_plugin_meter };
+
+  struct Engine {
+    Engine(const uint& rate, std::vector<double> channel_weights)
+        : rate(rate),
+          n_channels(static_cast<uint>(channel_weights.size())),
+          meter(rate, std::move(channel_weights), false, max_history_limit) {}
+
+    uint rate = 0U;
 
-  uint old_rate = 0U;
+    uint n_channels = 2U;
+
+    int maximum_history = -1;
+
+    LoudnessMeter meter;
+  };
+
+  static constexpr uint max_history_limit = 3600U;  // upper limit of the maximum-history key
 
   double target = -23.0;  // target loudness level
   double silence_threshold = -70.0;
   double internal_output_gain = 1.0;
 
+  std::atomic<int> maximum_history = 15;
+
+  std::atomic<int> gain_update_interval = 100;  // milliseconds
+
+  uint frames_since_gain_update = 0U;
+
+  uint64_t engine_generation = 0U;
+
   Reference reference = Reference::geometric_mean_msi;
 
-  std::vector<float> data;
+  RtState<Engine> engine;
 
-  ebur128_state* ebur_state = nullptr;
+  void init_meter(const uint& rate);
 
-  std::vector<std::thread> mythreads;
+  // measures the input frames and updates the loudness values and internal_output_gain
 
-  auto init_ebur128() -> bool;
+  void update_gain(Engine& e, const uint64_t& generation, std::span<const std::span<float>> frames);
 
   static auto parse_reference_key(const std::string& key) -> Reference;
 
-  void set_maximum_history(const int& seconds);
+  void on_meter(const telemetry::Record& record) override;
 };
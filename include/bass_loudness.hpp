@@ -37,8 +37,6 @@ class BassLoudness : public PluginBase {
   auto operator=(const BassLoudness&&) -> BassLoudness& = delete;
   ~BassLoudness() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -0,0 +1,154 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/*
+  Single threaded FIFO with a fixed capacity. The memory is allocated by resize() and never again, so it is safe to use
+  in the realtime thread after that.
+*/
+
+class RingBuffer {
+ public:
+  // The capacity is rounded up to a power of 2. All the stored data is discarded.
+  void resize(const size_t& min_capacity);
+
+  void clear();
+
+  [[nodiscard]] auto size() const -> size_t { return write_pos - read_pos; }
+
+  [[nodiscard]] auto capacity() const -> size_t { return buffer.size(); }
+
+  // Returns how many values were written. What does not fit is dropped.
+  auto push(std::span<const float> input) -> size_t;
+
+  auto push_zeros(const size_t& count) -> size_t;
+
+  // Returns how many values were read.
+  auto pop(std::span<float> output) -> size_t;
+
+  // Fills the whole output. When there is not enough data zeros are put at the beginning. Returns how many.
+  auto pop_or_pad(std::span<float> output) -> size_t;
+
+ private:
+  size_t mask = 0U;
+
+  size_t read_pos = 0U, write_pos = 0U;
+
+  std::vector<float> buffer;
+};
+
+/*
+  Turns the quanta given by PipeWire into the fixed size blocks some of our filters need.
+
+  The input is collected in contiguous block buffers. Every time a block is complete it is handed to the callback, that
+  processes it in place, and the result goes to an output FIFO. The output FIFO is primed with zeros so that process()
+  can always fill the output buffer. This makes the latency constant: block_size - gcd(block_size, quantum) frames.
+*/
+
+class BlockAdapter {
+ public:
+  /*
+    Block size for FFT based filters running with this quantum. fftw is fast for any size made of the factors 2, 3, 5
+    and 7, like the 1000 and 1764 frames quanta used at 44.1 kHz, so there is no reason to round down to a power of 2.
+    The largest such divisor of the quantum is chosen, which makes the latency zero, unless it would split the quantum
+    in more than max_blocks pieces. In that case the quantum itself is used and fftw falls back to its generic
+    algorithms.
+  */
+
+  static auto fft_block_size(const uint& quantum, const uint& max_blocks = 4U) -> uint;
+
+  // Allocates all the memory. It must not be called from the realtime thread.
+  void setup(const uint& block_size, const uint& quantum, const uint& max_input_size = 0U);
+
+  // Discards the buffered data and primes the output again.
+  void reset();
+
+  [[nodiscard]] auto get_block_size() const -> uint { return block_size; }
+
+  [[nodiscard]] auto get_latency_frames() const -> uint { return latency_frames; }
+
+  [[nodiscard]] auto available() const -> size_t { return fifo_out_L.size(); }
+
+  // Buffers the input. The callback is called with (std::span<float> left, std::span<float> right) for each new block.
+  template <typename Callback>
+  void push(std::span<const float> left_in, std::span<const float> right_in, Callback&& callback) {
+    const size_t n_frames = std::min(left_in.size(), right_in.size());
+
+    size_t offset = 0U;
+
+    while (offset < n_frames) {
+      const size_t count = std::min(n_frames - offset, static_cast<size_t>(block_size - block_fill));
+
+      std::copy_n(left_in.begin() + offset, count, block_L.begin() + block_fill);
+      std::copy_n(right_in.begin() + offset, count, block_R.begin() + block_fill);
+
+      block_fill += count;
+      offset += count;
+
+      if (block_fill == block_size) {
+        callback(std::span<float>(block_L), std::span<float>(block_R));
+
+        fifo_out_L.push(block_L);
+        fifo_out_R.push(block_R);
+
+        block_fill = 0U;
+      }
+    }
+  }
+
+  // Fills the output with processed data. Returns how many zeros had to be inserted at the beginning because there
+  // was not enough data.
+  auto pull(std::span<float> left_out, std::span<float> right_out) -> uint;
+
+  template <typename Callback>
+  void process(std::span<const float> left_in,
+               std::span<const float> right_in,
+               std::span<float> left_out,
+               std::span<float> right_out,
+               Callback&& callback) {
+    // When the quantum is the block size we can process directly in the output buffers.
+
+    if (left_in.size() == block_size && block_fill == 0U && fifo_out_L.size() == 0U) {
+      std::ranges::copy(left_in, left_out.begin());
+      std::ranges::copy(right_in, right_out.begin());
+
+      callback(left_out, right_out);
+
+      return;
+    }
+
+    push(left_in, right_in, callback);
+
+    pull(left_out, right_out);
+  }
+
+ private:
+  uint block_size = 0U, block_fill = 0U, latency_frames = 0U;
+
+  std::vector<float> block_L, block_R;
+
+  RingBuffer fifo_out_L, fifo_out_R;
+};
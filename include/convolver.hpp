@@ -20,14 +20,14 @@
 #pragma once
 
 #include <sys/types.h>
-#include <zita-convolver.h>
-#include <deque>
+#include <memory>
 #include <span>
 #include <string>
-#include <thread>
 #include <vector>
+#include "partitioned_convolver.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "rt_state.hpp"
 #include "util.hpp"
 
 class Convolver : public PluginBase {
@@ -43,13 +43,17 @@ class Convolver : public PluginBase {
   auto operator=(const Convolver&&) -> Convolver& = delete;
   ~Convolver() override;
 
-  void setup() override;
+  void setup_engine(const uint& n_samples, const uint& rate) override;
+
+  auto is_ready() -> bool override;
 
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
                std::span<float>& right_out) override;
 
+  void process_channels(std::span<std::span<float>> in, std::span<std::span<float>> out) override;
+
   auto get_latency_seconds() -> float override;
 
   bool do_autogain = false;
@@ -59,63 +63,54 @@ class Convolver : public PluginBase {
   auto search_irs_path(const std::string& name) -> std::string;
 
  private:
+  struct Engine {
+    Engine() = default;
+    Engine(const Engine&) = delete;
+    auto operator=(const Engine&) -> Engine& = delete;
+    Engine(const Engine&&) = delete;
+    auto operator=(const Engine&&) -> Engine& = delete;
+    ~Engine() = default;
+
+    uint rate = 0U;
+
+    PartitionedConvolver conv_L, conv_R;
+
+    // channels beyond the front pair, in the order of PluginBase::channels
+
+    std::vector<std::unique_ptr<PartitionedConvolver>> conv_surround;
+  };
+
   std::string local_dir_irs;
   std::vector<std::string> system_data_dir_irs;
 
   bool kernel_is_initialized = false;
-  bool n_samples_is_power_of_2 = true;
-  bool zita_ready = false;
-  bool ready = false;
-  bool notify_latency = false;
 
-  uint blocksize = 512U;
+  uint engine_rate = 0U;  // rate of the last engine build, even when it failed for a missing kernel
+
+  bool kernel_outdated = false;  // the kernel file has to be read again by the next rebuild()
+
   uint ir_width = 100U;
-  uint latency_n_frames = 0U;
 
   std::vector<float> kernel_L, kernel_R;
   std::vector<float> original_kernel_L, original_kernel_R;
-  std::vector<float> data_L, data_R;
-
-  std::deque<float> deque_out_L, deque_out_R;
 
-  Convproc* conv = nullptr;
+  RtState<Engine> engine;
 
-  std::vector<std::thread> mythreads;
-
-  void read_kernel_file();
+  void read_kernel_file(const uint& rate);
 
   void apply_kernel_autogain();
 
   void set_kernel_stereo_width();
 
-  void setup_zita();
-
-  auto get_zita_buffer_size() -> uint;
-
-  void prepare_kernel();
-
-  template <typename T1>
-  void do_convolution(T1& data_left, T1& data_right) {
-    std::span conv_left_in(conv->inpdata(0), get_zita_buffer_size());
-    std::span conv_right_in(conv->inpdata(1), get_zita_buffer_size());
-
-    std::span conv_left_out(conv->outdata(0), get_zita_buffer_size());
-    std::span conv_right_out(conv->outdata(1), get_zita_buffer_size());
-
-    std::copy(data_left.begin(), data_left.end(), conv_left_in.begin());
-    std::copy(data_right.begin(), data_right.end(), conv_right_in.begin());
+  void build_engine(const uint& rate);
 
-    if (zita_ready) {
-      const int& ret = conv->process(true);  // thread sync mode set to true
+  // Processes the front pair with an engine the caller got from a single read of the RtState.
 
-      if (ret != 0) {
-        util::debug(log_tag + "IR: process failed: " + util::to_string(ret, ""));
+  void process_stereo(Engine& e,
+                      std::span<float>& left_in,
+                      std::span<float>& right_in,
+                      std::span<float>& left_out,
+                      std::span<float>& right_out);
 
-        zita_ready = false;
-      } else {
-        std::copy(conv_left_out.begin(), conv_left_out.end(), data_left.begin());
-        std::copy(conv_right_out.begin(), conv_right_out.end(), data_right.begin());
-      }
-    }
-  }
+  void rebuild() override;
 };
@@ -20,11 +20,13 @@
 #pragma once
 
 #include <bs2bclass.h>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <vector>
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "rt_state.hpp"
 
 class Crossfeed : public PluginBase {
  public:
@@ -49,7 +51,19 @@ class Crossfeed : public PluginBase {
   auto get_latency_seconds() -> float override;
 
  private:
+  struct Params {
+    int fcut = 0;
+
+    int feed = 0;
+  };
+
+  uint64_t params_generation = 0U;
+
   std::vector<float> data;
 
   bs2b_base bs2b;
+
+  RtState<Params> params;
+
+  void publish_params();
 };
@@ -20,16 +20,16 @@
 #pragma once
 
 #include <sys/types.h>
-#include <algorithm>
 #include <array>
-#include <deque>
-#include <memory>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <vector>
-#include "fir_filter_base.hpp"
+#include "block_adapter.hpp"
+#include "filter_bank.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "rt_state.hpp"
 
 class Crystalizer : public PluginBase {
  public:
@@ -46,7 +46,7 @@ class Crystalizer : public PluginBase {
 
   auto get_latency() const -> float;
 
-  void setup() override;
+  void setup_engine(const uint& n_samples, const uint& rate) override;
 
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
@@ -56,164 +56,43 @@ class Crystalizer : public PluginBase {
   auto get_latency_seconds() -> float override;
 
  private:
-  bool n_samples_is_power_of_2 = true;
-  bool filters_are_ready = false;
+  static constexpr uint nbands = 13U;
+
+  struct Engine {
+    uint n_samples = 0U;
+    uint rate = 0U;
+    uint blocksize = 512U;
+
+    FilterBank bank;
+
+    // Each band block is preceded by the last two samples of the previous block.
+
+    std::array<std::vector<float>, nbands> band_data_L;
+    std::array<std::vector<float>, nbands> band_data_R;
+
+    std::array<std::span<float>, nbands> outputs_L;
+    std::array<std::span<float>, nbands> outputs_R;
+
+    BlockAdapter adapter;
+  };
+
   bool notify_latency = false;
-  bool do_first_rotation = true;
 
-  uint blocksize = 512U;
   uint latency_n_frames = 0U;
 
-  static constexpr uint nbands = 13U;
-
-  std::vector<float> data_L;
-  std::vector<float> data_R;
+  uint64_t engine_generation = 0U;
 
   std::array<bool, nbands> band_mute;
   std::array<bool, nbands> band_bypass;
 
   std::array<float, nbands + 1U> frequencies;
   std::array<float, nbands> band_intensity;
-  std::array<float, nbands> band_last_L;
-  std::array<float, nbands> band_last_R;
-  std::array<float, nbands> band_next_L;
-  std::array<float, nbands> band_next_R;
 
-  std::array<std::vector<float>, nbands> band_data_L;
-  std::array<std::vector<float>, nbands> band_data_R;
-  std::array<std::vector<float>, nbands> band_gain;
-  std::array<std::vector<float>, nbands> band_second_derivative_L;
-  std::array<std::vector<float>, nbands> band_second_derivative_R;
-
-  std::array<std::unique_ptr<FirFilterBase>, nbands> filters;
-
-  std::deque<float> deque_out_L, deque_out_R;
+  RtState<Engine> engine;
 
   void bind_band(const int& n);
 
-  template <typename T1>
-  void enhance_peaks(T1& data_left, T1& data_right) {
-    for (uint n = 0U; n < nbands; n++) {
-      std::copy(data_left.begin(), data_left.end(), band_data_L.at(n).begin());
-      std::copy(data_right.begin(), data_right.end(), band_data_R.at(n).begin());
-
-      filters.at(n)->process(band_data_L.at(n), band_data_R.at(n));
-
-      /*
-        Later we will need to calculate the second derivative of each band. This
-        is done through the central difference method. In order to calculate
-        the derivative at the last elements of the array we have to know the first
-        element of the next buffer. As we do not have this information the only
-        way to do this calculation is delaying the signal by 1 sample.
-      */
-
-      // last (R,L) becomes the first
-
-      std::rotate(band_data_L.at(n).rbegin(), band_data_L.at(n).rbegin() + 1, band_data_L.at(n).rend());
-      std::rotate(band_data_R.at(n).rbegin(), band_data_R.at(n).rbegin() + 1, band_data_R.at(n).rend());
-
-      if (do_first_rotation) {
-        /*
-          band_data was rotated. Its first values are the last ones from the original array. we have to save them for
-          the next round.
-        */
-
-        band_next_L.at(n) = band_data_L.at(n)[0];
-        band_next_R.at(n) = band_data_R.at(n)[0];
-
-        band_last_L.at(n) = 0.0F;
-        band_last_R.at(n) = 0.0F;
-
-        band_data_L.at(n)[0] = 0.0F;
-        band_data_R.at(n)[0] = 0.0F;
-
-        do_first_rotation = false;
-      } else {
-        /*
-          band_data was rotated. Its first values are the last ones from the original array. we have to save them for
-          the next round.
-        */
-
-        const float L = band_data_L.at(n)[0];
-        const float R = band_data_R.at(n)[0];
-
-        band_data_L.at(n)[0] = band_next_L.at(n);
-        band_data_R.at(n)[0] = band_next_R.at(n);
-
-        band_next_L.at(n) = L;
-        band_next_R.at(n) = R;
-      }
-    }
-
-    for (uint n = 0U; n < nbands; n++) {
-      // Calculating the second derivative
-
-      if (!band_bypass.at(n)) {
-        for (uint m = 0U; m < blocksize; m++) {
-          const float L = band_data_L.at(n)[m];
-          const float R = band_data_R.at(n)[m];
-
-          if (m > 0U && m < blocksize - 1U) {
-            const float& L_lower = band_data_L.at(n)[m - 1U];
-            const float& R_lower = band_data_R.at(n)[m - 1U];
-            const float& L_upper = band_data_L.at(n)[m + 1U];
-            const float& R_upper = band_data_R.at(n)[m + 1U];
-
-            band_second_derivative_L.at(n)[m] = L_upper - 2.0F * L + L_lower;
-            band_second_derivative_R.at(n)[m] = R_upper - 2.0F * R + R_lower;
-          } else if (m == 0U) {
-            const float& L_lower = band_last_L.at(n);
-            const float& R_lower = band_last_R.at(n);
-            const float& L_upper = band_data_L.at(n)[m + 1U];
-            const float& R_upper = band_data_R.at(n)[m + 1U];
-
-            band_second_derivative_L.at(n)[m] = L_upper - 2.0F * L + L_lower;
-            band_second_derivative_R.at(n)[m] = R_upper - 2.0F * R + R_lower;
-          } else if (m == blocksize - 1U) {
-            const float& L_upper = band_next_L.at(n);
-            const float& R_upper = band_next_R.at(n);
-            const float& L_lower = band_data_L.at(n)[m - 1U];
-            const float& R_lower = band_data_R.at(n)[m - 1U];
-
-            band_second_derivative_L.at(n)[m] = L_upper - 2.0F * L + L_lower;
-            band_second_derivative_R.at(n)[m] = R_upper - 2.0F * R + R_lower;
-          }
-        }
-
-        // peak enhancing using second derivative
-
-        for (uint m = 0U; m < blocksize; m++) {
-          const float L = band_data_L.at(n)[m];
-          const float R = band_data_R.at(n)[m];
-          const float& d2L = band_second_derivative_L.at(n)[m];
-          const float& d2R = band_second_derivative_R.at(n)[m];
-
-          band_data_L.at(n)[m] = L - band_intensity.at(n) * d2L;
-          band_data_R.at(n)[m] = R - band_intensity.at(n) * d2R;
-
-          if (m == blocksize - 1U) {
-            band_last_L.at(n) = L;
-            band_last_R.at(n) = R;
-          }
-        }
-      } else {
-        band_last_L.at(n) = band_data_L.at(n)[blocksize - 1U];
-        band_last_R.at(n) = band_data_R.at(n)[blocksize - 1U];
-      }
-    }
-
-    // add bands
-
-    for (uint m = 0U; m < blocksize; m++) {
-      data_left[m] = 0.0F;
-      data_right[m] = 0.0F;
-
-      for (uint n = 0U; n < nbands; n++) {
-        if (!band_mute.at(n)) {
-          data_left[m] += band_data_L.at(n)[m];
-          data_right[m] += band_data_R.at(n)[m];
-        }
-      }
-    }
-  }
+  void enhance_peaks(Engine& e, std::span<float> data_left, std::span<float> data_right);
+
+  static void add_enhanced_band(std::span<float> band, std::span<float> output, const float& intensity);
 };
@@ -19,14 +19,17 @@
 
 #pragma once
 
+#include <sys/types.h>
 #include <memory>
 #include <span>
 #include <string>
 #include <vector>
+#include "block_adapter.hpp"
 #include "ladspa_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "resampler.hpp"
+#include "rt_state.hpp"
 
 class DeepFilterNet : public PluginBase {
  public:
@@ -43,6 +46,8 @@ class DeepFilterNet : public PluginBase {
 
   void setup() override;
 
+  void setup_engine(const uint& n_samples, const uint& rate) override;
+
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -51,14 +56,22 @@ class DeepFilterNet : public PluginBase {
   auto get_latency_seconds() -> float override;
 
  private:
+  struct Engine {
+    uint n_samples = 0U;
+    uint rate = 0U;
+
+    std::unique_ptr<Resampler> resampler_in, resampler_out;
+
+    std::vector<float> resampled_inL, resampled_inR;
+    std::vector<float> resampled_outL, resampled_outR;
+    std::vector<float> outL, outR;
+
+    RingBuffer fifo_out_L, fifo_out_R;
+  };
+
   std::unique_ptr<ladspa::LadspaWrapper> ladspa_wrapper;
 
   bool resample = false;
-  bool resampler_ready = true;
-
-  std::unique_ptr<Resampler> resampler_inL, resampler_outL;
-  std::unique_ptr<Resampler> resampler_inR, resampler_outR;
 
-  std::vector<float> resampled_outL, resampled_outR;
-  std::vector<float> carryover_l, carryover_r;
+  RtState<Engine> engine;
 };
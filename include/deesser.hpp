@@ -20,10 +20,13 @@
 #pragma once
 
 #include <sigc++/signal.h>
+#include <cstdint>
 #include <span>
 #include <string>
+#include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "telemetry.hpp"
 
 class Deesser : public PluginBase {
  public:
@@ -38,8 +41,6 @@ class Deesser : public PluginBase {
   auto operator=(const Deesser&&) -> Deesser& = delete;
   ~Deesser() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -53,4 +54,9 @@ class Deesser : public PluginBase {
   double detected_port_value = 0.0;
 
  private:
+  enum Meter : uint16_t { detected_meter = telemetry::first_plugin_meter, compression_meter };
+
+  lv2::ControlPort port_detected, port_compression;
+
+  void on_meter(const telemetry::Record& record) override;
 };
@@ -21,11 +21,13 @@
 
 #include <speex/speex_echo.h>
 #include <climits>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <vector>
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "rt_state.hpp"
 
 #include <speex/speex_preprocess.h>
 #include <speex/speexdsp_config_types.h>
@@ -46,6 +48,8 @@ class EchoCanceller : public PluginBase {
 
   void setup() override;
 
+  void setup_engine(const uint& n_samples, const uint& rate) override;
+
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -56,29 +60,61 @@ class EchoCanceller : public PluginBase {
   auto get_latency_seconds() -> float override;
 
  private:
+  struct Params {
+    int residual_echo_suppression = -10;
+
+    int near_end_suppression = -10;
+  };
+
+  struct Engine {
+    Engine() = default;
+    Engine(const Engine&) = delete;
+    auto operator=(const Engine&) -> Engine& = delete;
+    Engine(const Engine&&) = delete;
+    auto operator=(const Engine&&) -> Engine& = delete;
+    ~Engine();
+
+    uint n_samples = 0U;
+
+    uint rate = 0U;
+
+    std::vector<spx_int16_t> data_L;
+    std::vector<spx_int16_t> data_R;
+    std::vector<spx_int16_t> probe_mono;
+    std::vector<spx_int16_t> filtered_L;
+    std::vector<spx_int16_t> filtered_R;
+
+    SpeexEchoState* echo_state_L = nullptr;
+    SpeexEchoState* echo_state_R = nullptr;
+
+    SpeexPreprocessState *state_left = nullptr, *state_right = nullptr;
+
+    void apply(Params& p) const;
+  };
+
   bool notify_latency = false;
-  bool ready = false;
 
   uint filter_length_ms = 100U;
+
   uint latency_n_frames = 0U;
 
   int residual_echo_suppression = -10;
+
   int near_end_suppression = -10;
 
+  uint64_t params_generation = 0U;
+
+  uint64_t engine_generation = 0U;
+
   const float inv_short_max = 1.0F / (SHRT_MAX + 1.0F);
 
-  std::vector<spx_int16_t> data_L;
-  std::vector<spx_int16_t> data_R;
-  std::vector<spx_int16_t> probe_mono;
-  std::vector<spx_int16_t> filtered_L;
-  std::vector<spx_int16_t> filtered_R;
+  RtState<Params> params;
 
-  SpeexEchoState* echo_state_L = nullptr;
-  SpeexEchoState* echo_state_R = nullptr;
+  RtState<Engine> engine;
 
-  SpeexPreprocessState *state_left = nullptr, *state_right = nullptr;
+  void publish_params();
 
-  void free_speex();
+  void init_speex(const uint& n_samples, const uint& rate);
 
-  void init_speex();
+  void rebuild() override;
 };
@@ -24,9 +24,15 @@
 #include <pipewire/proxy.h>
 #include <sigc++/connection.h>
 #include <sigc++/signal.h>
+#include <spa/utils/defs.h>
+#include <sys/types.h>
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 #include "autogain.hpp"
 #include "bass_enhancer.hpp"
@@ -43,6 +49,7 @@
 #include "exciter.hpp"
 #include "expander.hpp"
 #include "filter.hpp"
+#include "fused_chain.hpp"
 #include "gate.hpp"
 #include "limiter.hpp"
 #include "loudness.hpp"
@@ -110,6 +117,22 @@ class EffectsBase {
 
   sigc::signal<void(const float&)> pipeline_latency;
 
+  /*
+    Main thread. Called around a preset load. The plugins running in the fused chain keep their current values while
+    the preset is written, so that a crossfade started by the new plugin list goes from the old values to the new
+    ones. The instances that are not replaced by the crossfade get the new values when the load is finished.
+  */
+
+  void freeze_running_plugins();
+
+  void thaw_plugins();
+
+  // Emitted when plugin instances were replaced by new ones built for a crossfaded switch of the chain.
+
+  sigc::signal<void()> plugins_replaced;
+
+  virtual void set_bypass(const bool& state) = 0;
+
   auto get_plugins_map() -> std::map<std::string, std::shared_ptr<PluginBase>>;
 
   template <typename T>
@@ -117,6 +140,13 @@ class EffectsBase {
     return std::dynamic_pointer_cast<T>(plugins[name]);
   }
 
+  // Instances created with a null PipeManager have no PipeWire filter. They are used by OfflineRenderer.
+  static auto create_plugin(const std::string& name,
+                            const std::string& log_tag,
+                            const std::string& schema_base_path,
+                            PipeManager* pm,
+                            PipelineType pipeline_type) -> std::shared_ptr<PluginBase>;
+
  protected:
   GSettings *settings = nullptr, *global_settings = nullptr;
 
@@ -124,12 +154,50 @@ class EffectsBase {
 
   std::map<std::string, std::shared_ptr<PluginBase>> plugins;
 
-  std::vector<pw_proxy*> list_proxies, list_proxies_listen_mic;
+  std::vector<std::shared_ptr<FusedChain>> fused_chains;
+
+  std::vector<pw_proxy*> list_proxies_listen_mic;
+
+  // Links between two nodes of the chain. The nodes are identified by their serials because PipeWire reuses ids.
+
+  struct ChainHop {
+    uint64_t output_serial = SPA_ID_INVALID;
+
+    uint64_t input_serial = SPA_ID_INVALID;
+
+    bool probe_link = false;
+
+    std::vector<pw_proxy*> links;
+  };
+
+  std::vector<ChainHop> chain_hops;
 
   std::vector<sigc::connection> connections;
 
+  // Connections to the signals of each plugin instance. They go away with the instances replaced by a crossfade.
+
+  std::map<const PluginBase*, std::vector<sigc::connection>> plugin_connections;
+
   std::vector<gulong> gconnections, gconnections_global;
 
+  guint telemetry_source_id = 0U;
+
+  guint switch_source_id = 0U;
+
+  guint relink_source_id = 0U;
+
+  struct ChainSwitch {
+    std::vector<std::shared_ptr<PluginBase>> plugins;
+
+    std::vector<std::shared_ptr<PluginBase>> outgoing;  // instances replaced by the ones in plugins
+
+    bool started = false;
+
+    gint64 deadline = 0;  // monotonic time in microseconds
+  } chain_switch;
+
+  std::vector<std::shared_ptr<PluginBase>> frozen_plugins;
+
   void create_filters_if_necessary();
 
   void remove_unused_filters();
@@ -139,4 +207,63 @@ class EffectsBase {
   void deactivate_filters();
 
   void broadcast_pipeline_latency();
+
+  // The meter records posted by the realtime thread are handed to the interface by a single timer per pipeline.
+
+  void start_telemetry_timer(const int& interval_ms);
+
+  void drain_telemetry();
+
+  auto build_node_chain(const std::vector<std::string>& list, std::vector<std::shared_ptr<PluginBase>>& bypassed)
+      -> std::vector<std::shared_ptr<PluginBase>>;
+
+  // Routes the chain around the plugins whose bypass state changed. Many changes are applied in a single relink.
+
+  void schedule_relink();
+
+  // Connects the nodes that are not in the graph yet. PipeWire creates all of them in parallel.
+
+  static void connect_nodes_to_pw(const std::vector<std::shared_ptr<PluginBase>>& nodes);
+
+  void disconnect_fused_chains(std::set<uint>& link_id_list);
+
+  /*
+    Links node_ids[0] to node_ids[1] and so on, skipping the nodes that could not be linked. The pairs in probe_links
+    are linked through the probe ports of their input node. The links of hops that are already in place are kept. The
+    missing ones are created and the obsolete ones destroyed in a single round trip to the server, so adding, removing
+    or moving one effect does not interrupt the audio going through the rest of the chain. Hops leaving the first
+    node need source_min_links links. The others need one link per stereo channel.
+  */
+
+  void relink_chain(const std::vector<uint>& node_ids,
+                    const std::vector<std::pair<uint, uint>>& probe_links,
+                    const size_t& source_min_links = 2U);
+
+  void unlink_chain();
+
+  // Removes from the graph the filters and fused chains that are not in nodes.
+
+  void disconnect_unused_filters(const std::vector<std::shared_ptr<PluginBase>>& nodes);
+
+  // Inactive filters stay in the graph but are not scheduled by PipeWire even when a node property forces processing.
+
+  void set_filters_active(const std::vector<std::shared_ptr<PluginBase>>& nodes, const bool& state);
+
+  /*
+    Double buffered switching of the effects chain. When the whole chain runs in a single fused node the new plugin
+    instances are built and set up next to the current ones in the main thread. Once they are ready the fused chain
+    crossfades to them and the graph is not touched. Returns false when the filters have to be relinked instead.
+  */
+
+  auto crossfade_chain() -> bool;
+
+  auto update_chain_switch() -> gboolean;
+
+  void cancel_chain_switch();
+
+  void release_outgoing_plugins();
+
+  void connect_plugin_signals(const std::shared_ptr<PluginBase>& plugin);
+
+  void disconnect_plugin_signals(const PluginBase* plugin);
 };
@@ -27,6 +27,7 @@
 #include <string>
 #include <utility>
 #include <vector>
+#include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_equalizer.hpp"
@@ -47,8 +48,6 @@ class Equalizer : public PluginBase {
   auto operator=(const Equalizer&&) -> Equalizer& = delete;
   ~Equalizer() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -61,12 +60,16 @@ class Equalizer : public PluginBase {
   static constexpr uint max_bands = 32U;
 
  private:
+  lv2::ControlPort port_out_latency;
+
   GSettings *settings_left = nullptr, *settings_right = nullptr;
 
   uint latency_n_frames = 0U;
 
   std::vector<gulong> gconnections_unified;
 
+  auto parameter_settings() -> std::vector<GSettings*> override;
+
   template <size_t n>
   constexpr void bind_band() {
     using namespace tags::equalizer;
@@ -20,10 +20,13 @@
 #pragma once
 
 #include <sigc++/signal.h>
+#include <cstdint>
 #include <span>
 #include <string>
+#include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "telemetry.hpp"
 
 class Exciter : public PluginBase {
  public:
@@ -38,8 +41,6 @@ class Exciter : public PluginBase {
   auto operator=(const Exciter&&) -> Exciter& = delete;
   ~Exciter() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -52,4 +53,9 @@ class Exciter : public PluginBase {
   double harmonics_port_value = 0.0;
 
  private:
+  enum Meter : uint16_t { harmonics_meter = telemetry::first_plugin_meter };
+
+  lv2::ControlPort port_meter_drive;
+
+  void on_meter(const telemetry::Record& record) override;
 };
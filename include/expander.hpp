@@ -22,11 +22,14 @@
 #include <pipewire/proxy.h>
 #include <sigc++/signal.h>
 #include <sys/types.h>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <vector>
+#include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "telemetry.hpp"
 
 class Expander : public PluginBase {
  public:
@@ -41,8 +44,6 @@ class Expander : public PluginBase {
   auto operator=(const Expander&&) -> Expander& = delete;
   ~Expander() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -62,9 +63,21 @@ class Expander : public PluginBase {
   float envelope_port_value = 0.0F;
 
  private:
+  enum Meter : uint16_t {
+    reduction_meter = telemetry::first_plugin_meter,
+    sidechain_meter,
+    curve_meter,
+    envelope_meter,
+  };
+
+  lv2::ControlPort port_out_latency, port_rlm_l, port_rlm_r, port_slm_l, port_slm_r, port_clm_l, port_clm_r, port_elm_l,
+                   port_elm_r;
+
   uint latency_n_frames = 0U;
 
   std::vector<pw_proxy*> list_proxies;
 
   void update_sidechain_links(const std::string& key);
+
+  void on_meter(const telemetry::Record& record) override;
 };
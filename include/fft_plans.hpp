@@ -0,0 +1,47 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <fftw3.h>
+#include <sys/types.h>
+
+/*
+  Process wide cache of the single precision fftw plans used by the spectrum and by the convolvers.
+
+  Plans are created with FFTW_MEASURE the first time a transform size is requested and are kept until the program
+  exits. The wisdom gathered while measuring is saved in the user cache directory, so the next start gets the same
+  plans without measuring again. Planning overwrites the arrays given here.
+
+  A cached plan is executed through fftwf_execute_dft_r2c and fftwf_execute_dft_c2r. This is thread safe and works
+  with any out of place pair of arrays that has the same alignment as the pair used to request the plan. Arrays
+  allocated by fftwf_alloc_real and fftwf_alloc_complex always have it.
+*/
+
+namespace fft_plans {
+
+// Not realtime safe. Returns a plan for a real to complex transform of size points.
+auto r2c(const uint& size, float* in, fftwf_complex* out) -> fftwf_plan;
+
+// Not realtime safe. Returns a plan for a complex to real transform of size points.
+auto c2r(const uint& size, fftwf_complex* in, float* out) -> fftwf_plan;
+
+void save_wisdom();
+
+}  // namespace fft_plans
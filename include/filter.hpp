@@ -37,8 +37,6 @@ class Filter : public PluginBase {
   auto operator=(const Filter&&) -> Filter& = delete;
   ~Filter() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -0,0 +1,90 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <fftw3.h>
+#include <sys/types.h>
+#include <span>
+#include <vector>
+
+/*
+  Splits a signal into bands with FIR filters that share the analysis work.
+
+  Each band is a uniformly partitioned overlap-save convolution with a partition of one block. The spectrum of the
+  input block is computed a single time and stored in a frequency domain delay line shared by all the bands. Each band
+  then only needs a complex multiply-accumulate with its kernel partitions and one inverse transform. The output of a
+  block is ready as soon as the block is processed, so there is no latency beyond the block size chosen by the caller.
+*/
+
+class FilterBank {
+ public:
+  FilterBank() = default;
+  FilterBank(const FilterBank&) = delete;
+  auto operator=(const FilterBank&) -> FilterBank& = delete;
+  FilterBank(const FilterBank&&) = delete;
+  auto operator=(const FilterBank&&) -> FilterBank& = delete;
+  ~FilterBank();
+
+  // Not realtime safe. Every kernel becomes one band. The fftw plans are taken from the shared cache.
+  void setup(const uint& block_size, const uint& n_channels, const std::vector<std::vector<float>>& kernels);
+
+  /*
+    Realtime safe. Filters one block of block_size frames of the given channel. outputs has one entry per band. The
+    bands whose entry is empty are not computed.
+  */
+
+  void process(const uint& channel, std::span<const float> input, std::span<const std::span<float>> outputs);
+
+  [[nodiscard]] auto get_block_size() const -> uint { return block_size; }
+
+  [[nodiscard]] auto get_n_bands() const -> size_t { return bands.size(); }
+
+ private:
+  struct Channel {
+    std::vector<float> previous;  // last input block
+
+    std::vector<float> fdl_re, fdl_im;  // max_partitions * n_bins
+
+    uint fdl_index = 0U;
+  };
+
+  struct Band {
+    uint n_partitions = 0U;
+
+    std::vector<float> re, im;  // kernel spectra, n_partitions * n_bins
+  };
+
+  uint block_size = 0U, n_bins = 0U, max_partitions = 0U;
+
+  float* frame = nullptr;  // 2 * block_size
+
+  fftwf_complex* spectrum = nullptr;  // n_bins
+
+  fftwf_plan forward = nullptr;  // owned by fft_plans
+  fftwf_plan backward = nullptr;
+
+  std::vector<float> acc_re, acc_im;
+
+  std::vector<Channel> channels;
+
+  std::vector<Band> bands;
+
+  void free_buffers();
+};
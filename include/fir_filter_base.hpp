@@ -20,12 +20,9 @@
 #pragma once
 
 #include <sys/types.h>
-#include <zita-convolver.h>
-#include <algorithm>
-#include <span>
 #include <string>
 #include <vector>
-#include "util.hpp"
+#include "partitioned_convolver.hpp"
 
 class FirFilterBase {
  public:
@@ -48,37 +45,30 @@ class FirFilterBase {
 
   virtual void setup();
 
+  // When enabled setup() only designs the kernel. It is for users that do the convolution themselves.
+  void set_kernel_only(const bool& value);
+
+  [[nodiscard]] auto get_kernel() const -> const std::vector<float>&;
+
   [[nodiscard]] auto get_delay() const -> float;
 
+  // Realtime safe. Filters in place. Nothing is done until the kernel is set by setup().
   template <typename T1>
   void process(T1& data_left, T1& data_right) {
-    std::span conv_left_in(conv->inpdata(0), n_samples);
-    std::span conv_right_in(conv->inpdata(1), n_samples);
-
-    std::span conv_left_out(conv->outdata(0), n_samples);
-    std::span conv_right_out(conv->outdata(1), n_samples);
-
-    std::copy(data_left.begin(), data_left.end(), conv_left_in.begin());
-    std::copy(data_right.begin(), data_right.end(), conv_right_in.begin());
-
-    if (zita_ready) {
-      const int& ret = conv->process(true);  // thread sync mode set to true
-
-      if (ret != 0) {
-        util::debug(log_tag + "IR: process failed: " + util::to_string(ret, ""));
-
-        zita_ready = false;
-      } else {
-        std::copy(conv_left_out.begin(), conv_left_out.end(), data_left.begin());
-        std::copy(conv_right_out.begin(), conv_right_out.end(), data_right.begin());
-      }
+    if (!convolver_ready) {
+      return;
     }
+
+    conv_L.process(data_left);
+    conv_R.process(data_right);
   }
 
  protected:
   const std::string log_tag;
 
-  bool zita_ready = false;
+  bool convolver_ready = false;
+
+  bool kernel_only = false;
 
   uint n_samples = 0U;
   uint rate = 0U;
@@ -90,12 +80,12 @@ class FirFilterBase {
 
   std::vector<float> kernel;
 
-  Convproc* conv = nullptr;
+  PartitionedConvolver conv_L, conv_R;
 
   [[nodiscard]] auto create_lowpass_kernel(const float& cutoff, const float& transition_band) const
       -> std::vector<float>;
 
-  void setup_zita();
+  void setup_convolver();
 
   static void direct_conv(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c);
 };
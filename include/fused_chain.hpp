@@ -0,0 +1,151 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "pipe_manager.hpp"
+#include "pipeline_type.hpp"
+#include "plugin_base.hpp"
+
+/*
+  A single PipeWire filter node that runs a sequence of plugins back to back inside its own process callback. The
+  plugins are not connected to the graph while they are part of a fused chain. Audio moves between them through a pair
+  of scratch buffers instead of PipeWire links, what saves one graph hop and one buffer copy per plugin.
+*/
+
+class FusedChain : public PluginBase {
+ public:
+  FusedChain(const std::string& tag, const std::string& chain_name, PipeManager* pipe_manager, PipelineType pipe_type);
+  FusedChain(const FusedChain&) = delete;
+  auto operator=(const FusedChain&) -> FusedChain& = delete;
+  FusedChain(const FusedChain&&) = delete;
+  auto operator=(const FusedChain&&) -> FusedChain& = delete;
+  ~FusedChain() override;
+
+  void set_plugins(const std::vector<std::shared_ptr<PluginBase>>& list);
+
+  /*
+    Replaces the plugins while our filter is connected. At the beginning of the next processing cycle the new list
+    starts to run in parallel with the current one and their outputs are mixed during crossfade_ms. The side with
+    the lower latency is delayed by the difference, so that both are aligned. When that is the new list its delay
+    ends with the fade, like any other latency change of the node. A list with the same effects as the current one,
+    like the one of a preset that only changes parameters, gives a correlated signal and is faded linearly. Other
+    lists are faded with equal-power gains. The new plugins must already be set up for our quantum and sampling rate
+    and none of them can be in the current list, because a plugin is processed a single time per cycle. Nothing is
+    done if a switch is already in progress.
+  */
+
+  auto crossfade_to(const std::vector<std::shared_ptr<PluginBase>>& list, const uint& crossfade_ms) -> bool;
+
+  // Main thread. Returns true when no switch is in progress. The plugins of a completed switch are released here.
+
+  auto finish_crossfade() -> bool;
+
+  [[nodiscard]] auto get_plugins() const -> const std::vector<std::shared_ptr<PluginBase>>&;
+
+  void setup() override;
+
+  void process(std::span<float>& left_in,
+               std::span<float>& right_in,
+               std::span<float>& left_out,
+               std::span<float>& right_out) override;
+
+  void process_channels(std::span<std::span<float>> in, std::span<std::span<float>> out) override;
+
+  auto get_latency_seconds() -> float override;
+
+ private:
+  enum class Switch { idle, requested, fading, finished };
+
+  /*
+    The realtime thread processes stages[active]. The other stage is only touched by the main thread while
+    switch_state is idle or finished.
+  */
+
+  std::array<std::vector<std::shared_ptr<PluginBase>>, 2U> stages;
+
+  std::atomic<uint> active = 0U;
+
+  std::atomic<Switch> switch_state = Switch::idle;
+
+  std::atomic<uint> fade_ms = 0U;
+
+  std::atomic<bool> fade_linear = false;
+
+  uint fade_frames = 0U, fade_position = 0U;  // realtime thread only
+
+  /*
+    Delay lines of the two sides of a crossfade, one block of align_capacity frames per channel. They are allocated
+    by crossfade_to and only touched by the realtime thread while fading.
+  */
+
+  std::array<std::vector<float>, 2U> align_lines;
+
+  uint align_capacity = 0U;
+
+  size_t align_position = 0U;
+
+  std::vector<float> buffer_a_left, buffer_a_right, buffer_b_left, buffer_b_right;
+
+  std::vector<float> buffer_a, buffer_b;  // all channels, one block of n_samples each
+
+  std::vector<std::span<float>> a_spans, b_spans;
+
+  // The input is copied before the current stage runs because plugins may apply their input gain in place.
+
+  std::vector<float> dry_left, dry_right, fade_left, fade_right;
+
+  std::vector<float> dry, fade;
+
+  std::vector<std::span<float>> dry_spans, fade_spans;
+
+  // Index of the last plugin that is not routed around, list.size() when all of them are.
+
+  static auto last_active_plugin(const std::vector<std::shared_ptr<PluginBase>>& list) -> size_t;
+
+  auto run_plugins(const std::vector<std::shared_ptr<PluginBase>>& list,
+                   std::span<float> left_in,
+                   std::span<float> right_in,
+                   std::span<float> left_out,
+                   std::span<float> right_out) -> float;
+
+  auto run_plugins(const std::vector<std::shared_ptr<PluginBase>>& list,
+                   std::span<std::span<float>> in,
+                   std::span<std::span<float>> out) -> float;
+
+  auto start_switch() -> bool;
+
+  void align_sides(std::span<std::span<float>> current_out,
+                   std::span<std::span<float>> incoming_out,
+                   const float& current_latency,
+                   const float& incoming_latency);
+
+  void mix_incoming(std::span<float> out, std::span<const float> incoming) const;
+
+  void advance_crossfade();
+
+  void update_latency(const float& total_latency);
+};
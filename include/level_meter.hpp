@@ -19,15 +19,16 @@
 
 #pragma once
 
-#include <ebur128.h>
 #include <sigc++/signal.h>
 #include <sys/types.h>
+#include <cstdint>
 #include <span>
 #include <string>
-#include <thread>
-#include <vector>
+#include "loudness_meter.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "rt_state.hpp"
+#include "telemetry.hpp"
 
 class LevelMeter : public PluginBase {
  public:
@@ -42,7 +43,7 @@ class LevelMeter : public PluginBase {
   auto operator=(const LevelMeter&&) -> LevelMeter& = delete;
   ~LevelMeter() override;
 
-  void setup() override;
+  void setup_engine(const uint& n_samples, const uint& rate) override;
 
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
@@ -64,9 +65,15 @@ class LevelMeter : public PluginBase {
       results;  // range
 
  private:
-  bool ebur128_ready = false;
+  enum Meter : uint16_t { results_meter = telemetry::first_plugin_meter };
 
-  uint old_rate = 0U;
+  struct Engine {
+    explicit Engine(const uint& rate) : rate(rate), meter(rate, {1.0, 1.0}, true) {}
+
+    uint rate = 0U;
+
+    LoudnessMeter meter;
+  };
 
   double momentary = 0.0;
   double shortterm = 0.0;
@@ -77,11 +84,9 @@ class LevelMeter : public PluginBase {
   double true_peak_L = 0.0;
   double true_peak_R = 0.0;
 
-  std::vector<float> data;
-
-  ebur128_state* ebur_state = nullptr;
+  RtState<Engine> engine;
 
-  std::vector<std::thread> mythreads;
+  void init_meter(const uint& rate);
 
-  auto init_ebur128() -> bool;
+  void on_meter(const telemetry::Record& record) override;
 };
@@ -22,11 +22,14 @@
 #include <pipewire/proxy.h>
 #include <sigc++/signal.h>
 #include <sys/types.h>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <vector>
+#include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "telemetry.hpp"
 
 class Limiter : public PluginBase {
  public:
@@ -41,8 +44,6 @@ class Limiter : public PluginBase {
   auto operator=(const Limiter&&) -> Limiter& = delete;
   ~Limiter() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -62,9 +63,20 @@ class Limiter : public PluginBase {
   float sidechain_r_port_value = 0.0F;
 
  private:
+  enum Meter : uint16_t {
+    gain_left_meter = telemetry::first_plugin_meter,
+    gain_right_meter,
+    sidechain_left_meter,
+    sidechain_right_meter,
+  };
+
+  lv2::ControlPort port_out_latency, port_grlm_l, port_grlm_r, port_sclm_l, port_sclm_r;
+
   uint latency_n_frames = 0U;
 
   std::vector<pw_proxy*> list_proxies;
 
   void update_sidechain_links(const std::string& key);
+
+  void on_meter(const telemetry::Record& record) override;
 };
@@ -22,6 +22,7 @@
 #include <sys/types.h>
 #include <span>
 #include <string>
+#include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 
@@ -38,8 +39,6 @@ class Loudness : public PluginBase {
   auto operator=(const Loudness&&) -> Loudness& = delete;
   ~Loudness() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -48,5 +47,7 @@ class Loudness : public PluginBase {
   auto get_latency_seconds() -> float override;
 
  private:
+  lv2::ControlPort port_out_latency;
+
   uint latency_n_frames = 0U;
 };
@@ -0,0 +1,179 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+/*
+  Streaming loudness meter following ITU-R BS.1770 and EBU Tech 3341/3342.
+
+  The signal is K-weighted and its energy is summed in 100 ms steps. Momentary and short-term loudness come from the
+  last 4 and 30 steps. Every step also yields a 400 ms gating block for the integrated loudness and a 3 s short-term
+  value for the loudness range. Both go to histograms with 0.1 LU bins that are updated incrementally, so the cost of a
+  measurement does not depend on how much history is kept.
+
+  Memory is only allocated by the constructor. Everything else may be called from the realtime thread.
+*/
+
+class LoudnessMeter {
+ public:
+  /*
+    channel_weights has one entry per channel. max_history_seconds is the largest history that set_max_history can
+    select. Zero means that the history is unlimited.
+  */
+
+  LoudnessMeter(const uint& rate,
+                std::vector<double> channel_weights,
+                const bool& enable_true_peak,
+                const uint& max_history_seconds = 0U);
+
+  // BS.1770 weight of a PipeWire channel position. The LFE is ignored and the surround channels count more.
+
+  static auto channel_weight(const std::string& position) -> double;
+
+  // Values above the capacity given to the constructor are clamped to it.
+
+  void set_max_history(const uint& seconds);
+
+  void add_frames(std::span<const std::span<float>> channels);
+
+  // True when the last add_frames call completed at least one 100 ms step.
+
+  [[nodiscard]] auto updated() const -> bool { return n_new_steps != 0U; }
+
+  [[nodiscard]] auto momentary() const -> double { return momentary_value; }
+
+  [[nodiscard]] auto shortterm() const -> double { return shortterm_value; }
+
+  [[nodiscard]] auto integrated() const -> double { return integrated_value; }
+
+  [[nodiscard]] auto relative_threshold() const -> double { return relative_value; }
+
+  [[nodiscard]] auto loudness_range() const -> double { return range_value; }
+
+  // Largest absolute sample value of all channels seen by the last add_frames call.
+
+  [[nodiscard]] auto previous_sample_peak() const -> double { return previous_peak; }
+
+  // Largest absolute value of the oversampled signal since the meter was created. Sample peak if it is disabled.
+
+  [[nodiscard]] auto true_peak(const size_t& channel) const -> double { return true_peak_values[channel]; }
+
+ private:
+  static constexpr uint n_bins = 1000U;  // -70 to +30 LUFS with 0.1 LU resolution
+
+  static constexpr uint16_t gated_out = UINT16_MAX;
+
+  static constexpr uint momentary_steps = 4U;
+  static constexpr uint shortterm_steps = 30U;
+
+  struct Biquad {
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+  };
+
+  // Loudness histogram of the blocks within the history. Each bin keeps the sum of the energies that fall in it.
+
+  struct Histogram {
+    std::array<uint, n_bins> count{};
+
+    std::array<double, n_bins> energy{};
+
+    uint total_count = 0U;
+
+    double total_energy = 0.0;
+
+    std::vector<uint16_t> history;  // bin of each block in arrival order
+
+    size_t history_start = 0U, history_size = 0U;
+
+    void add(const double& block_energy, const size_t& max_size);
+
+    void remove_oldest();
+  };
+
+  uint step_frames = 0U;  // 100 ms
+
+  size_t n_channels = 0U;
+
+  size_t history_capacity = 0U, history_limit = 0U;  // in steps
+
+  std::vector<double> weights;
+
+  // Filter states. The state of every channel is contiguous so that the loop over the channels can be vectorized.
+
+  Biquad shelf, highpass;
+
+  std::vector<double> shelf_z1, shelf_z2, highpass_z1, highpass_z2;
+
+  // 100 ms steps
+
+  std::array<double, shortterm_steps> step_energy{};
+
+  uint step_position = 0U, step_frame_count = 0U, n_steps = 0U, n_new_steps = 0U;
+
+  double step_sum = 0.0;
+
+  Histogram blocks, shortterm_blocks;
+
+  // true peak
+
+  bool true_peak_enabled = false;
+
+  uint oversampling = 1U;
+
+  static constexpr uint taps_per_phase = 12U;
+
+  std::vector<double> interpolator;  // oversampling * taps_per_phase coefficients ordered by phase
+
+  std::vector<double> tp_history;  // per channel: taps_per_phase samples stored twice to avoid wrapping
+
+  uint tp_position = 0U;
+
+  std::vector<double> true_peak_values;
+
+  double previous_peak = 0.0;
+
+  double momentary_value = -std::numeric_limits<double>::infinity();
+  double shortterm_value = -std::numeric_limits<double>::infinity();
+  double integrated_value = -std::numeric_limits<double>::infinity();
+  double relative_value = -70.0;
+  double range_value = 0.0;
+
+  void finish_step();
+
+  void update_integrated();
+
+  void update_range();
+
+  void update_true_peak(const size_t& frame, std::span<const std::span<float>> channels);
+
+  static auto energy_to_loudness(const double& energy) -> double;
+
+  static auto bin_of(const double& energy) -> uint16_t;
+
+  static auto first_bin_above(const double& loudness) -> uint;
+};
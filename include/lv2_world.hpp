@@ -0,0 +1,150 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <lilv/lilv.h>
+#include <sys/types.h>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lv2 {
+
+enum PortType { TYPE_CONTROL, TYPE_AUDIO, TYPE_ATOM };
+
+struct Port {
+  PortType type;  // Datatype
+
+  uint index;  // Port index
+
+  std::string name;
+
+  std::string symbol;
+
+  float value = 0.0F;  // Control value (if applicable)
+
+  float min = -std::numeric_limits<float>::infinity();
+
+  float max = std::numeric_limits<float>::infinity();
+
+  bool is_input;  // True if an input port
+
+  bool optional;  // True if the connection is optional
+};
+
+struct DataPorts {
+  struct {
+    uint left = UINT_MAX, right = UINT_MAX;
+  } in;
+  struct {
+    uint left = UINT_MAX, right = UINT_MAX;
+  } probe;
+  struct {
+    uint left = UINT_MAX, right = UINT_MAX;
+  } out;
+};
+
+/*
+  Everything we need to know about a plugin before instantiating it. The port table holds the default values, so
+  every Lv2Wrapper starts from a copy of it.
+*/
+
+struct PluginDescriptor {
+  const LilvPlugin* plugin = nullptr;  // nullptr when the plugin is not installed
+
+  std::vector<Port> ports;
+
+  DataPorts data_ports;
+
+  uint n_audio_in = 0U;
+  uint n_audio_out = 0U;
+};
+
+/*
+  The lilv world shared by every Lv2Wrapper of the process. It lives while at least one wrapper holds it.
+
+  Instead of scanning the whole LV2 collection we only load the bundles of the plugins we are asked for. Their
+  location comes from an index saved in the user cache directory. The index entry of a bundle is ignored when its
+  modification time changed. Only when a plugin is not in the index the world falls back to lilv_world_load_all and
+  the index is rebuilt. A plugin that the full scan did not find is saved as missing, together with the modification
+  time of the LV2 search path, so that it does not cause a full scan on every start until something is installed.
+*/
+
+class World {
+ public:
+  World();
+  World(const World&) = delete;
+  auto operator=(const World&) -> World& = delete;
+  World(const World&&) = delete;
+  auto operator=(const World&&) -> World& = delete;
+  ~World();
+
+  static auto acquire() -> std::shared_ptr<World>;
+
+  auto find_plugin(const std::string& uri) -> const PluginDescriptor&;
+
+  [[nodiscard]] auto get() const -> LilvWorld*;
+
+  // Every lilv call that reads or changes the world, like instantiating or freeing a plugin, has to hold it.
+
+  [[nodiscard]] auto get_mutex() -> std::mutex&;
+
+ private:
+  LilvWorld* world = nullptr;
+
+  bool loaded_all = false;
+
+  struct IndexEntry {
+    std::string bundle;
+
+    int64_t mtime = 0;
+  };
+
+  std::unordered_map<std::string, IndexEntry> index;
+
+  std::unordered_map<std::string, int64_t> missing;  // search path modification time of the scan that missed it
+
+  std::unordered_map<std::string, std::unique_ptr<PluginDescriptor>> descriptors;
+
+  std::mutex mutex;
+
+  auto lookup(const std::string& uri) -> const LilvPlugin*;
+
+  void load_all();
+
+  void read_index();
+
+  void write_index();
+
+  auto describe(const LilvPlugin* plugin) -> std::unique_ptr<PluginDescriptor>;
+
+  static auto bundle_mtime(const std::string& bundle) -> int64_t;
+
+  static auto search_path_mtime() -> int64_t;
+
+  static auto index_path() -> std::string;
+};
+
+}  // namespace lv2
@@ -29,13 +29,16 @@
 #include <lv2/urid/urid.h>
 #include <sys/types.h>
 #include <array>
+#include <climits>
 #include <functional>
-#include <limits>
+#include <memory>
 #include <mutex>
 #include <span>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
+#include "lv2_world.hpp"
 #include "string_literal_wrapper.hpp"
 #include "util.hpp"
 
@@ -47,26 +50,10 @@ using namespace std::string_literals;
 
 #define LV2_UI_makeSONameResident LV2_UI_PREFIX "makeSONameResident"
 
-enum PortType { TYPE_CONTROL, TYPE_AUDIO, TYPE_ATOM };
+struct ControlPort {
+  uint index = UINT_MAX;
 
-struct Port {
-  PortType type;  // Datatype
-
-  uint index;  // Port index
-
-  std::string name;
-
-  std::string symbol;
-
-  float value = 0.0F;  // Control value (if applicable)
-
-  float min = -std::numeric_limits<float>::infinity();
-
-  float max = std::numeric_limits<float>::infinity();
-
-  bool is_input;  // True if an input port
-
-  bool optional;  // True if the connection is optional
+  [[nodiscard]] auto valid() const -> bool { return index != UINT_MAX; }
 };
 
 class Lv2Wrapper {
@@ -106,12 +93,43 @@ class Lv2Wrapper {
 
   void deactivate();
 
+  /*
+    Control ports should be resolved once, when the plugin is created. Reading and writing through the returned handle
+    is a plain array access that can be done in the realtime thread. A symbol that an installed plugin does not have
+    is a programming error and aborts at startup. When the plugin is not installed the handle is invalid and its value
+    is always zero.
+  */
+
+  auto get_control_port(const std::string& symbol) -> ControlPort;
+
+  template <StringLiteralWrapper symbol_wrapper>
+  auto get_control_port() -> ControlPort {
+    return get_control_port(symbol_wrapper.msg.data());
+  }
+
+  [[nodiscard]] auto get_control_port_value(const ControlPort& port) const -> float {
+    return port.valid() ? ports[port.index].value : 0.0F;
+  }
+
+  void set_control_port_value(const ControlPort& port, const float& value);
+
+  /*
+    Main thread only. They look the symbol up on every call and debug builds abort when they are called from another
+    thread. Realtime code has to use the ControlPort handles.
+  */
+
   void set_control_port_value(const std::string& symbol, const float& value);
 
   auto get_control_port_value(const std::string& symbol) -> float;
 
   auto has_instance() -> bool;
 
+  [[nodiscard]] auto get_plugin_uri() const -> const std::string&;
+
+  // Realtime thread safe. Copies the input control values of another wrapper of the same plugin.
+
+  void copy_control_values(const Lv2Wrapper& source);
+
   void load_ui();
 
   void notify_ui();
@@ -254,7 +272,7 @@ class Lv2Wrapper {
  private:
   std::string plugin_uri;
 
-  LilvWorld* world = nullptr;
+  std::shared_ptr<World> world;
 
   const LilvPlugin* plugin = nullptr;
 
@@ -280,20 +298,9 @@ class Lv2Wrapper {
 
   std::vector<Port> ports;
 
-  // Multiband compressor/gate use 1+8*7=57 control ports. Round up to 64.
-  std::array<std::pair<size_t, uint>, 64> control_ports_cache;
-
-  struct {
-    struct {
-      uint left, right;
-    } in;
-    struct {
-      uint left, right;
-    } probe;
-    struct {
-      uint left, right;
-    } out;
-  } data_ports;
+  std::unordered_map<std::string, uint> control_port_indices;
+
+  DataPorts data_ports;
 
   std::vector<std::function<void()>> gsettings_sync_funcs;
 
@@ -304,9 +311,9 @@ class Lv2Wrapper {
 
   std::mutex ui_mutex;
 
-  void check_required_features();
+  std::thread::id main_thread_id = std::this_thread::get_id();
 
-  void create_ports();
+  void check_required_features();
 
   void connect_control_ports();
 
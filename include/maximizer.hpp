@@ -21,10 +21,13 @@
 
 #include <sigc++/signal.h>
 #include <sys/types.h>
+#include <cstdint>
 #include <span>
 #include <string>
+#include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "telemetry.hpp"
 
 class Maximizer : public PluginBase {
  public:
@@ -39,8 +42,6 @@ class Maximizer : public PluginBase {
   auto operator=(const Maximizer&&) -> Maximizer& = delete;
   ~Maximizer() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -53,5 +54,11 @@ class Maximizer : public PluginBase {
   double reduction_port_value = 0.0;
 
  private:
+  enum Meter : uint16_t { reduction_meter = telemetry::first_plugin_meter };
+
+  lv2::ControlPort port_lv2_latency, port_gr;
+
   uint latency_n_frames = 0U;
+
+  void on_meter(const telemetry::Record& record) override;
 };
@@ -27,13 +27,16 @@
 #include <sys/types.h>
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <utility>
 #include <vector>
+#include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_multiband_compressor.hpp"
+#include "telemetry.hpp"
 
 class MultibandCompressor : public PluginBase {
  public:
@@ -50,8 +53,6 @@ class MultibandCompressor : public PluginBase {
 
   static constexpr uint n_bands = tags::multiband_compressor::n_bands;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -71,6 +72,18 @@ class MultibandCompressor : public PluginBase {
   std::array<float, n_bands> reduction_port_array = {0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F};
 
  private:
+  enum Meter : uint16_t {
+    frequency_range_meter = telemetry::first_plugin_meter,
+    envelope_meter,
+    curve_meter,
+    reduction_meter,
+  };
+
+  lv2::ControlPort port_out_latency;
+
+  std::array<lv2::ControlPort, n_bands> port_fre, port_elm_l, port_elm_r, port_clm_l, port_clm_r, port_rlm_l,
+      port_rlm_r;
+
   uint latency_n_frames = 0U;
 
   std::vector<pw_proxy*> list_proxies;
@@ -131,4 +144,6 @@ class MultibandCompressor : public PluginBase {
   constexpr void bind_bands(std::index_sequence<Ns...> /*unused*/) {
     (bind_band<Ns>(), ...);
   }
+
+  void on_meter(const telemetry::Record& record) override;
 };
@@ -27,13 +27,16 @@
 #include <sys/types.h>
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <utility>
 #include <vector>
+#include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_multiband_gate.hpp"
+#include "telemetry.hpp"
 
 class MultibandGate : public PluginBase {
  public:
@@ -50,8 +53,6 @@ class MultibandGate : public PluginBase {
 
   static constexpr uint n_bands = tags::multiband_gate::n_bands;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -73,6 +74,18 @@ class MultibandGate : public PluginBase {
   std::array<float, n_bands> reduction_port_array = {0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F};
 
  private:
+  enum Meter : uint16_t {
+    frequency_range_meter = telemetry::first_plugin_meter,
+    envelope_meter,
+    curve_meter,
+    reduction_meter,
+  };
+
+  lv2::ControlPort port_out_latency;
+
+  std::array<lv2::ControlPort, n_bands> port_fre, port_elm_l, port_elm_r, port_clm_l, port_clm_r, port_rlm_l,
+      port_rlm_r;
+
   uint latency_n_frames = 0U;
 
   std::vector<pw_proxy*> list_proxies;
@@ -130,4 +143,6 @@ class MultibandGate : public PluginBase {
   constexpr void bind_bands(std::index_sequence<Ns...> /*unused*/) {
     (bind_band<Ns>(), ...);
   }
+
+  void on_meter(const telemetry::Record& record) override;
 };
@@ -44,7 +44,7 @@ struct _NodeInfoHolder {
 
   std::string icon_name;  // The name of the icon that will represent the node when we show it in a list
 
-  sigc::signal<void(const NodeInfo)> info_updated;
+  sigc::signal<void(const NodeInfo, const uint)> info_updated;
 };
 
 auto create(const NodeInfo& info) -> NodeInfoHolder*;
@@ -0,0 +1,115 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "pipeline_type.hpp"
+#include "plugin_base.hpp"
+#include "presets_manager.hpp"
+
+/*
+  Runs the effects chain of a preset over an audio file without PipeWire. The plugins are created without a
+  PipeManager and their process method is called directly, one quantum at a time, as fast as possible.
+*/
+
+class OfflineRenderer {
+ public:
+  OfflineRenderer(PipelineType pipe_type, const uint& quantum, const uint& sampling_rate = 0U);
+  OfflineRenderer(const OfflineRenderer&) = delete;
+  auto operator=(const OfflineRenderer&) -> OfflineRenderer& = delete;
+  OfflineRenderer(const OfflineRenderer&&) = delete;
+  auto operator=(const OfflineRenderer&&) -> OfflineRenderer& = delete;
+  ~OfflineRenderer();
+
+  // When true the pipeline latency is removed from the beginning of the output and the tail is rendered instead.
+  bool compensate_latency = true;
+
+  auto load_preset(const std::filesystem::path& preset_file) -> bool;
+
+  auto render(const std::filesystem::path& input_file, const std::filesystem::path& output_file) -> bool;
+
+  /*
+    Compares a rendered file with a reference one. They must have the same rate, channels and length and no sample
+    may differ by more than tolerance_db relative to full scale.
+  */
+
+  auto compare(const std::filesystem::path& rendered_file,
+               const std::filesystem::path& reference_file,
+               const double& tolerance_db) -> bool;
+
+  struct BenchmarkResult {
+    std::string plugin;
+
+    uint quantum = 0U;
+
+    uint rate = 0U;
+
+    double ns_per_sample = 0.0;
+
+    double worst_quantum_us = 0.0;  // slowest cycle
+
+    double worst_load = 0.0;  // slowest cycle divided by the quantum duration
+  };
+
+  /*
+    Times the process method of each plugin of the loaded preset. When no preset was loaded every plugin is
+    measured with its default settings.
+  */
+
+  auto benchmark(const std::vector<uint>& quanta, const std::vector<uint>& rates, const double& seconds)
+      -> std::vector<BenchmarkResult>;
+
+ private:
+  std::string log_tag = "offline_renderer: ";
+
+  PipelineType pipeline_type;
+
+  uint n_samples = 0U;
+
+  uint rate = 0U;  // 0 means the rate of the input file
+
+  std::string schema_base_path;
+
+  std::unique_ptr<PresetsManager> presets_manager;
+
+  std::vector<std::string> plugins_order;
+
+  std::vector<std::shared_ptr<PluginBase>> plugins;
+
+  std::vector<float> left, right, left_out, right_out, probe_left, probe_right;
+
+  void create_plugins();
+
+  void set_quantum(const uint& quantum);
+
+  void prepare(const uint& sampling_rate);
+
+  void process_quantum(const uint& sampling_rate);
+
+  auto get_latency_frames(const uint& sampling_rate) -> uint;
+
+  // Dispatches the pending main loop callbacks and the engine setups requested by the plugins.
+
+  void flush_main_context();
+};
@@ -37,7 +37,7 @@ class OutputLevel : public PluginBase {
   auto operator=(const OutputLevel&&) -> OutputLevel& = delete;
   ~OutputLevel() override;
 
-  void setup() override;
+  void setup_engine(const uint& n_samples, const uint& rate) override;
 
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
@@ -0,0 +1,124 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <fftw3.h>
+#include <sys/types.h>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include "worker_pool.hpp"
+
+/*
+  Non uniformly partitioned convolution with zero latency and no restriction on the number of frames per call.
+
+  The first head_size taps of the impulse response are applied in the time domain. The rest is split into stages of
+  growing block size. Each stage is a uniformly partitioned overlap-save convolver whose first partition starts at
+  least one block after the beginning of the impulse response, so its output is only needed after it was computed.
+  Stage block sizes grow by 4 from head_size until max_block_size.
+*/
+
+class PartitionedConvolver {
+ public:
+  PartitionedConvolver() = default;
+  PartitionedConvolver(const PartitionedConvolver&) = delete;
+  auto operator=(const PartitionedConvolver&) -> PartitionedConvolver& = delete;
+  PartitionedConvolver(const PartitionedConvolver&&) = delete;
+  auto operator=(const PartitionedConvolver&&) -> PartitionedConvolver& = delete;
+  ~PartitionedConvolver();
+
+  static constexpr uint head_size = 64U;
+
+  static constexpr uint max_block_size = 4096U;
+
+  static constexpr uint min_async_block_size = 1024U;  // smaller stages are cheaper to run than to schedule
+
+  // Not realtime safe. The fftw plans are taken from the shared cache and may be measured here.
+  void set_kernel(std::span<const float> kernel, const uint& sampling_rate);
+
+  // Realtime safe. Convolves in place any number of frames.
+  void process(std::span<float> data);
+
+  void reset();
+
+  [[nodiscard]] auto get_kernel_size() const -> size_t { return kernel_size; }
+
+ private:
+  struct Stage : public WorkerPoolJob {
+    uint block_size = 0U;
+
+    uint offset = 0U;  // position of the first partition in the impulse response
+
+    uint n_partitions = 0U;
+
+    uint n_bins = 0U;
+
+    uint fdl_index = 0U;
+
+    float* frame = nullptr;  // 2 * block_size
+
+    fftwf_complex* spectrum = nullptr;  // n_bins
+
+    fftwf_plan forward = nullptr;  // owned by fft_plans
+    fftwf_plan backward = nullptr;
+
+    // split complex layout makes the multiply-accumulate easy to vectorize
+
+    std::vector<float> partitions_re, partitions_im;  // n_partitions * n_bins
+
+    std::vector<float> fdl_re, fdl_im;  // frequency domain delay line, n_partitions * n_bins
+
+    std::vector<float> acc_re, acc_im;
+
+    bool async = false;
+
+    bool pending = false;  // submitted and not collected yet
+
+    uint64_t output_start = 0U;  // where the valid half of the frame goes in the output ring
+
+    // Loads nothing. The frame must hold the last 2 blocks of input and holds the result afterwards.
+    void run() override;
+  };
+
+  size_t kernel_size = 0U;
+
+  uint rate = 0U;
+
+  uint64_t time = 0U;  // frames processed since the last reset
+
+  std::vector<float> head;  // reversed head taps
+
+  std::vector<float> head_buffer;  // head_size - 1 past frames followed by the current chunk
+
+  std::vector<float> input_ring, output_ring;
+
+  size_t input_mask = 0U, output_mask = 0U;
+
+  std::vector<std::unique_ptr<Stage>> stages;
+
+  void free_stages();
+
+  void start_stage(Stage& s);
+
+  void collect_stage(Stage& s);
+
+  void wait_pending();
+};
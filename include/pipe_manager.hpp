@@ -29,10 +29,15 @@
 #include <spa/utils/json.h>
 #include <sys/types.h>
 #include <array>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "pipe_objects.hpp"
 
@@ -54,13 +59,26 @@ class PipeManager {
 
   inline static bool exclude_monitor_stream = true;
 
+  static constexpr std::chrono::milliseconds connection_timeout{10000};
+
   spa_hook metadata_listener{};
 
   std::map<uint64_t, NodeInfo> node_map;
 
-  std::vector<LinkInfo> list_links;
+  /*
+    Indexes of the graph. They are updated by the registry handlers together with node_map, so relinking only looks
+    at the nodes involved instead of walking every object PipeWire knows about.
+  */
+
+  std::unordered_map<uint, uint64_t> node_serial_by_id;
+
+  std::unordered_multimap<std::string, uint64_t> node_serials_by_name;
+
+  std::unordered_map<uint, LinkInfo> link_map;  // by link id
 
-  std::vector<PortInfo> list_ports;
+  std::unordered_map<uint, std::vector<uint>> node_links;  // ids of the links on the ports of a node
+
+  std::unordered_map<uint, std::vector<PortInfo>> node_ports;
 
   std::vector<ModuleInfo> list_modules;
 
@@ -73,6 +91,15 @@ class PipeManager {
   NodeInfo ee_sink_node, ee_source_node;
   NodeInfo output_device, input_device;
 
+  /*
+    Channel positions of our sink and of the filters in the output pipeline. FL and FR always come first. It is
+    chosen at startup and only differs from stereo when surround output is enabled. The sink and the plugin ports are
+    built with it, so a different layout needs a restart. The application does it when select_output_channels stops
+    matching this.
+  */
+
+  std::vector<std::string> output_channels = {"FL", "FR"};
+
   constexpr static auto blocklist_node_name =
       std::to_array({"Easy Effects", "EasyEffects", "easyeffects", "easyeffects_soe", "easyeffects_sie",
                      "EasyEffectsWebrtcProbe", "libcanberra", "gsd-media-keys", "GNOME Shell", "speech-dispatcher",
@@ -90,6 +117,32 @@ class PipeManager {
 
   auto node_map_at_id(const uint& id) -> NodeInfo&;
 
+  // The node with the lowest serial among the ones with this name, or nullptr.
+  auto find_node_by_name(const std::string& name) -> NodeInfo*;
+
+  /*
+    The layout output_channels should have for the current output device and surround setting. Empty while the
+    surround output is enabled and the device is not in the graph yet. Call it with the PipeWire lock held.
+  */
+
+  [[nodiscard]] auto select_output_channels() const -> std::vector<std::string>;
+
+  [[nodiscard]] auto get_node_ports(const uint& node_id) const -> const std::vector<PortInfo>&;
+
+  [[nodiscard]] auto get_node_link_ids(const uint& node_id) const -> const std::vector<uint>&;
+
+  // Called by the registry handlers in the PipeWire thread.
+
+  void index_node(const NodeInfo& node);
+
+  void unindex_node(const NodeInfo& node);
+
+  void index_link(const LinkInfo& link);
+
+  void unindex_link(const uint& link_id);
+
+  auto intern_channel(const std::string& name) -> uint;
+
   auto stream_is_connected(const uint& id, const std::string& media_class) -> bool;
 
   void connect_stream_output(const uint& id) const;
@@ -113,6 +166,16 @@ class PipeManager {
                   const bool& probe_link = false,
                   const bool& link_passive = true) -> std::vector<pw_proxy*>;
 
+  /*
+    Same as link_nodes but the caller has to hold the thread loop lock. This way many links can be created and
+    destroyed in a single round trip to the server that is finished with sync_wait_unlock.
+  */
+
+  auto link_nodes_locked(const uint& output_node_id,
+                         const uint& input_node_id,
+                         const bool& probe_link = false,
+                         const bool& link_passive = true) -> std::vector<pw_proxy*>;
+
   void destroy_object(const int& id) const;
 
   /*
@@ -121,6 +184,8 @@ class PipeManager {
 
   void destroy_links(const std::vector<pw_proxy*>& list) const;
 
+  static void destroy_links_locked(const std::vector<pw_proxy*>& list);
+
   void lock() const;
 
   void unlock() const;
@@ -129,6 +194,25 @@ class PipeManager {
 
   auto wait_full() const -> int;
 
+  /*
+    Blocks until ready() returns true or the timeout expires. ready() is evaluated with the thread loop locked each time
+    a node, a port or one of our filters changes, so it may read the graph. The caller must not hold the thread loop
+    lock. Returns the last value of ready().
+  */
+
+  auto wait_for(const std::function<bool()>& ready, const std::chrono::milliseconds& timeout) const -> bool;
+
+  // Wakes up the threads blocked in wait_for. It is called from the PipeWire thread.
+  void notify_graph_changed() const;
+
+  /*
+    Records the node_change bits of a node. It is called from the PipeWire thread. The changes made to the same node
+    until the main loop runs again are merged and the *_changed signals are emitted once per node with a snapshot of
+    its NodeInfo and the accumulated bits.
+  */
+
+  void mark_node_changed(const uint64_t& serial, const uint& changes);
+
   static void lock_node_map();
 
   static void unlock_node_map();
@@ -137,8 +221,8 @@ class PipeManager {
 
   sigc::signal<void(const NodeInfo)> stream_output_added;
   sigc::signal<void(const NodeInfo)> stream_input_added;
-  sigc::signal<void(const NodeInfo)> stream_output_changed;
-  sigc::signal<void(const NodeInfo)> stream_input_changed;
+  sigc::signal<void(const NodeInfo, const uint)> stream_output_changed;
+  sigc::signal<void(const NodeInfo, const uint)> stream_input_changed;
   sigc::signal<void(const uint64_t)> stream_output_removed;
   sigc::signal<void(const uint64_t)> stream_input_removed;
 
@@ -147,10 +231,10 @@ class PipeManager {
   */
 
   sigc::signal<void(NodeInfo)> source_added;
-  sigc::signal<void(NodeInfo)> source_changed;
+  sigc::signal<void(NodeInfo, uint)> source_changed;
   sigc::signal<void(NodeInfo)> source_removed;
   sigc::signal<void(NodeInfo)> sink_added;
-  sigc::signal<void(NodeInfo)> sink_changed;
+  sigc::signal<void(NodeInfo, uint)> sink_changed;
   sigc::signal<void(NodeInfo)> sink_removed;
   sigc::signal<void(std::string)> new_default_sink_name;
   sigc::signal<void(std::string)> new_default_source_name;
@@ -165,5 +249,28 @@ class PipeManager {
 
   spa_hook core_listener{}, registry_listener{};
 
+  mutable std::condition_variable_any graph_changed;
+
+  std::unordered_map<std::string, uint> channel_ids = {{"", port_channel::unknown},
+                                                       {"UNK", port_channel::unknown},
+                                                       {"FL", port_channel::fl},
+                                                       {"FR", port_channel::fr},
+                                                       {"PROBE_FL", port_channel::probe_fl},
+                                                       {"PROBE_FR", port_channel::probe_fr}};
+
+  uint next_channel_id = port_channel::probe_fr + 1U;
+
+  std::mutex changes_mutex;
+
+  std::unordered_map<uint64_t, uint> pending_changes;
+
+  bool flush_scheduled = false;
+
+  void flush_node_changes();
+
+  inline static const std::vector<PortInfo> no_ports;
+
+  inline static const std::vector<uint> no_links;
+
   void set_metadata_target_node(const uint& origin_id, const uint& target_id, const uint64_t& target_serial) const;
 };
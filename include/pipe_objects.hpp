@@ -28,6 +28,38 @@
 #include <cstdint>
 #include <string>
 
+enum class PortDirection { unknown, input, output };
+
+/*
+  Audio channel names are interned by PipeManager when the port is registered, so the ports are matched by comparing
+  integers. The names we look for when linking have fixed ids.
+*/
+
+namespace port_channel {
+
+inline constexpr uint unknown = 0U;  // also used for "UNK" and ports without a channel
+inline constexpr uint fl = 1U;
+inline constexpr uint fr = 2U;
+inline constexpr uint probe_fl = 3U;
+inline constexpr uint probe_fr = 4U;
+
+}  // namespace port_channel
+
+// Bits describing what changed in a NodeInfo since the last notification about it.
+
+namespace node_change {
+
+inline constexpr uint state = 1U << 0U;
+inline constexpr uint app_info = 1U << 1U;  // application and media names and icons
+inline constexpr uint format = 1U << 2U;    // sample format, rate and latency
+inline constexpr uint volume = 1U << 3U;
+inline constexpr uint mute = 1U << 4U;
+inline constexpr uint connected = 1U << 5U;
+inline constexpr uint properties = 1U << 6U;  // everything else read from the node properties
+inline constexpr uint all = ~0U;
+
+}  // namespace node_change
+
 struct NodeInfo {
   pw_proxy* proxy = nullptr;
 
@@ -63,6 +95,8 @@ struct NodeInfo {
 
   std::string application_id;
 
+  std::string audio_position;  // channel positions like FL,FR,FC,LFE,RL,RR
+
   int priority = -1;
 
   pw_node_state state = PW_NODE_STATE_IDLE;
@@ -113,7 +147,9 @@ struct PortInfo {
 
   std::string name;
 
-  std::string direction;
+  PortDirection direction = PortDirection::unknown;
+
+  uint channel_id = port_channel::unknown;
 
   bool physical = false;
 
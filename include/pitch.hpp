@@ -20,13 +20,15 @@
 #pragma once
 
 #include <STTypes.h>
-#include <deque>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <vector>
 #include "SoundTouch.h"
+#include "block_adapter.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "rt_state.hpp"
 
 class Pitch : public PluginBase {
  public:
@@ -49,6 +51,8 @@ class Pitch : public PluginBase {
 
   void setup() override;
 
+  void setup_engine(const uint& n_samples, const uint& rate) override;
+
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -57,16 +61,38 @@ class Pitch : public PluginBase {
   auto get_latency_seconds() -> float override;
 
  private:
-  bool soundtouch_ready = false;
+  struct Params {
+    double total_semitones = 0.0;
+
+    double tempo_difference = 0.0;
+
+    double rate_difference = 0.0;
+  };
+
+  struct Engine {
+    uint n_samples = 0U;
+    uint rate = 0U;
+
+    soundtouch::SoundTouch snd_touch;
+
+    std::vector<float> received_L, received_R;
+
+    RingBuffer fifo_out_L, fifo_out_R;
+  };
+
   bool notify_latency = false;
 
   uint latency_n_frames = 0U;
 
-  std::vector<float> data_L, data_R, data;
+  uint64_t params_generation = 0U;
+
+  uint64_t engine_generation = 0U;
 
-  std::deque<float> deque_out_L, deque_out_R;
+  std::vector<float> data;
 
-  soundtouch::SoundTouch* snd_touch = nullptr;
+  RtState<Params> params;
+
+  RtState<Engine> engine;
 
   bool anti_alias = false;
   bool quick_seek = false;
@@ -81,13 +107,8 @@ class Pitch : public PluginBase {
   double tempo_difference = 0.0;
   double rate_difference = 0.0;
 
-  void update_pitch();
-  void set_sequence_length();
-  void set_seek_window();
-  void set_overlap_length();
-  void set_quick_seek();
-  void set_anti_alias();
-  void set_tempo_difference();
-  void set_rate_difference();
-  void init_soundtouch();
+  void publish_params();
+  void init_soundtouch(const uint& n_samples, const uint& rate);
+
+  void rebuild() override;
 };
@@ -25,16 +25,20 @@
 #include <sigc++/signal.h>
 #include <spa/utils/hook.h>
 #include <sys/types.h>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <initializer_list>
 #include <memory>
-#include <mutex>
 #include <span>
 #include <string>
 #include <vector>
 #include "lv2_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "pipeline_type.hpp"
+#include "rt_state.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 class PluginBase {
@@ -60,16 +64,15 @@ class PluginBase {
   };
 
   struct data {
-    struct port* in_left = nullptr;
-    struct port* in_right = nullptr;
-
-    struct port* out_left = nullptr;
-    struct port* out_right = nullptr;
+    std::vector<struct port*> in;  // one port per entry of channels
+    std::vector<struct port*> out;
 
     struct port* probe_left = nullptr;
     struct port* probe_right = nullptr;
 
     PluginBase* pb = nullptr;
+
+    PipeManager* pm = nullptr;
   };
 
   const std::string log_tag;
@@ -90,10 +93,36 @@ class PluginBase {
 
   uint rate = 0U;
 
+  /*
+    Channel positions of our ports. FL and FR always come first. Output pipelines follow the layout chosen by
+    PipeManager and input pipelines are always stereo.
+  */
+
+  std::vector<std::string> channels;
+
+  /*
+    The buffers that follow the quantum reserve this size when the plugin is created, so that a quantum change does not
+    allocate in the realtime thread. It is also the maxBlockLength given to the LV2 plugins. PipeWire only goes beyond
+    it when clock.quantum-limit is raised, and then the first cycle with the larger quantum allocates.
+  */
+
+  static constexpr uint max_quantum = 8192U;
+
   bool package_installed = true;
 
+  /*
+    bypass is what the realtime thread does and bypass_requested is the value of the settings. Turning the bypass on
+    first ramps the output to the input and then sets bypass. Turning it off clears bypass at once and ramps back.
+  */
+
   std::atomic<bool> bypass = {false};
 
+  std::atomic<bool> bypass_requested = {false};
+
+  // Written by the main thread. Bypassed without latency to compensate, so the hosts can leave it out of the chain.
+
+  std::atomic<bool> routed_around = {false};
+
   bool connected_to_pw = false;
 
   bool send_notifications = false;
@@ -104,30 +133,98 @@ class PluginBase {
 
   float latency_value = 0.0F;  // seconds
 
-  std::chrono::time_point<std::chrono::system_clock> clock_start;
+  std::chrono::time_point<std::chrono::steady_clock> clock_start;
 
   std::vector<float> dummy_left, dummy_right;
 
+  std::vector<float> dummy_surround;  // channels beyond the front pair, one block of n_samples each
+
+  std::vector<std::span<float>> in_spans, out_spans;  // filled by the PipeWire process callback
+
+  /*
+    Execution time of the processing cycle relative to the quantum duration n_samples / rate. A value above 1 means
+    that this plugin alone used more time than the graph had for the whole cycle.
+  */
+
+  struct DspLoad {
+    float min = 0.0F;
+    float avg = 0.0F;
+    float max = 0.0F;
+    float p99 = 0.0F;
+
+    float peak = 0.0F;  // largest value since the plugin was created
+
+    uint64_t overruns = 0U;  // cycles above the quantum duration since the plugin was created
+  };
+
   [[nodiscard]] auto get_node_id() const -> uint;
 
+  [[nodiscard]] auto get_dsp_load() const -> DspLoad;
+
   void set_active(const bool& state) const;
 
   void set_post_messages(const bool& state);
 
   auto connect_to_pw() -> bool;
 
+  /*
+    connect_to_pw in two steps. Connecting many filters with begin_connect_to_pw before calling finish_connect_to_pw
+    on them lets PipeWire create all their nodes and ports at the same time.
+  */
+
+  auto begin_connect_to_pw() -> bool;
+
+  // Waits until the node and all the ports of the filter are in the graph.
+  auto finish_connect_to_pw() -> bool;
+
   void disconnect_from_pw();
 
   void reset_settings();
 
+  /*
+    Main thread. A frozen instance ignores the changes of its settings and keeps processing with the values it had.
+    This is what the instances replaced by a chain crossfade do, so that the fade goes from the old values to the new
+    ones. thaw_settings applies the changes made in the meantime.
+  */
+
+  void freeze_settings();
+
+  void thaw_settings();
+
   void show_native_ui();
 
   void close_native_ui();
 
   void set_native_ui_update_frequency(const uint& value);
 
+  /*
+    Called before and after every processing cycle. Our PipeWire process callback uses them and so does the fused
+    chain, that runs plugins without their own filter node.
+  */
+
+  void begin_cycle(const uint& quantum, const uint& sampling_rate);
+
+  void end_cycle();
+
   virtual void setup();
 
+  /*
+    Main thread. Builds the state that allocates, like engines, resamplers and meters, for a new quantum or sampling
+    rate. begin_cycle only records the request and the call happens in the next drain_telemetry or in prepare.
+  */
+
+  virtual void setup_engine(const uint& n_samples, const uint& rate);
+
+  /*
+    Main thread. Sets up a plugin that no thread processes yet for the given quantum and rate, so that LV2 instances
+    are activated and engines are scheduled before its first cycle. is_ready() tells when the plugin is done with it
+    and does not pass the audio through anymore.
+  */
+
+  void prepare(const uint& quantum, const uint& sampling_rate);
+
+  [[nodiscard]] virtual auto is_ready() -> bool;
+
   virtual void process(std::span<float>& left_in,
                        std::span<float>& right_in,
                        std::span<float>& left_out,
@@ -140,17 +237,55 @@ class PluginBase {
                        std::span<float>& probe_left,
                        std::span<float>& probe_right);
 
+  /*
+    Used when there are more than two channels. The default implementation processes the front pair with the stereo
+    process method. LV2 plugins run the remaining channels through extra instances of the plugin and the others pass
+    them through. Plugins that can handle every channel override it.
+  */
+
+  virtual void process_channels(std::span<std::span<float>> in, std::span<std::span<float>> out);
+
+  /*
+    Realtime thread. The hosts run the plugin through these between begin_cycle and end_cycle. A bypass toggle is a
+    linear crossfade of bypass_ramp_ms between the output of the plugin and its input delayed by the plugin latency.
+    A bypassed plugin with latency keeps delaying its input by it, so the latency of the chain does not change.
+  */
+
+  void run(std::span<float> left_in, std::span<float> right_in, std::span<float> left_out, std::span<float> right_out);
+
+  void run(std::span<std::span<float>> in,
+           std::span<std::span<float>> out,
+           std::span<float> probe_left,
+           std::span<float> probe_right);
+
+  void run_channels(std::span<std::span<float>> in, std::span<std::span<float>> out);
+
+  /*
+    Realtime thread. Copies the channels beyond the front pair to the output. When the plugin has latency they are
+    delayed by it, so that they stay aligned with the front pair.
+  */
+
+  void pass_through_surround(std::span<std::span<float>> in, std::span<std::span<float>> out);
+
   virtual void update_probe_links();
 
   virtual auto get_latency_seconds() -> float;
 
+  /*
+    Called periodically by the pipeline in the main thread. The records posted by the realtime thread since the last
+    call are reduced to the latest value of each meter and the signals below are emitted from this snapshot. Engine
+    setups and latency changes requested by the realtime thread are also handled here.
+  */
+
+  void drain_telemetry();
+
   sigc::signal<void(const float, const float)> input_level;
   sigc::signal<void(const float, const float)> output_level;
   sigc::signal<void()> latency;
+  sigc::signal<void()> bypass_changed;
+  sigc::signal<void(const DspLoad)> dsp_load;  // statistics of the last notification window
 
  protected:
-  std::mutex data_mutex;
-
   GSettings *settings = nullptr, *global_settings = nullptr;
 
   PipeManager* pm = nullptr;
@@ -168,14 +303,46 @@ class PluginBase {
 
   std::unique_ptr<lv2::Lv2Wrapper> lv2_wrapper;
 
+  bool lv2_ready = false;  // realtime thread. The LV2 instance is set up for the quantum and rate of this cycle.
+
   std::vector<gulong> gconnections;
 
+  // The settings objects the parameters are read from. Plugins with settings besides the main one override it.
+
+  virtual auto parameter_settings() -> std::vector<GSettings*>;
+
   void setup_input_output_gain();
 
   void initialize_listener();
 
   void notify();
 
+  // Realtime thread only. The record is copied to a lock-free ring. Nothing is allocated and no signal is emitted.
+
+  void post_meter(const uint16_t& id, std::span<const float> values = {});
+
+  void post_meter(const uint16_t& id, std::initializer_list<float> values) {
+    post_meter(id, std::span<const float>(values.begin(), values.size()));
+  }
+
+  // Main thread only. Plugins with their own meters override it and hand the other ids to this implementation.
+
+  virtual void on_meter(const telemetry::Record& record);
+
+  // Realtime thread only. The main thread logs the new latency_value and updates the node latency param.
+
+  void post_latency();
+
+  /*
+    Settings handlers that rebuild heavy state, like engines, kernels and models, call schedule_rebuild instead of
+    doing the work at once. rebuild() then runs a single time from the main loop, no matter how many keys changed
+    together. This is what happens when a preset is loaded.
+  */
+
+  void schedule_rebuild();
+
+  virtual void rebuild();
+
   void get_peaks(const std::span<float>& left_in,
                  const std::span<float>& right_in,
                  std::span<float>& left_out,
@@ -188,6 +355,134 @@ class PluginBase {
  private:
   uint node_id = 0U;
 
+  std::string node_description;
+
+  void create_filter();
+
+  guint rebuild_source_id = 0U;
+
   float input_peak_left = util::minimum_linear_level, input_peak_right = util::minimum_linear_level;
   float output_peak_left = util::minimum_linear_level, output_peak_right = util::minimum_linear_level;
+
+  // dsp load. The window values are only touched by the processing thread.
+
+  static constexpr uint load_histogram_size = 201U;  // 1% bins up to twice the quantum duration
+
+  std::chrono::time_point<std::chrono::steady_clock> cycle_start;
+
+  std::array<uint, load_histogram_size> load_histogram{};
+
+  uint load_cycles = 0U;
+
+  float load_sum = 0.0F, load_min = 0.0F, load_max = 0.0F;
+
+  std::atomic<float> load_min_value = 0.0F, load_avg_value = 0.0F, load_max_value = 0.0F, load_p99_value = 0.0F,
+                     load_peak_value = 0.0F;
+
+  std::atomic<uint64_t> load_overruns = 0U;
+
+  telemetry::Ring<telemetry::Record, 256U> telemetry_ring;
+
+  std::array<telemetry::Record, telemetry::max_meters> telemetry_snapshot{};
+
+  std::atomic<bool> latency_changed = {false};
+
+  std::atomic<uint64_t> pending_setup = 0U;  // quantum in the high half and rate in the low half
+
+  /*
+    The LV2 instance is created and resized in the main thread. The realtime thread only runs it in a cycle whose
+    quantum and rate match lv2_ready_for, and lv2_in_use tells the main thread that such a cycle may be running.
+  */
+
+  std::atomic<uint64_t> pending_lv2_setup = 0U;
+
+  std::atomic<uint64_t> lv2_ready_for = 0U;
+
+  std::atomic<bool> lv2_in_use = {false};
+
+  void setup_lv2();
+
+  /*
+    Instances of the LV2 plugin for the channels beyond the front pair. Left and right surround channels share an
+    instance. A channel without a partner, like FC or LFE, runs alone with silence on the other input.
+  */
+
+  struct SurroundLv2 {
+    struct Unit {
+      std::unique_ptr<lv2::Lv2Wrapper> instance;
+
+      size_t left = 0U, right = 0U;  // equal when the channel runs alone
+    };
+
+    uint n_samples = 0U;
+
+    uint rate = 0U;
+
+    std::vector<Unit> units;
+
+    std::vector<float> silence, discard;
+  };
+
+  RtState<SurroundLv2> surround_lv2;
+
+  /*
+    One delay line of the plugin latency per channel, built by the main thread whenever latency_value or the rate
+    changes. The realtime thread feeds them every cycle and gets the input aligned with the output of the plugin.
+  */
+
+  struct LatencyDelay {
+    uint n_frames = 0U;
+
+    size_t position = 0U;  // only touched by the realtime thread
+
+    std::vector<std::vector<float>> lines;
+  };
+
+  RtState<LatencyDelay> latency_delay;
+
+  static constexpr uint bypass_ramp_ms = 20U;
+
+  // Realtime thread only. bypass_mix is 1 for the output of the plugin and 0 for the delayed input.
+
+  float bypass_mix = 1.0F;
+
+  bool bypass_ramping = false, dry_ready = false;
+
+  std::vector<float> delayed_dry;  // all channels, one block of n_samples each
+
+  std::vector<std::span<float>> dry_spans;
+
+  std::atomic<bool> bypass_settled = {false};  // the realtime thread finished a ramp to the input
+
+  gint64 bypass_request_time = 0;  // main thread
+
+  auto begin_bypass_ramp(std::span<std::span<float>> in, std::span<std::span<float>> out) -> bool;
+
+  void end_bypass_ramp(std::span<std::span<float>> out);
+
+  void update_bypass();
+
+  void update_routing();
+
+  bool settings_frozen = false;
+
+  struct FrozenValue {
+    GSettings* settings = nullptr;
+
+    std::string key;
+
+    GVariant* value = nullptr;
+  };
+
+  std::vector<FrozenValue> frozen_values;
+
+  void run_pending_setup();
+
+  void setup_surround_lv2(const uint& n_samples, const uint& rate);
+
+  void setup_latency_delay();
+
+  void record_load(const float& load);
+
+  void publish_load();
 };
@@ -51,7 +51,12 @@ class PluginPresetBase {
     }
   }
 
-  void read(const nlohmann::json& json) {
+  /*
+    Writes the preset values to a delayed GSettings. The plugin only sees them when apply() is called, and they are
+    discarded if this object is destroyed before that.
+  */
+
+  void stage(const nlohmann::json& json) {
     /*
       Old presets do not have the filter instance id.
     */
@@ -66,10 +71,10 @@ class PluginPresetBase {
     g_settings_delay(settings);
 
     load(json);
-
-    g_settings_apply(settings);
   }
 
+  void apply() { g_settings_apply(settings); }
+
  protected:
   int index = 0;
 
@@ -54,6 +54,10 @@ class PresetsManager {
   // signal sending title and description strings
   sigc::signal<void(const std::string, const std::string)> preset_load_error;
 
+  // Emitted before the values of a preset are written and after its plugin list was set, even if the load failed.
+  sigc::signal<void(const PresetType&)> preset_load_started;
+  sigc::signal<void(const PresetType&)> preset_load_finished;
+
   auto get_all_community_presets_paths(const PresetType& preset_type) -> std::vector<std::string>;
 
   auto scan_community_package_recursive(std::filesystem::directory_iterator& it,
@@ -20,21 +20,56 @@
 #pragma once
 
 #include <samplerate.h>
+#include <sys/types.h>
 #include <cmath>
+#include <cstddef>
+#include <span>
 #include <vector>
 
 class Resampler {
  public:
+  enum class Quality {
+    fastest,
+    medium,
+    best,
+    polyphase  // fixed ratio windowed sinc. It is used when the reduced ratio is small, like in 44.1 kHz <-> 48 kHz
+  };
+
   Resampler(const int& input_rate, const int& output_rate);
+
+  /*
+    Realtime safe instance. All the memory needed to process up to max_input_frames per call is allocated here, so
+    the process methods never allocate as long as this limit is respected.
+  */
+
+  Resampler(const int& input_rate,
+            const int& output_rate,
+            const uint& channels,
+            const uint& max_input_frames,
+            const Quality& quality = Quality::fastest);
+
   Resampler(const Resampler&) = delete;
   auto operator=(const Resampler&) -> Resampler& = delete;
   Resampler(const Resampler&&) = delete;
   auto operator=(const Resampler&&) -> Resampler& = delete;
   ~Resampler();
 
+  // Mono processing. The output has to be resized when the instance was not created with a maximum block size.
   template <typename T>
   auto process(const T& input, const bool& end_of_input) -> const std::vector<float>& {
-    output.resize(std::ceil(1.5 * resample_ratio * input.size()));
+    const auto n_out = static_cast<size_t>(std::ceil(1.5 * resample_ratio * input.size()));
+
+    if (max_input_frames == 0U || n_out > output.capacity()) {
+      output.resize(n_out);
+    } else {
+      output.resize(output.capacity());
+    }
+
+    if (polyphase) {
+      output.resize(process_polyphase(input.data(), input.size(), output.data(), output.size()));
+
+      return output;
+    }
 
     // The number of frames of data pointed to by data_in
     src_data.input_frames = input.size();
@@ -61,7 +96,32 @@ class Resampler {
     return output;
   }
 
+  /*
+    Interleaved processing of all channels. Returns the number of frames written to the output. An output with room
+    for get_max_output_frames() always takes all the input. The polyphase path keeps the input that did not fit in a
+    shorter output for the next call.
+  */
+  auto process_interleaved(std::span<const float> input, std::span<float> output) -> size_t;
+
+  // Planar stereo processing with a single state. Returns the number of frames written to each output.
+  auto process(std::span<const float> left_in,
+               std::span<const float> right_in,
+               std::span<float> left_out,
+               std::span<float> right_out) -> size_t;
+
+  // The largest number of frames a call may give when the input has max_input_frames.
+  [[nodiscard]] auto get_max_output_frames() const -> size_t { return max_output_frames; }
+
+  // Delay added by the polyphase filter. libsamplerate does not report it.
+  [[nodiscard]] auto get_latency_frames() const -> uint { return polyphase ? taps_per_phase / 2U : 0U; }
+
  private:
+  bool polyphase = false;
+
+  uint n_channels = 1U;
+
+  size_t max_input_frames = 0U, max_output_frames = 0U;
+
   double resample_ratio = 1.0;
 
   SRC_STATE* src_state = nullptr;
@@ -69,4 +129,26 @@ class Resampler {
   SRC_DATA src_data{};
 
   std::vector<float> output;
+
+  std::vector<float> interleaved_in, interleaved_out;
+
+  // polyphase state
+
+  static constexpr uint taps_per_phase = 32U;
+
+  uint up_factor = 1U, down_factor = 1U;
+
+  uint phase = 0U;
+
+  size_t position = 0U;  // index of the newest input sample used by the next output
+
+  size_t n_buffered = 0U;  // frames in the history, the filter memory plus the input not used yet
+
+  std::vector<float> coefficients;  // taps_per_phase values for each phase
+
+  std::vector<float> history;  // interleaved, (taps_per_phase - 1 + 2 * max_input_frames) frames
+
+  void init_polyphase(const int& input_rate, const int& output_rate);
+
+  auto process_polyphase(const float* input, const size_t& n_frames, float* out, const size_t& out_capacity) -> size_t;
 };
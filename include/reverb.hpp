@@ -37,8 +37,6 @@ class Reverb : public PluginBase {
   auto operator=(const Reverb&&) -> Reverb& = delete;
   ~Reverb() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <climits>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <span>
 #include <string>
@@ -33,9 +34,10 @@
 #include <rnnoise.h>
 #endif
 
-#include <deque>
+#include "block_adapter.hpp"
 #include "plugin_base.hpp"
 #include "resampler.hpp"
+#include "rt_state.hpp"
 
 class RNNoise : public PluginBase {
  public:
@@ -52,6 +54,10 @@ class RNNoise : public PluginBase {
 
   void setup() override;
 
+  void setup_engine(const uint& n_samples, const uint& rate) override;
+
+  auto is_ready() -> bool override;
+
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -74,13 +80,39 @@ class RNNoise : public PluginBase {
   sigc::signal<void(const bool load_error)> model_changed;
 
  private:
+  struct Engine {
+    Engine() = default;
+    Engine(const Engine&) = delete;
+    auto operator=(const Engine&) -> Engine& = delete;
+    Engine(const Engine&&) = delete;
+    auto operator=(const Engine&&) -> Engine& = delete;
+    ~Engine();
+
+    uint n_samples = 0U;
+    uint rate = 0U;
+
+    std::unique_ptr<Resampler> resampler_in, resampler_out;
+
+    BlockAdapter adapter;
+
+    std::vector<float> resampled_L, resampled_R;
+    std::vector<float> denoised_L, denoised_R;
+    std::vector<float> output_L, output_R;
+
+    RingBuffer fifo_out_L, fifo_out_R;
+
+#ifdef ENABLE_RNNOISE
+    RNNModel* model = nullptr;
+
+    DenoiseState *state_left = nullptr, *state_right = nullptr;
+#endif
+  };
+
   std::string local_dir_rnnoise;
   std::vector<std::string> system_data_dir_rnnoise;
 
   bool resample = false;
   bool notify_latency = false;
-  bool rnnoise_ready = false;
-  bool resampler_ready = false;
   bool enable_vad = false;
 
   uint blocksize = 480U;
@@ -93,117 +125,25 @@ class RNNoise : public PluginBase {
 
   const float inv_short_max = 1.0F / (SHRT_MAX + 1.0F);
 
-  std::deque<float> deque_out_L, deque_out_R;
+  std::vector<float> data_tmp;
 
-  std::vector<float> data_L, data_R, data_tmp;
-  std::vector<float> resampled_data_L, resampled_data_R;
+  uint64_t engine_generation = 0U;
 
-  std::unique_ptr<Resampler> resampler_inL, resampler_outL;
-  std::unique_ptr<Resampler> resampler_inR, resampler_outR;
+  RtState<Engine> engine;
 
-#ifdef ENABLE_RNNOISE
+  void init_engine(const uint& n_samples, const uint& rate);
 
-  RNNModel* model = nullptr;
+  void rebuild() override;
 
-  DenoiseState *state_left = nullptr, *state_right = nullptr;
+#ifdef ENABLE_RNNOISE
 
   float vad_prob_left, vad_prob_right;
   int vad_grace_left, vad_grace_right;
 
   auto get_model_from_name() -> RNNModel*;
 
-  void free_rnnoise();
-
-  template <typename T1, typename T2>
-  void remove_noise(const T1& left_in, const T1& right_in, T2& out_L, T2& out_R) {
-    for (const auto& v : left_in) {
-      data_L.push_back(v);
-
-      if (data_L.size() == blocksize) {
-        if (state_left != nullptr) {
-          std::ranges::for_each(data_L, [](auto& v) { v *= static_cast<float>(SHRT_MAX + 1); });
-
-          data_tmp = data_L;
-
-          vad_prob_left = rnnoise_process_frame(state_left, data_L.data(), data_L.data());
-
-          if (enable_vad) {
-            if (vad_prob_left >= vad_thres) {
-              vad_grace_left = release;
-            }
-
-            if (vad_grace_left >= 0) {
-              --vad_grace_left;
-
-              for (size_t i = 0U; i < data_L.size(); i++) {
-                data_L[i] = data_L[i] * wet_ratio + data_tmp[i] * (1.0F - wet_ratio);
-
-                data_L[i] *= inv_short_max;
-              }
-            } else {
-              std::ranges::for_each(data_L, [&](auto& v) { v = 0.0F; });
-            }
-          } else {
-            for (size_t i = 0U; i < data_L.size(); i++) {
-              data_L[i] = data_L[i] * wet_ratio + data_tmp[i] * (1.0F - wet_ratio);
-
-              data_L[i] *= inv_short_max;
-            }
-          }
-        }
-
-        for (const auto& v : data_L) {
-          out_L.push_back(v);
-        }
-
-        data_L.resize(0U);
-      }
-    }
-
-    for (const auto& v : right_in) {
-      data_R.push_back(v);
-
-      if (data_R.size() == blocksize) {
-        if (state_right != nullptr) {
-          std::ranges::for_each(data_R, [](auto& v) { v *= static_cast<float>(SHRT_MAX + 1); });
-
-          data_tmp = data_R;
-
-          vad_prob_right = rnnoise_process_frame(state_right, data_R.data(), data_R.data());
-
-          if (enable_vad) {
-            if (vad_prob_right >= vad_thres) {
-              vad_grace_right = release;
-            }
-
-            if (vad_grace_right >= 0) {
-              --vad_grace_right;
-
-              for (size_t i = 0U; i < data_R.size(); i++) {
-                data_R[i] = data_R[i] * wet_ratio + data_tmp[i] * (1.0F - wet_ratio);
-
-                data_R[i] *= inv_short_max;
-              }
-            } else {
-              std::ranges::for_each(data_R, [&](auto& v) { v = 0.0F; });
-            }
-          } else {
-            for (size_t i = 0U; i < data_R.size(); i++) {
-              data_R[i] = data_R[i] * wet_ratio + data_tmp[i] * (1.0F - wet_ratio);
-
-              data_R[i] *= inv_short_max;
-            }
-          }
-        }
-
-        for (const auto& v : data_R) {
-          out_R.push_back(v);
-        }
-
-        data_R.resize(0U);
-      }
-    }
-  }
+  // Denoises one block of blocksize samples in place.
+  void remove_noise(DenoiseState* state, std::span<float> data, float& vad_prob, int& vad_grace);
 
 #endif
 };
@@ -0,0 +1,187 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/*
+  Publishes data built in the main thread to the realtime thread without locks.
+
+  The main thread builds a new T and calls publish(). The previous value is retired and deleted later, once the
+  realtime thread is not reading it anymore. The realtime thread calls read() at the beginning of its processing cycle
+  and keeps the returned Reader alive while it uses the data. Reading never blocks and never allocates.
+
+  Only one thread may read a given RtState. Every PluginBase is processed by a single PipeWire data thread, so this is
+  enough for us. The values may be modified by the reader as long as the main thread does not touch them after they
+  were published. Readers may be nested. The inner ones get the value of the outermost one, which stays protected
+  until it is destroyed.
+*/
+
+template <typename T>
+class RtState {
+ private:
+  struct Slot {
+    std::unique_ptr<T> value;
+
+    uint64_t generation = 0U;
+  };
+
+ public:
+  RtState() = default;
+  RtState(const RtState&) = delete;
+  auto operator=(const RtState&) -> RtState& = delete;
+  RtState(const RtState&&) = delete;
+  auto operator=(const RtState&&) -> RtState& = delete;
+
+  ~RtState() {
+    if (reclaim_source_id != 0U) {
+      g_source_remove(reclaim_source_id);
+    }
+
+    delete current.exchange(nullptr);
+  }
+
+  class Reader {
+   public:
+    explicit Reader(RtState& rt_state) : owner(rt_state) {
+      if (owner.n_readers++ != 0U) {
+        slot = owner.hazard.load();
+
+        return;
+      }
+
+      auto* s = owner.current.load();
+
+      while (true) {
+        owner.hazard.store(s);
+
+        auto* again = owner.current.load();
+
+        if (again == s) {
+          break;
+        }
+
+        s = again;
+      }
+
+      slot = s;
+    }
+
+    Reader(const Reader&) = delete;
+    auto operator=(const Reader&) -> Reader& = delete;
+    Reader(const Reader&&) = delete;
+    auto operator=(const Reader&&) -> Reader& = delete;
+
+    ~Reader() {
+      if (--owner.n_readers == 0U) {
+        owner.hazard.store(nullptr);
+      }
+    }
+
+    explicit operator bool() const { return slot != nullptr && slot->value != nullptr; }
+
+    auto operator->() const -> T* { return slot->value.get(); }
+
+    auto operator*() const -> T& { return *slot->value; }
+
+    [[nodiscard]] auto get() const -> T* { return (slot != nullptr) ? slot->value.get() : nullptr; }
+
+    // Changes every time a new value is published. Zero means nothing was published yet.
+    [[nodiscard]] auto generation() const -> uint64_t { return (slot != nullptr) ? slot->generation : 0U; }
+
+   private:
+    RtState& owner;
+
+    Slot* slot = nullptr;
+  };
+
+  // Realtime thread only.
+  auto read() -> Reader { return Reader(*this); }
+
+  // Main thread only. A null value is allowed and makes the reader see an empty state.
+  void publish(std::unique_ptr<T> value) {
+    auto* slot = new Slot{.value = std::move(value), .generation = ++n_published};
+
+    auto* old = current.exchange(slot);
+
+    if (old != nullptr) {
+      retired.emplace_back(old);
+    }
+
+    reclaim();
+  }
+
+  // Main thread only. It is useful when the main thread needs a consistent copy to build the next state from.
+  [[nodiscard]] auto peek() const -> const T* {
+    auto* slot = current.load();
+
+    return (slot != nullptr) ? slot->value.get() : nullptr;
+  }
+
+ private:
+  std::atomic<Slot*> current = nullptr;
+
+  std::atomic<Slot*> hazard = nullptr;
+
+  uint n_readers = 0U;  // only touched by the reader thread
+
+  std::vector<std::unique_ptr<Slot>> retired;
+
+  uint64_t n_published = 0U;
+
+  guint reclaim_source_id = 0U;
+
+  void reclaim() {
+    auto* in_use = hazard.load();
+
+    std::erase_if(retired, [&](const auto& slot) { return slot.get() != in_use; });
+
+    if (retired.empty() || reclaim_source_id != 0U) {
+      return;
+    }
+
+    // The realtime thread is still using a retired value. It will be done with it in one processing cycle.
+
+    reclaim_source_id = g_timeout_add(
+        100U,
+        (GSourceFunc) +
+            [](RtState* self) {
+              auto* in_use = self->hazard.load();
+
+              std::erase_if(self->retired, [&](const auto& slot) { return slot.get() != in_use; });
+
+              if (!self->retired.empty()) {
+                return G_SOURCE_CONTINUE;
+              }
+
+              self->reclaim_source_id = 0U;
+
+              return G_SOURCE_REMOVE;
+            },
+        this);
+  }
+};
@@ -22,8 +22,9 @@
 #include <fftw3.h>
 #include <sigc++/signal.h>
 #include <sys/types.h>
+#include <array>
 #include <atomic>
-#include <deque>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <vector>
@@ -52,36 +53,73 @@ class Spectrum : public PluginBase {
 
   auto get_latency_seconds() -> float override;
 
-  std::tuple<uint, uint, double*> compute_magnitudes();  // rate, nbands, magnitudes
+  /*
+    Called by the GUI thread. set_display_axis gives the frequencies of the chart points. compute_magnitudes fills one
+    power value per point and returns false when less than one hop of new audio arrived since the last call.
+  */
 
- private:
-  std::atomic<bool> fftw_ready = false;
-
-  fftwf_plan plan = nullptr;
+  void set_display_axis(const std::vector<double>& frequencies);
 
-  fftwf_complex* complex_output = nullptr;
+  auto compute_magnitudes(std::vector<double>& magnitudes) -> bool;
 
-  static constexpr uint n_bands = 8192U;
+ private:
+  static constexpr uint max_fft_size = 32768U;
+  static constexpr uint ring_size = 2U * max_fft_size;  // room for the RT thread to write while we read a window
 
-  std::array<float, n_bands> real_input;
-  std::array<double, n_bands / 2U + 1U> output;
+  // values written by the processing thread
 
   std::vector<float> left_delayed_vector;
   std::vector<float> right_delayed_vector;
   std::span<float> left_delayed;
   std::span<float> right_delayed;
 
-  std::array<float, n_bands> latest_samples_mono;
+  std::array<std::atomic<float>, ring_size> ring;
+
+  std::atomic<uint64_t> ring_written = 0U;  // total number of mono samples written to the ring
+
+  std::atomic<uint64_t> ring_claimed = 0U;  // ring_written plus the block being written
+
+  // values only touched by the GUI thread
+
+  uint fft_size = 8192U;
+  uint hop = 2048U;
+
+  bool log_binning = true;
+
+  uint64_t last_analyzed = 0U;
+
+  fftwf_plan plan = nullptr;  // owned by fft_plans
 
-  std::array<float, n_bands> hann_window;
+  float* real_input = nullptr;
 
-  enum {
-    DB_BIT_IDX = (1 << 0),      // To which db_buffers array process() should write.
-    DB_BIT_NEWDATA = (1 << 1),  // If new data has been written by process().
-    DB_BIT_BUSY = (1 << 2),     // If process() is currently writing data.
+  fftwf_complex* complex_output = nullptr;
+
+  std::vector<float> hann_window;
+
+  std::vector<double> power;
+
+  /*
+    For every display point either the two bins used in the linear interpolation or the range of bins averaged in the
+    logarithmic band around it.
+  */
+
+  struct DisplayPoint {
+    uint first = 0U;
+    uint last = 0U;
+    float fraction = 0.0F;
+    bool band = false;
   };
 
-  std::array<std::array<float, n_bands>, 2> db_buffers;
-  std::atomic<int> db_control = {0};
-  static_assert(std::atomic<int>::is_always_lock_free);
+  std::vector<double> display_axis;
+
+  std::vector<DisplayPoint> display_map;
+
+  uint map_rate = 0U;
+  uint map_fft_size = 0U;
+
+  void init_fft(const uint& size);
+
+  void update_hop(const int& overlap);
+
+  void build_display_map(const uint& sampling_rate);
 };
@@ -23,11 +23,13 @@
 #include <speex/speexdsp_config_types.h>
 #include <sys/types.h>
 #include <climits>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <vector>
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
+#include "rt_state.hpp"
 
 class Speex : public PluginBase {
  public:
@@ -44,6 +46,8 @@ class Speex : public PluginBase {
 
   void setup() override;
 
+  void setup_engine(const uint& n_samples, const uint& rate) override;
+
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -52,18 +56,49 @@ class Speex : public PluginBase {
   auto get_latency_seconds() -> float override;
 
  private:
-  bool speex_ready = false;
+  struct Params {
+    int enable_denoise = 0;
+    int noise_suppression = -15;
+    int enable_agc = 0;
+    int enable_vad = 0;
+    int vad_probability_start = 95;
+    int vad_probability_continue = 90;
+    int enable_dereverb = 0;
+  };
+
+  struct Engine {
+    Engine() = default;
+    Engine(const Engine&) = delete;
+    auto operator=(const Engine&) -> Engine& = delete;
+    Engine(const Engine&&) = delete;
+    auto operator=(const Engine&&) -> Engine& = delete;
+    ~Engine();
+
+    uint n_samples = 0U;
+
+    uint rate = 0U;
+
+    std::vector<spx_int16_t> data_L, data_R;
+
+    SpeexPreprocessState *state_left = nullptr, *state_right = nullptr;
+
+    void apply(Params& p) const;
+  };
 
   int enable_denoise = 0, noise_suppression = -15, enable_agc = 0, enable_vad = 0, vad_probability_start = 95,
       vad_probability_continue = 90, enable_dereverb = 0;
 
   uint latency_n_frames = 0U;
 
+  uint64_t params_generation = 0U;
+
+  uint64_t engine_generation = 0U;
+
   const float inv_short_max = 1.0F / (SHRT_MAX + 1);
 
-  std::vector<spx_int16_t> data_L, data_R;
+  RtState<Params> params;
 
-  SpeexPreprocessState *state_left = nullptr, *state_right = nullptr;
+  RtState<Engine> engine;
 
-  void free_speex();
+  void publish_params();
 };
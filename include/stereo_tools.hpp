@@ -37,8 +37,6 @@ class StereoTools : public PluginBase {
   auto operator=(const StereoTools&&) -> StereoTools& = delete;
   ~StereoTools() override;
 
-  void setup() override;
-
   void process(std::span<float>& left_in,
                std::span<float>& right_in,
                std::span<float>& left_out,
@@ -32,7 +32,7 @@ class StreamInputEffects : public EffectsBase {
   auto operator=(const StreamInputEffects&&) -> StreamInputEffects& = delete;
   ~StreamInputEffects() override;
 
-  void set_bypass(const bool& state);
+  void set_bypass(const bool& state) override;
 
   void set_listen_to_mic(const bool& state);
 
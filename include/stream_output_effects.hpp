@@ -32,7 +32,7 @@ class StreamOutputEffects : public EffectsBase {
   auto operator=(const StreamOutputEffects&&) -> StreamOutputEffects& = delete;
   ~StreamOutputEffects() override;
 
-  void set_bypass(const bool& state);
+  void set_bypass(const bool& state) override;
 
  private:
   bool bypass = false;
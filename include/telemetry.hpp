@@ -0,0 +1,101 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace telemetry {
+
+/*
+  Meters are identified by a small number. The first ones are shared by every plugin and each plugin numbers its own
+  meters from first_plugin_meter.
+*/
+
+inline constexpr uint16_t input_level_meter = 0U;
+inline constexpr uint16_t output_level_meter = 1U;
+inline constexpr uint16_t dsp_load_meter = 2U;
+
+inline constexpr uint16_t first_plugin_meter = 3U;
+
+inline constexpr uint16_t max_meters = 16U;
+
+inline constexpr size_t max_values = 8U;
+
+struct Record {
+  uint16_t id = 0U;
+
+  uint16_t size = 0U;
+
+  std::array<float, max_values> values{};
+};
+
+/*
+  Wait-free ring with a single producer and a single consumer. The realtime thread pushes meter records and the main
+  thread pops them. When the ring is full new records are dropped instead of making the producer wait.
+*/
+
+template <typename T, size_t capacity>
+class Ring {
+  static_assert(std::has_single_bit(capacity), "the ring capacity must be a power of two");
+
+ public:
+  // Producer thread only.
+  auto push(const T& value) -> bool {
+    const auto head = write_index.load(std::memory_order_relaxed);
+
+    if (head - read_index.load(std::memory_order_acquire) == capacity) {
+      return false;
+    }
+
+    buffer[head & (capacity - 1U)] = value;
+
+    write_index.store(head + 1U, std::memory_order_release);
+
+    return true;
+  }
+
+  // Consumer thread only.
+  auto pop(T& value) -> bool {
+    const auto tail = read_index.load(std::memory_order_relaxed);
+
+    if (tail == write_index.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    value = buffer[tail & (capacity - 1U)];
+
+    read_index.store(tail + 1U, std::memory_order_release);
+
+    return true;
+  }
+
+ private:
+  std::array<T, capacity> buffer{};
+
+  alignas(64) std::atomic<size_t> write_index = 0U;
+
+  alignas(64) std::atomic<size_t> read_index = 0U;
+};
+
+}  // namespace telemetry
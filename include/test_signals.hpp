@@ -50,6 +50,8 @@ class TestSignals {
     struct port* out_right = nullptr;
 
     TestSignals* ts = nullptr;
+
+    PipeManager* pm = nullptr;
   };
 
   pw_filter* filter = nullptr;
@@ -0,0 +1,98 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+/*
+  A single pool of worker threads shared by every convolver of the program, so the number of realtime threads does not
+  grow with the number of effects.
+
+  The processing threads submit jobs whose results they need at a known time in the future, like the tail partitions
+  of a long impulse response. Workers always take the queued job with the earliest deadline. When the deadline comes
+  and no worker started the job yet, the processing thread runs it itself. Submitting and waiting never allocate or
+  lock.
+*/
+
+class WorkerPoolJob {
+ public:
+  WorkerPoolJob() = default;
+  WorkerPoolJob(const WorkerPoolJob&) = delete;
+  auto operator=(const WorkerPoolJob&) -> WorkerPoolJob& = delete;
+  WorkerPoolJob(const WorkerPoolJob&&) = delete;
+  auto operator=(const WorkerPoolJob&&) -> WorkerPoolJob& = delete;
+  virtual ~WorkerPoolJob() = default;
+
+  virtual void run() = 0;
+
+  /*
+    Returns once the job was computed, running it in the calling thread when no worker took it. When a worker is
+    already computing it the caller spins for a short time and then sleeps until the worker is done. Sleeping lets a
+    worker sharing the same core finish. It only happens when the workers are late.
+  */
+
+  void wait();
+
+  // Not realtime safe. Waits until no worker references the job anymore. It must be called before destroying it.
+  void release();
+
+ private:
+  friend class WorkerPool;
+
+  enum class State { idle, queued, running, done };
+
+  std::atomic<State> state = State::idle;
+
+  // Number of entries of this job in the queue or in the workers heap. A job is submitted again while an entry of
+  // its previous submission may still be waiting for a worker that finds it already done.
+
+  std::atomic<uint> n_entries = 0U;
+
+  auto try_run() -> bool;
+
+  void finish_entry();
+};
+
+class WorkerPool {
+ public:
+  // Realtime safe. Without workers or when the queue is full the job runs at once in the calling thread.
+  static void submit(WorkerPoolJob& job, const std::chrono::steady_clock::time_point& deadline);
+
+  /*
+    Main thread. Restarts the pool with n_threads workers. When cpus is not empty the workers only run on those cores.
+    The workers ask for the SCHED_FIFO policy and stay as normal threads when it is not allowed.
+  */
+
+  static void configure(const uint& n_threads, const std::vector<int>& cpus);
+
+  static void stop();
+
+  [[nodiscard]] static auto get_n_threads() -> uint;
+
+ private:
+  friend class WorkerPoolJob;
+
+  static void work();
+
+  static void drain_queue();
+};
@@ -254,7 +254,35 @@ void on_blocklist(GtkCheckButton* btn, AppInfo* self) {
   }
 }
 
-void update(AppInfo* self, const NodeInfo node_info) {
+void update_volume(AppInfo* self, const NodeInfo& node_info) {
+  gtk_label_set_text(self->channels, fmt::format("{0:d} {1}", node_info.n_volume_channels, _("channels")).c_str());
+
+  g_signal_handler_block(self->volume, self->data->handler_id_volume);
+
+  if (g_settings_get_boolean(self->app_settings, "use-cubic-volumes") != 0) {
+    gtk_spin_button_set_value(self->volume, 100.0 * std::cbrt(static_cast<double>(node_info.volume)));
+  } else {
+    gtk_spin_button_set_value(self->volume, 100.0 * static_cast<double>(node_info.volume));
+  }
+
+  g_signal_handler_unblock(self->volume, self->data->handler_id_volume);
+}
+
+void update_mute(AppInfo* self, const NodeInfo& node_info) {
+  g_signal_handler_block(self->mute, self->data->handler_id_mute);
+
+  if (node_info.mute) {
+    gtk_button_set_icon_name(GTK_BUTTON(self->mute), "audio-volume-muted-symbolic");
+  } else {
+    gtk_button_set_icon_name(GTK_BUTTON(self->mute), "audio-volume-high-symbolic");
+  }
+
+  gtk_toggle_button_set_active(self->mute, static_cast<gboolean>(node_info.mute));
+
+  g_signal_handler_unblock(self->mute, self->data->handler_id_mute);
+}
+
+void update(AppInfo* self, const NodeInfo node_info, const uint changes) {
   if (node_info.state == PW_NODE_STATE_CREATING) {
     // PW_NODE_STATE_CREATING is useless and does not give any meaningful info, therefore skip it
     return;
@@ -262,6 +290,20 @@ void update(AppInfo* self, const NodeInfo node_info) {
 
   self->data->info = node_info;
 
+  // Volume and mute changes are the most frequent ones. They do not require the other widgets to be refreshed.
+
+  if ((changes & ~(node_change::volume | node_change::mute)) == 0U) {
+    if ((changes & node_change::volume) != 0U) {
+      update_volume(self, node_info);
+    }
+
+    if ((changes & node_change::mute) != 0U) {
+      update_mute(self, node_info);
+    }
+
+    return;
+  }
+
   std::string app_name = node_info.app_name;
 
   auto isspace = [](std::string_view a) { return std::ranges::all_of(a, [](auto c) { return std::isspace(c); }); };
@@ -289,7 +331,6 @@ void update(AppInfo* self, const NodeInfo node_info) {
   gtk_label_set_text(
       self->rate,
       fmt::format(ui::get_user_locale(), "{0:.1Lf} kHz", static_cast<float>(node_info.rate) / 1000.0F).c_str());
-  gtk_label_set_text(self->channels, fmt::format("{0:d} {1}", node_info.n_volume_channels, _("channels")).c_str());
   gtk_label_set_text(self->latency, fmt::format("{0:.0f} ms", 1000.0F * node_info.latency).c_str());
   gtk_label_set_text(self->state, node_state_to_char_pointer(node_info.state));
 
@@ -305,31 +346,9 @@ void update(AppInfo* self, const NodeInfo node_info) {
 
   g_signal_handler_unblock(self->enable, self->data->handler_id_enable);
 
-  // updating the volume
-
-  g_signal_handler_block(self->volume, self->data->handler_id_volume);
-
-  if (g_settings_get_boolean(self->app_settings, "use-cubic-volumes") != 0) {
-    gtk_spin_button_set_value(self->volume, 100.0 * std::cbrt(static_cast<double>(node_info.volume)));
-  } else {
-    gtk_spin_button_set_value(self->volume, 100.0 * static_cast<double>(node_info.volume));
-  }
-
-  g_signal_handler_unblock(self->volume, self->data->handler_id_volume);
-
-  // updating the mute button state
-
-  g_signal_handler_block(self->mute, self->data->handler_id_mute);
-
-  if (node_info.mute) {
-    gtk_button_set_icon_name(GTK_BUTTON(self->mute), "audio-volume-muted-symbolic");
-  } else {
-    gtk_button_set_icon_name(GTK_BUTTON(self->mute), "audio-volume-high-symbolic");
-  }
-
-  gtk_toggle_button_set_active(self->mute, static_cast<gboolean>(node_info.mute));
+  update_volume(self, node_info);
 
-  g_signal_handler_unblock(self->mute, self->data->handler_id_mute);
+  update_mute(self, node_info);
 
   // set the icon name
 
@@ -23,6 +23,8 @@
 #include <glib-object.h>
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <fmt/core.h>
+#include <fmt/format.h>
 #include <gtk/gtk.h>
 #include <spa/param/param.h>
 #include <spa/utils/defs.h>
@@ -31,10 +33,14 @@
 #include <cstring>
 #include <iostream>
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 #include "application_ui.hpp"
 #include "config.h"
+#include "effects_base.hpp"
+#include "fft_plans.hpp"
 #include "pipe_manager.hpp"
 #include "pipe_objects.hpp"
 #include "preferences_window.hpp"
@@ -47,6 +53,7 @@
 #include "tags_resources.hpp"
 #include "tags_schema.hpp"
 #include "util.hpp"
+#include "worker_pool.hpp"
 
 namespace app {
 
@@ -55,6 +62,16 @@ using namespace std::string_literals;
 // NOLINTNEXTLINE
 G_DEFINE_TYPE(Application, application, ADW_TYPE_APPLICATION)
 
+namespace {
+
+bool restart = false;
+
+}  // namespace
+
+auto restart_requested() -> bool {
+  return restart;
+}
+
 void hide_all_windows(GApplication* app) {
   auto* list = gtk_application_get_windows(GTK_APPLICATION(app));
 
@@ -77,6 +94,79 @@ void update_bypass_state(Application* self) {
   util::info(((state) != 0 ? "enabling" : "disabling") + " global bypass"s);
 }
 
+void check_output_layout(Application* self) {
+  /*
+    The sink and the output plugins are built with the layout chosen at startup. When the output device or the
+    surround setting asks for another one we quit and main starts us again.
+  */
+
+  self->pm->lock();
+
+  const auto channels = self->pm->select_output_channels();
+
+  self->pm->unlock();
+
+  if (channels.empty() || channels == self->pm->output_channels || restart) {
+    return;
+  }
+
+  util::warning("the output layout changed from " + util::to_string(self->pm->output_channels.size()) + " to " +
+                util::to_string(channels.size()) + " channels. Restarting Easy Effects to rebuild the output pipeline");
+
+  restart = true;
+
+  hide_all_windows(G_APPLICATION(self));
+
+  g_application_quit(G_APPLICATION(self));
+}
+
+void configure_worker_pool(Application* self) {
+  const auto n_threads = g_settings_get_int(self->settings, "convolution-threads");
+
+  // comma separated list of cpu cores
+
+  std::vector<int> cpus;
+
+  std::stringstream ss(util::gsettings_get_string(self->settings, "convolution-cpu-affinity"));
+
+  for (std::string item; std::getline(ss, item, ',');) {
+    if (int cpu = -1; util::str_to_num(item, cpu) && cpu >= 0) {
+      cpus.push_back(cpu);
+    } else if (!item.empty()) {
+      util::warning("ignoring the invalid cpu core in the convolution affinity: " + item);
+    }
+  }
+
+  WorkerPool::configure(static_cast<uint>(n_threads), cpus);
+}
+
+void print_dsp_load(Application* self, GApplicationCommandLine* cmdline) {
+  /*
+    Values are relative to the quantum duration. The overruns are the cycles where a plugin alone took longer than
+    the quantum, which makes the graph xrun.
+  */
+
+  auto print = [&](const std::string& pipeline, EffectsBase* effects) {
+    if (effects == nullptr) {
+      return;
+    }
+
+    for (const auto& [name, plugin] : effects->get_plugins_map()) {
+      const auto load = plugin->get_dsp_load();
+
+      const auto line = fmt::format("{0}: {1} min {2:.1f}% avg {3:.1f}% p99 {4:.1f}% max {5:.1f}% peak {6:.1f}% "
+                                    "overruns {7}\n",
+                                    pipeline, name, 100.0F * load.min, 100.0F * load.avg, 100.0F * load.p99,
+                                    100.0F * load.max, 100.0F * load.peak, load.overruns);
+
+      g_application_command_line_print(cmdline, "%s", line.c_str());
+    }
+  };
+
+  print("output", self->soe);
+  print("input", self->sie);
+}
+
 void on_startup(GApplication* gapp) {
   G_APPLICATION_CLASS(application_parent_class)->startup(gapp);
 
@@ -99,8 +189,26 @@ void on_startup(GApplication* gapp) {
     self->presets_manager = new PresetsManager();
   }
 
+  self->data->connections.push_back(self->presets_manager->preset_load_started.connect([=](const PresetType& type) {
+    if (type == PresetType::output) {
+      self->soe->freeze_running_plugins();
+    } else {
+      self->sie->freeze_running_plugins();
+    }
+  }));
+
+  self->data->connections.push_back(self->presets_manager->preset_load_finished.connect([=](const PresetType& type) {
+    if (type == PresetType::output) {
+      self->soe->thaw_plugins();
+    } else {
+      self->sie->thaw_plugins();
+    }
+  }));
+
   PipeManager::exclude_monitor_stream = g_settings_get_boolean(self->settings, "exclude-monitor-streams") != 0;
 
+  configure_worker_pool(self);
+
   self->data->connections.push_back(self->pm->new_default_sink_name.connect([=](const std::string name) {
     util::debug("new default output device: " + name);
 
@@ -183,9 +291,11 @@ void on_startup(GApplication* gapp) {
           if (util::str_contains(name, device.bus_path) || util::str_contains(name, device.bus_id)) {
             self->presets_manager->autoload(PresetType::output, name, device.output_route_name);
 
-            return;
+            break;
           }
         }
+
+        check_output_layout(self);
       }),
       self));
 
@@ -217,6 +327,20 @@ void on_startup(GApplication* gapp) {
       }),
       self));
 
+  self->data->gconnections.push_back(g_signal_connect(
+      self->settings, "changed::surround-output", G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
+        check_output_layout(static_cast<Application*>(user_data));
+      }),
+      self));
+
+  // the output device may come back with another profile and so another channel layout
+
+  self->data->connections.push_back(self->pm->sink_added.connect([=](const NodeInfo node) {
+    if (node.name == util::gsettings_get_string(self->soe_settings, "output-device")) {
+      check_output_layout(self);
+    }
+  }));
+
   self->data->gconnections.push_back(
       g_signal_connect(self->settings, "changed::exclude-monitor-streams",
                        G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
@@ -224,6 +348,14 @@ void on_startup(GApplication* gapp) {
                        }),
                        self));
 
+  for (const auto* signal : {"changed::convolution-threads", "changed::convolution-cpu-affinity"}) {
+    self->data->gconnections.push_back(g_signal_connect(
+        self->settings, signal, G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
+          configure_worker_pool(static_cast<Application*>(user_data));
+        }),
+        self));
+  }
+
   update_bypass_state(self);
 
   if ((g_application_get_flags(gapp) & G_APPLICATION_IS_SERVICE) != 0) {
@@ -369,6 +501,12 @@ void application_class_init(ApplicationClass* klass) {
       }
     }
 
+    if (g_variant_dict_contains(options, "dsp-load") != 0) {
+      print_dsp_load(self, cmdline);
+
+      return EXIT_SUCCESS;
+    }
+
     if (g_variant_dict_contains(options, "reset") != 0) {
       util::reset_all_keys_except(self->settings);
 
@@ -458,6 +596,10 @@ void application_class_init(ApplicationClass* klass) {
     self->soe = nullptr;
     self->pm = nullptr;
 
+    WorkerPool::stop();
+
+    fft_plans::save_wisdom();
+
     util::debug("Shutting down...");
   };
 }
@@ -626,6 +768,10 @@ auto application_new() -> GApplication* {
   g_application_add_main_option(G_APPLICATION(app), "active-presets", 'a', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE,
                                 _("Show the active presets."), nullptr);
 
+  g_application_add_main_option(G_APPLICATION(app), "dsp-load", 'd', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE,
+                                _("Show the processing time of each effect relative to the quantum duration."),
+                                nullptr);
+
   g_application_add_main_option(G_APPLICATION(app), "active-preset", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING,
                                 _("Show the loaded preset of a specific category. Takes 'input' or 'output' as a "
                                   "value. Example: easyeffects -s input"),
@@ -18,20 +18,24 @@
  */
 
 #include "autogain.hpp"
-#include <ebur128.h>
 #include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 #include <sys/types.h>
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstddef>
-#include <mutex>
+#include <memory>
 #include <span>
 #include <string>
+#include <utility>
+#include <vector>
+#include "loudness_meter.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 AutoGain::AutoGain(const std::string& tag,
@@ -41,13 +45,15 @@ AutoGain::AutoGain(const std::string& tag,
                    PipelineType pipe_type)
     : PluginBase(tag,
                  tags::plugin_name::autogain,
-                 tags::plugin_package::ebur128,
+                 tags::plugin_package::ee,
                  schema,
                  schema_path,
                  pipe_manager,
                  pipe_type),
       target(g_settings_get_double(settings, "target")),
-      silence_threshold(g_settings_get_double(settings, "silence-threshold")) {
+      silence_threshold(g_settings_get_double(settings, "silence-threshold")),
+      maximum_history(g_settings_get_int(settings, "maximum-history")),
+      gain_update_interval(g_settings_get_int(settings, "gain-update-interval")) {
   reference = parse_reference_key(util::gsettings_get_string(settings, "reference"));
 
   gconnections.push_back(g_signal_connect(settings, "changed::target",
@@ -70,9 +76,15 @@ AutoGain::AutoGain(const std::string& tag,
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<AutoGain*>(user_data);
 
-                                            std::scoped_lock<std::mutex> lock(self->data_mutex);
+                                            self->maximum_history = g_settings_get_int(settings, key);
+                                          }),
+                                          this));
 
-                                            self->set_maximum_history(g_settings_get_int(settings, key));
+  gconnections.push_back(g_signal_connect(settings, "changed::gain-update-interval",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
+                                            auto* self = static_cast<AutoGain*>(user_data);
+
+                                            self->gain_update_interval = g_settings_get_int(settings, key);
                                           }),
                                           this));
 
@@ -80,21 +92,7 @@ AutoGain::AutoGain(const std::string& tag,
       settings, "changed::reset-history", G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
         auto* self = static_cast<AutoGain*>(user_data);
 
-        self->mythreads.emplace_back([self]() {  // Using emplace_back here makes sense
-          self->data_mutex.lock();
-
-          self->ebur128_ready = false;
-
-          self->data_mutex.unlock();
-
-          auto status = self->init_ebur128();
-
-          self->data_mutex.lock();
-
-          self->ebur128_ready = status;
-
-          self->data_mutex.unlock();
-        });
+        self->init_meter(self->rate);
       }),
       this));
 
@@ -114,42 +112,23 @@ AutoGain::~AutoGain() {
     disconnect_from_pw();
   }
 
-  for (auto& t : mythreads) {
-    t.join();
-  }
-
-  mythreads.clear();
-
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  if (ebur_state != nullptr) {
-    ebur128_destroy(&ebur_state);
-  }
-
   util::debug(log_tag + name + " destroyed");
 }
 
-auto AutoGain::init_ebur128() -> bool {
-  if (n_samples == 0U || rate == 0U) {
-    return false;
+void AutoGain::init_meter(const uint& rate) {
+  if (rate == 0U) {
+    return;
   }
 
-  internal_output_gain = 1.0;
+  std::vector<double> weights;
 
-  if (ebur_state != nullptr) {
-    ebur128_destroy(&ebur_state);
+  weights.reserve(channels.size());
 
-    ebur_state = nullptr;
+  for (const auto& position : channels) {
+    weights.push_back(LoudnessMeter::channel_weight(position));
   }
 
-  ebur_state = ebur128_init(2U, rate, EBUR128_MODE_S | EBUR128_MODE_I | EBUR128_MODE_LRA | EBUR128_MODE_SAMPLE_PEAK);
-
-  ebur128_set_channel(ebur_state, 0U, EBUR128_LEFT);
-  ebur128_set_channel(ebur_state, 1U, EBUR128_RIGHT);
-
-  set_maximum_history(g_settings_get_int(settings, "maximum-history"));
-
-  return ebur_state != nullptr;
+  engine.publish(std::make_unique<Engine>(rate, std::move(weights)));
 }
 
 auto AutoGain::parse_reference_key(const std::string& key) -> Reference {
@@ -180,90 +159,101 @@ auto AutoGain::parse_reference_key(const std::string& key) -> Reference {
   return Reference::geometric_mean_msi;
 }
 
-void AutoGain::set_maximum_history(const int& seconds) {
-  if (ebur_state == nullptr) {
+void AutoGain::setup_engine(const uint& n_samples, const uint& rate) {
+  // The meter allocates its state when it is created. So this is done in the main thread and then it is published to
+  // the realtime thread.
+
+  if (const auto* e = engine.peek(); e != nullptr && e->rate == rate) {
     return;
   }
 
-  // The value given to ebur128_set_max_history must be in milliseconds
-
-  ebur128_set_max_history(ebur_state, static_cast<ulong>(seconds) * 1000UL);
+  init_meter(rate);
 }
 
-void AutoGain::setup() {
-  if (2U * static_cast<size_t>(n_samples) != data.size()) {
-    data.resize(static_cast<size_t>(n_samples) * 2U);
-  }
+void AutoGain::process(std::span<float>& left_in,
+                       std::span<float>& right_in,
+                       std::span<float>& left_out,
+                       std::span<float>& right_out) {
+  const auto e = engine.read();
 
-  if (rate != old_rate) {
-    data_mutex.lock();
+  if (bypass || !e || e->rate != rate || e->n_channels != 2U) {
+    std::copy(left_in.begin(), left_in.end(), left_out.begin());
+    std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
-    ebur128_ready = false;
+    return;
+  }
 
-    data_mutex.unlock();
+  if (input_gain != 1.0F) {
+    apply_gain(left_in, right_in, input_gain);
+  }
 
-    mythreads.emplace_back([this]() {  // Using emplace_back here makes sense
-      if (ebur128_ready) {
-        return;
-      }
+  const std::array<std::span<float>, 2U> frames = {left_in, right_in};
 
-      auto status = true;
+  update_gain(*e, e.generation(), frames);
 
-      old_rate = rate;
+  std::copy(left_in.begin(), left_in.end(), left_out.begin());
+  std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
-      status = init_ebur128();
+  if (internal_output_gain != 1.0F) {
+    apply_gain(left_out, right_out, static_cast<float>(internal_output_gain));
+  }
 
-      data_mutex.lock();
+  if (output_gain != 1.0F) {
+    apply_gain(left_out, right_out, output_gain);
+  }
 
-      ebur128_ready = status;
+  if (post_messages) {
+    get_peaks(left_in, right_in, left_out, right_out);
+
+    if (send_notifications) {
+      post_meter(results_meter, {static_cast<float>(loudness), static_cast<float>(internal_output_gain),
+                                 static_cast<float>(momentary), static_cast<float>(shortterm),
+                                 static_cast<float>(global), static_cast<float>(relative), static_cast<float>(range)});
 
-      data_mutex.unlock();
-    });
+      notify();
+    }
   }
 }
 
-void AutoGain::process(std::span<float>& left_in,
-                       std::span<float>& right_in,
-                       std::span<float>& left_out,
-                       std::span<float>& right_out) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+void AutoGain::update_gain(Engine& e, const uint64_t& generation, std::span<const std::span<float>> frames) {
+  auto& meter = e.meter;
 
-  if (bypass || !ebur128_ready) {
-    std::copy(left_in.begin(), left_in.end(), left_out.begin());
-    std::copy(right_in.begin(), right_in.end(), right_out.begin());
+  if (generation != engine_generation) {
+    internal_output_gain = 1.0;
 
-    return;
-  }
+    e.maximum_history = -1;
 
-  if (input_gain != 1.0F) {
-    apply_gain(left_in, right_in, input_gain);
+    frames_since_gain_update = 0U;
+
+    engine_generation = generation;
   }
 
-  for (size_t n = 0U; n < n_samples; n++) {
-    data[2U * n] = left_in[n];
-    data[2U * n + 1U] = right_in[n];
+  if (const auto seconds = maximum_history.load(); seconds != e.maximum_history) {
+    meter.set_max_history(static_cast<uint>(seconds));
+
+    e.maximum_history = seconds;
   }
 
-  ebur128_add_frames_float(ebur_state, data.data(), n_samples);
+  meter.add_frames(frames);
 
-  auto failed = false;
+  frames_since_gain_update += n_samples;
 
-  if (EBUR128_SUCCESS != ebur128_loudness_momentary(ebur_state, &momentary)) {
-    failed = true;
-  }
+  // The loudness values change every 100 ms and the gain target is recomputed at the rate chosen by the user
 
-  if (EBUR128_SUCCESS != ebur128_loudness_shortterm(ebur_state, &shortterm)) {
-    failed = true;
+  if (!meter.updated()) {
+    return;
   }
 
-  if (EBUR128_SUCCESS != ebur128_loudness_global(ebur_state, &global)) {
-    failed = true;
-  }
+  momentary = meter.momentary();
+  shortterm = meter.shortterm();
+  global = meter.integrated();
+  relative = meter.relative_threshold();
+  range = meter.loudness_range();
 
   if (std::isinf(momentary) || std::isnan(momentary)) {
     /*
-      Assuming zero so that the output gain is negative. This should avoid undesirably high amplification in case
-      a bad resutla comes from libebur128
+      Assuming zero so that the output gain is negative. This should avoid undesirably high amplification when there
+      is no signal to measure.
     */
 
     momentary = 0.0;
@@ -289,110 +279,116 @@ void AutoGain::process(std::span<float>& left_in,
     global = momentary;
   }
 
-  if (EBUR128_SUCCESS != ebur128_relative_threshold(ebur_state, &relative)) {
-    failed = true;
-  }
+  const auto interval_frames = static_cast<uint>(gain_update_interval.load()) * e.rate / 1000U;
 
-  if (EBUR128_SUCCESS != ebur128_loudness_range(ebur_state, &range)) {
-    failed = true;
+  if (frames_since_gain_update < interval_frames) {
+    return;
   }
 
-  if (momentary > silence_threshold && !failed) {
-    double peak_L = 0.0;
-    double peak_R = 0.0;
+  frames_since_gain_update = 0U;
 
-    if (EBUR128_SUCCESS != ebur128_prev_sample_peak(ebur_state, 0U, &peak_L)) {
-      failed = true;
-    }
+  if (momentary > silence_threshold) {
+    const auto peak = meter.previous_sample_peak();
 
-    if (EBUR128_SUCCESS != ebur128_prev_sample_peak(ebur_state, 1U, &peak_R)) {
-      failed = true;
-    }
+    switch (reference) {
+      case Reference::momentary: {
+        loudness = momentary;
 
-    if (!failed) {
-      switch (reference) {
-        case Reference::momentary: {
-          loudness = momentary;
+        break;
+      }
+      case Reference::shortterm: {
+        loudness = shortterm;
 
-          break;
-        }
-        case Reference::shortterm: {
-          loudness = shortterm;
+        break;
+      }
+      case Reference::integrated: {
+        loudness = global;
 
-          break;
-        }
-        case Reference::integrated: {
-          loudness = global;
+        break;
+      }
+      case Reference::geometric_mean_msi: {
+        loudness = std::cbrt(momentary * shortterm * global);
 
-          break;
-        }
-        case Reference::geometric_mean_msi: {
-          loudness = std::cbrt(momentary * shortterm * global);
+        break;
+      }
+      case Reference::geometric_mean_ms: {
+        loudness = std::sqrt(std::fabs(momentary * shortterm));
 
-          break;
+        if (momentary < 0 && shortterm < 0) {
+          loudness *= -1;
         }
-        case Reference::geometric_mean_ms: {
-          loudness = std::sqrt(std::fabs(momentary * shortterm));
 
-          if (momentary < 0 && shortterm < 0) {
-            loudness *= -1;
-          }
+        break;
+      }
+      case Reference::geometric_mean_mi: {
+        loudness = std::sqrt(std::fabs(momentary * global));
 
-          break;
+        if (momentary < 0 && global < 0) {
+          loudness *= -1;
         }
-        case Reference::geometric_mean_mi: {
-          loudness = std::sqrt(std::fabs(momentary * global));
 
-          if (momentary < 0 && global < 0) {
-            loudness *= -1;
-          }
+        break;
+      }
+      case Reference::geometric_mean_si: {
+        loudness = std::sqrt(std::fabs(shortterm * global));
 
-          break;
+        if (shortterm < 0 && global < 0) {
+          loudness *= -1;
         }
-        case Reference::geometric_mean_si: {
-          loudness = std::sqrt(std::fabs(shortterm * global));
 
-          if (shortterm < 0 && global < 0) {
-            loudness *= -1;
-          }
-
-          break;
-        }
+        break;
       }
+    }
 
-      const double diff = target - loudness;
-
-      // 10^(diff/20). The way below should be faster than using pow
-      const double gain = std::exp((diff / 20.0) * std::log(10.0));
+    const double diff = target - loudness;
 
-      const double peak = (peak_L > peak_R) ? peak_L : peak_R;
+    // 10^(diff/20). The way below should be faster than using pow
+    const double gain = std::exp((diff / 20.0) * std::log(10.0));
 
-      const auto db_peak = util::linear_to_db(peak);
+    const auto db_peak = util::linear_to_db(peak);
 
-      if (db_peak > util::minimum_db_level) {
-        if (gain * peak < 1.0) {
-          internal_output_gain = gain;
-        }
+    if (db_peak > util::minimum_db_level) {
+      if (gain * peak < 1.0) {
+        internal_output_gain = gain;
       }
     }
   }
+}
 
-  std::copy(left_in.begin(), left_in.end(), left_out.begin());
-  std::copy(right_in.begin(), right_in.end(), right_out.begin());
+void AutoGain::process_channels(std::span<std::span<float>> in, std::span<std::span<float>> out) {
+  const auto e = engine.read();
 
-  if (internal_output_gain != 1.0F) {
-    apply_gain(left_out, right_out, static_cast<float>(internal_output_gain));
+  if (bypass || !e || e->rate != rate || e->n_channels != in.size()) {
+    for (size_t c = 0U; c < in.size(); c++) {
+      std::ranges::copy(in[c], out[c].begin());
+    }
+
+    return;
   }
 
-  if (output_gain != 1.0F) {
-    apply_gain(left_out, right_out, output_gain);
+  const auto n_channels = in.size();
+
+  for (size_t c = 0U; c < n_channels; c++) {
+    if (input_gain != 1.0F) {
+      std::ranges::for_each(in[c], [&](auto& v) { v *= input_gain; });
+    }
+  }
+
+  update_gain(*e, e.generation(), in);
+
+  const auto gain = static_cast<float>(internal_output_gain) * output_gain;
+
+  for (size_t c = 0U; c < n_channels; c++) {
+    std::ranges::transform(in[c], out[c].begin(), [&](const auto& v) { return v * gain; });
   }
 
   if (post_messages) {
-    get_peaks(left_in, right_in, left_out, right_out);
+    get_peaks(in[0], in[1], out[0], out[1]);
 
     if (send_notifications) {
-      results.emit(loudness, internal_output_gain, momentary, shortterm, global, relative, range);
+      post_meter(results_meter, {static_cast<float>(loudness), static_cast<float>(internal_output_gain),
+                                 static_cast<float>(momentary), static_cast<float>(shortterm),
+                                 static_cast<float>(global), static_cast<float>(relative), static_cast<float>(range)});
 
       notify();
     }
@@ -402,3 +398,15 @@ void AutoGain::process(std::span<float>& left_in,
 auto AutoGain::get_latency_seconds() -> float {
   return 0.0F;
 }
+
+void AutoGain::on_meter(const telemetry::Record& record) {
+  if (record.id != results_meter) {
+    PluginBase::on_meter(record);
+
+    return;
+  }
+
+  const auto& v = record.values;
+
+  results.emit(v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+}
@@ -49,6 +49,8 @@ void AutoGainPreset::save(nlohmann::json& json) {
 
   json[section][instance_name]["maximum-history"] = g_settings_get_int(settings, "maximum-history");
 
+  json[section][instance_name]["gain-update-interval"] = g_settings_get_int(settings, "gain-update-interval");
+
   json[section][instance_name]["reference"] = util::gsettings_get_string(settings, "reference");
 }
 
@@ -65,5 +67,7 @@ void AutoGainPreset::load(const nlohmann::json& json) {
 
   update_key<int>(json.at(section).at(instance_name), settings, "maximum-history", "maximum-history");
 
+  update_key<int>(json.at(section).at(instance_name), settings, "gain-update-interval", "gain-update-interval");
+
   update_key<gchar*>(json.at(section).at(instance_name), settings, "reference", "reference");
 }
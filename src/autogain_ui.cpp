@@ -63,7 +63,7 @@ struct _AutogainBox {
   GtkLabel *input_level_left_label, *input_level_right_label, *output_level_left_label, *output_level_right_label,
       *plugin_credit;
 
-  GtkSpinButton *target, *silence_threshold, *maximum_history;
+  GtkSpinButton *target, *silence_threshold, *maximum_history, *gain_update_interval;
 
   GtkLevelBar *m_level, *s_level, *i_level, *r_level, *g_level, *l_level, *lra_level;
 
@@ -186,8 +186,8 @@ void setup(AutogainBox* self, std::shared_ptr<AutoGain> autogain, const std::str
 
   gsettings_bind_widgets<"input-gain", "output-gain">(self->settings, self->input_gain, self->output_gain);
 
-  gsettings_bind_widgets<"target", "silence-threshold", "maximum-history">(
-      self->settings, self->target, self->silence_threshold, self->maximum_history);
+  gsettings_bind_widgets<"target", "silence-threshold", "maximum-history", "gain-update-interval">(
+      self->settings, self->target, self->silence_threshold, self->maximum_history, self->gain_update_interval);
 
   ui::gsettings_bind_enum_to_combo_widget(self->settings, "reference", self->reference);
 }
@@ -249,6 +249,7 @@ void autogain_box_class_init(AutogainBoxClass* klass) {
   gtk_widget_class_bind_template_child(widget_class, AutogainBox, target);
   gtk_widget_class_bind_template_child(widget_class, AutogainBox, silence_threshold);
   gtk_widget_class_bind_template_child(widget_class, AutogainBox, maximum_history);
+  gtk_widget_class_bind_template_child(widget_class, AutogainBox, gain_update_interval);
   gtk_widget_class_bind_template_child(widget_class, AutogainBox, reference);
   gtk_widget_class_bind_template_child(widget_class, AutogainBox, reset_history);
 
@@ -282,6 +283,7 @@ void autogain_box_init(AutogainBox* self) {
 
   prepare_spinbuttons<"dB">(self->target, self->silence_threshold);
   prepare_spinbuttons<"s">(self->maximum_history);
+  prepare_spinbuttons<"ms">(self->gain_update_interval);
 }
 
 auto create() -> AutogainBox* {
@@ -26,6 +26,7 @@
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 BassEnhancer::BassEnhancer(const std::string& tag,
@@ -48,6 +49,8 @@ BassEnhancer::BassEnhancer(const std::string& tag,
     util::debug(log_tag + "http://calf.sourceforge.net/plugins/BassEnhancer is not installed");
   }
 
+  port_meter_drive = lv2_wrapper->get_control_port<"meter_drive">();
+
   lv2_wrapper->bind_key_double_db<"amount", "amount">(settings);
 
   lv2_wrapper->bind_key_double<"drive", "harmonics">(settings);
@@ -73,23 +76,11 @@ BassEnhancer::~BassEnhancer() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void BassEnhancer::setup() {
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (lv2_wrapper->get_rate() != rate) {
-    lv2_wrapper->create_instance(rate);
-  }
-}
-
 void BassEnhancer::process(std::span<float>& left_in,
                            std::span<float>& right_in,
                            std::span<float>& left_out,
                            std::span<float>& right_out) {
-  if (!lv2_wrapper->found_plugin || !lv2_wrapper->has_instance() || bypass) {
+  if (!lv2_wrapper->found_plugin || !lv2_ready || bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -113,13 +104,13 @@ void BassEnhancer::process(std::span<float>& left_in,
     if (send_notifications) {
       // harmonics needed as double for levelbar widget ui, so we convert it here
 
-      harmonics_port_value = static_cast<double>(lv2_wrapper->get_control_port_value("meter_drive"));
+      harmonics_port_value = static_cast<double>(lv2_wrapper->get_control_port_value(port_meter_drive));
 
       if (!post_messages) {
         return;
       }
 
-      harmonics.emit(harmonics_port_value);
+      post_meter(harmonics_meter, {static_cast<float>(harmonics_port_value)});
 
       notify();
     }
@@ -129,3 +120,15 @@ void BassEnhancer::process(std::span<float>& left_in,
 auto BassEnhancer::get_latency_seconds() -> float {
   return 0.0F;
 }
+
+void BassEnhancer::on_meter(const telemetry::Record& record) {
+  switch (record.id) {
+    case harmonics_meter:
+      harmonics.emit(record.values[0]);
+      break;
+
+    default:
+      PluginBase::on_meter(record);
+      break;
+  }
+}
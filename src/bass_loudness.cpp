@@ -65,23 +65,11 @@ BassLoudness::~BassLoudness() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void BassLoudness::setup() {
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (lv2_wrapper->get_rate() != rate) {
-    lv2_wrapper->create_instance(rate);
-  }
-}
-
 void BassLoudness::process(std::span<float>& left_in,
                            std::span<float>& right_in,
                            std::span<float>& left_out,
                            std::span<float>& right_out) {
-  if (!lv2_wrapper->found_plugin || !lv2_wrapper->has_instance() || bypass) {
+  if (!lv2_wrapper->found_plugin || !lv2_ready || bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -0,0 +1,153 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "block_adapter.hpp"
+#include <sys/types.h>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <numeric>
+#include <span>
+
+void RingBuffer::resize(const size_t& min_capacity) {
+  buffer.resize(std::bit_ceil(std::max(min_capacity, static_cast<size_t>(1U))));
+
+  mask = buffer.size() - 1U;
+
+  clear();
+}
+
+void RingBuffer::clear() {
+  read_pos = 0U;
+  write_pos = 0U;
+}
+
+auto RingBuffer::push(std::span<const float> input) -> size_t {
+  const size_t count = std::min(input.size(), buffer.size() - size());
+
+  const size_t start = write_pos & mask;
+  const size_t first = std::min(count, buffer.size() - start);
+
+  std::copy_n(input.begin(), first, buffer.begin() + start);
+  std::copy_n(input.begin() + first, count - first, buffer.begin());
+
+  write_pos += count;
+
+  return count;
+}
+
+auto RingBuffer::push_zeros(const size_t& count) -> size_t {
+  const size_t n = std::min(count, buffer.size() - size());
+
+  const size_t start = write_pos & mask;
+  const size_t first = std::min(n, buffer.size() - start);
+
+  std::fill_n(buffer.begin() + start, first, 0.0F);
+  std::fill_n(buffer.begin(), n - first, 0.0F);
+
+  write_pos += n;
+
+  return n;
+}
+
+auto RingBuffer::pop(std::span<float> output) -> size_t {
+  const size_t count = std::min(output.size(), size());
+
+  const size_t start = read_pos & mask;
+  const size_t first = std::min(count, buffer.size() - start);
+
+  std::copy_n(buffer.begin() + start, first, output.begin());
+  std::copy_n(buffer.begin(), count - first, output.begin() + first);
+
+  read_pos += count;
+
+  return count;
+}
+
+auto RingBuffer::pop_or_pad(std::span<float> output) -> size_t {
+  const size_t n_zeros = output.size() - std::min(output.size(), size());
+
+  std::fill_n(output.begin(), n_zeros, 0.0F);
+
+  pop(output.subspan(n_zeros));
+
+  return n_zeros;
+}
+
+auto BlockAdapter::fft_block_size(const uint& quantum, const uint& max_blocks) -> uint {
+  if (quantum == 0U) {
+    return 1U;
+  }
+
+  auto is_smooth = [](uint n) {
+    for (const uint p : {2U, 3U, 5U, 7U}) {
+      while (n % p == 0U) {
+        n /= p;
+      }
+    }
+
+    return n == 1U;
+  };
+
+  for (uint n_blocks = 1U; n_blocks <= max_blocks; n_blocks++) {
+    if (quantum % n_blocks == 0U && is_smooth(quantum / n_blocks)) {
+      return quantum / n_blocks;
+    }
+  }
+
+  return quantum;
+}
+
+void BlockAdapter::setup(const uint& block_size, const uint& quantum, const uint& max_input_size) {
+  this->block_size = std::max(block_size, 1U);
+
+  latency_frames = (quantum == 0U) ? 0U : this->block_size - std::gcd(this->block_size, quantum);
+
+  block_L.resize(this->block_size);
+  block_R.resize(this->block_size);
+
+  // Enough room for the priming zeros, the data not consumed yet and one more quantum of new blocks.
+
+  const size_t capacity = static_cast<size_t>(latency_frames) + 2U * this->block_size +
+                          2U * static_cast<size_t>(std::max(quantum, max_input_size));
+
+  fifo_out_L.resize(capacity);
+  fifo_out_R.resize(capacity);
+
+  reset();
+}
+
+void BlockAdapter::reset() {
+  block_fill = 0U;
+
+  std::ranges::fill(block_L, 0.0F);
+  std::ranges::fill(block_R, 0.0F);
+
+  fifo_out_L.clear();
+  fifo_out_R.clear();
+
+  fifo_out_L.push_zeros(latency_frames);
+  fifo_out_R.push_zeros(latency_frames);
+}
+
+auto BlockAdapter::pull(std::span<float> left_out, std::span<float> right_out) -> uint {
+  fifo_out_R.pop_or_pad(right_out);
+
+  return static_cast<uint>(fifo_out_L.pop_or_pad(left_out));
+}
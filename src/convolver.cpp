@@ -21,18 +21,17 @@
 #include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
-#include <sched.h>
 #include <sys/types.h>
-#include <zita-convolver.h>
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <memory>
-#include <mutex>
 #include <sndfile.hh>
 #include <span>
 #include <string>
+#include <utility>
 #include <vector>
+#include "partitioned_convolver.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "resampler.hpp"
@@ -40,14 +39,6 @@
 #include "tags_resources.hpp"
 #include "util.hpp"
 
-namespace {
-
-constexpr auto CONVPROC_SCHEDULER_PRIORITY = 0;
-
-constexpr auto CONVPROC_SCHEDULER_CLASS = SCHED_FIFO;
-
-}  // namespace
-
 Convolver::Convolver(const std::string& tag,
                      const std::string& schema,
                      const std::string& schema_path,
@@ -55,7 +46,7 @@ Convolver::Convolver(const std::string& tag,
                      PipelineType pipe_type)
     : PluginBase(tag,
                  tags::plugin_name::convolver,
-                 tags::plugin_package::zita,
+                 tags::plugin_package::ee,
                  schema,
                  schema_path,
                  pipe_manager,
@@ -85,15 +76,7 @@ Convolver::Convolver(const std::string& tag,
 
                                             self->ir_width = g_settings_get_int(self->settings, key);
 
-                                            std::scoped_lock<std::mutex> lock(self->data_mutex);
-
-                                            if (self->kernel_is_initialized) {
-                                              self->kernel_L = self->original_kernel_L;
-                                              self->kernel_R = self->original_kernel_R;
-
-                                              self->set_kernel_stereo_width();
-                                              self->apply_kernel_autogain();
-                                            }
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -101,7 +84,9 @@ Convolver::Convolver(const std::string& tag,
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<Convolver*>(user_data);
 
-                                            self->prepare_kernel();
+                                            self->kernel_outdated = true;
+
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -111,7 +96,9 @@ Convolver::Convolver(const std::string& tag,
 
                                             self->do_autogain = g_settings_get_boolean(settings, key) != 0;
 
-                                            self->prepare_kernel();
+                                            self->kernel_outdated = true;
+
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -123,181 +110,92 @@ Convolver::~Convolver() {
     disconnect_from_pw();
   }
 
-  for (auto& t : mythreads) {
-    t.join();
-  }
-
-  mythreads.clear();
-
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  ready = false;
-
-  if (conv != nullptr) {
-    conv->stop_process();
-
-    conv->cleanup();
-
-    delete conv;
-  }
-
   util::debug(log_tag + name + " destroyed");
 }
 
-void Convolver::setup() {
-  ready = false;
-
+void Convolver::setup_engine(const uint& n_samples, const uint& rate) {
   /*
-    As zita uses fftw we have to be careful when reinitializing it. The thread that creates the fftw plan has to be the
-    same that destroys it. Otherwise segmentation faults can happen. As we do not want to do this initializing in the
-    plugin realtime thread we send it to the main thread through g_idle_add().connect_once
+    The convolution engine is built and destroyed in the main thread, where fftw plans can be created. The engine does
+    not depend on the quantum, so only a new sampling rate requires a new one.
   */
 
-  util::idle_add([&, this] {
-    if (ready) {
-      return;
-    }
-
-    blocksize = n_samples;
-
-    n_samples_is_power_of_2 = (n_samples & (n_samples - 1U)) == 0U && n_samples != 0U;
-
-    if (!n_samples_is_power_of_2) {
-      while ((blocksize & (blocksize - 1)) != 0 && blocksize > 2) {
-        blocksize--;
-      }
-    }
-
-    data_L.resize(0U);
-    data_R.resize(0U);
-
-    deque_out_L.resize(0U);
-    deque_out_R.resize(0U);
-
-    notify_latency = true;
-
-    latency_n_frames = 0U;
-
-    read_kernel_file();
-
-    if (kernel_is_initialized) {
-      kernel_L = original_kernel_L;
-      kernel_R = original_kernel_R;
-
-      set_kernel_stereo_width();
-      apply_kernel_autogain();
+  if (const auto* e = engine.peek(); e != nullptr && e->rate == rate) {
+    return;
+  }
 
-      setup_zita();
-    }
+  read_kernel_file(rate);
 
-    std::scoped_lock<std::mutex> lock(data_mutex);
+  build_engine(rate);
+}
 
-    ready = kernel_is_initialized && zita_ready;
-  });
+auto Convolver::is_ready() -> bool {
+  return engine_rate == rate;
 }
 
 void Convolver::process(std::span<float>& left_in,
                         std::span<float>& right_in,
                         std::span<float>& left_out,
                         std::span<float>& right_out) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  const auto e = engine.read();
 
-  if (bypass || !ready) {
+  if (bypass || !e || e->rate != rate) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
     return;
   }
 
+  process_stereo(*e, left_in, right_in, left_out, right_out);
+}
+
+void Convolver::process_stereo(Engine& e,
+                               std::span<float>& left_in,
+                               std::span<float>& right_in,
+                               std::span<float>& left_out,
+                               std::span<float>& right_out) {
   if (input_gain != 1.0F) {
     apply_gain(left_in, right_in, input_gain);
   }
 
-  if (n_samples_is_power_of_2) {
-    std::copy(left_in.begin(), left_in.end(), left_out.begin());
-    std::copy(right_in.begin(), right_in.end(), right_out.begin());
-
-    do_convolution(left_out, right_out);
-  } else {
-    for (size_t j = 0U; j < left_in.size(); j++) {
-      data_L.push_back(left_in[j]);
-      data_R.push_back(right_in[j]);
+  std::copy(left_in.begin(), left_in.end(), left_out.begin());
+  std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
-      if (data_L.size() == blocksize) {
-        do_convolution(data_L, data_R);
+  e.conv_L.process(left_out);
+  e.conv_R.process(right_out);
 
-        for (const auto& v : data_L) {
-          deque_out_L.push_back(v);
-        }
+  if (output_gain != 1.0F) {
+    apply_gain(left_out, right_out, output_gain);
+  }
 
-        for (const auto& v : data_R) {
-          deque_out_R.push_back(v);
-        }
+  if (post_messages) {
+    get_peaks(left_in, right_in, left_out, right_out);
 
-        data_L.resize(0U);
-        data_R.resize(0U);
-      }
+    if (send_notifications) {
+      notify();
     }
+  }
+}
 
-    // copying the processed samples to the output buffers
-
-    if (deque_out_L.size() >= left_out.size()) {
-      for (float& v : left_out) {
-        v = deque_out_L.front();
-
-        deque_out_L.pop_front();
-      }
-
-      for (float& v : right_out) {
-        v = deque_out_R.front();
-
-        deque_out_R.pop_front();
-      }
-    } else {
-      const uint offset = 2U * (left_out.size() - deque_out_L.size());
-
-      if (offset != latency_n_frames) {
-        latency_n_frames = offset;
-
-        notify_latency = true;
-      }
-
-      for (uint n = 0U; !deque_out_L.empty() && n < left_out.size(); n++) {
-        if (n < offset) {
-          left_out[n] = 0.0F;
-          right_out[n] = 0.0F;
-        } else {
-          left_out[n] = deque_out_L.front();
-          right_out[n] = deque_out_R.front();
+void Convolver::process_channels(std::span<std::span<float>> in, std::span<std::span<float>> out) {
+  const auto e = engine.read();
 
-          deque_out_R.pop_front();
-          deque_out_L.pop_front();
-        }
-      }
+  if (bypass || !e || e->rate != rate || e->conv_surround.size() + 2U != in.size()) {
+    for (size_t n = 0U; n < in.size(); n++) {
+      std::ranges::copy(in[n], out[n].begin());
     }
-  }
 
-  if (output_gain != 1.0F) {
-    apply_gain(left_out, right_out, output_gain);
+    return;
   }
 
-  if (notify_latency) {
-    latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
+  process_stereo(*e, in[0], in[1], out[0], out[1]);
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
+  for (size_t n = 2U; n < in.size(); n++) {
+    std::ranges::transform(in[n], out[n].begin(), [&](const auto& v) { return v * input_gain; });
 
-    util::idle_add([this] { latency.emit(); });
-
-    update_filter_params();
-
-    notify_latency = false;
-  }
+    e->conv_surround[n - 2U]->process(out[n]);
 
-  if (post_messages) {
-    get_peaks(left_in, right_in, left_out, right_out);
-
-    if (send_notifications) {
-      notify();
+    if (output_gain != 1.0F) {
+      std::ranges::for_each(out[n], [&](auto& v) { v *= output_gain; });
     }
   }
 }
@@ -333,7 +231,7 @@ auto Convolver::search_irs_path(const std::string& name) -> std::string {
   return irs_full_path;
 }
 
-void Convolver::read_kernel_file() {
+void Convolver::read_kernel_file(const uint& rate) {
   kernel_is_initialized = false;
 
   const auto name = util::gsettings_get_string(settings, "kernel-name");
@@ -467,106 +365,78 @@ void Convolver::set_kernel_stereo_width() {
   }
 }
 
-void Convolver::setup_zita() {
-  zita_ready = false;
-
-  if (n_samples == 0U || !kernel_is_initialized) {
-    return;
-  }
-
-  const uint max_convolution_size = kernel_L.size();
-  const uint buffer_size = get_zita_buffer_size();
-
-  if (conv != nullptr) {
-    conv->stop_process();
-
-    conv->cleanup();
-
-    delete conv;
-  }
-
-  conv = new Convproc();
+void Convolver::build_engine(const uint& rate) {
+  engine_rate = rate;
 
-  conv->set_options(0);
-
-  int ret = conv->configure(2, 2, max_convolution_size, buffer_size, buffer_size, buffer_size, 0.0F /*density*/);
-
-  if (ret != 0) {
-    util::warning(log_tag + name + " can't initialise zita-convolver engine: " + util::to_string(ret, ""));
+  if (rate == 0U || !kernel_is_initialized) {
+    engine.publish(nullptr);
 
     return;
   }
 
-  ret = conv->impdata_create(0, 0, 1, kernel_L.data(), 0, static_cast<int>(kernel_L.size()));
+  kernel_L = original_kernel_L;
+  kernel_R = original_kernel_R;
 
-  if (ret != 0) {
-    util::warning(log_tag + name + " left impdata_create failed: " + util::to_string(ret));
-
-    return;
-  }
+  set_kernel_stereo_width();
+  apply_kernel_autogain();
 
-  ret = conv->impdata_create(1, 1, 1, kernel_R.data(), 0, static_cast<int>(kernel_R.size()));
+  auto new_engine = std::make_unique<Engine>();
 
-  if (ret != 0) {
-    util::warning(log_tag + name + " right impdata_create failed: " + util::to_string(ret, ""));
+  new_engine->rate = rate;
 
-    return;
-  }
+  new_engine->conv_L.set_kernel(kernel_L, rate);
+  new_engine->conv_R.set_kernel(kernel_R, rate);
 
-  ret = conv->start_process(CONVPROC_SCHEDULER_PRIORITY, CONVPROC_SCHEDULER_CLASS);
+  /*
+    Impulse responses are stereo. Surround channels on the left side use the left kernel and the ones on the right
+    side use the right kernel. Center channels and the LFE get the average of both.
+  */
 
-  if (ret != 0) {
-    util::warning(log_tag + name + " start_process failed: " + util::to_string(ret, ""));
+  std::vector<float> kernel_mid;
 
-    conv->stop_process();
-    conv->cleanup();
+  for (size_t n = 2U; n < channels.size(); n++) {
+    auto conv = std::make_unique<PartitionedConvolver>();
 
-    return;
-  }
+    if (channels[n].ends_with('L')) {
+      conv->set_kernel(kernel_L, rate);
+    } else if (channels[n].ends_with('R')) {
+      conv->set_kernel(kernel_R, rate);
+    } else {
+      if (kernel_mid.empty()) {
+        kernel_mid.resize(kernel_L.size());
 
-  zita_ready = true;
+        for (size_t i = 0U; i < kernel_mid.size(); i++) {
+          kernel_mid[i] = 0.5F * (kernel_L[i] + kernel_R[i]);
+        }
+      }
 
-  util::debug(log_tag + name + ": zita is ready");
-}
+      conv->set_kernel(kernel_mid, rate);
+    }
 
-auto Convolver::get_zita_buffer_size() -> uint {
-  if (n_samples_is_power_of_2) {
-    return n_samples;
+    new_engine->conv_surround.push_back(std::move(conv));
   }
 
-  return blocksize;
+  util::debug(log_tag + name + ": convolution engine ready for " + util::to_string(kernel_L.size()) + " taps");
+
+  engine.publish(std::move(new_engine));
 }
 
 auto Convolver::get_latency_seconds() -> float {
   return this->latency_value;
 }
 
-void Convolver::prepare_kernel() {
-  if (n_samples == 0U || rate == 0U) {
-    return;
-  }
-
-  data_mutex.lock();
-
-  ready = false;
-
-  data_mutex.unlock();
+void Convolver::rebuild() {
+  const auto read_kernel = kernel_outdated;
 
-  read_kernel_file();
+  kernel_outdated = false;
 
-  if (kernel_is_initialized) {
-    kernel_L = original_kernel_L;
-    kernel_R = original_kernel_R;
-
-    set_kernel_stereo_width();
-    apply_kernel_autogain();
-
-    setup_zita();
-
-    data_mutex.lock();
-
-    ready = kernel_is_initialized && zita_ready;
+  if (rate == 0U) {
+    return;
+  }
 
-    data_mutex.unlock();
+  if (read_kernel) {
+    read_kernel_file(rate);
   }
+
+  build_engine(rate);
 }
@@ -23,7 +23,7 @@
 #include <glib.h>
 #include <algorithm>
 #include <cstddef>
-#include <mutex>
+#include <memory>
 #include <span>
 #include <string>
 #include "pipe_manager.hpp"
@@ -43,17 +43,15 @@ Crossfeed::Crossfeed(const std::string& tag,
                  schema_path,
                  pipe_manager,
                  pipe_type) {
-  bs2b.set_level_fcut(g_settings_get_int(settings, "fcut"));
+  data.reserve(2U * max_quantum);
 
-  bs2b.set_level_feed(10 * static_cast<int>(g_settings_get_double(settings, "feed")));
+  publish_params();
 
   gconnections.push_back(g_signal_connect(settings, "changed::fcut",
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<Crossfeed*>(user_data);
 
-                                            std::scoped_lock<std::mutex> lock(self->data_mutex);
-
-                                            self->bs2b.set_level_fcut(g_settings_get_int(settings, key));
+                                            self->publish_params();
                                           }),
                                           this));
 
@@ -61,9 +59,7 @@ Crossfeed::Crossfeed(const std::string& tag,
       g_signal_connect(settings, "changed::feed", G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                          auto* self = static_cast<Crossfeed*>(user_data);
 
-                         std::scoped_lock<std::mutex> lock(self->data_mutex);
-
-                         self->bs2b.set_level_feed(10 * static_cast<int>(g_settings_get_double(settings, key)));
+                         self->publish_params();
                        }),
                        this));
 
@@ -78,9 +74,14 @@ Crossfeed::~Crossfeed() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void Crossfeed::setup() {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+void Crossfeed::publish_params() {
+  params.publish(std::make_unique<Params>(Params{
+      .fcut = g_settings_get_int(settings, "fcut"),
+      .feed = 10 * static_cast<int>(g_settings_get_double(settings, "feed")),
+  }));
+}
 
+void Crossfeed::setup() {
   data.resize(2U * static_cast<size_t>(n_samples));
 
   if (rate != bs2b.get_srate()) {
@@ -88,11 +89,21 @@ void Crossfeed::setup() {
   }
 }
 
+/*
+  bs2b simulates speakers for headphone listening and only has a meaning for the front pair. The default
+  process_channels passes the surround channels through.
+*/
+
 void Crossfeed::process(std::span<float>& left_in,
                         std::span<float>& right_in,
                         std::span<float>& left_out,
                         std::span<float>& right_out) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  if (const auto p = params.read(); p && p.generation() != params_generation) {
+    bs2b.set_level_fcut(p->fcut);
+    bs2b.set_level_feed(p->feed);
+
+    params_generation = p.generation();
+  }
 
   if (bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
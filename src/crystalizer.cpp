@@ -25,14 +25,17 @@
 #include <algorithm>
 #include <cstddef>
 #include <memory>
-#include <mutex>
 #include <span>
 #include <string>
+#include <utility>
+#include <vector>
+#include "block_adapter.hpp"
+#include "filter_bank.hpp"
 #include "fir_filter_bandpass.hpp"
-#include "fir_filter_base.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 Crystalizer::Crystalizer(const std::string& tag,
@@ -47,15 +50,9 @@ Crystalizer::Crystalizer(const std::string& tag,
                  schema_path,
                  pipe_manager,
                  pipe_type) {
-  for (uint n = 0U; n < nbands; n++) {
-    filters.at(n) = std::make_unique<FirFilterBandpass>(log_tag + name + " band" + util::to_string(n));
-  }
-
   std::ranges::fill(band_mute, false);
   std::ranges::fill(band_bypass, false);
   std::ranges::fill(band_intensity, 1.0F);
-  std::ranges::fill(band_last_L, 0.0F);
-  std::ranges::fill(band_last_R, 0.0F);
 
   frequencies[0] = 20.0F;
   frequencies[1] = 520.0F;
@@ -84,192 +81,157 @@ Crystalizer::~Crystalizer() {
     disconnect_from_pw();
   }
 
-  data_mutex.lock();
-
-  filters_are_ready = false;
-
-  data_mutex.unlock();
-
   util::debug(log_tag + name + " destroyed");
 }
 
-void Crystalizer::setup() {
-  data_mutex.lock();
-
-  filters_are_ready = false;
-
-  data_mutex.unlock();
-
+void Crystalizer::setup_engine(const uint& n_samples, const uint& rate) {
   /*
-    As zita uses fftw we have to be careful when reinitializing it. The thread that creates the fftw plan has to be the
-    same that destroys it. Otherwise segmentation faults can happen. As we do not want to do this initializing in the
-    plugin realtime thread we send it to the main thread through g_idle_add().connect_once
+    Computing the filter kernels and their spectra allocates and may need new fftw plans. As we do not want to do this
+    in the plugin realtime thread we send it to the main thread. The old filters are also destroyed in the main thread
+    after the new ones are published.
   */
 
-  util::idle_add([&, this] {
-    if (filters_are_ready) {
-      return;
-    }
-
-    blocksize = n_samples;
-
-    n_samples_is_power_of_2 = (n_samples & (n_samples - 1U)) == 0 && n_samples != 0U;
+  if (const auto* e = engine.peek(); e != nullptr && e->n_samples == n_samples && e->rate == rate) {
+    return;
+  }
 
-    if (!n_samples_is_power_of_2) {
-      while ((blocksize & (blocksize - 1U)) != 0 && blocksize > 2U) {
-        blocksize--;
-      }
-    }
+  if (n_samples == 0U || rate == 0U) {
+    return;
+  }
 
-    util::debug(log_tag + name + " blocksize: " + util::to_string(blocksize));
+  auto new_engine = std::make_unique<Engine>();
 
-    notify_latency = true;
-    do_first_rotation = true;
+  new_engine->n_samples = n_samples;
+  new_engine->rate = rate;
+  new_engine->blocksize = BlockAdapter::fft_block_size(n_samples);
 
-    latency_n_frames = 1U;  // the second derivative forces us to delay at least one sample
+  const auto& blocksize = new_engine->blocksize;
 
-    deque_out_L.resize(0U);
-    deque_out_R.resize(0U);
+  util::debug(log_tag + name + " blocksize: " + util::to_string(blocksize));
 
-    data_L.resize(0U);
-    data_R.resize(0U);
+  new_engine->adapter.setup(blocksize, n_samples);
 
-    for (uint n = 0U; n < nbands; n++) {
-      band_data_L.at(n).resize(blocksize);
-      band_data_R.at(n).resize(blocksize);
+  std::vector<std::vector<float>> kernels(nbands);
 
-      band_second_derivative_L.at(n).resize(blocksize);
-      band_second_derivative_R.at(n).resize(blocksize);
-    }
+  for (uint n = 0U; n < nbands; n++) {
+    FirFilterBandpass filter(log_tag + name + " band" + util::to_string(n));
 
-    for (uint n = 0U; n < nbands; n++) {
-      filters.at(n)->set_n_samples(blocksize);
-      filters.at(n)->set_rate(rate);
+    filter.set_kernel_only(true);
+    filter.set_rate(rate);
+    filter.set_min_frequency(frequencies.at(n));
+    filter.set_max_frequency(frequencies.at(n + 1U));
 
-      filters.at(n)->set_min_frequency(frequencies.at(n));
-      filters.at(n)->set_max_frequency(frequencies.at(n + 1U));
+    filter.setup();
 
-      filters.at(n)->setup();
-    }
+    kernels[n] = filter.get_kernel();
 
-    data_mutex.lock();
+    new_engine->band_data_L.at(n).assign(blocksize + 2U, 0.0F);
+    new_engine->band_data_R.at(n).assign(blocksize + 2U, 0.0F);
+  }
 
-    filters_are_ready = true;
+  new_engine->bank.setup(blocksize, 2U, kernels);
 
-    data_mutex.unlock();
-  });
+  engine.publish(std::move(new_engine));
 }
 
 void Crystalizer::process(std::span<float>& left_in,
                           std::span<float>& right_in,
                           std::span<float>& left_out,
                           std::span<float>& right_out) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  const auto e = engine.read();
 
-  if (bypass || !filters_are_ready) {
+  if (bypass || !e || e->n_samples != n_samples || e->rate != rate) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
     return;
   }
 
-  if (input_gain != 1.0F) {
-    apply_gain(left_in, right_in, input_gain);
-  }
+  if (e.generation() != engine_generation) {
+    notify_latency = true;
 
-  if (n_samples_is_power_of_2 && blocksize == n_samples) {
-    std::copy(left_in.begin(), left_in.end(), left_out.begin());
-    std::copy(right_in.begin(), right_in.end(), right_out.begin());
+    // the second derivative forces us to delay at least one sample
 
-    enhance_peaks(left_out, right_out);
-  } else {
-    for (size_t j = 0U; j < left_in.size(); j++) {
-      data_L.push_back(left_in[j]);
-      data_R.push_back(right_in[j]);
+    latency_n_frames = e->adapter.get_latency_frames() + 1U;
 
-      if (data_L.size() == blocksize) {
-        enhance_peaks(data_L, data_R);
+    engine_generation = e.generation();
+  }
 
-        for (const auto& v : data_L) {
-          deque_out_L.push_back(v);
-        }
+  if (input_gain != 1.0F) {
+    apply_gain(left_in, right_in, input_gain);
+  }
 
-        for (const auto& v : data_R) {
-          deque_out_R.push_back(v);
-        }
+  e->adapter.process(left_in, right_in, left_out, right_out,
+                     [&](std::span<float> block_L, std::span<float> block_R) { enhance_peaks(*e, block_L, block_R); });
 
-        data_L.resize(0U);
-        data_R.resize(0U);
-      }
-    }
+  if (output_gain != 1.0F) {
+    apply_gain(left_out, right_out, output_gain);
+  }
 
-    // copying the processed samples to the output buffers
+  if (notify_latency) {
+    latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    if (deque_out_L.size() >= left_out.size()) {
-      for (float& v : left_out) {
-        v = deque_out_L.front();
+    post_latency();
 
-        deque_out_L.pop_front();
-      }
+    notify_latency = false;
+  }
 
-      for (float& v : right_out) {
-        v = deque_out_R.front();
+  if (post_messages) {
+    get_peaks(left_in, right_in, left_out, right_out);
 
-        deque_out_R.pop_front();
-      }
-    } else {
-      uint offset = 2U * (left_out.size() - deque_out_L.size());
+    if (send_notifications) {
+      notify();
+    }
+  }
+}
 
-      if (offset != latency_n_frames) {
-        latency_n_frames = offset + 1U;  // the second derivative forces us to delay at least one sample
+void Crystalizer::enhance_peaks(Engine& e, std::span<float> data_left, std::span<float> data_right) {
+  for (uint n = 0U; n < nbands; n++) {
+    e.outputs_L[n] = band_mute[n] ? std::span<float>() : std::span(e.band_data_L[n]).subspan(2U);
+    e.outputs_R[n] = band_mute[n] ? std::span<float>() : std::span(e.band_data_R[n]).subspan(2U);
+  }
 
-        notify_latency = true;
-      }
+  // The input spectrum is computed once per channel and shared by all the bands.
 
-      for (uint n = 0U; !deque_out_L.empty() && n < left_out.size(); n++) {
-        if (n < offset) {
-          left_out[n] = 0.0F;
-          right_out[n] = 0.0F;
-        } else {
-          left_out[n] = deque_out_L.front();
-          right_out[n] = deque_out_R.front();
+  e.bank.process(0U, data_left, e.outputs_L);
+  e.bank.process(1U, data_right, e.outputs_R);
 
-          deque_out_R.pop_front();
-          deque_out_L.pop_front();
-        }
-      }
+  std::ranges::fill(data_left, 0.0F);
+  std::ranges::fill(data_right, 0.0F);
+
+  for (uint n = 0U; n < nbands; n++) {
+    if (band_mute[n]) {
+      continue;
     }
-  }
 
-  if (output_gain != 1.0F) {
-    apply_gain(left_out, right_out, output_gain);
+    const auto intensity = band_bypass[n] ? 0.0F : band_intensity[n];
+
+    add_enhanced_band(e.band_data_L[n], data_left, intensity);
+    add_enhanced_band(e.band_data_R[n], data_right, intensity);
   }
+}
 
-  if (notify_latency) {
-    latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
+void Crystalizer::add_enhanced_band(std::span<float> band, std::span<float> output, const float& intensity) {
+  /*
+    Peaks are enhanced by subtracting the second derivative of the band, calculated through the central difference
+    method. The derivative at the last sample needs the first one of the next block, so the band is delayed by one
+    sample. band[0] and band[1] are the last two samples of the previous block and band[m + 2] is the current sample m.
+  */
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
+  const auto blocksize = output.size();
 
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
+  const auto* x = band.data();
 
-      latency.emit();
-    });
+  auto* y = output.data();
 
-    update_filter_params();
+  for (size_t m = 0U; m < blocksize; m++) {
+    const auto d2 = x[m + 2U] - 2.0F * x[m + 1U] + x[m];
 
-    notify_latency = false;
+    y[m] += x[m + 1U] - intensity * d2;
   }
 
-  if (post_messages) {
-    get_peaks(left_in, right_in, left_out, right_out);
-
-    if (send_notifications) {
-      notify();
-    }
-  }
+  band[0] = band[blocksize];
+  band[1] = band[blocksize + 1U];
 }
 
 void Crystalizer::bind_band(const int& n) {
@@ -19,11 +19,13 @@
 
 #include "deepfilternet.hpp"
 #include <algorithm>
+#include <cstddef>
 #include <memory>
-#include <mutex>
 #include <span>
 #include <string>
+#include <utility>
 #include <vector>
+#include "block_adapter.hpp"
 #include "ladspa_wrapper.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
@@ -80,60 +82,74 @@ DeepFilterNet::~DeepFilterNet() {
 }
 
 void DeepFilterNet::setup() {
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
   if (!ladspa_wrapper->found_plugin()) {
     return;
   }
 
   resample = rate != 48000;
-  resampler_ready = !resample;
+}
 
-  util::idle_add([&, this] {
-    ladspa_wrapper->n_samples = n_samples;
-    std::scoped_lock<std::mutex> lock(data_mutex);
+void DeepFilterNet::setup_engine(const uint& n_samples, const uint& rate) {
+  if (!ladspa_wrapper->found_plugin()) {
+    return;
+  }
 
-    if (ladspa_wrapper->get_rate() != 48000) {
-      ladspa_wrapper->create_instance(48000);
-      ladspa_wrapper->activate();
-    }
+  /*
+    The ladspa instance and the resamplers are created in the main thread. The realtime thread only starts to use them
+    after the engine holding the resamplers is published.
+  */
 
-    if (resample && !resampler_ready) {
-      resampler_inL = std::make_unique<Resampler>(rate, 48000);
-      resampler_inR = std::make_unique<Resampler>(rate, 48000);
-      resampler_outL = std::make_unique<Resampler>(48000, rate);
-      resampler_outR = std::make_unique<Resampler>(48000, rate);
+  ladspa_wrapper->n_samples = n_samples;
 
-      std::vector<float> dummy(n_samples);
+  if (ladspa_wrapper->get_rate() != 48000) {
+    ladspa_wrapper->create_instance(48000);
+    ladspa_wrapper->activate();
+  }
 
-      const auto resampled_inL = resampler_inL->process(dummy, false);
-      const auto resampled_inR = resampler_inR->process(dummy, false);
+  auto new_engine = std::make_unique<Engine>();
 
-      resampled_outL.resize(resampled_inL.size());
-      resampled_outR.resize(resampled_inR.size());
+  new_engine->n_samples = n_samples;
+  new_engine->rate = rate;
 
-      resampler_outL->process(resampled_inL, false);
-      resampler_outR->process(resampled_inR, false);
+  if (rate != 48000) {
+    new_engine->resampler_in = std::make_unique<Resampler>(rate, 48000, 2U, n_samples, Resampler::Quality::polyphase);
 
-      carryover_l.clear();
-      carryover_r.clear();
-      carryover_l.reserve(4);  // chosen by fair dice roll.
-      carryover_r.reserve(4);  // guaranteed to be random.
-      carryover_l.push_back(0.0F);
-      carryover_r.push_back(0.0F);
+    const auto max_resampled = static_cast<uint>(new_engine->resampler_in->get_max_output_frames());
 
-      resampler_ready = true;
-    }
-  });
+    new_engine->resampler_out =
+        std::make_unique<Resampler>(48000, rate, 2U, max_resampled, Resampler::Quality::polyphase);
+
+    new_engine->resampled_inL.resize(max_resampled);
+    new_engine->resampled_inR.resize(max_resampled);
+
+    new_engine->resampled_outL.resize(max_resampled);
+    new_engine->resampled_outR.resize(max_resampled);
+
+    new_engine->outL.resize(new_engine->resampler_out->get_max_output_frames());
+    new_engine->outR.resize(new_engine->resampler_out->get_max_output_frames());
+
+    // A little priming, as the two resamplers together may give a sample or two less than a quantum in some cycles.
+
+    const auto fifo_size = 4U * static_cast<size_t>(n_samples);
+
+    new_engine->fifo_out_L.resize(fifo_size);
+    new_engine->fifo_out_R.resize(fifo_size);
+
+    new_engine->fifo_out_L.push_zeros(2U);
+    new_engine->fifo_out_R.push_zeros(2U);
+  }
+
+  engine.publish(std::move(new_engine));
 }
 
 void DeepFilterNet::process(std::span<float>& left_in,
                             std::span<float>& right_in,
                             std::span<float>& left_out,
                             std::span<float>& right_out) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  const auto e = engine.read();
 
-  if (!ladspa_wrapper->found_plugin() || !ladspa_wrapper->has_instance() || bypass) {
+  if (!ladspa_wrapper->found_plugin() || !ladspa_wrapper->has_instance() || bypass || !e ||
+      e->n_samples != n_samples || e->rate != rate) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -145,52 +161,29 @@ void DeepFilterNet::process(std::span<float>& left_in,
   }
 
   if (resample) {
-    const auto& resampled_inL = resampler_inL->process(left_in, false);
-    const auto& resampled_inR = resampler_inR->process(right_in, false);
+    const auto n_resampled = e->resampler_in->process(left_in, right_in, e->resampled_inL, e->resampled_inR);
 
-    resampled_outL.resize(resampled_inL.size());
-    resampled_outR.resize(resampled_inR.size());
+    const auto resampled_inL = std::span(e->resampled_inL).first(n_resampled);
+    const auto resampled_inR = std::span(e->resampled_inR).first(n_resampled);
+    const auto resampled_outL = std::span(e->resampled_outL).first(n_resampled);
+    const auto resampled_outR = std::span(e->resampled_outR).first(n_resampled);
 
-    ladspa_wrapper->n_samples = resampled_inL.size();
+    ladspa_wrapper->n_samples = n_resampled;
     ladspa_wrapper->connect_data_ports(resampled_inL, resampled_inR, resampled_outL, resampled_outR);
-  } else {
-    ladspa_wrapper->connect_data_ports(left_in, right_in, left_out, right_out);
-  }
-
-  ladspa_wrapper->run();
-
-  if (resample) {
-    const auto& outL = resampler_outL->process(resampled_outL, false);
-    const auto& outR = resampler_outR->process(resampled_outR, false);
-
-    auto carryover_end_l = std::min(carryover_l.size(), left_out.size());
-    auto carryover_end_r = std::min(carryover_r.size(), right_out.size());
-
-    auto left_offset =
-        carryover_end_l + outL.size() > left_out.size() ? carryover_end_l : left_out.size() - outL.size();
-    auto right_offset =
-        carryover_end_r + outR.size() > right_out.size() ? carryover_end_r : right_out.size() - outR.size();
-
-    auto left_count = std::min(outL.size(), left_out.size() - left_offset);
-    auto right_count = std::min(outR.size(), right_out.size() - right_offset);
 
-    std::copy(carryover_l.begin(), carryover_l.begin() + carryover_end_l, left_out.begin());
-    std::copy(carryover_r.begin(), carryover_r.begin() + carryover_end_r, right_out.begin());
+    ladspa_wrapper->run();
 
-    carryover_l.erase(carryover_l.begin(), carryover_l.begin() + carryover_end_l);
-    carryover_r.erase(carryover_r.begin(), carryover_r.begin() + carryover_end_r);
+    const auto n_out = e->resampler_out->process(resampled_outL, resampled_outR, e->outL, e->outR);
 
-    std::fill(left_out.begin() + carryover_end_l, left_out.begin() + left_offset, 0);
-    std::fill(right_out.begin() + carryover_end_r, right_out.begin() + right_offset, 0);
+    e->fifo_out_L.push(std::span(e->outL).first(n_out));
+    e->fifo_out_R.push(std::span(e->outR).first(n_out));
 
-    std::copy(outL.begin(), outL.begin() + left_count, left_out.begin() + left_offset);
-    std::copy(outR.begin(), outR.begin() + right_count, right_out.begin() + right_offset);
-
-    carryover_l.insert(carryover_l.end(), outL.begin() + left_count, outL.end());
-    carryover_r.insert(carryover_r.end(), outR.begin() + right_count, outR.end());
+    e->fifo_out_L.pop_or_pad(left_out);
+    e->fifo_out_R.pop_or_pad(right_out);
+  } else {
+    ladspa_wrapper->connect_data_ports(left_in, right_in, left_out, right_out);
 
-    std::fill(left_out.begin() + left_offset + left_count, left_out.end(), 0);
-    std::fill(right_out.begin() + right_offset + right_count, right_out.end(), 0);
+    ladspa_wrapper->run();
   }
 
   if (output_gain != 1.0F) {
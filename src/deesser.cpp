@@ -26,6 +26,7 @@
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 Deesser::Deesser(const std::string& tag,
@@ -48,6 +49,9 @@ Deesser::Deesser(const std::string& tag,
     util::debug(log_tag + "http://calf.sourceforge.net/plugins/Deesser is not installed");
   }
 
+  port_detected = lv2_wrapper->get_control_port<"detected">();
+  port_compression = lv2_wrapper->get_control_port<"compression">();
+
   lv2_wrapper->bind_key_enum<"mode", "mode">(settings);
 
   lv2_wrapper->bind_key_enum<"detection", "detection">(settings);
@@ -83,23 +87,11 @@ Deesser::~Deesser() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void Deesser::setup() {
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (lv2_wrapper->get_rate() != rate) {
-    lv2_wrapper->create_instance(rate);
-  }
-}
-
 void Deesser::process(std::span<float>& left_in,
                       std::span<float>& right_in,
                       std::span<float>& left_out,
                       std::span<float>& right_out) {
-  if (!lv2_wrapper->found_plugin || !lv2_wrapper->has_instance() || bypass) {
+  if (!lv2_wrapper->found_plugin || !lv2_ready || bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -123,11 +115,11 @@ void Deesser::process(std::span<float>& left_in,
     if (send_notifications) {
       // values needed as double for levelbars widget ui, so we convert them here
 
-      detected_port_value = static_cast<double>(lv2_wrapper->get_control_port_value("detected"));
-      compression_port_value = static_cast<double>(lv2_wrapper->get_control_port_value("compression"));
+      detected_port_value = static_cast<double>(lv2_wrapper->get_control_port_value(port_detected));
+      compression_port_value = static_cast<double>(lv2_wrapper->get_control_port_value(port_compression));
 
-      detected.emit(detected_port_value);
-      compression.emit(compression_port_value);
+      post_meter(detected_meter, {static_cast<float>(detected_port_value)});
+      post_meter(compression_meter, {static_cast<float>(compression_port_value)});
 
       notify();
     }
@@ -137,3 +129,19 @@ void Deesser::process(std::span<float>& left_in,
 auto Deesser::get_latency_seconds() -> float {
   return 0.0F;
 }
+
+void Deesser::on_meter(const telemetry::Record& record) {
+  switch (record.id) {
+    case detected_meter:
+      detected.emit(record.values[0]);
+      break;
+
+    case compression_meter:
+      compression.emit(record.values[0]);
+      break;
+
+    default:
+      PluginBase::on_meter(record);
+      break;
+  }
+}
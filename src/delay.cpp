@@ -27,6 +27,7 @@
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 Delay::Delay(const std::string& tag,
@@ -49,6 +50,8 @@ Delay::Delay(const std::string& tag,
     util::debug(log_tag + "http://lsp-plug.in/plugins/lv2/comp_delay_x2_stereo is not installed");
   }
 
+  port_out_latency = lv2_wrapper->get_control_port<"out_latency">();
+
   lv2_wrapper->set_control_port_value("mode_l", 2);
   lv2_wrapper->set_control_port_value("mode_r", 2);
 
@@ -76,23 +79,11 @@ Delay::~Delay() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void Delay::setup() {
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (lv2_wrapper->get_rate() != rate) {
-    lv2_wrapper->create_instance(rate);
-  }
-}
-
 void Delay::process(std::span<float>& left_in,
                     std::span<float>& right_in,
                     std::span<float>& left_out,
                     std::span<float>& right_out) {
-  if (!lv2_wrapper->found_plugin || !lv2_wrapper->has_instance() || bypass) {
+  if (!lv2_wrapper->found_plugin || !lv2_ready || bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -114,24 +105,14 @@ void Delay::process(std::span<float>& left_in,
     This plugin gives the latency in number of samples
   */
 
-  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value("out_latency"));
+  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value(port_out_latency));
 
   if (latency_n_frames != lv) {
     latency_n_frames = lv;
 
     latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
-
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
-
-      latency.emit();
-    });
-
-    update_filter_params();
+    post_latency();
   }
 
   if (post_messages) {
@@ -22,8 +22,10 @@
 #include <glib-unix.h>
 #include <glib.h>
 #include <libintl.h>
+#include <unistd.h>
 #include <cerrno>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <iostream>
 #include <ostream>
@@ -68,6 +70,14 @@ auto main(int argc, char* argv[]) -> int {
 
     g_object_unref(app);
 
+    if (app::restart_requested()) {
+      util::info("restarting to use the new output layout");
+
+      execv("/proc/self/exe", argv);
+
+      util::warning("could not restart: " + std::string(std::strerror(errno)));
+    }
+
     util::debug("Exitting the main function with status: " + util::to_string(status, ""));
 
     return status;
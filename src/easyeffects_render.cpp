@@ -0,0 +1,174 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <glib.h>
+#include <libintl.h>
+#include <sys/types.h>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "offline_renderer.hpp"
+#include "pipeline_type.hpp"
+#include "util.hpp"
+
+/*
+  Renders a preset over an audio file without PipeWire and without a graphical session. Usage example:
+
+  easyeffects-render --preset my_preset.json --input song.flac --output processed.wav --quantum 1024
+
+  With --reference the rendered file is compared with a known good one and the exit status tells if they match. With
+  --benchmark the process method of each plugin is timed for several quanta and sampling rates instead.
+*/
+
+namespace {
+
+void print_benchmark(const std::vector<OfflineRenderer::BenchmarkResult>& results) {
+  std::cout << fmt::format("{:<22}{:>9}{:>9}{:>12}{:>14}{:>12}\n", "plugin", "quantum", "rate", "ns/sample",
+                           "worst (us)", "worst load");
+
+  for (const auto& r : results) {
+    std::cout << fmt::format("{:<22}{:>9}{:>9}{:>12.2f}{:>14.1f}{:>11.1f}%\n", r.plugin, r.quantum, r.rate,
+                             r.ns_per_sample, r.worst_quantum_us, 100.0 * r.worst_load);
+  }
+}
+
+}  // namespace
+
+auto main(int argc, char* argv[]) -> int {
+  util::debug("easyeffects-render version: " + std::string(VERSION));
+
+  /*
+    The preset is written to the plugins settings before they are created. A memory backend keeps the user
+    configuration untouched.
+  */
+
+  g_setenv("GSETTINGS_BACKEND", "memory", 1);
+
+  bindtextdomain(GETTEXT_PACKAGE, LOCALE_DIR);
+  bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
+  textdomain(GETTEXT_PACKAGE);
+
+  gchar* preset = nullptr;
+  gchar* input = nullptr;
+  gchar* output = nullptr;
+  gchar* pipeline = nullptr;
+  gchar* reference = nullptr;
+  gint quantum = 512;
+  gint rate = 0;
+  gboolean no_latency_compensation = 0;
+  gboolean benchmark = 0;
+  gdouble benchmark_seconds = 1.0;
+  gdouble tolerance = -90.0;
+
+  // NOLINTBEGIN(modernize-avoid-c-arrays)
+  GOptionEntry entries[] = {
+      {"preset", 'p', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &preset, "Preset file", "FILE"},
+      {"input", 'i', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &input, "Audio file to be processed", "FILE"},
+      {"output", 'o', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &output,
+       "Rendered file. The format is FLAC when the extension is .flac and 32 bit float WAV otherwise", "FILE"},
+      {"pipeline", 't', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &pipeline,
+       "Pipeline section of the preset: output (default) or input", "TYPE"},
+      {"quantum", 'q', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &quantum, "Frames per processing cycle (default 512)",
+       "N"},
+      {"rate", 'r', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &rate, "Processing rate. The default is the file rate",
+       "HZ"},
+      {"no-latency-compensation", 'n', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &no_latency_compensation,
+       "Keep the pipeline delay at the beginning of the output", nullptr},
+      {"reference", 'R', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &reference,
+       "Fail when the rendered file differs from this one", "FILE"},
+      {"tolerance", 'T', G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, &tolerance,
+       "Largest difference from the reference, in dB relative to full scale (default -90)", "DB"},
+      {"benchmark", 'b', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &benchmark,
+       "Time the plugins of the preset, or all of them when no preset is given, instead of rendering a file",
+       nullptr},
+      {"benchmark-seconds", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, &benchmark_seconds,
+       "Audio duration processed for each quantum and rate (default 1)", "SECONDS"},
+      {nullptr}};
+  // NOLINTEND(modernize-avoid-c-arrays)
+
+  auto* context = g_option_context_new("- render an Easy Effects preset over an audio file");
+
+  g_option_context_add_main_entries(context, entries, GETTEXT_PACKAGE);
+
+  GError* error = nullptr;
+
+  if (g_option_context_parse(context, &argc, &argv, &error) == 0) {
+    std::cerr << error->message << '\n';
+
+    g_error_free(error);
+    g_option_context_free(context);
+
+    return EXIT_FAILURE;
+  }
+
+  g_option_context_free(context);
+
+  if (quantum <= 0 || rate < 0 ||
+      (benchmark == 0 && (preset == nullptr || input == nullptr || output == nullptr))) {
+    std::cerr << "the preset, input and output files are required and the quantum has to be positive" << '\n';
+
+    return EXIT_FAILURE;
+  }
+
+  const auto pipeline_type =
+      (pipeline != nullptr && std::string(pipeline) == "input") ? PipelineType::input : PipelineType::output;
+
+  auto status = EXIT_SUCCESS;
+
+  try {
+    OfflineRenderer renderer(pipeline_type, static_cast<uint>(quantum), static_cast<uint>(rate));
+
+    renderer.compensate_latency = no_latency_compensation == 0;
+
+    if (benchmark != 0) {
+      if (preset != nullptr && !renderer.load_preset(preset)) {
+        status = EXIT_FAILURE;
+      } else {
+        // power of two and non power of two quanta. 480 is the RNNoise frame size.
+        const std::vector<uint> quanta = {32U, 64U, 100U, 128U, 256U, 480U, 512U, 1000U, 1024U, 2048U, 4096U, 8192U};
+
+        const std::vector<uint> rates = (rate > 0) ? std::vector<uint>{static_cast<uint>(rate)}
+                                                   : std::vector<uint>{44100U, 48000U, 96000U};
+
+        print_benchmark(renderer.benchmark(quanta, rates, benchmark_seconds));
+      }
+    } else if (!renderer.load_preset(preset) || !renderer.render(input, output) ||
+               (reference != nullptr && !renderer.compare(output, reference, tolerance))) {
+      status = EXIT_FAILURE;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << '\n';
+
+    status = EXIT_FAILURE;
+  }
+
+  g_free(preset);
+  g_free(input);
+  g_free(output);
+  g_free(pipeline);
+  g_free(reference);
+
+  return status;
+}
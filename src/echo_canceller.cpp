@@ -28,12 +28,14 @@
 #include <algorithm>
 #include <climits>
 #include <cstddef>
-#include <mutex>
+#include <memory>
 #include <span>
 #include <string>
+#include <utility>
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 EchoCanceller::EchoCanceller(const std::string& tag,
@@ -49,54 +51,36 @@ EchoCanceller::EchoCanceller(const std::string& tag,
                  pipe_manager,
                  pipe_type,
                  true),
+      filter_length_ms(g_settings_get_int(settings, "filter-length")),
       residual_echo_suppression(g_settings_get_int(settings, "residual-echo-suppression")),
       near_end_suppression(g_settings_get_int(settings, "near-end-suppression")) {
+  publish_params();
+
   gconnections.push_back(g_signal_connect(settings, "changed::filter-length",
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<EchoCanceller*>(user_data);
 
-                                            std::scoped_lock<std::mutex> lock(self->data_mutex);
-
                                             self->filter_length_ms = g_settings_get_int(settings, key);
 
-                                            self->init_speex();
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
-  gconnections.push_back(g_signal_connect(
-      settings, "changed::residual-echo-suppression",
-      G_CALLBACK(+[](GSettings* settings, char* key, EchoCanceller* self) {
-        std::scoped_lock<std::mutex> lock(self->data_mutex);
-
-        self->residual_echo_suppression = g_settings_get_int(settings, key);
-
-        if (self->state_left) {
-          speex_preprocess_ctl(self->state_left, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS, &self->residual_echo_suppression);
-        }
-
-        if (self->state_right) {
-          speex_preprocess_ctl(self->state_right, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS, &self->residual_echo_suppression);
-        }
-      }),
-      this));
+  gconnections.push_back(g_signal_connect(settings, "changed::residual-echo-suppression",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, EchoCanceller* self) {
+                                            self->residual_echo_suppression = g_settings_get_int(settings, key);
 
-  gconnections.push_back(g_signal_connect(
-      settings, "changed::near-end-suppression", G_CALLBACK(+[](GSettings* settings, char* key, EchoCanceller* self) {
-        std::scoped_lock<std::mutex> lock(self->data_mutex);
-
-        self->near_end_suppression = g_settings_get_int(settings, key);
+                                            self->publish_params();
+                                          }),
+                                          this));
 
-        if (self->state_left) {
-          speex_preprocess_ctl(self->state_left, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS_ACTIVE,
-                               &self->near_end_suppression);
-        }
+  gconnections.push_back(g_signal_connect(settings, "changed::near-end-suppression",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, EchoCanceller* self) {
+                                            self->near_end_suppression = g_settings_get_int(settings, key);
 
-        if (self->state_right) {
-          speex_preprocess_ctl(self->state_right, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS_ACTIVE,
-                               &self->near_end_suppression);
-        }
-      }),
-      this));
+                                            self->publish_params();
+                                          }),
+                                          this));
 
   setup_input_output_gain();
 }
@@ -106,35 +90,22 @@ EchoCanceller::~EchoCanceller() {
     disconnect_from_pw();
   }
 
-  data_mutex.lock();
-
-  ready = false;
-
-  if (echo_state_L != nullptr) {
-    speex_echo_state_destroy(echo_state_L);
-  }
-
-  if (echo_state_R != nullptr) {
-    speex_echo_state_destroy(echo_state_R);
-  }
-
-  free_speex();
-
-  data_mutex.unlock();
-
   util::debug(log_tag + name + " destroyed");
 }
 
 void EchoCanceller::setup() {
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  ready = false;
-
   notify_latency = true;
 
   latency_n_frames = 0U;
+}
 
-  init_speex();
+void EchoCanceller::setup_engine(const uint& n_samples, const uint& rate) {
+  /*
+    The speex states allocate memory when they are created. So they are built in the main thread and published to
+    the realtime thread.
+  */
+
+  init_speex(n_samples, rate);
 }
 
 void EchoCanceller::process(std::span<float>& left_in,
@@ -143,15 +114,28 @@ void EchoCanceller::process(std::span<float>& left_in,
                             std::span<float>& right_out,
                             std::span<float>& probe_left,
                             std::span<float>& probe_right) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  const auto e = engine.read();
 
-  if (bypass || !ready) {
+  if (bypass || !e || e->n_samples != n_samples || e->rate != rate) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
     return;
   }
 
+  if (const auto p = params.read(); p && (p.generation() != params_generation || e.generation() != engine_generation)) {
+    e->apply(*p);
+
+    params_generation = p.generation();
+    engine_generation = e.generation();
+  }
+
+  auto& data_L = e->data_L;
+  auto& data_R = e->data_R;
+  auto& probe_mono = e->probe_mono;
+  auto& filtered_L = e->filtered_L;
+  auto& filtered_R = e->filtered_R;
+
   if (input_gain != 1.0F) {
     apply_gain(left_in, right_in, input_gain);
   }
@@ -168,11 +152,11 @@ void EchoCanceller::process(std::span<float>& left_in,
     probe_mono[j] = static_cast<spx_int16_t>(0.5F * (probe_left[j] + probe_right[j]) * (SHRT_MAX + 1));
   }
 
-  speex_echo_cancellation(echo_state_L, data_L.data(), probe_mono.data(), filtered_L.data());
-  speex_echo_cancellation(echo_state_R, data_R.data(), probe_mono.data(), filtered_R.data());
+  speex_echo_cancellation(e->echo_state_L, data_L.data(), probe_mono.data(), filtered_L.data());
+  speex_echo_cancellation(e->echo_state_R, data_R.data(), probe_mono.data(), filtered_R.data());
 
-  speex_preprocess_run(state_left, filtered_L.data());
-  speex_preprocess_run(state_right, filtered_R.data());
+  speex_preprocess_run(e->state_left, filtered_L.data());
+  speex_preprocess_run(e->state_right, filtered_R.data());
 
   for (size_t j = 0U; j < filtered_L.size(); j++) {
     left_out[j] = static_cast<float>(filtered_L[j]) * inv_short_max;
@@ -185,19 +169,9 @@ void EchoCanceller::process(std::span<float>& left_in,
   }
 
   if (notify_latency) {
-    const float latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
-
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
-
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
-
-      latency.emit();
-    });
+    latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    update_filter_params();
+    post_latency();
 
     notify_latency = false;
   }
@@ -211,72 +185,69 @@ void EchoCanceller::process(std::span<float>& left_in,
   }
 }
 
-void EchoCanceller::init_speex() {
+void EchoCanceller::init_speex(const uint& n_samples, const uint& rate) {
   if (n_samples == 0U || rate == 0U) {
     return;
   }
 
-  data_L.resize(n_samples);
-  data_R.resize(n_samples);
-  probe_mono.resize(n_samples);
-  filtered_L.resize(n_samples);
-  filtered_R.resize(n_samples);
+  auto new_engine = std::make_unique<Engine>();
+
+  new_engine->n_samples = n_samples;
+  new_engine->rate = rate;
+
+  new_engine->data_L.resize(n_samples);
+  new_engine->data_R.resize(n_samples);
+  new_engine->probe_mono.resize(n_samples);
+  new_engine->filtered_L.resize(n_samples);
+  new_engine->filtered_R.resize(n_samples);
 
   const uint filter_length = static_cast<uint>(0.001F * static_cast<float>(filter_length_ms * rate));
 
   util::debug(log_tag + name + " filter length: " + util::to_string(filter_length));
 
-  if (echo_state_L != nullptr) {
-    speex_echo_state_destroy(echo_state_L);
-  }
+  int speex_rate = static_cast<int>(rate);
 
-  echo_state_L = speex_echo_state_init(static_cast<int>(n_samples), static_cast<int>(filter_length));
+  new_engine->echo_state_L = speex_echo_state_init(static_cast<int>(n_samples), static_cast<int>(filter_length));
 
-  if (speex_echo_ctl(echo_state_L, SPEEX_ECHO_SET_SAMPLING_RATE, &rate) != 0) {
+  if (speex_echo_ctl(new_engine->echo_state_L, SPEEX_ECHO_SET_SAMPLING_RATE, &speex_rate) != 0) {
     util::warning(log_tag + name + "SPEEX_ECHO_SET_SAMPLING_RATE: unknown request");
   }
 
-  if (echo_state_R != nullptr) {
-    speex_echo_state_destroy(echo_state_R);
-  }
-
-  echo_state_R = speex_echo_state_init(static_cast<int>(n_samples), static_cast<int>(filter_length));
+  new_engine->echo_state_R = speex_echo_state_init(static_cast<int>(n_samples), static_cast<int>(filter_length));
 
-  if (speex_echo_ctl(echo_state_R, SPEEX_ECHO_SET_SAMPLING_RATE, &rate) != 0) {
+  if (speex_echo_ctl(new_engine->echo_state_R, SPEEX_ECHO_SET_SAMPLING_RATE, &speex_rate) != 0) {
     util::warning(log_tag + name + "SPEEX_ECHO_SET_SAMPLING_RATE: unknown request");
   }
 
-  if (state_left != nullptr) {
-    speex_preprocess_state_destroy(state_left);
-  }
-
-  if (state_right != nullptr) {
-    speex_preprocess_state_destroy(state_right);
-  }
+  new_engine->state_left = speex_preprocess_state_init(static_cast<int>(n_samples), static_cast<int>(rate));
+  new_engine->state_right = speex_preprocess_state_init(static_cast<int>(n_samples), static_cast<int>(rate));
 
-  state_left = speex_preprocess_state_init(static_cast<int>(n_samples), static_cast<int>(rate));
-  state_right = speex_preprocess_state_init(static_cast<int>(n_samples), static_cast<int>(rate));
+  if (new_engine->state_left == nullptr || new_engine->state_right == nullptr) {
+    util::warning(log_tag + name + " failed to create the speex preprocessor");
 
-  if (state_left != nullptr) {
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_ECHO_STATE, echo_state_L);
+    return;
+  }
 
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS, &residual_echo_suppression);
+  speex_preprocess_ctl(new_engine->state_left, SPEEX_PREPROCESS_SET_ECHO_STATE, new_engine->echo_state_L);
+  speex_preprocess_ctl(new_engine->state_right, SPEEX_PREPROCESS_SET_ECHO_STATE, new_engine->echo_state_R);
 
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS_ACTIVE, &near_end_suppression);
-  }
+  engine.publish(std::move(new_engine));
+}
 
-  if (state_right != nullptr) {
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_ECHO_STATE, echo_state_R);
+void EchoCanceller::publish_params() {
+  params.publish(std::make_unique<Params>(Params{.residual_echo_suppression = residual_echo_suppression,
+                                                 .near_end_suppression = near_end_suppression}));
+}
 
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS, &residual_echo_suppression);
+void EchoCanceller::Engine::apply(Params& p) const {
+  for (auto* state : {state_left, state_right}) {
+    speex_preprocess_ctl(state, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS, &p.residual_echo_suppression);
 
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS_ACTIVE, &near_end_suppression);
+    speex_preprocess_ctl(state, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS_ACTIVE, &p.near_end_suppression);
   }
-
-  ready = true;
 }
 
-void EchoCanceller::free_speex() {
+EchoCanceller::Engine::~Engine() {
   if (state_left != nullptr) {
     speex_preprocess_state_destroy(state_left);
   }
@@ -285,10 +256,19 @@ void EchoCanceller::free_speex() {
     speex_preprocess_state_destroy(state_right);
   }
 
-  state_left = nullptr;
-  state_right = nullptr;
+  if (echo_state_L != nullptr) {
+    speex_echo_state_destroy(echo_state_L);
+  }
+
+  if (echo_state_R != nullptr) {
+    speex_echo_state_destroy(echo_state_R);
+  }
 }
 
 auto EchoCanceller::get_latency_seconds() -> float {
   return latency_value;
 }
+
+void EchoCanceller::rebuild() {
+  init_speex(n_samples, rate);
+}
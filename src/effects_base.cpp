@@ -21,12 +21,18 @@
 #include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
+#include <pipewire/proxy.h>
+#include <sys/types.h>
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <ranges>
+#include <set>
 #include <string>
 #include <utility>
+#include <vector>
 #include "autogain.hpp"
 #include "bass_enhancer.hpp"
 #include "bass_loudness.hpp"
@@ -42,6 +48,7 @@
 #include "exciter.hpp"
 #include "expander.hpp"
 #include "filter.hpp"
+#include "fused_chain.hpp"
 #include "gate.hpp"
 #include "level_meter.hpp"
 #include "limiter.hpp"
@@ -81,13 +88,7 @@ EffectsBase::EffectsBase(std::string tag, const std::string& schema, PipeManager
   spectrum = std::make_shared<Spectrum>(log_tag, tags::schema::spectrum::id, tags::app::path + "/spectrum/"s, pm,
                                         pipeline_type);
 
-  if (!output_level->connected_to_pw) {
-    output_level->connect_to_pw();
-  }
-
-  if (!spectrum->connected_to_pw) {
-    spectrum->connect_to_pw();
-  }
+  connect_nodes_to_pw({output_level, spectrum});
 
   create_filters_if_necessary();
 
@@ -112,6 +113,8 @@ EffectsBase::EffectsBase(std::string tag, const std::string& schema, PipeManager
                                                    for (auto& plugin : self->plugins | std::views::values) {
                                                      plugin->notification_time_window = 0.001F * v;
                                                    }
+
+                                                   self->start_telemetry_timer(v);
                                                  }),
                                                  this));
 
@@ -135,13 +138,31 @@ EffectsBase::EffectsBase(std::string tag, const std::string& schema, PipeManager
   for (auto& plugin : plugins | std::views::values) {
     plugin->notification_time_window = notification_time_window;
   }
+
+  start_telemetry_timer(g_settings_get_int(global_settings, "meters-update-interval"));
 }
 
 EffectsBase::~EffectsBase() {
+  if (telemetry_source_id != 0U) {
+    g_source_remove(telemetry_source_id);
+  }
+
+  if (relink_source_id != 0U) {
+    g_source_remove(relink_source_id);
+  }
+
+  cancel_chain_switch();
+
   for (auto& c : connections) {
     c.disconnect();
   }
 
+  for (auto& list : plugin_connections | std::views::values) {
+    for (auto& c : list) {
+      c.disconnect();
+    }
+  }
+
   for (auto& handler_id : gconnections) {
     g_signal_handler_disconnect(settings, handler_id);
   }
@@ -177,80 +198,94 @@ void EffectsBase::create_filters_if_necessary() {
       continue;
     }
 
-    auto instance_id = util::to_string(tags::plugin_name::get_id(name));
-
-    auto path = schema_base_path + tags::plugin_name::get_base_name(name) + "/" + instance_id + "/";
-
-    path.erase(std::remove(path.begin(), path.end(), '_'), path.end());
-
-    std::shared_ptr<PluginBase> filter;
-
-    if (name.starts_with(tags::plugin_name::autogain)) {
-      filter = std::make_shared<AutoGain>(log_tag, tags::schema::autogain::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::bass_enhancer)) {
-      filter = std::make_shared<BassEnhancer>(log_tag, tags::schema::bass_enhancer::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::bass_loudness)) {
-      filter = std::make_shared<BassLoudness>(log_tag, tags::schema::bass_loudness::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::compressor)) {
-      filter = std::make_shared<Compressor>(log_tag, tags::schema::compressor::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::convolver)) {
-      filter = std::make_shared<Convolver>(log_tag, tags::schema::convolver::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::crossfeed)) {
-      filter = std::make_shared<Crossfeed>(log_tag, tags::schema::crossfeed::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::crystalizer)) {
-      filter = std::make_shared<Crystalizer>(log_tag, tags::schema::crystalizer::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::deepfilternet)) {
-      filter = std::make_shared<DeepFilterNet>(log_tag, tags::schema::deepfilternet::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::deesser)) {
-      filter = std::make_shared<Deesser>(log_tag, tags::schema::deesser::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::delay)) {
-      filter = std::make_shared<Delay>(log_tag, tags::schema::delay::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::echo_canceller)) {
-      filter = std::make_shared<EchoCanceller>(log_tag, tags::schema::echo_canceller::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::exciter)) {
-      filter = std::make_shared<Exciter>(log_tag, tags::schema::exciter::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::expander)) {
-      filter = std::make_shared<Expander>(log_tag, tags::schema::expander::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::equalizer)) {
-      filter = std::make_shared<Equalizer>(
-          log_tag, tags::schema::equalizer::id, path, tags::schema::equalizer::channel_id,
-          schema_base_path + "equalizer/" + instance_id + "/leftchannel/",
-          schema_base_path + "equalizer/" + instance_id + "/rightchannel/", pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::filter)) {
-      filter = std::make_shared<Filter>(log_tag, tags::schema::filter::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::gate)) {
-      filter = std::make_shared<Gate>(log_tag, tags::schema::gate::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::level_meter)) {
-      filter = std::make_shared<LevelMeter>(log_tag, tags::schema::level_meter::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::limiter)) {
-      filter = std::make_shared<Limiter>(log_tag, tags::schema::limiter::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::loudness)) {
-      filter = std::make_shared<Loudness>(log_tag, tags::schema::loudness::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::maximizer)) {
-      filter = std::make_shared<Maximizer>(log_tag, tags::schema::maximizer::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::multiband_compressor)) {
-      filter = std::make_shared<MultibandCompressor>(log_tag, tags::schema::multiband_compressor::id, path, pm,
-                                                     pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::multiband_gate)) {
-      filter = std::make_shared<MultibandGate>(log_tag, tags::schema::multiband_gate::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::pitch)) {
-      filter = std::make_shared<Pitch>(log_tag, tags::schema::pitch::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::reverb)) {
-      filter = std::make_shared<Reverb>(log_tag, tags::schema::reverb::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::rnnoise)) {
-      filter = std::make_shared<RNNoise>(log_tag, tags::schema::rnnoise::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::speex)) {
-      filter = std::make_shared<Speex>(log_tag, tags::schema::speex::id, path, pm, pipeline_type);
-    } else if (name.starts_with(tags::plugin_name::stereo_tools)) {
-      filter = std::make_shared<StereoTools>(log_tag, tags::schema::stereo_tools::id, path, pm, pipeline_type);
+    auto filter = create_plugin(name, log_tag, schema_base_path, pm, pipeline_type);
+
+    if (filter == nullptr) {
+      continue;
     }
 
-    connections.push_back(filter->latency.connect([this]() { broadcast_pipeline_latency(); }));
+    connect_plugin_signals(filter);
 
     plugins.insert(std::make_pair(name, filter));
   }
 }
 
+auto EffectsBase::create_plugin(const std::string& name,
+                                const std::string& log_tag,
+                                const std::string& schema_base_path,
+                                PipeManager* pm,
+                                PipelineType pipeline_type) -> std::shared_ptr<PluginBase> {
+  auto instance_id = util::to_string(tags::plugin_name::get_id(name));
+
+  auto path = schema_base_path + tags::plugin_name::get_base_name(name) + "/" + instance_id + "/";
+
+  path.erase(std::remove(path.begin(), path.end(), '_'), path.end());
+
+  std::shared_ptr<PluginBase> filter;
+
+  if (name.starts_with(tags::plugin_name::autogain)) {
+    filter = std::make_shared<AutoGain>(log_tag, tags::schema::autogain::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::bass_enhancer)) {
+    filter = std::make_shared<BassEnhancer>(log_tag, tags::schema::bass_enhancer::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::bass_loudness)) {
+    filter = std::make_shared<BassLoudness>(log_tag, tags::schema::bass_loudness::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::compressor)) {
+    filter = std::make_shared<Compressor>(log_tag, tags::schema::compressor::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::convolver)) {
+    filter = std::make_shared<Convolver>(log_tag, tags::schema::convolver::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::crossfeed)) {
+    filter = std::make_shared<Crossfeed>(log_tag, tags::schema::crossfeed::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::crystalizer)) {
+    filter = std::make_shared<Crystalizer>(log_tag, tags::schema::crystalizer::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::deepfilternet)) {
+    filter = std::make_shared<DeepFilterNet>(log_tag, tags::schema::deepfilternet::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::deesser)) {
+    filter = std::make_shared<Deesser>(log_tag, tags::schema::deesser::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::delay)) {
+    filter = std::make_shared<Delay>(log_tag, tags::schema::delay::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::echo_canceller)) {
+    filter = std::make_shared<EchoCanceller>(log_tag, tags::schema::echo_canceller::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::exciter)) {
+    filter = std::make_shared<Exciter>(log_tag, tags::schema::exciter::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::expander)) {
+    filter = std::make_shared<Expander>(log_tag, tags::schema::expander::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::equalizer)) {
+    filter = std::make_shared<Equalizer>(
+        log_tag, tags::schema::equalizer::id, path, tags::schema::equalizer::channel_id,
+        schema_base_path + "equalizer/" + instance_id + "/leftchannel/",
+        schema_base_path + "equalizer/" + instance_id + "/rightchannel/", pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::filter)) {
+    filter = std::make_shared<Filter>(log_tag, tags::schema::filter::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::gate)) {
+    filter = std::make_shared<Gate>(log_tag, tags::schema::gate::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::level_meter)) {
+    filter = std::make_shared<LevelMeter>(log_tag, tags::schema::level_meter::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::limiter)) {
+    filter = std::make_shared<Limiter>(log_tag, tags::schema::limiter::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::loudness)) {
+    filter = std::make_shared<Loudness>(log_tag, tags::schema::loudness::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::maximizer)) {
+    filter = std::make_shared<Maximizer>(log_tag, tags::schema::maximizer::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::multiband_compressor)) {
+    filter = std::make_shared<MultibandCompressor>(log_tag, tags::schema::multiband_compressor::id, path, pm,
+                                                   pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::multiband_gate)) {
+    filter = std::make_shared<MultibandGate>(log_tag, tags::schema::multiband_gate::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::pitch)) {
+    filter = std::make_shared<Pitch>(log_tag, tags::schema::pitch::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::reverb)) {
+    filter = std::make_shared<Reverb>(log_tag, tags::schema::reverb::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::rnnoise)) {
+    filter = std::make_shared<RNNoise>(log_tag, tags::schema::rnnoise::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::speex)) {
+    filter = std::make_shared<Speex>(log_tag, tags::schema::speex::id, path, pm, pipeline_type);
+  } else if (name.starts_with(tags::plugin_name::stereo_tools)) {
+    filter = std::make_shared<StereoTools>(log_tag, tags::schema::stereo_tools::id, path, pm, pipeline_type);
+  }
+
+  return filter;
+}
+
 void EffectsBase::remove_unused_filters() {
   const auto list = util::gchar_array_to_vector(g_settings_get_strv(settings, "plugins"));
 
@@ -296,8 +331,10 @@ void EffectsBase::deactivate_filters() {
 auto EffectsBase::get_pipeline_latency() -> float {
   float total = 0.0F;
 
+  // The plugins routed around do not delay the audio. The other bypassed ones keep their latency.
+
   for (const auto& name : util::gchar_array_to_vector(g_settings_get_strv(settings, "plugins"))) {
-    if (plugins.contains(name)) {
+    if (plugins.contains(name) && !plugins[name]->routed_around) {
       total += plugins[name]->get_latency_seconds();
     }
   }
@@ -305,6 +342,34 @@ auto EffectsBase::get_pipeline_latency() -> float {
   return total * 1000.0F;
 }
 
+void EffectsBase::start_telemetry_timer(const int& interval_ms) {
+  if (telemetry_source_id != 0U) {
+    g_source_remove(telemetry_source_id);
+  }
+
+  telemetry_source_id = g_timeout_add(static_cast<guint>(interval_ms),
+                                      (GSourceFunc) +
+                                          [](EffectsBase* self) {
+                                            self->drain_telemetry();
+
+                                            return G_SOURCE_CONTINUE;
+                                          },
+                                      this);
+}
+
+void EffectsBase::drain_telemetry() {
+  output_level->drain_telemetry();
+  spectrum->drain_telemetry();
+
+  for (auto& plugin : plugins | std::views::values) {
+    plugin->drain_telemetry();
+  }
+
+  for (auto& fused_chain : fused_chains) {
+    fused_chain->drain_telemetry();
+  }
+}
+
 void EffectsBase::broadcast_pipeline_latency() {
   const auto latency_value = get_pipeline_latency();
 
@@ -313,6 +378,484 @@ void EffectsBase::broadcast_pipeline_latency() {
   pipeline_latency.emit(latency_value);
 }
 
+void EffectsBase::connect_nodes_to_pw(const std::vector<std::shared_ptr<PluginBase>>& nodes) {
+  std::vector<std::shared_ptr<PluginBase>> pending;
+
+  for (const auto& node : nodes) {
+    if (!node->connected_to_pw && node->begin_connect_to_pw()) {
+      pending.push_back(node);
+    }
+  }
+
+  for (const auto& node : pending) {
+    node->finish_connect_to_pw();
+  }
+}
+
+auto EffectsBase::build_node_chain(const std::vector<std::string>& list,
+                                   std::vector<std::shared_ptr<PluginBase>>& bypassed)
+    -> std::vector<std::shared_ptr<PluginBase>> {
+  /*
+    When the fused mode is enabled consecutive plugins are grouped in a single node. Plugins with probe ports are left
+    out because their probes have to be linked to other nodes in the graph. A group with a single plugin is not worth
+    a fused chain.
+
+    Bypassed plugins without probe ports and without latency are not linked. Their filters are returned in bypassed
+    so they can stay in the graph without being scheduled. Inside a fused chain they are skipped by the chain itself.
+    A bypassed plugin with latency stays in the chain and delays its input by it, so that the latency of the chain
+    does not jump when the bypass is toggled.
+  */
+
+  const auto fuse = g_settings_get_boolean(global_settings, "fuse-effects-chain") != 0;
+
+  std::vector<std::shared_ptr<PluginBase>> nodes;
+  std::vector<std::shared_ptr<PluginBase>> group;
+
+  bypassed.clear();
+
+  size_t n_chains = 0U;
+
+  auto add_node = [&](const std::shared_ptr<PluginBase>& plugin) {
+    if (plugin->routed_around) {
+      bypassed.push_back(plugin);
+    } else {
+      nodes.push_back(plugin);
+    }
+  };
+
+  auto flush_group = [&]() {
+    if (group.size() < 2U) {
+      std::ranges::for_each(group, add_node);
+    } else {
+      if (n_chains == fused_chains.size()) {
+        fused_chains.push_back(
+            std::make_shared<FusedChain>(log_tag, "fused_chain_" + util::to_string(n_chains), pm, pipeline_type));
+      }
+
+      auto& chain = fused_chains[n_chains];
+
+      for (auto& plugin : group) {
+        if (plugin->connected_to_pw) {
+          plugin->disconnect_from_pw();
+        }
+      }
+
+      // A chain that already runs this group stays in the graph together with its links.
+
+      if (!chain->connected_to_pw || chain->get_plugins() != group) {
+        if (chain->connected_to_pw) {
+          chain->disconnect_from_pw();
+        }
+
+        chain->set_plugins(group);
+      }
+
+      nodes.push_back(chain);
+
+      n_chains++;
+    }
+
+    group.clear();
+  };
+
+  for (const auto& name : list) {
+    if (!plugins.contains(name)) {
+      continue;
+    }
+
+    if (fuse && !plugins[name]->enable_probe) {
+      group.push_back(plugins[name]);
+
+      continue;
+    }
+
+    flush_group();
+
+    add_node(plugins[name]);
+  }
+
+  flush_group();
+
+  return nodes;
+}
+
+void EffectsBase::disconnect_fused_chains(std::set<uint>& link_id_list) {
+  cancel_chain_switch();
+
+  for (const auto& chain : fused_chains) {
+    for (const auto& link_id : pm->get_node_link_ids(chain->get_node_id())) {
+      link_id_list.insert(link_id);
+    }
+
+    if (chain->connected_to_pw) {
+      util::debug("disconnecting the " + chain->name + " filter from PipeWire");
+
+      chain->disconnect_from_pw();
+    }
+
+    chain->set_plugins({});
+  }
+}
+
+void EffectsBase::relink_chain(const std::vector<uint>& node_ids,
+                               const std::vector<std::pair<uint, uint>>& probe_links,
+                               const size_t& source_min_links) {
+  std::vector<ChainHop> hops;
+  std::vector<pw_proxy*> obsolete_links;
+
+  // The graph index is updated by the PipeWire thread. It is only read while holding the thread loop lock.
+
+  pm->lock();
+
+  const auto get_serial = [&](const uint& node_id) -> uint64_t {
+    const auto it = pm->node_serial_by_id.find(node_id);
+
+    return (it != pm->node_serial_by_id.end()) ? it->second : SPA_ID_INVALID;
+  };
+
+  const auto link = [&](const uint& output_node_id, const uint& input_node_id, const bool& probe_link,
+                        const size_t& min_links) {
+    const auto output_serial = get_serial(output_node_id);
+    const auto input_serial = get_serial(input_node_id);
+
+    if (output_serial == SPA_ID_INVALID || input_serial == SPA_ID_INVALID) {
+      return false;
+    }
+
+    // A hop is reused only if all of its links are still in the graph.
+
+    auto it = std::ranges::find_if(chain_hops, [&](const ChainHop& hop) {
+      return hop.output_serial == output_serial && hop.input_serial == input_serial && hop.probe_link == probe_link;
+    });
+
+    if (it != chain_hops.end() && std::ranges::all_of(it->links, [&](pw_proxy* proxy) {
+          return pm->link_map.contains(pw_proxy_get_bound_id(proxy));
+        })) {
+      hops.push_back(std::move(*it));
+
+      chain_hops.erase(it);
+
+      return true;
+    }
+
+    auto links = pm->link_nodes_locked(output_node_id, input_node_id, probe_link);
+
+    if (links.size() < min_links) {
+      obsolete_links.insert(obsolete_links.end(), links.begin(), links.end());
+
+      return false;
+    }
+
+    hops.push_back({.output_serial = output_serial,
+                    .input_serial = input_serial,
+                    .probe_link = probe_link,
+                    .links = std::move(links)});
+
+    return true;
+  };
+
+  if (!node_ids.empty()) {
+    auto prev_node_id = node_ids.front();
+
+    for (const auto& next_node_id : node_ids | std::views::drop(1)) {
+      const auto min_links = (prev_node_id == node_ids.front()) ? source_min_links : 2U;
+
+      if (link(prev_node_id, next_node_id, false, min_links)) {
+        prev_node_id = next_node_id;
+      } else {
+        util::warning(" link from node " + util::to_string(prev_node_id) + " to node " +
+                      util::to_string(next_node_id) + " failed");
+      }
+    }
+  }
+
+  for (const auto& [output_node_id, input_node_id] : probe_links) {
+    link(output_node_id, input_node_id, true, 1U);
+  }
+
+  // What is left in chain_hops is not part of the new chain
+
+  for (const auto& hop : chain_hops) {
+    obsolete_links.insert(obsolete_links.end(), hop.links.begin(), hop.links.end());
+  }
+
+  PipeManager::destroy_links_locked(obsolete_links);
+
+  chain_hops = std::move(hops);
+
+  pm->sync_wait_unlock();
+}
+
+void EffectsBase::unlink_chain() {
+  std::vector<pw_proxy*> links;
+
+  for (const auto& hop : chain_hops) {
+    links.insert(links.end(), hop.links.begin(), hop.links.end());
+  }
+
+  chain_hops.clear();
+
+  pm->destroy_links(links);
+}
+
+void EffectsBase::set_filters_active(const std::vector<std::shared_ptr<PluginBase>>& nodes, const bool& state) {
+  if (nodes.empty()) {
+    return;
+  }
+
+  pm->lock();
+
+  for (const auto& node : nodes) {
+    if (node->connected_to_pw) {
+      node->set_active(state);
+    }
+  }
+
+  pm->unlock();
+}
+
+void EffectsBase::disconnect_unused_filters(const std::vector<std::shared_ptr<PluginBase>>& nodes) {
+  const auto is_used = [&](const auto& node) {
+    return std::ranges::any_of(nodes, [&](const auto& n) { return n.get() == node.get(); });
+  };
+
+  for (const auto& plugin : plugins | std::views::values) {
+    if (plugin->connected_to_pw && !is_used(plugin)) {
+      util::debug("disconnecting the " + plugin->name + " filter from PipeWire");
+
+      plugin->disconnect_from_pw();
+    }
+  }
+
+  for (const auto& fused_chain : fused_chains) {
+    if (!is_used(fused_chain)) {
+      if (fused_chain->connected_to_pw) {
+        util::debug("disconnecting the " + fused_chain->name + " filter from PipeWire");
+
+        fused_chain->disconnect_from_pw();
+      }
+
+      fused_chain->set_plugins({});
+    }
+  }
+}
+
+void EffectsBase::schedule_relink() {
+  if (relink_source_id != 0U) {
+    return;
+  }
+
+  relink_source_id = g_idle_add((GSourceFunc) +
+                                    [](EffectsBase* self) {
+                                      self->relink_source_id = 0U;
+
+                                      // A running crossfade and the global bypass take care of the links themselves
+
+                                      if (g_settings_get_boolean(self->global_settings, "bypass") == 0 &&
+                                          self->switch_source_id == 0U) {
+                                        self->set_bypass(false);
+                                      }
+
+                                      self->broadcast_pipeline_latency();
+
+                                      return G_SOURCE_REMOVE;
+                                    },
+                                this);
+}
+
+auto EffectsBase::crossfade_chain() -> bool {
+  if (g_settings_get_boolean(global_settings, "crossfade-chain-switch") == 0 ||
+      g_settings_get_boolean(global_settings, "fuse-effects-chain") == 0 || switch_source_id != 0U) {
+    return false;
+  }
+
+  // The current chain has to be a single fused node that is already processing audio.
+
+  if (fused_chains.empty() || !fused_chains[0]->connected_to_pw || fused_chains[0]->rate == 0U ||
+      std::ranges::any_of(fused_chains | std::views::drop(1), [](const auto& c) { return c->connected_to_pw; }) ||
+      std::ranges::any_of(plugins | std::views::values, [](const auto& p) { return p->connected_to_pw; })) {
+    return false;
+  }
+
+  const auto list = util::gchar_array_to_vector(g_settings_get_strv(settings, "plugins"));
+
+  auto names = list | std::views::filter([&](const auto& name) { return plugins.contains(name); });
+
+  if (names.empty() || std::ranges::any_of(names, [&](const auto& name) { return plugins[name]->enable_probe; })) {
+    return false;
+  }
+
+  auto& chain = fused_chains[0];
+
+  const auto& current = chain->get_plugins();
+
+  /*
+    A plugin can not be processed by both sides of the crossfade. The ones that are running now are replaced by new
+    instances. They read the same settings, so the user does not see a difference. When a preset is being loaded the
+    running ones are frozen and keep the old values until they are released.
+  */
+
+  std::vector<std::shared_ptr<PluginBase>> incoming;
+
+  for (const auto& name : names) {
+    if (std::ranges::find(current, plugins[name]) != current.end()) {
+      auto filter = create_plugin(name, log_tag, schema_base_path, pm, pipeline_type);
+
+      if (filter == nullptr) {
+        return false;
+      }
+
+      filter->notification_time_window = plugins[name]->notification_time_window;
+
+      connect_plugin_signals(filter);
+
+      chain_switch.outgoing.push_back(plugins[name]);
+
+      plugins[name] = filter;
+    }
+
+    incoming.push_back(plugins[name]);
+  }
+
+  for (const auto& plugin : incoming) {
+    plugin->prepare(chain->n_samples, chain->rate);
+  }
+
+  chain_switch.plugins = incoming;
+  chain_switch.started = false;
+  chain_switch.deadline = g_get_monotonic_time() + 2 * G_USEC_PER_SEC;
+
+  switch_source_id = g_timeout_add(10U,
+                                   (GSourceFunc) +
+                                       [](EffectsBase* self) { return self->update_chain_switch(); },
+                                   this);
+
+  plugins_replaced.emit();
+
+  return true;
+}
+
+void EffectsBase::freeze_running_plugins() {
+  if (g_settings_get_boolean(global_settings, "crossfade-chain-switch") == 0 ||
+      g_settings_get_boolean(global_settings, "fuse-effects-chain") == 0 || switch_source_id != 0U ||
+      fused_chains.empty() || !fused_chains[0]->connected_to_pw) {
+    return;
+  }
+
+  frozen_plugins = fused_chains[0]->get_plugins();
+
+  for (const auto& plugin : frozen_plugins) {
+    plugin->freeze_settings();
+  }
+}
+
+void EffectsBase::thaw_plugins() {
+  // the instances replaced by a crossfade stay frozen until they are released
+
+  for (const auto& plugin : frozen_plugins) {
+    if (const auto it = plugins.find(plugin->name); it != plugins.end() && it->second == plugin) {
+      plugin->thaw_settings();
+    }
+  }
+
+  frozen_plugins.clear();
+}
+
+auto EffectsBase::update_chain_switch() -> gboolean {
+  auto& chain = fused_chains[0];
+
+  const auto now = g_get_monotonic_time();
+
+  if (!chain_switch.started) {
+    const auto ready = std::ranges::all_of(chain_switch.plugins, [](const auto& p) { return p->is_ready(); });
+
+    if (!ready && now < chain_switch.deadline) {
+      return G_SOURCE_CONTINUE;
+    }
+
+    if (!ready) {
+      util::warning(log_tag + "some plugins were not ready in time. Switching to them anyway");
+    }
+
+    const auto crossfade_ms = g_settings_get_int(global_settings, "chain-crossfade-time");
+
+    chain_switch.started = chain->crossfade_to(chain_switch.plugins, static_cast<uint>(crossfade_ms));
+
+    chain_switch.deadline = now + (crossfade_ms + 1000) * G_TIME_SPAN_MILLISECOND;
+
+    if (chain_switch.started) {
+      return G_SOURCE_CONTINUE;
+    }
+  } else if (chain->finish_crossfade()) {
+    switch_source_id = 0U;
+
+    chain_switch.plugins.clear();
+
+    release_outgoing_plugins();
+
+    broadcast_pipeline_latency();
+
+    return G_SOURCE_REMOVE;
+  } else if (now < chain_switch.deadline) {
+    return G_SOURCE_CONTINUE;
+  }
+
+  // The graph is not running our node. The new plugins are linked the usual way.
+
+  util::debug(log_tag + "the fused chain did not switch its plugins. Relinking the filters");
+
+  switch_source_id = 0U;
+
+  chain_switch.plugins.clear();
+
+  set_bypass(false);
+
+  return G_SOURCE_REMOVE;
+}
+
+void EffectsBase::cancel_chain_switch() {
+  if (switch_source_id != 0U) {
+    g_source_remove(switch_source_id);
+
+    switch_source_id = 0U;
+  }
+
+  chain_switch.plugins.clear();
+
+  release_outgoing_plugins();
+}
+
+void EffectsBase::release_outgoing_plugins() {
+  /*
+    The fused chain does not process these instances anymore. Once we drop our references their GSettings handlers are
+    disconnected by their destructors.
+  */
+
+  for (const auto& plugin : chain_switch.outgoing) {
+    disconnect_plugin_signals(plugin.get());
+  }
+
+  chain_switch.outgoing.clear();
+}
+
+void EffectsBase::connect_plugin_signals(const std::shared_ptr<PluginBase>& plugin) {
+  auto& list = plugin_connections[plugin.get()];
+
+  list.push_back(plugin->latency.connect([this]() { broadcast_pipeline_latency(); }));
+
+  list.push_back(plugin->bypass_changed.connect([this]() { schedule_relink(); }));
+}
+
+void EffectsBase::disconnect_plugin_signals(const PluginBase* plugin) {
+  if (auto it = plugin_connections.find(plugin); it != plugin_connections.end()) {
+    for (auto& c : it->second) {
+      c.disconnect();
+    }
+
+    plugin_connections.erase(it);
+  }
+}
+
 auto EffectsBase::get_plugins_map() -> std::map<std::string, std::shared_ptr<PluginBase>> {
   return plugins;
 }
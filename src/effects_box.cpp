@@ -27,8 +27,6 @@
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gobject/gobject.h>
-#include <gsl/gsl_interp.h>
-#include <gsl/gsl_spline.h>
 #include <gtk/gtk.h>
 #include <gtk/gtkshortcut.h>
 #include <sigc++/connection.h>
@@ -40,6 +38,7 @@
 #include "blocklist_menu.hpp"
 #include "chart.hpp"
 #include "effects_base.hpp"
+#include "pipe_objects.hpp"
 #include "pipeline_type.hpp"
 #include "plugins_box.hpp"
 #include "tags_app.hpp"
@@ -66,11 +65,9 @@ struct Data {
 
   PipelineType pipeline_type;
 
-  uint spectrum_rate, spectrum_n_bands;
-
   float global_output_level_left, global_output_level_right, pipeline_latency_ms;
 
-  std::vector<double> spectrum_mag, spectrum_x_axis, spectrum_freqs;
+  std::vector<double> spectrum_mag, spectrum_x_axis;
 
   std::vector<sigc::connection> connections;
 
@@ -111,36 +108,28 @@ struct _EffectsBox {
 G_DEFINE_TYPE(EffectsBox, effects_box, GTK_TYPE_BOX)
 
 void init_spectrum_frequency_axis(EffectsBox* self) {
-  self->data->spectrum_freqs.resize(self->data->spectrum_n_bands);
+  const auto min_freq = static_cast<float>(g_settings_get_int(self->settings_spectrum, "minimum-frequency"));
+  const auto max_freq = static_cast<float>(g_settings_get_int(self->settings_spectrum, "maximum-frequency"));
 
-  for (uint n = 0U; n < self->data->spectrum_n_bands; n++) {
-    self->data->spectrum_freqs[n] = 0.5F * static_cast<float>(self->data->spectrum_rate) * static_cast<float>(n) /
-                                    static_cast<float>(self->data->spectrum_n_bands);
+  if (min_freq > (max_freq - 100.0F)) {
+    return;
   }
 
-  if (!self->data->spectrum_freqs.empty()) {
-    const auto min_freq = static_cast<float>(g_settings_get_int(self->settings_spectrum, "minimum-frequency"));
-    const auto max_freq = static_cast<float>(g_settings_get_int(self->settings_spectrum, "maximum-frequency"));
+  auto log_x_axis = util::logspace(min_freq, max_freq, g_settings_get_int(self->settings_spectrum, "n-points"));
 
-    if (min_freq > (max_freq - 100.0F)) {
-      return;
-    }
+  self->data->spectrum_x_axis.resize(log_x_axis.size());
+  self->data->spectrum_mag.resize(log_x_axis.size());
 
-    auto log_x_axis = util::logspace(min_freq, max_freq, g_settings_get_int(self->settings_spectrum, "n-points"));
+  std::copy(log_x_axis.begin(), log_x_axis.end(), self->data->spectrum_x_axis.begin());
 
-    self->data->spectrum_x_axis.resize(log_x_axis.size());
-    self->data->spectrum_mag.resize(log_x_axis.size());
+  // the spectrum maps its FFT bins to these points once instead of interpolating on every frame
 
-    std::copy(log_x_axis.begin(), log_x_axis.end(), self->data->spectrum_x_axis.begin());
+  self->data->effects_base->spectrum->set_display_axis(self->data->spectrum_x_axis);
 
-    ui::chart::set_x_data(self->spectrum_chart, self->data->spectrum_x_axis);
-  }
+  ui::chart::set_x_data(self->spectrum_chart, self->data->spectrum_x_axis);
 }
 
 void setup_spectrum(EffectsBox* self) {
-  self->data->spectrum_rate = 0U;
-  self->data->spectrum_n_bands = 0U;
-
   ui::chart::set_color(self->spectrum_chart, util::gsettings_get_color(self->settings_spectrum, "color"));
 
   ui::chart::set_axis_labels_color(self->spectrum_chart,
@@ -303,32 +292,11 @@ static gboolean spectrum_data_update(GtkWidget* widget, GdkFrameClock* frame_clo
     return G_SOURCE_CONTINUE;
   }
 
-  auto [rate, n_bands, magnitudes] = self->data->effects_base->spectrum->compute_magnitudes();
-
-  // No new data available, no redraw required.
-  if (rate == 0 || n_bands == 0) {
+  // No new hop of audio available, no redraw required.
+  if (!self->data->effects_base->spectrum->compute_magnitudes(self->data->spectrum_mag)) {
     return G_SOURCE_CONTINUE;
   }
 
-  if (self->data->spectrum_rate != rate || self->data->spectrum_n_bands != n_bands) {
-    self->data->spectrum_rate = rate;
-    self->data->spectrum_n_bands = n_bands;
-
-    init_spectrum_frequency_axis(self);
-  }
-
-  auto* acc = gsl_interp_accel_alloc();
-  auto* spline = gsl_spline_alloc(gsl_interp_steffen, n_bands);
-
-  gsl_spline_init(spline, self->data->spectrum_freqs.data(), magnitudes, n_bands);
-
-  for (size_t n = 0; n < self->data->spectrum_x_axis.size(); n++) {
-    self->data->spectrum_mag[n] = static_cast<float>(gsl_spline_eval(spline, self->data->spectrum_x_axis[n], acc));
-  }
-
-  gsl_spline_free(spline);
-  gsl_interp_accel_free(acc);
-
   std::ranges::for_each(self->data->spectrum_mag, [](auto& v) {
     v = 10.0F * std::log10(v);
 
@@ -365,11 +333,12 @@ void setup(EffectsBox* self, app::Application* application, PipelineType pipelin
 
       set_device_state_label();
 
-      self->data->connections.push_back(application->pm->source_changed.connect([=](const auto nd_info) {
-        if (nd_info.id == application->pm->ee_source_node.id) {
-          set_device_state_label();
-        }
-      }));
+      self->data->connections.push_back(
+          application->pm->source_changed.connect([=](const auto nd_info, const auto changes) {
+            if (nd_info.id == application->pm->ee_source_node.id && (changes & node_change::format) != 0U) {
+              set_device_state_label();
+            }
+          }));
 
       break;
     }
@@ -388,11 +357,12 @@ void setup(EffectsBox* self, app::Application* application, PipelineType pipelin
 
       set_device_state_label();
 
-      self->data->connections.push_back(application->pm->sink_changed.connect([=](const auto nd_info) {
-        if (nd_info.id == application->pm->ee_sink_node.id) {
-          set_device_state_label();
-        }
-      }));
+      self->data->connections.push_back(
+          application->pm->sink_changed.connect([=](const auto nd_info, const auto changes) {
+            if (nd_info.id == application->pm->ee_sink_node.id && (changes & node_change::format) != 0U) {
+              set_device_state_label();
+            }
+          }));
 
       break;
     }
@@ -445,6 +415,8 @@ void setup(EffectsBox* self, app::Application* application, PipelineType pipelin
 
   // spectrum array
 
+  init_spectrum_frequency_axis(self);
+
   gtk_widget_add_tick_callback(GTK_WIDGET(self->spectrum_chart), (GtkTickCallback)spectrum_data_update, self, NULL);
 
   // As we are showing the window we want the filters to send notifications about level meters, etc
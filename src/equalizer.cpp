@@ -34,6 +34,7 @@
 #include "plugin_base.hpp"
 #include "tags_equalizer.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 using namespace std::string_literals;
@@ -63,6 +64,8 @@ Equalizer::Equalizer(const std::string& tag,
     util::debug(log_tag + "http://lsp-plug.in/plugins/lv2/para_equalizer_x32_lr is not installed");
   }
 
+  port_out_latency = lv2_wrapper->get_control_port<"out_latency">();
+
   lv2_wrapper->bind_key_enum<"mode", "mode">(settings);
 
   lv2_wrapper->bind_key_double<"bal", "balance">(settings);
@@ -226,23 +229,11 @@ void Equalizer::on_split_channels() {
   }
 }
 
-void Equalizer::setup() {
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (lv2_wrapper->get_rate() != rate) {
-    lv2_wrapper->create_instance(rate);
-  }
-}
-
 void Equalizer::process(std::span<float>& left_in,
                         std::span<float>& right_in,
                         std::span<float>& left_out,
                         std::span<float>& right_out) {
-  if (!lv2_wrapper->found_plugin || !lv2_wrapper->has_instance() || bypass) {
+  if (!lv2_wrapper->found_plugin || !lv2_ready || bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -264,24 +255,14 @@ void Equalizer::process(std::span<float>& left_in,
     This plugin gives the latency in number of samples
   */
 
-  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value("out_latency"));
+  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value(port_out_latency));
 
   if (latency_n_frames != lv) {
     latency_n_frames = lv;
 
     latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
-
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
-
-      latency.emit();
-    });
-
-    update_filter_params();
+    post_latency();
   }
 
   if (post_messages) {
@@ -354,3 +335,7 @@ void Equalizer::sort_bands() {
 auto Equalizer::get_latency_seconds() -> float {
   return latency_value;
 }
+
+auto Equalizer::parameter_settings() -> std::vector<GSettings*> {
+  return {settings, settings_left, settings_right};
+}
@@ -31,6 +31,7 @@
 #include "pipe_objects.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 Expander::Expander(const std::string& tag,
@@ -54,6 +55,16 @@ Expander::Expander(const std::string& tag,
     util::debug(log_tag + "http://lsp-plug.in/plugins/lv2/sc_expander_stereo is not installed");
   }
 
+  port_out_latency = lv2_wrapper->get_control_port<"out_latency">();
+  port_rlm_l = lv2_wrapper->get_control_port<"rlm_l">();
+  port_rlm_r = lv2_wrapper->get_control_port<"rlm_r">();
+  port_slm_l = lv2_wrapper->get_control_port<"slm_l">();
+  port_slm_r = lv2_wrapper->get_control_port<"slm_r">();
+  port_clm_l = lv2_wrapper->get_control_port<"clm_l">();
+  port_clm_r = lv2_wrapper->get_control_port<"clm_r">();
+  port_elm_l = lv2_wrapper->get_control_port<"elm_l">();
+  port_elm_r = lv2_wrapper->get_control_port<"elm_r">();
+
   gconnections.push_back(g_signal_connect(settings, "changed::sidechain-type",
                                           G_CALLBACK(+[](GSettings* settings, const char* key, gpointer user_data) {
                                             auto* self = static_cast<Expander*>(user_data);
@@ -128,25 +139,13 @@ Expander::~Expander() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void Expander::setup() {
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (lv2_wrapper->get_rate() != rate) {
-    lv2_wrapper->create_instance(rate);
-  }
-}
-
 void Expander::process(std::span<float>& left_in,
                        std::span<float>& right_in,
                        std::span<float>& left_out,
                        std::span<float>& right_out,
                        std::span<float>& probe_left,
                        std::span<float>& probe_right) {
-  if (!lv2_wrapper->found_plugin || !lv2_wrapper->has_instance() || bypass) {
+  if (!lv2_wrapper->found_plugin || !lv2_ready || bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -168,24 +167,14 @@ void Expander::process(std::span<float>& left_in,
    This plugin gives the latency in number of samples
  */
 
-  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value("out_latency"));
+  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value(port_out_latency));
 
   if (latency_n_frames != lv) {
     latency_n_frames = lv;
 
     latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
-
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
-
-      latency.emit();
-    });
-
-    update_filter_params();
+    post_latency();
   }
 
   if (post_messages) {
@@ -193,21 +182,21 @@ void Expander::process(std::span<float>& left_in,
 
     if (send_notifications) {
       reduction_port_value =
-          0.5F * (lv2_wrapper->get_control_port_value("rlm_l") + lv2_wrapper->get_control_port_value("rlm_r"));
+          0.5F * (lv2_wrapper->get_control_port_value(port_rlm_l) + lv2_wrapper->get_control_port_value(port_rlm_r));
 
       sidechain_port_value =
-          0.5F * (lv2_wrapper->get_control_port_value("slm_l") + lv2_wrapper->get_control_port_value("slm_r"));
+          0.5F * (lv2_wrapper->get_control_port_value(port_slm_l) + lv2_wrapper->get_control_port_value(port_slm_r));
 
       curve_port_value =
-          0.5F * (lv2_wrapper->get_control_port_value("clm_l") + lv2_wrapper->get_control_port_value("clm_r"));
+          0.5F * (lv2_wrapper->get_control_port_value(port_clm_l) + lv2_wrapper->get_control_port_value(port_clm_r));
 
       envelope_port_value =
-          0.5F * (lv2_wrapper->get_control_port_value("elm_l") + lv2_wrapper->get_control_port_value("elm_r"));
+          0.5F * (lv2_wrapper->get_control_port_value(port_elm_l) + lv2_wrapper->get_control_port_value(port_elm_r));
 
-      reduction.emit(reduction_port_value);
-      sidechain.emit(sidechain_port_value);
-      curve.emit(curve_port_value);
-      envelope.emit(envelope_port_value);
+      post_meter(reduction_meter, {reduction_port_value});
+      post_meter(sidechain_meter, {sidechain_port_value});
+      post_meter(curve_meter, {curve_port_value});
+      post_meter(envelope_meter, {envelope_port_value});
 
       notify();
     }
@@ -215,6 +204,10 @@ void Expander::process(std::span<float>& left_in,
 }
 
 void Expander::update_sidechain_links(const std::string& key) {
+  if (pm == nullptr) {
+    return;
+  }
+
   if (util::gsettings_get_string(settings, "sidechain-type") != "External") {
     pm->destroy_links(list_proxies);
 
@@ -227,12 +220,8 @@ void Expander::update_sidechain_links(const std::string& key) {
 
   NodeInfo input_device = pm->ee_source_node;
 
-  for (const auto& [serial, node] : pm->node_map) {
-    if (node.name == device_name) {
-      input_device = node;
-
-      break;
-    }
+  if (const auto* node = pm->find_node_by_name(device_name); node != nullptr) {
+    input_device = *node;
   }
 
   pm->destroy_links(list_proxies);
@@ -251,3 +240,27 @@ void Expander::update_probe_links() {
 auto Expander::get_latency_seconds() -> float {
   return this->latency_value;
 }
+
+void Expander::on_meter(const telemetry::Record& record) {
+  switch (record.id) {
+    case reduction_meter:
+      reduction.emit(record.values[0]);
+      break;
+
+    case sidechain_meter:
+      sidechain.emit(record.values[0]);
+      break;
+
+    case curve_meter:
+      curve.emit(record.values[0]);
+      break;
+
+    case envelope_meter:
+      envelope.emit(record.values[0]);
+      break;
+
+    default:
+      PluginBase::on_meter(record);
+      break;
+  }
+}
@@ -0,0 +1,174 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fft_plans.hpp"
+#include <fftw3.h>
+#include <glib.h>
+#include <sys/types.h>
+#include <compare>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include "util.hpp"
+
+namespace {
+
+enum class Direction { r2c, c2r };
+
+struct Key {
+  Direction direction;
+
+  uint size;
+
+  int in_alignment, out_alignment;
+
+  auto operator<=>(const Key&) const = default;
+};
+
+/*
+  The fftw planner is not thread safe. Every single precision plan of the program is created through this cache, so
+  its lock is enough to serialize them.
+*/
+
+std::mutex planner_mutex;
+
+std::map<Key, fftwf_plan> plans;
+
+bool wisdom_loaded = false, wisdom_changed = false;
+
+guint save_source_id = 0U;
+
+auto wisdom_path() -> std::filesystem::path {
+  return std::filesystem::path(g_get_user_cache_dir()) / "easyeffects" / "fftwf_wisdom";
+}
+
+void load_wisdom() {
+  wisdom_loaded = true;
+
+  const auto path = wisdom_path();
+
+  if (!std::filesystem::exists(path)) {
+    return;
+  }
+
+  if (fftwf_import_wisdom_from_filename(path.c_str()) == 0) {
+    util::warning("could not read the fftw wisdom in " + path.string());
+
+    return;
+  }
+
+  util::debug("fftw wisdom loaded from " + path.string());
+}
+
+void schedule_save() {
+  wisdom_changed = true;
+
+  if (save_source_id != 0U) {
+    return;
+  }
+
+  // Plans are usually requested in bursts, like when the convolver loads a kernel. They are saved once at the end.
+
+  save_source_id = g_timeout_add_seconds(5U,
+                                         (GSourceFunc) +
+                                             [](gpointer user_data) {
+                                               {
+                                                 std::scoped_lock<std::mutex> lock(planner_mutex);
+
+                                                 save_source_id = 0U;
+                                               }
+
+                                               fft_plans::save_wisdom();
+
+                                               return G_SOURCE_REMOVE;
+                                             },
+                                         nullptr);
+}
+
+auto get_plan(const Key& key, void* in, void* out) -> fftwf_plan {
+  std::scoped_lock<std::mutex> lock(planner_mutex);
+
+  if (const auto it = plans.find(key); it != plans.end()) {
+    return it->second;
+  }
+
+  if (!wisdom_loaded) {
+    load_wisdom();
+  }
+
+  const auto n = static_cast<int>(key.size);
+
+  auto* plan = (key.direction == Direction::r2c)
+                   ? fftwf_plan_dft_r2c_1d(n, static_cast<float*>(in), static_cast<fftwf_complex*>(out), FFTW_MEASURE)
+                   : fftwf_plan_dft_c2r_1d(n, static_cast<fftwf_complex*>(in), static_cast<float*>(out), FFTW_MEASURE);
+
+  plans[key] = plan;
+
+  schedule_save();
+
+  return plan;
+}
+
+}  // namespace
+
+namespace fft_plans {
+
+auto r2c(const uint& size, float* in, fftwf_complex* out) -> fftwf_plan {
+  return get_plan({.direction = Direction::r2c,
+                   .size = size,
+                   .in_alignment = fftwf_alignment_of(in),
+                   .out_alignment = fftwf_alignment_of(reinterpret_cast<float*>(out))},
+                  in, out);
+}
+
+auto c2r(const uint& size, fftwf_complex* in, float* out) -> fftwf_plan {
+  return get_plan({.direction = Direction::c2r,
+                   .size = size,
+                   .in_alignment = fftwf_alignment_of(reinterpret_cast<float*>(in)),
+                   .out_alignment = fftwf_alignment_of(out)},
+                  in, out);
+}
+
+void save_wisdom() {
+  std::scoped_lock<std::mutex> lock(planner_mutex);
+
+  if (!wisdom_changed) {
+    return;
+  }
+
+  const auto path = wisdom_path();
+
+  std::error_code ec;
+
+  std::filesystem::create_directories(path.parent_path(), ec);
+
+  if (fftwf_export_wisdom_to_filename(path.c_str()) == 0) {
+    util::warning("could not save the fftw wisdom to " + path.string());
+
+    return;
+  }
+
+  wisdom_changed = false;
+
+  util::debug("fftw wisdom saved to " + path.string());
+}
+
+}  // namespace fft_plans
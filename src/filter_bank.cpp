@@ -0,0 +1,174 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "filter_bank.hpp"
+#include <fftw3.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "fft_plans.hpp"
+
+FilterBank::~FilterBank() {
+  free_buffers();
+}
+
+void FilterBank::free_buffers() {
+  if (frame != nullptr) {
+    fftwf_free(frame);
+
+    frame = nullptr;
+  }
+
+  if (spectrum != nullptr) {
+    fftwf_free(spectrum);
+
+    spectrum = nullptr;
+  }
+}
+
+void FilterBank::setup(const uint& block_size, const uint& n_channels, const std::vector<std::vector<float>>& kernels) {
+  free_buffers();
+
+  this->block_size = std::max(block_size, 1U);
+
+  const auto frame_size = 2U * this->block_size;
+
+  n_bins = this->block_size + 1U;
+
+  frame = fftwf_alloc_real(frame_size);
+  spectrum = fftwf_alloc_complex(n_bins);
+
+  forward = fft_plans::r2c(frame_size, frame, spectrum);
+  backward = fft_plans::c2r(frame_size, spectrum, frame);
+
+  acc_re.resize(n_bins);
+  acc_im.resize(n_bins);
+
+  // fftw does not normalize. The inverse transform scale is folded into the kernel spectra.
+
+  const auto scale = 1.0F / static_cast<float>(frame_size);
+
+  bands.resize(kernels.size());
+
+  max_partitions = 1U;
+
+  for (size_t b = 0U; b < kernels.size(); b++) {
+    const auto& kernel = kernels[b];
+
+    auto& band = bands[b];
+
+    band.n_partitions = std::max(static_cast<uint>((kernel.size() + this->block_size - 1U) / this->block_size), 1U);
+
+    band.re.resize(static_cast<size_t>(band.n_partitions) * n_bins);
+    band.im.resize(static_cast<size_t>(band.n_partitions) * n_bins);
+
+    for (uint p = 0U; p < band.n_partitions; p++) {
+      std::fill(frame, frame + frame_size, 0.0F);
+
+      const auto start = static_cast<size_t>(p) * this->block_size;
+
+      for (size_t n = 0U; n < this->block_size && start + n < kernel.size(); n++) {
+        frame[n] = scale * kernel[start + n];
+      }
+
+      fftwf_execute_dft_r2c(forward, frame, spectrum);
+
+      for (uint k = 0U; k < n_bins; k++) {
+        band.re[(p * n_bins) + k] = spectrum[k][0];
+        band.im[(p * n_bins) + k] = spectrum[k][1];
+      }
+    }
+
+    max_partitions = std::max(max_partitions, band.n_partitions);
+  }
+
+  channels.resize(n_channels);
+
+  for (auto& c : channels) {
+    c.previous.assign(this->block_size, 0.0F);
+
+    c.fdl_re.assign(static_cast<size_t>(max_partitions) * n_bins, 0.0F);
+    c.fdl_im.assign(static_cast<size_t>(max_partitions) * n_bins, 0.0F);
+
+    c.fdl_index = 0U;
+  }
+}
+
+void FilterBank::process(const uint& channel, std::span<const float> input, std::span<const std::span<float>> outputs) {
+  auto& c = channels[channel];
+
+  // overlap-save frame with the previous and the current block
+
+  std::ranges::copy(c.previous, frame);
+  std::ranges::copy(input.first(block_size), frame + block_size);
+  std::ranges::copy(input.first(block_size), c.previous.begin());
+
+  fftwf_execute_dft_r2c(forward, frame, spectrum);
+
+  c.fdl_index = (c.fdl_index + 1U) % max_partitions;
+
+  auto* x_re = c.fdl_re.data() + (static_cast<size_t>(c.fdl_index) * n_bins);
+  auto* x_im = c.fdl_im.data() + (static_cast<size_t>(c.fdl_index) * n_bins);
+
+  for (uint k = 0U; k < n_bins; k++) {
+    x_re[k] = spectrum[k][0];
+    x_im[k] = spectrum[k][1];
+  }
+
+  auto* acc_re_ptr = acc_re.data();
+  auto* acc_im_ptr = acc_im.data();
+
+  for (size_t b = 0U; b < bands.size() && b < outputs.size(); b++) {
+    if (outputs[b].empty()) {
+      continue;
+    }
+
+    const auto& band = bands[b];
+
+    std::ranges::fill(acc_re, 0.0F);
+    std::ranges::fill(acc_im, 0.0F);
+
+    for (uint p = 0U; p < band.n_partitions; p++) {
+      const auto slot = static_cast<size_t>((c.fdl_index + max_partitions - p) % max_partitions) * n_bins;
+
+      const auto* a_re = c.fdl_re.data() + slot;
+      const auto* a_im = c.fdl_im.data() + slot;
+      const auto* b_re = band.re.data() + (static_cast<size_t>(p) * n_bins);
+      const auto* b_im = band.im.data() + (static_cast<size_t>(p) * n_bins);
+
+      for (uint k = 0U; k < n_bins; k++) {
+        acc_re_ptr[k] += (a_re[k] * b_re[k]) - (a_im[k] * b_im[k]);
+        acc_im_ptr[k] += (a_re[k] * b_im[k]) + (a_im[k] * b_re[k]);
+      }
+    }
+
+    for (uint k = 0U; k < n_bins; k++) {
+      spectrum[k][0] = acc_re_ptr[k];
+      spectrum[k][1] = acc_im_ptr[k];
+    }
+
+    fftwf_execute_dft_c2r(backward, spectrum, frame);
+
+    // only the last block of the frame is free of circular aliasing
+
+    std::copy_n(frame + block_size, std::min(static_cast<size_t>(block_size), outputs[b].size()), outputs[b].begin());
+  }
+}
@@ -18,9 +18,7 @@
  */
 
 #include "fir_filter_base.hpp"
-#include <sched.h>
 #include <sys/types.h>
-#include <zita-convolver.h>
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
@@ -28,29 +26,10 @@
 #include <string>
 #include <utility>
 #include <vector>
-#include "util.hpp"
-
-namespace {
-
-constexpr auto CONVPROC_SCHEDULER_PRIORITY = 0;
-
-constexpr auto CONVPROC_SCHEDULER_CLASS = SCHED_FIFO;
-
-}  // namespace
 
 FirFilterBase::FirFilterBase(std::string tag) : log_tag(std::move(tag)) {}
 
-FirFilterBase::~FirFilterBase() {
-  zita_ready = false;
-
-  if (conv != nullptr) {
-    conv->stop_process();
-
-    conv->cleanup();
-
-    delete conv;
-  }
-}
+FirFilterBase::~FirFilterBase() = default;
 
 void FirFilterBase::set_rate(const uint& value) {
   rate = value;
@@ -72,8 +51,16 @@ void FirFilterBase::set_transition_band(const float& value) {
   transition_band = value;
 }
 
+void FirFilterBase::set_kernel_only(const bool& value) {
+  kernel_only = value;
+}
+
 void FirFilterBase::setup() {}
 
+auto FirFilterBase::get_kernel() const -> const std::vector<float>& {
+  return kernel;
+}
+
 auto FirFilterBase::create_lowpass_kernel(const float& cutoff, const float& transition_band) const
     -> std::vector<float> {
   std::vector<float> output;
@@ -143,63 +130,22 @@ auto FirFilterBase::create_lowpass_kernel(const float& cutoff, const float& tran
   return output;
 }
 
-void FirFilterBase::setup_zita() {
-  zita_ready = false;
+void FirFilterBase::setup_convolver() {
+  convolver_ready = false;
 
-  if (n_samples == 0U || kernel.empty()) {
+  if (kernel_only || n_samples == 0U || kernel.empty()) {
     return;
   }
 
-  if (conv != nullptr) {
-    conv->stop_process();
-
-    conv->cleanup();
-
-    delete conv;
-  }
-
-  conv = new Convproc();
-
-  conv->set_options(0);
-
-  int ret = conv->configure(2, 2, kernel.size(), n_samples, n_samples, n_samples, 0.0F /*density*/);
-
-  if (ret != 0) {
-    util::warning(log_tag + "can't initialise zita-convolver engine: " + util::to_string(ret, ""));
-
-    return;
-  }
-
-  ret = conv->impdata_create(0, 0, 1, kernel.data(), 0, static_cast<int>(kernel.size()));
-
-  if (ret != 0) {
-    util::warning(log_tag + "left impdata_create failed: " + util::to_string(ret, ""));
-
-    return;
-  }
-
-  ret = conv->impdata_create(1, 1, 1, kernel.data(), 0, static_cast<int>(kernel.size()));
-
-  if (ret != 0) {
-    util::warning(log_tag + "right impdata_create failed: " + util::to_string(ret, ""));
-
-    return;
-  }
-
-  ret = conv->start_process(CONVPROC_SCHEDULER_PRIORITY, CONVPROC_SCHEDULER_CLASS);
-
-  if (ret != 0) {
-    util::warning(log_tag + "start_process failed: " + util::to_string(ret, ""));
-
-    conv->stop_process();
-    conv->cleanup();
-
-    return;
-  }
+  /*
+    The kernel is applied with zero latency, like zita-convolver did when its minimum partition was the block size.
+    The fftw plans come from the cache shared by every filter, so only the kernel spectra are computed here.
+  */
 
-  // conv->print();
+  conv_L.set_kernel(kernel, rate);
+  conv_R.set_kernel(kernel, rate);
 
-  zita_ready = true;
+  convolver_ready = true;
 }
 
 void FirFilterBase::direct_conv(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c) {
@@ -36,5 +36,5 @@ void FirFilterHighpass::setup() {
 
   delay = 0.5F * static_cast<float>(kernel.size() - 1U) / static_cast<float>(rate);
 
-  setup_zita();
+  setup_convolver();
 }
@@ -0,0 +1,484 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fused_chain.hpp"
+#include <sys/types.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <numbers>
+#include <span>
+#include <string>
+#include <vector>
+#include "pipe_manager.hpp"
+#include "pipeline_type.hpp"
+#include "plugin_base.hpp"
+#include "tags_plugin_name.hpp"
+#include "util.hpp"
+
+FusedChain::FusedChain(const std::string& tag,
+                       const std::string& chain_name,
+                       PipeManager* pipe_manager,
+                       PipelineType pipe_type)
+    : PluginBase(tag, chain_name, tags::plugin_package::ee, "", "", pipe_manager, pipe_type) {
+  a_spans.resize(channels.size());
+  b_spans.resize(channels.size());
+  dry_spans.resize(channels.size());
+  fade_spans.resize(channels.size());
+
+  for (auto* v : {&buffer_a_left, &buffer_a_right, &buffer_b_left, &buffer_b_right, &dry_left, &dry_right, &fade_left,
+                  &fade_right}) {
+    v->reserve(max_quantum);
+  }
+
+  if (channels.size() > 2U) {
+    for (auto* v : {&buffer_a, &buffer_b, &dry, &fade}) {
+      v->reserve(channels.size() * max_quantum);
+    }
+  }
+}
+
+FusedChain::~FusedChain() {
+  if (connected_to_pw) {
+    disconnect_from_pw();
+  }
+
+  util::debug(log_tag + name + " destroyed");
+}
+
+void FusedChain::set_plugins(const std::vector<std::shared_ptr<PluginBase>>& list) {
+  /*
+    The plugins are read by the realtime thread. They can only be replaced here while our filter is not connected.
+  */
+
+  if (connected_to_pw) {
+    util::warning(log_tag + name + " cannot change its plugins while connected to PipeWire");
+
+    return;
+  }
+
+  const auto n = active.load();
+
+  stages[n] = list;
+
+  stages[1U - n].clear();
+
+  switch_state.store(Switch::idle);
+
+  std::string names;
+
+  for (const auto& plugin : list) {
+    names += " " + plugin->name;
+  }
+
+  util::debug(log_tag + name + " fusing:" + names);
+}
+
+auto FusedChain::crossfade_to(const std::vector<std::shared_ptr<PluginBase>>& list, const uint& crossfade_ms)
+    -> bool {
+  if (!connected_to_pw) {
+    set_plugins(list);
+
+    return true;
+  }
+
+  if (switch_state.load() != Switch::idle) {
+    util::warning(log_tag + name + " is already switching its plugins");
+
+    return false;
+  }
+
+  const auto& current = stages[active.load()];
+
+  const auto same_effects =
+      std::ranges::equal(list, current, [](const auto& a, const auto& b) { return a->name == b->name; });
+
+  // one second is more than the latency of any of our plugins
+
+  if (align_capacity != rate) {
+    align_capacity = rate;
+
+    for (auto& line : align_lines) {
+      line.resize(channels.size() * align_capacity);
+    }
+  }
+
+  for (auto& line : align_lines) {
+    std::ranges::fill(line, 0.0F);
+  }
+
+  align_position = 0U;
+
+  stages[1U - active.load()] = list;
+
+  fade_ms.store(crossfade_ms);
+
+  fade_linear.store(same_effects);
+
+  switch_state.store(Switch::requested, std::memory_order_release);
+
+  std::string names;
+
+  for (const auto& plugin : list) {
+    names += " " + plugin->name;
+  }
+
+  util::debug(log_tag + name + " switching in " + util::to_string(crossfade_ms) + " ms to:" + names);
+
+  return true;
+}
+
+auto FusedChain::finish_crossfade() -> bool {
+  const auto s = switch_state.load(std::memory_order_acquire);
+
+  if (s == Switch::finished) {
+    stages[1U - active.load()].clear();
+
+    switch_state.store(Switch::idle);
+
+    util::debug(log_tag + name + " finished switching its plugins");
+
+    return true;
+  }
+
+  return s == Switch::idle;
+}
+
+auto FusedChain::get_plugins() const -> const std::vector<std::shared_ptr<PluginBase>>& {
+  return stages[active.load()];
+}
+
+void FusedChain::setup() {
+  for (auto* v : {&buffer_a_left, &buffer_a_right, &buffer_b_left, &buffer_b_right, &dry_left, &dry_right, &fade_left,
+                  &fade_right}) {
+    v->resize(n_samples);
+
+    std::ranges::fill(*v, 0.0F);
+  }
+
+  if (channels.size() > 2U) {
+    for (auto* v : {&buffer_a, &buffer_b, &dry, &fade}) {
+      v->resize(channels.size() * n_samples);
+
+      std::ranges::fill(*v, 0.0F);
+    }
+
+    for (size_t n = 0U; n < channels.size(); n++) {
+      a_spans[n] = std::span(buffer_a).subspan(n * n_samples, n_samples);
+      b_spans[n] = std::span(buffer_b).subspan(n * n_samples, n_samples);
+      dry_spans[n] = std::span(dry).subspan(n * n_samples, n_samples);
+      fade_spans[n] = std::span(fade).subspan(n * n_samples, n_samples);
+    }
+  }
+}
+
+void FusedChain::process(std::span<float>& left_in,
+                         std::span<float>& right_in,
+                         std::span<float>& left_out,
+                         std::span<float>& right_out) {
+  const auto fading = start_switch();
+
+  const auto& current = stages[active.load()];
+
+  if (!fading) {
+    update_latency(run_plugins(current, left_in, right_in, left_out, right_out));
+
+    return;
+  }
+
+  std::ranges::copy(left_in, dry_left.begin());
+  std::ranges::copy(right_in, dry_right.begin());
+
+  const auto total_latency = run_plugins(current, left_in, right_in, left_out, right_out);
+
+  const auto incoming_latency = run_plugins(stages[1U - active.load()], dry_left, dry_right, fade_left, fade_right);
+
+  std::array<std::span<float>, 2U> current_out = {left_out, right_out};
+  std::array<std::span<float>, 2U> incoming_out = {std::span<float>(fade_left), std::span<float>(fade_right)};
+
+  align_sides(current_out, incoming_out, total_latency, incoming_latency);
+
+  mix_incoming(left_out, fade_left);
+  mix_incoming(right_out, fade_right);
+
+  advance_crossfade();
+
+  update_latency(std::max(total_latency, incoming_latency));
+}
+
+void FusedChain::process_channels(std::span<std::span<float>> in, std::span<std::span<float>> out) {
+  const auto fading = start_switch();
+
+  const auto& current = stages[active.load()];
+
+  if (!fading) {
+    update_latency(run_plugins(current, in, out));
+
+    return;
+  }
+
+  for (size_t c = 0U; c < in.size(); c++) {
+    std::ranges::copy(in[c], dry_spans[c].begin());
+  }
+
+  const auto total_latency = run_plugins(current, in, out);
+
+  const auto incoming_latency = run_plugins(stages[1U - active.load()], dry_spans, fade_spans);
+
+  align_sides(out, fade_spans, total_latency, incoming_latency);
+
+  for (size_t c = 0U; c < out.size(); c++) {
+    mix_incoming(out[c], fade_spans[c]);
+  }
+
+  advance_crossfade();
+
+  update_latency(std::max(total_latency, incoming_latency));
+}
+
+auto FusedChain::last_active_plugin(const std::vector<std::shared_ptr<PluginBase>>& list) -> size_t {
+  for (size_t n = list.size(); n > 0U; n--) {
+    if (!list[n - 1U]->routed_around) {
+      return n - 1U;
+    }
+  }
+
+  return list.size();
+}
+
+auto FusedChain::run_plugins(const std::vector<std::shared_ptr<PluginBase>>& list,
+                             std::span<float> left_in,
+                             std::span<float> right_in,
+                             std::span<float> left_out,
+                             std::span<float> right_out) -> float {
+  const auto last = last_active_plugin(list);
+
+  if (last == list.size()) {
+    std::ranges::copy(left_in, left_out.begin());
+    std::ranges::copy(right_in, right_out.begin());
+
+    return 0.0F;
+  }
+
+  /*
+    Like in a PipeWire graph every plugin gets distinct input and output buffers. The scratch pairs are used in
+    alternation. The first plugin reads the input and the last one writes directly to the output. Plugins routed
+    around are skipped and the next one reads the buffer they would have copied.
+  */
+
+  std::span<float> a_left(buffer_a_left.data(), n_samples);
+  std::span<float> a_right(buffer_a_right.data(), n_samples);
+  std::span<float> b_left(buffer_b_left.data(), n_samples);
+  std::span<float> b_right(buffer_b_right.data(), n_samples);
+
+  std::span<float> src_left = left_in;
+  std::span<float> src_right = right_in;
+
+  float total_latency = 0.0F;
+
+  size_t n_run = 0U;
+
+  for (size_t n = 0U; n <= last; n++) {
+    const auto& plugin = list[n];
+
+    const bool is_last = n == last;
+
+    if (!is_last && plugin->routed_around) {
+      continue;
+    }
+
+    std::span<float> dst_left = is_last ? left_out : ((n_run % 2U == 0U) ? a_left : b_left);
+    std::span<float> dst_right = is_last ? right_out : ((n_run % 2U == 0U) ? a_right : b_right);
+
+    n_run++;
+
+    plugin->begin_cycle(n_samples, rate);
+
+    plugin->run(src_left, src_right, dst_left, dst_right);
+
+    plugin->end_cycle();
+
+    total_latency += plugin->get_latency_seconds();
+
+    src_left = dst_left;
+    src_right = dst_right;
+  }
+
+  return total_latency;
+}
+
+auto FusedChain::run_plugins(const std::vector<std::shared_ptr<PluginBase>>& list,
+                             std::span<std::span<float>> in,
+                             std::span<std::span<float>> out) -> float {
+  const auto last = last_active_plugin(list);
+
+  if (last == list.size()) {
+    for (size_t c = 0U; c < in.size(); c++) {
+      std::ranges::copy(in[c], out[c].begin());
+    }
+
+    return 0.0F;
+  }
+
+  std::span<std::span<float>> src = in;
+
+  float total_latency = 0.0F;
+
+  size_t n_run = 0U;
+
+  for (size_t n = 0U; n <= last; n++) {
+    const auto& plugin = list[n];
+
+    const bool is_last = n == last;
+
+    if (!is_last && plugin->routed_around) {
+      continue;
+    }
+
+    std::span<std::span<float>> dst = is_last ? out : std::span((n_run % 2U == 0U) ? a_spans : b_spans);
+
+    n_run++;
+
+    plugin->begin_cycle(n_samples, rate);
+
+    plugin->run_channels(src, dst);
+
+    plugin->end_cycle();
+
+    total_latency += plugin->get_latency_seconds();
+
+    src = dst;
+  }
+
+  return total_latency;
+}
+
+auto FusedChain::start_switch() -> bool {
+  // Realtime thread. Returns true while both stages have to be processed.
+
+  const auto s = switch_state.load(std::memory_order_acquire);
+
+  if (s != Switch::requested) {
+    return s == Switch::fading;
+  }
+
+  fade_position = 0U;
+  fade_frames = fade_ms.load() * rate / 1000U;
+
+  if (fade_frames == 0U) {
+    active.store(1U - active.load());
+
+    switch_state.store(Switch::finished, std::memory_order_release);
+
+    return false;
+  }
+
+  switch_state.store(Switch::fading);
+
+  return true;
+}
+
+void FusedChain::align_sides(std::span<std::span<float>> current_out,
+                             std::span<std::span<float>> incoming_out,
+                             const float& current_latency,
+                             const float& incoming_latency) {
+  /*
+    Both sides always go through their line, so the delay can move from one side to the other when a plugin changes
+    its latency during the fade. Each sample is written before the delayed one is read, what allows a zero delay.
+  */
+
+  if (align_capacity == 0U) {
+    return;
+  }
+
+  const auto difference = std::lround((current_latency - incoming_latency) * static_cast<float>(rate));
+
+  const auto max_delay = static_cast<long>(align_capacity) - 1L;
+
+  const std::array<size_t, 2U> delays = {static_cast<size_t>(std::clamp(-difference, 0L, max_delay)),
+                                         static_cast<size_t>(std::clamp(difference, 0L, max_delay))};
+
+  const std::array<std::span<std::span<float>>, 2U> sides = {current_out, incoming_out};
+
+  for (size_t s = 0U; s < 2U; s++) {
+    for (size_t c = 0U; c < sides[s].size(); c++) {
+      auto line = std::span(align_lines[s]).subspan(c * align_capacity, align_capacity);
+
+      auto p = align_position;
+
+      for (auto& v : sides[s][c]) {
+        line[p] = v;
+
+        v = line[(p + align_capacity - delays[s]) % align_capacity];
+
+        p = (p + 1U == align_capacity) ? 0U : p + 1U;
+      }
+    }
+  }
+
+  align_position = (align_position + n_samples) % align_capacity;
+}
+
+void FusedChain::mix_incoming(std::span<float> out, std::span<const float> incoming) const {
+  /*
+    Linear gains sum correlated signals, like the same effects with other values, to a constant level. Equal-power
+    gains do the same for signals that are not correlated.
+  */
+
+  const auto inv_frames = 1.0F / static_cast<float>(fade_frames);
+
+  const auto linear = fade_linear.load(std::memory_order_relaxed);
+
+  for (size_t n = 0U; n < out.size(); n++) {
+    const auto t = std::min(static_cast<float>(fade_position + n) * inv_frames, 1.0F);
+
+    if (linear) {
+      out[n] = out[n] * (1.0F - t) + incoming[n] * t;
+    } else {
+      const auto angle = 0.5F * std::numbers::pi_v<float> * t;
+
+      out[n] = out[n] * std::cos(angle) + incoming[n] * std::sin(angle);
+    }
+  }
+}
+
+void FusedChain::advance_crossfade() {
+  fade_position += n_samples;
+
+  if (fade_position >= fade_frames) {
+    active.store(1U - active.load());
+
+    switch_state.store(Switch::finished, std::memory_order_release);
+  }
+}
+
+void FusedChain::update_latency(const float& total_latency) {
+  if (total_latency != latency_value) {
+    latency_value = total_latency;
+
+    post_latency();
+  }
+}
+
+auto FusedChain::get_latency_seconds() -> float {
+  return latency_value;
+}
@@ -18,15 +18,16 @@
  */
 
 #include "level_meter.hpp"
-#include <ebur128.h>
 #include <algorithm>
-#include <cstddef>
-#include <mutex>
+#include <array>
+#include <memory>
 #include <span>
 #include <string>
+#include "loudness_meter.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 LevelMeter::LevelMeter(const std::string& tag,
@@ -36,7 +37,7 @@ LevelMeter::LevelMeter(const std::string& tag,
                        PipelineType pipe_type)
     : PluginBase(tag,
                  tags::plugin_name::level_meter,
-                 tags::plugin_package::ebur128,
+                 tags::plugin_package::ee,
                  schema,
                  schema_path,
                  pipe_manager,
@@ -47,126 +48,62 @@ LevelMeter::~LevelMeter() {
     disconnect_from_pw();
   }
 
-  for (auto& t : mythreads) {
-    t.join();
-  }
-
-  mythreads.clear();
-
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  if (ebur_state != nullptr) {
-    ebur128_destroy(&ebur_state);
-  }
-
   util::debug(log_tag + name + " destroyed");
 }
 
-auto LevelMeter::init_ebur128() -> bool {
-  if (n_samples == 0U || rate == 0U) {
-    return false;
-  }
-
-  if (ebur_state != nullptr) {
-    ebur128_destroy(&ebur_state);
-
-    ebur_state = nullptr;
+void LevelMeter::init_meter(const uint& rate) {
+  if (rate == 0U) {
+    return;
   }
 
-  ebur_state = ebur128_init(
-      2U, rate, EBUR128_MODE_S | EBUR128_MODE_I | EBUR128_MODE_LRA | EBUR128_MODE_TRUE_PEAK | EBUR128_MODE_HISTOGRAM);
-
-  ebur128_set_channel(ebur_state, 0U, EBUR128_LEFT);
-  ebur128_set_channel(ebur_state, 1U, EBUR128_RIGHT);
-
-  return ebur_state != nullptr;
+  engine.publish(std::make_unique<Engine>(rate));
 }
 
-void LevelMeter::setup() {
-  if (2U * static_cast<size_t>(n_samples) != data.size()) {
-    data.resize(static_cast<size_t>(n_samples) * 2U);
+void LevelMeter::setup_engine(const uint& n_samples, const uint& rate) {
+  if (const auto* e = engine.peek(); e != nullptr && e->rate == rate) {
+    return;
   }
 
-  if (rate != old_rate) {
-    data_mutex.lock();
-
-    ebur128_ready = false;
-
-    data_mutex.unlock();
-
-    mythreads.emplace_back([this]() {  // Using emplace_back here makes sense
-      if (ebur128_ready) {
-        return;
-      }
-
-      auto status = true;
-
-      old_rate = rate;
-
-      status = init_ebur128();
-
-      data_mutex.lock();
-
-      ebur128_ready = status;
-
-      data_mutex.unlock();
-    });
-  }
+  init_meter(rate);
 }
 
 void LevelMeter::process(std::span<float>& left_in,
                          std::span<float>& right_in,
                          std::span<float>& left_out,
                          std::span<float>& right_out) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
   std::copy(left_in.begin(), left_in.end(), left_out.begin());
   std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
-  if (bypass || !ebur128_ready) {
-    return;
-  }
-
-  for (size_t n = 0U; n < n_samples; n++) {
-    data[2U * n] = left_in[n];
-    data[2U * n + 1U] = right_in[n];
-  }
-
-  ebur128_add_frames_float(ebur_state, data.data(), n_samples);
-
-  if (EBUR128_SUCCESS != ebur128_loudness_momentary(ebur_state, &momentary)) {
-    momentary = 0.0;
-  }
+  const auto e = engine.read();
 
-  if (EBUR128_SUCCESS != ebur128_loudness_shortterm(ebur_state, &shortterm)) {
-    shortterm = 0.0;
+  if (bypass || !e || e->rate != rate) {
+    return;
   }
 
-  if (EBUR128_SUCCESS != ebur128_loudness_global(ebur_state, &global)) {
-    global = 0.0;
-  }
+  auto& meter = e->meter;
 
-  if (EBUR128_SUCCESS != ebur128_relative_threshold(ebur_state, &relative)) {
-    relative = 0.0;
-  }
+  const std::array<std::span<float>, 2U> frames = {left_in, right_in};
 
-  if (EBUR128_SUCCESS != ebur128_loudness_range(ebur_state, &range)) {
-    range = 0.0;
-  }
+  meter.add_frames(frames);
 
-  if (EBUR128_SUCCESS != ebur128_true_peak(ebur_state, 0U, &true_peak_L)) {
-    true_peak_L = 0.0;
-  }
+  if (meter.updated()) {
+    momentary = meter.momentary();
+    shortterm = meter.shortterm();
+    global = meter.integrated();
+    relative = meter.relative_threshold();
+    range = meter.loudness_range();
 
-  if (EBUR128_SUCCESS != ebur128_true_peak(ebur_state, 1U, &true_peak_R)) {
-    true_peak_R = 0.0;
+    true_peak_L = meter.true_peak(0U);
+    true_peak_R = meter.true_peak(1U);
   }
 
   if (post_messages) {
     get_peaks(left_in, right_in, left_out, right_out);
 
     if (send_notifications) {
-      results.emit(momentary, shortterm, global, relative, range, true_peak_L, true_peak_R);
+      post_meter(results_meter, {static_cast<float>(momentary), static_cast<float>(shortterm),
+                                 static_cast<float>(global), static_cast<float>(relative), static_cast<float>(range),
+                                 static_cast<float>(true_peak_L), static_cast<float>(true_peak_R)});
 
       notify();
     }
@@ -178,19 +115,17 @@ auto LevelMeter::get_latency_seconds() -> float {
 }
 
 void LevelMeter::reset_history() {
-  mythreads.emplace_back([this]() {  // Using emplace_back here makes sense
-    data_mutex.lock();
-
-    ebur128_ready = false;
-
-    data_mutex.unlock();
+  init_meter(rate);
+}
 
-    auto status = init_ebur128();
+void LevelMeter::on_meter(const telemetry::Record& record) {
+  if (record.id != results_meter) {
+    PluginBase::on_meter(record);
 
-    data_mutex.lock();
+    return;
+  }
 
-    ebur128_ready = status;
+  const auto& v = record.values;
 
-    data_mutex.unlock();
-  });
+  results.emit(v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
 }
@@ -31,6 +31,7 @@
 #include "pipe_objects.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 Limiter::Limiter(const std::string& tag,
@@ -54,6 +55,12 @@ Limiter::Limiter(const std::string& tag,
     util::debug(log_tag + "http://lsp-plug.in/plugins/lv2/sc_limiter_stereo is not installed");
   }
 
+  port_out_latency = lv2_wrapper->get_control_port<"out_latency">();
+  port_grlm_l = lv2_wrapper->get_control_port<"grlm_l">();
+  port_grlm_r = lv2_wrapper->get_control_port<"grlm_r">();
+  port_sclm_l = lv2_wrapper->get_control_port<"sclm_l">();
+  port_sclm_r = lv2_wrapper->get_control_port<"sclm_r">();
+
   gconnections.push_back(g_signal_connect(settings, "changed::external-sidechain",
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<Limiter*>(user_data);
@@ -111,25 +118,13 @@ Limiter::~Limiter() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void Limiter::setup() {
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (lv2_wrapper->get_rate() != rate) {
-    lv2_wrapper->create_instance(rate);
-  }
-}
-
 void Limiter::process(std::span<float>& left_in,
                       std::span<float>& right_in,
                       std::span<float>& left_out,
                       std::span<float>& right_out,
                       std::span<float>& probe_left,
                       std::span<float>& probe_right) {
-  if (!lv2_wrapper->found_plugin || !lv2_wrapper->has_instance() || bypass) {
+  if (!lv2_wrapper->found_plugin || !lv2_ready || bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -151,39 +146,29 @@ void Limiter::process(std::span<float>& left_in,
    This plugin gives the latency in number of samples
  */
 
-  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value("out_latency"));
+  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value(port_out_latency));
 
   if (latency_n_frames != lv) {
     latency_n_frames = lv;
 
     latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
-
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
-
-      latency.emit();
-    });
-
-    update_filter_params();
+    post_latency();
   }
 
   if (post_messages) {
     get_peaks(left_in, right_in, left_out, right_out);
 
     if (send_notifications) {
-      gain_l_port_value = lv2_wrapper->get_control_port_value("grlm_l");
-      gain_r_port_value = lv2_wrapper->get_control_port_value("grlm_r");
-      sidechain_l_port_value = lv2_wrapper->get_control_port_value("sclm_l");
-      sidechain_r_port_value = lv2_wrapper->get_control_port_value("sclm_r");
+      gain_l_port_value = lv2_wrapper->get_control_port_value(port_grlm_l);
+      gain_r_port_value = lv2_wrapper->get_control_port_value(port_grlm_r);
+      sidechain_l_port_value = lv2_wrapper->get_control_port_value(port_sclm_l);
+      sidechain_r_port_value = lv2_wrapper->get_control_port_value(port_sclm_r);
 
-      gain_left.emit(gain_l_port_value);
-      gain_right.emit(gain_r_port_value);
-      sidechain_left.emit(sidechain_l_port_value);
-      sidechain_right.emit(sidechain_r_port_value);
+      post_meter(gain_left_meter, {gain_l_port_value});
+      post_meter(gain_right_meter, {gain_r_port_value});
+      post_meter(sidechain_left_meter, {sidechain_l_port_value});
+      post_meter(sidechain_right_meter, {sidechain_r_port_value});
 
       notify();
     }
@@ -191,6 +176,10 @@ void Limiter::process(std::span<float>& left_in,
 }
 
 void Limiter::update_sidechain_links(const std::string& key) {
+  if (pm == nullptr) {
+    return;
+  }
+
   if (g_settings_get_boolean(settings, "external-sidechain") == 0) {
     pm->destroy_links(list_proxies);
 
@@ -203,12 +192,8 @@ void Limiter::update_sidechain_links(const std::string& key) {
 
   NodeInfo input_device = pm->ee_source_node;
 
-  for (const auto& [serial, node] : pm->node_map) {
-    if (node.name == device_name) {
-      input_device = node;
-
-      break;
-    }
+  if (const auto* node = pm->find_node_by_name(device_name); node != nullptr) {
+    input_device = *node;
   }
 
   pm->destroy_links(list_proxies);
@@ -227,3 +212,27 @@ void Limiter::update_probe_links() {
 auto Limiter::get_latency_seconds() -> float {
   return this->latency_value;
 }
+
+void Limiter::on_meter(const telemetry::Record& record) {
+  switch (record.id) {
+    case gain_left_meter:
+      gain_left.emit(record.values[0]);
+      break;
+
+    case gain_right_meter:
+      gain_right.emit(record.values[0]);
+      break;
+
+    case sidechain_left_meter:
+      sidechain_left.emit(record.values[0]);
+      break;
+
+    case sidechain_right_meter:
+      sidechain_right.emit(record.values[0]);
+      break;
+
+    default:
+      PluginBase::on_meter(record);
+      break;
+  }
+}
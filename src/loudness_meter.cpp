@@ -0,0 +1,446 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "loudness_meter.hpp"
+#include <sys/types.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr auto minus_infinity = -std::numeric_limits<double>::infinity();
+
+constexpr double absolute_gate = -70.0;  // LUFS
+
+// loudness of the center of a histogram bin
+
+auto bin_loudness(const uint& bin) -> double {
+  return absolute_gate + 0.05 + (0.1 * static_cast<double>(bin));
+}
+
+}  // namespace
+
+LoudnessMeter::LoudnessMeter(const uint& rate,
+                             std::vector<double> channel_weights,
+                             const bool& enable_true_peak,
+                             const uint& max_history_seconds)
+    : step_frames(std::max(1U, static_cast<uint>(std::lround(0.1 * static_cast<double>(rate))))),
+      n_channels(channel_weights.size()),
+      history_capacity(10U * static_cast<size_t>(max_history_seconds)),
+      history_limit(history_capacity),
+      weights(std::move(channel_weights)),
+      shelf_z1(n_channels, 0.0),
+      shelf_z2(n_channels, 0.0),
+      highpass_z1(n_channels, 0.0),
+      highpass_z2(n_channels, 0.0),
+      true_peak_enabled(enable_true_peak),
+      true_peak_values(n_channels, 0.0) {
+  /*
+    K-weighting. The BS.1770 filters are given for 48 kHz. The analog prototypes below give the same response at any
+    sampling rate.
+  */
+
+  const auto fs = static_cast<double>(rate);
+
+  {
+    const double f0 = 1681.974450955533;
+    const double gain_db = 3.999843853973347;
+    const double q = 0.7071752369554196;
+
+    const double k = std::tan(std::numbers::pi * f0 / fs);
+    const double vh = std::pow(10.0, gain_db / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    const double a0 = 1.0 + (k / q) + (k * k);
+
+    shelf.b0 = (vh + (vb * k / q) + (k * k)) / a0;
+    shelf.b1 = 2.0 * ((k * k) - vh) / a0;
+    shelf.b2 = (vh - (vb * k / q) + (k * k)) / a0;
+    shelf.a1 = 2.0 * ((k * k) - 1.0) / a0;
+    shelf.a2 = (1.0 - (k / q) + (k * k)) / a0;
+  }
+
+  {
+    const double f0 = 38.13547087602444;
+    const double q = 0.5003270373238773;
+
+    const double k = std::tan(std::numbers::pi * f0 / fs);
+    const double a0 = 1.0 + (k / q) + (k * k);
+
+    highpass.b0 = 1.0;
+    highpass.b1 = -2.0;
+    highpass.b2 = 1.0;
+    highpass.a1 = 2.0 * ((k * k) - 1.0) / a0;
+    highpass.a2 = (1.0 - (k / q) + (k * k)) / a0;
+  }
+
+  blocks.history.resize(history_capacity);
+  shortterm_blocks.history.resize(history_capacity);
+
+  if (!true_peak_enabled) {
+    return;
+  }
+
+  // The signal is oversampled up to at least 192 kHz as recommended by BS.1770 Annex 2
+
+  oversampling = (rate < 96000U) ? 4U : ((rate < 192000U) ? 2U : 1U);
+
+  if (oversampling == 1U) {
+    return;
+  }
+
+  // Hann windowed sinc interpolator split in one polyphase branch per output sample
+
+  const auto n_taps = oversampling * taps_per_phase;
+
+  interpolator.resize(n_taps);
+
+  for (uint k = 0U; k < n_taps; k++) {
+    const double t = (static_cast<double>(k) - (0.5 * static_cast<double>(n_taps - 1U))) / oversampling;
+
+    const double sinc = (t == 0.0) ? 1.0 : std::sin(std::numbers::pi * t) / (std::numbers::pi * t);
+
+    const double window = 0.5 - (0.5 * std::cos(2.0 * std::numbers::pi * (static_cast<double>(k) + 0.5) / n_taps));
+
+    interpolator[((k % oversampling) * taps_per_phase) + (k / oversampling)] = sinc * window;
+  }
+
+  for (uint p = 0U; p < oversampling; p++) {
+    const auto phase = std::span(interpolator).subspan(p * taps_per_phase, taps_per_phase);
+
+    const auto sum = std::accumulate(phase.begin(), phase.end(), 0.0);
+
+    std::ranges::for_each(phase, [&](auto& v) { v /= sum; });
+  }
+
+  tp_history.resize(n_channels * 2U * taps_per_phase, 0.0);
+}
+
+auto LoudnessMeter::channel_weight(const std::string& position) -> double {
+  if (position == "LFE") {
+    return 0.0;
+  }
+
+  if ((position.ends_with('L') || position.ends_with('R')) && !position.starts_with('F')) {
+    return 1.41;
+  }
+
+  return 1.0;
+}
+
+void LoudnessMeter::set_max_history(const uint& seconds) {
+  if (history_capacity == 0U) {
+    return;
+  }
+
+  history_limit = std::clamp<size_t>(10U * static_cast<size_t>(seconds), 1U, history_capacity);
+
+  while (blocks.history_size > history_limit) {
+    blocks.remove_oldest();
+  }
+
+  while (shortterm_blocks.history_size > history_limit) {
+    shortterm_blocks.remove_oldest();
+  }
+
+  update_integrated();
+  update_range();
+}
+
+void LoudnessMeter::add_frames(std::span<const std::span<float>> channels) {
+  n_new_steps = 0U;
+  previous_peak = 0.0;
+
+  if (channels.size() != n_channels || n_channels == 0U) {
+    return;
+  }
+
+  const auto n_frames = channels[0].size();
+
+  for (size_t n = 0U; n < n_frames; n++) {
+    double frame_energy = 0.0;
+
+    for (size_t c = 0U; c < n_channels; c++) {
+      const auto x = static_cast<double>(channels[c][n]);
+
+      previous_peak = std::max(previous_peak, std::fabs(x));
+
+      // transposed direct form II
+
+      const auto y = (shelf.b0 * x) + shelf_z1[c];
+
+      shelf_z1[c] = (shelf.b1 * x) - (shelf.a1 * y) + shelf_z2[c];
+      shelf_z2[c] = (shelf.b2 * x) - (shelf.a2 * y);
+
+      const auto z = (highpass.b0 * y) + highpass_z1[c];
+
+      highpass_z1[c] = (highpass.b1 * y) - (highpass.a1 * z) + highpass_z2[c];
+      highpass_z2[c] = (highpass.b2 * y) - (highpass.a2 * z);
+
+      frame_energy += weights[c] * z * z;
+    }
+
+    if (true_peak_enabled) {
+      update_true_peak(n, channels);
+    }
+
+    step_sum += frame_energy;
+
+    if (++step_frame_count == step_frames) {
+      finish_step();
+    }
+  }
+}
+
+void LoudnessMeter::finish_step() {
+  step_energy[step_position] = step_sum / static_cast<double>(step_frames);
+
+  step_position = (step_position + 1U) % shortterm_steps;
+
+  step_sum = 0.0;
+  step_frame_count = 0U;
+
+  n_steps++;
+  n_new_steps++;
+
+  // The windows are not full at the beginning. The missing steps count as silence.
+
+  double momentary_energy = 0.0;
+
+  for (uint i = 1U; i <= momentary_steps; i++) {
+    momentary_energy += step_energy[(step_position + shortterm_steps - i) % shortterm_steps];
+  }
+
+  momentary_energy /= static_cast<double>(momentary_steps);
+
+  const auto shortterm_energy =
+      std::accumulate(step_energy.begin(), step_energy.end(), 0.0) / static_cast<double>(shortterm_steps);
+
+  momentary_value = energy_to_loudness(momentary_energy);
+  shortterm_value = energy_to_loudness(shortterm_energy);
+
+  // 400 ms gating blocks overlapping by 75% and 3 s short-term values taken every 100 ms
+
+  if (n_steps >= momentary_steps) {
+    blocks.add(momentary_energy, history_limit);
+
+    update_integrated();
+  }
+
+  if (n_steps >= shortterm_steps) {
+    shortterm_blocks.add(shortterm_energy, history_limit);
+
+    update_range();
+  }
+}
+
+void LoudnessMeter::update_integrated() {
+  if (blocks.total_count == 0U) {
+    integrated_value = minus_infinity;
+    relative_value = absolute_gate;
+
+    return;
+  }
+
+  relative_value = energy_to_loudness(blocks.total_energy / static_cast<double>(blocks.total_count)) - 10.0;
+
+  uint count = 0U;
+  double energy = 0.0;
+
+  for (uint bin = first_bin_above(relative_value); bin < n_bins; bin++) {
+    count += blocks.count[bin];
+    energy += blocks.energy[bin];
+  }
+
+  integrated_value = (count != 0U) ? energy_to_loudness(energy / static_cast<double>(count)) : minus_infinity;
+}
+
+void LoudnessMeter::update_range() {
+  // EBU Tech 3342
+
+  if (shortterm_blocks.total_count == 0U) {
+    range_value = 0.0;
+
+    return;
+  }
+
+  const auto gate =
+      energy_to_loudness(shortterm_blocks.total_energy / static_cast<double>(shortterm_blocks.total_count)) - 20.0;
+
+  const auto first_bin = first_bin_above(gate);
+
+  uint count = 0U;
+
+  for (uint bin = first_bin; bin < n_bins; bin++) {
+    count += shortterm_blocks.count[bin];
+  }
+
+  if (count == 0U) {
+    range_value = 0.0;
+
+    return;
+  }
+
+  const auto low_rank = static_cast<uint>(std::lround(0.10 * static_cast<double>(count - 1U)));
+  const auto high_rank = static_cast<uint>(std::lround(0.95 * static_cast<double>(count - 1U)));
+
+  uint low_bin = first_bin;
+  uint high_bin = first_bin;
+  uint cumulative = 0U;
+
+  for (uint bin = first_bin; bin < n_bins; bin++) {
+    const auto previous = cumulative;
+
+    cumulative += shortterm_blocks.count[bin];
+
+    if (previous <= low_rank && low_rank < cumulative) {
+      low_bin = bin;
+    }
+
+    if (previous <= high_rank && high_rank < cumulative) {
+      high_bin = bin;
+
+      break;
+    }
+  }
+
+  range_value = bin_loudness(high_bin) - bin_loudness(low_bin);
+}
+
+void LoudnessMeter::update_true_peak(const size_t& frame, std::span<const std::span<float>> channels) {
+  for (size_t c = 0U; c < n_channels; c++) {
+    const auto x = static_cast<double>(channels[c][frame]);
+
+    auto peak = std::max(true_peak_values[c], std::fabs(x));
+
+    if (oversampling > 1U) {
+      auto* history = &tp_history[c * 2U * taps_per_phase];
+
+      history[tp_position] = x;
+      history[tp_position + taps_per_phase] = x;
+
+      // history[tp_position + taps_per_phase - j] is the input sample j frames ago
+
+      for (uint p = 0U; p < oversampling; p++) {
+        const auto* h = &interpolator[p * taps_per_phase];
+
+        double y = 0.0;
+
+        for (uint j = 0U; j < taps_per_phase; j++) {
+          y += h[j] * history[tp_position + taps_per_phase - j];
+        }
+
+        peak = std::max(peak, std::fabs(y));
+      }
+    }
+
+    true_peak_values[c] = peak;
+  }
+
+  tp_position = (tp_position + 1U) % taps_per_phase;
+}
+
+auto LoudnessMeter::energy_to_loudness(const double& energy) -> double {
+  return (energy > 0.0) ? -0.691 + (10.0 * std::log10(energy)) : minus_infinity;
+}
+
+auto LoudnessMeter::bin_of(const double& energy) -> uint16_t {
+  const auto loudness = energy_to_loudness(energy);
+
+  if (loudness < absolute_gate) {
+    return gated_out;
+  }
+
+  const auto bin = std::floor((loudness - absolute_gate) * 10.0);
+
+  return static_cast<uint16_t>(std::min(static_cast<double>(n_bins - 1U), bin));
+}
+
+auto LoudnessMeter::first_bin_above(const double& loudness) -> uint {
+  // bins whose center is below the threshold are left out
+
+  if (loudness < absolute_gate) {
+    return 0U;
+  }
+
+  auto bin = static_cast<uint>(std::min(static_cast<double>(n_bins), std::floor((loudness - absolute_gate) * 10.0)));
+
+  if (bin < n_bins && bin_loudness(bin) < loudness) {
+    bin++;
+  }
+
+  return bin;
+}
+
+void LoudnessMeter::Histogram::add(const double& block_energy, const size_t& max_size) {
+  const auto bin = bin_of(block_energy);
+
+  if (!history.empty()) {
+    while (history_size >= max_size && history_size != 0U) {
+      remove_oldest();
+    }
+
+    history[(history_start + history_size) % history.size()] = bin;
+
+    history_size++;
+  }
+
+  if (bin == gated_out) {
+    return;
+  }
+
+  count[bin]++;
+  energy[bin] += block_energy;
+
+  total_count++;
+  total_energy += block_energy;
+}
+
+void LoudnessMeter::Histogram::remove_oldest() {
+  const auto bin = history[history_start];
+
+  history_start = (history_start + 1U) % history.size();
+
+  history_size--;
+
+  if (bin == gated_out) {
+    return;
+  }
+
+  /*
+    The energy of each block is not stored. The blocks in a bin are within 0.1 LU of each other, so the mean energy of
+    the bin is taken out.
+  */
+
+  const auto mean = energy[bin] / static_cast<double>(count[bin]);
+
+  count[bin]--;
+  energy[bin] = (count[bin] != 0U) ? energy[bin] - mean : 0.0;
+
+  total_count--;
+  total_energy = (total_count != 0U) ? std::max(0.0, total_energy - mean) : 0.0;
+}
@@ -0,0 +1,405 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "lv2_world.hpp"
+#include <glib.h>
+#include <lilv/lilv.h>
+#include <lv2/atom/atom.h>
+#include <lv2/core/lv2.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <ranges>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "util.hpp"
+
+namespace lv2 {
+
+namespace {
+
+constexpr auto index_version = 2;
+
+std::mutex world_mutex;
+
+std::weak_ptr<World> shared_world;
+
+}  // namespace
+
+World::World() : world(lilv_world_new()) {
+  if (world == nullptr) {
+    util::warning("failed to initialized the world");
+
+    return;
+  }
+
+  read_index();
+}
+
+World::~World() {
+  descriptors.clear();
+
+  if (world != nullptr) {
+    lilv_world_free(world);
+  }
+
+  util::debug("lv2 world destroyed");
+}
+
+auto World::acquire() -> std::shared_ptr<World> {
+  std::scoped_lock<std::mutex> lock(world_mutex);
+
+  auto instance = shared_world.lock();
+
+  if (instance == nullptr) {
+    instance = std::make_shared<World>();
+
+    shared_world = instance;
+  }
+
+  return instance;
+}
+
+auto World::get() const -> LilvWorld* {
+  return world;
+}
+
+auto World::get_mutex() -> std::mutex& {
+  return mutex;
+}
+
+auto World::find_plugin(const std::string& uri) -> const PluginDescriptor& {
+  std::scoped_lock<std::mutex> lock(mutex);
+
+  if (auto it = descriptors.find(uri); it != descriptors.end()) {
+    return *it->second;
+  }
+
+  const auto* plugin = (world != nullptr) ? lookup(uri) : nullptr;
+
+  auto descriptor = (plugin != nullptr) ? describe(plugin) : std::make_unique<PluginDescriptor>();
+
+  return *descriptors.emplace(uri, std::move(descriptor)).first->second;
+}
+
+auto World::lookup(const std::string& uri) -> const LilvPlugin* {
+  auto* const node = lilv_new_uri(world, uri.c_str());
+
+  if (node == nullptr) {
+    util::warning("Invalid plugin URI: " + uri);
+
+    return nullptr;
+  }
+
+  const auto* plugin = lilv_plugins_get_by_uri(lilv_world_get_all_plugins(world), node);
+
+  if (plugin == nullptr && !loaded_all) {
+    if (auto it = index.find(uri); it != index.end() && bundle_mtime(it->second.bundle) == it->second.mtime) {
+      auto* bundle = lilv_new_file_uri(world, nullptr, it->second.bundle.c_str());
+
+      lilv_world_load_bundle(world, bundle);
+
+      lilv_node_free(bundle);
+
+      plugin = lilv_plugins_get_by_uri(lilv_world_get_all_plugins(world), node);
+    }
+
+    const auto it = missing.find(uri);
+
+    if (plugin == nullptr && it != missing.end() && it->second == search_path_mtime()) {
+      util::debug(uri + " was not found by the last scan and nothing was installed since then");
+    } else if (plugin == nullptr) {
+      util::debug(uri + " is not in the lv2 index. Scanning all the bundles");
+
+      load_all();
+
+      plugin = lilv_plugins_get_by_uri(lilv_world_get_all_plugins(world), node);
+    }
+  }
+
+  if (plugin == nullptr && loaded_all && !missing.contains(uri)) {
+    missing[uri] = search_path_mtime();
+
+    write_index();
+  }
+
+  lilv_node_free(node);
+
+  if (plugin == nullptr) {
+    util::warning("Could not find the plugin: " + uri);
+  }
+
+  return plugin;
+}
+
+void World::load_all() {
+  lilv_world_load_all(world);
+
+  loaded_all = true;
+
+  index.clear();
+  missing.clear();
+
+  const auto* plugins = lilv_world_get_all_plugins(world);
+
+  LILV_FOREACH (plugins, i, plugins) {
+    const auto* plugin = lilv_plugins_get(plugins, i);
+
+    auto* path = lilv_file_uri_parse(lilv_node_as_uri(lilv_plugin_get_bundle_uri(plugin)), nullptr);
+
+    if (path == nullptr) {
+      continue;
+    }
+
+    index[lilv_node_as_uri(lilv_plugin_get_uri(plugin))] = {.bundle = path, .mtime = bundle_mtime(path)};
+
+    lilv_free(path);
+  }
+
+  write_index();
+}
+
+auto World::bundle_mtime(const std::string& bundle) -> int64_t {
+  // adding or removing files changes the directory and editing the manifest changes the manifest
+
+  std::error_code ec;
+
+  const auto dir_time = std::filesystem::last_write_time(bundle, ec);
+
+  if (ec) {
+    return -1;
+  }
+
+  const auto manifest_time = std::filesystem::last_write_time(std::filesystem::path(bundle) / "manifest.ttl", ec);
+
+  const auto latest = (ec) ? dir_time : std::max(dir_time, manifest_time);
+
+  return std::chrono::duration_cast<std::chrono::seconds>(latest.time_since_epoch()).count();
+}
+
+auto World::search_path_mtime() -> int64_t {
+  /*
+    Installing or removing a bundle changes the directory that holds it. We use the same directories as lilv, LV2_PATH
+    or the usual system and user locations.
+  */
+
+  const auto* env = g_getenv("LV2_PATH");
+
+  const std::string search_path =
+      (env != nullptr) ? env : "~/.lv2:/usr/local/lib/lv2:/usr/lib/lv2:/usr/local/lib64/lv2:/usr/lib64/lv2";
+
+  int64_t latest = 0;
+
+  for (const auto& range : std::views::split(search_path, ':')) {
+    std::string dir(range.begin(), range.end());
+
+    if (dir.starts_with('~')) {
+      dir = g_get_home_dir() + dir.substr(1U);
+    }
+
+    std::error_code ec;
+
+    const auto time = std::filesystem::last_write_time(dir, ec);
+
+    if (!ec) {
+      latest = std::max(latest, std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count());
+    }
+  }
+
+  return latest;
+}
+
+auto World::index_path() -> std::string {
+  return std::string(g_get_user_cache_dir()) + "/easyeffects/lv2_index.json";
+}
+
+void World::read_index() {
+  std::ifstream is(index_path());
+
+  if (!is.is_open()) {
+    return;
+  }
+
+  try {
+    nlohmann::json json;
+
+    is >> json;
+
+    if (json.at("version").get<int>() != index_version) {
+      return;
+    }
+
+    for (const auto& [uri, entry] : json.at("plugins").items()) {
+      index[uri] = {.bundle = entry.at("bundle").get<std::string>(), .mtime = entry.at("mtime").get<int64_t>()};
+    }
+
+    for (const auto& [uri, mtime] : json.at("missing").items()) {
+      missing[uri] = mtime.get<int64_t>();
+    }
+
+    util::debug("lv2 index has " + util::to_string(index.size()) + " plugins");
+  } catch (const std::exception& e) {
+    util::warning("could not read the lv2 index: " + std::string(e.what()));
+
+    index.clear();
+    missing.clear();
+  }
+}
+
+void World::write_index() {
+  const std::filesystem::path path = index_path();
+
+  std::error_code ec;
+
+  std::filesystem::create_directories(path.parent_path(), ec);
+
+  nlohmann::json json;
+
+  json["version"] = index_version;
+  json["plugins"] = nlohmann::json::object();
+
+  for (const auto& [uri, entry] : index) {
+    json["plugins"][uri] = {{"bundle", entry.bundle}, {"mtime", entry.mtime}};
+  }
+
+  json["missing"] = missing;
+
+  std::ofstream o(path);
+
+  if (!o.is_open()) {
+    util::debug("could not write the lv2 index to " + path.string());
+
+    return;
+  }
+
+  o << json << '\n';
+
+  util::debug("lv2 index with " + util::to_string(index.size()) + " plugins saved to " + path.string());
+}
+
+auto World::describe(const LilvPlugin* plugin) -> std::unique_ptr<PluginDescriptor> {
+  auto descriptor = std::make_unique<PluginDescriptor>();
+
+  descriptor->plugin = plugin;
+
+  const auto n_ports = lilv_plugin_get_num_ports(plugin);
+
+  auto& ports = descriptor->ports;
+  auto& data_ports = descriptor->data_ports;
+
+  ports.resize(n_ports);
+
+  // Get min, max and default values for all ports
+
+  std::vector<float> values(n_ports);
+  std::vector<float> minimum(n_ports);
+  std::vector<float> maximum(n_ports);
+
+  lilv_plugin_get_port_ranges_float(plugin, minimum.data(), maximum.data(), values.data());
+
+  LilvNode* lv2_InputPort = lilv_new_uri(world, LV2_CORE__InputPort);
+  LilvNode* lv2_OutputPort = lilv_new_uri(world, LV2_CORE__OutputPort);
+  LilvNode* lv2_AudioPort = lilv_new_uri(world, LV2_CORE__AudioPort);
+  LilvNode* lv2_ControlPort = lilv_new_uri(world, LV2_CORE__ControlPort);
+  LilvNode* lv2_AtomPort = lilv_new_uri(world, LV2_ATOM__AtomPort);
+  LilvNode* lv2_connectionOptional = lilv_new_uri(world, LV2_CORE__connectionOptional);
+
+  for (uint n = 0U; n < n_ports; n++) {
+    auto* port = &ports[n];
+
+    const auto* lilv_port = lilv_plugin_get_port_by_index(plugin, n);
+
+    auto* port_name = lilv_port_get_name(plugin, lilv_port);
+
+    port->index = n;
+    port->name = lilv_node_as_string(port_name);
+    port->symbol = lilv_node_as_string(lilv_port_get_symbol(plugin, lilv_port));
+    port->optional = lilv_port_has_property(plugin, lilv_port, lv2_connectionOptional);
+
+    // Save port default value
+    if (!std::isnan(values[n])) {
+      port->value = values[n];
+    }
+    // Save minimum and maximum values
+    if (!std::isnan(minimum[n])) {
+      port->min = minimum[n];
+    }
+    if (!std::isnan(maximum[n])) {
+      port->max = maximum[n];
+    }
+
+    if (lilv_port_is_a(plugin, lilv_port, lv2_InputPort)) {
+      port->is_input = true;
+    } else if (!lilv_port_is_a(plugin, lilv_port, lv2_OutputPort) && !port->optional) {
+      util::warning("Port " + port->name + " is neither input nor output!");
+    }
+
+    if (lilv_port_is_a(plugin, lilv_port, lv2_ControlPort)) {
+      port->type = TYPE_CONTROL;
+    } else if (lilv_port_is_a(plugin, lilv_port, lv2_AtomPort)) {
+      port->type = TYPE_ATOM;
+    } else if (lilv_port_is_a(plugin, lilv_port, lv2_AudioPort)) {
+      port->type = TYPE_AUDIO;
+
+      if (port->is_input) {
+        if (descriptor->n_audio_in == 0)
+          data_ports.in.left = port->index;
+        else if (descriptor->n_audio_in == 1)
+          data_ports.in.right = port->index;
+        else if (descriptor->n_audio_in == 2)
+          data_ports.probe.left = port->index;
+        else if (descriptor->n_audio_in == 3)
+          data_ports.probe.right = port->index;
+
+        descriptor->n_audio_in++;
+      } else {
+        if (descriptor->n_audio_out == 0)
+          data_ports.out.left = port->index;
+        else if (descriptor->n_audio_out == 1)
+          data_ports.out.right = port->index;
+
+        descriptor->n_audio_out++;
+      }
+    } else if (!port->optional) {
+      util::warning("Port " + port->name + " has un unsupported type!");
+    }
+
+    lilv_node_free(port_name);
+  }
+
+  lilv_node_free(lv2_connectionOptional);
+  lilv_node_free(lv2_ControlPort);
+  lilv_node_free(lv2_AtomPort);
+  lilv_node_free(lv2_AudioPort);
+  lilv_node_free(lv2_OutputPort);
+  lilv_node_free(lv2_InputPort);
+
+  return descriptor;
+}
+
+}  // namespace lv2
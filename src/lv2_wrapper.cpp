@@ -31,9 +31,10 @@
 #include <lv2/ui/ui.h>
 #include <lv2/urid/urid.h>
 #include <sys/types.h>
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <chrono>
-#include <cmath>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
@@ -43,6 +44,7 @@
 #include <string>
 #include <thread>
 #include <vector>
+#include "lv2_world.hpp"
 #include "util.hpp"
 
 namespace lv2 {
@@ -62,56 +64,47 @@ auto lv2_printf(LV2_Log_Handle handle, LV2_URID type, const char* format, ...) -
   return r;
 }
 
-Lv2Wrapper::Lv2Wrapper(const std::string& plugin_uri) : plugin_uri(plugin_uri), world(lilv_world_new()) {
-  if (world == nullptr) {
-    util::warning("failed to initialized the world");
+Lv2Wrapper::Lv2Wrapper(const std::string& plugin_uri) : plugin_uri(plugin_uri), world(World::acquire()) {
+  const auto& descriptor = world->find_plugin(plugin_uri);
 
-    return;
-  }
-
-  auto* const uri = lilv_new_uri(world, plugin_uri.c_str());
-
-  if (uri == nullptr) {
-    util::warning("Invalid plugin URI: " + plugin_uri);
+  plugin = descriptor.plugin;
 
+  if (plugin == nullptr) {
     return;
   }
 
-  lilv_world_load_all(world);
-
-  const LilvPlugins* plugins = lilv_world_get_all_plugins(world);
-
-  plugin = lilv_plugins_get_by_uri(plugins, uri);
+  found_plugin = true;
 
-  lilv_node_free(uri);
+  ports = descriptor.ports;
+  data_ports = descriptor.data_ports;
 
-  if (plugin == nullptr) {
-    util::warning("Could not find the plugin: " + plugin_uri);
+  n_ports = static_cast<uint>(ports.size());
+  n_audio_in = descriptor.n_audio_in;
+  n_audio_out = descriptor.n_audio_out;
 
-    return;
+  for (const auto& p : ports) {
+    if (p.type == PortType::TYPE_CONTROL) {
+      control_port_indices[p.symbol] = p.index;
+    }
   }
 
-  found_plugin = true;
-
   check_required_features();
-
-  create_ports();
 }
 
 Lv2Wrapper::~Lv2Wrapper() {
   if (instance != nullptr) {
+    std::scoped_lock<std::mutex> lock(world->get_mutex());
+
     lilv_instance_deactivate(instance);
     lilv_instance_free(instance);
 
     instance = nullptr;
   }
-
-  if (world != nullptr) {
-    lilv_world_free(world);
-  }
 }
 
 void Lv2Wrapper::check_required_features() {
+  std::scoped_lock<std::mutex> lock(world->get_mutex());
+
   LilvNodes* required_features = lilv_plugin_get_required_features(plugin);
 
   if (required_features != nullptr) {
@@ -128,110 +121,11 @@ void Lv2Wrapper::check_required_features() {
   }
 }
 
-void Lv2Wrapper::create_ports() {
-  n_ports = lilv_plugin_get_num_ports(plugin);
-
-  ports.resize(n_ports);
-
-  // Get min, max and default values for all ports
-
-  std::vector<float> values(n_ports);
-  std::vector<float> minimum(n_ports);
-  std::vector<float> maximum(n_ports);
-
-  lilv_plugin_get_port_ranges_float(plugin, minimum.data(), maximum.data(), values.data());
-
-  LilvNode* lv2_InputPort = lilv_new_uri(world, LV2_CORE__InputPort);
-  LilvNode* lv2_OutputPort = lilv_new_uri(world, LV2_CORE__OutputPort);
-  LilvNode* lv2_AudioPort = lilv_new_uri(world, LV2_CORE__AudioPort);
-  LilvNode* lv2_ControlPort = lilv_new_uri(world, LV2_CORE__ControlPort);
-  LilvNode* lv2_AtomPort = lilv_new_uri(world, LV2_ATOM__AtomPort);
-  LilvNode* lv2_connectionOptional = lilv_new_uri(world, LV2_CORE__connectionOptional);
-
-  data_ports.in.left = data_ports.in.right = UINT_MAX;
-  data_ports.probe.left = data_ports.probe.right = UINT_MAX;
-  data_ports.out.left = data_ports.out.right = UINT_MAX;
-
-  for (uint n = 0U; n < n_ports; n++) {
-    auto* port = &ports[n];
-
-    const auto* lilv_port = lilv_plugin_get_port_by_index(plugin, n);
-
-    auto* port_name = lilv_port_get_name(plugin, lilv_port);
-
-    port->index = n;
-    port->name = lilv_node_as_string(port_name);
-    port->symbol = lilv_node_as_string(lilv_port_get_symbol(plugin, lilv_port));
-    port->optional = lilv_port_has_property(plugin, lilv_port, lv2_connectionOptional);
-
-    // Save port default value
-    if (!std::isnan(values[n])) {
-      port->value = values[n];
-    }
-    // Save minimum and maximum values
-    if (!std::isnan(minimum[n])) {
-      port->min = minimum[n];
-    }
-    if (!std::isnan(maximum[n])) {
-      port->max = maximum[n];
-    }
-
-    // util::warning("port name: " + port->name);
-    // util::warning("port symbol: " + port->symbol);
-
-    if (lilv_port_is_a(plugin, lilv_port, lv2_InputPort)) {
-      port->is_input = true;
-    } else if (!lilv_port_is_a(plugin, lilv_port, lv2_OutputPort) && !port->optional) {
-      util::warning("Port " + port->name + " is neither input nor output!");
-    }
-
-    if (lilv_port_is_a(plugin, lilv_port, lv2_ControlPort)) {
-      port->type = TYPE_CONTROL;
-    } else if (lilv_port_is_a(plugin, lilv_port, lv2_AtomPort)) {
-      port->type = TYPE_ATOM;
-
-      // util::warning("port name: " + port->name);
-    } else if (lilv_port_is_a(plugin, lilv_port, lv2_AudioPort)) {
-      port->type = TYPE_AUDIO;
-
-      if (port->is_input) {
-        if (n_audio_in == 0)
-          data_ports.in.left = port->index;
-        else if (n_audio_in == 1)
-          data_ports.in.right = port->index;
-        else if (n_audio_in == 2)
-          data_ports.probe.left = port->index;
-        else if (n_audio_in == 3)
-          data_ports.probe.right = port->index;
-
-        n_audio_in++;
-      } else {
-        if (n_audio_out == 0)
-          data_ports.out.left = port->index;
-        else if (n_audio_out == 1)
-          data_ports.out.right = port->index;
-
-        n_audio_out++;
-      }
-    } else if (!port->optional) {
-      util::warning("Port " + port->name + " has un unsupported type!");
-    }
-
-    lilv_node_free(port_name);
-  }
-
-  // util::warning("n audio_in ports: " + util::to_string(n_audio_in));
-  // util::warning("n audio_out ports: " + util::to_string(n_audio_out));
+auto Lv2Wrapper::create_instance(const uint& rate) -> bool {
+  // Main thread only. Loading a plugin library and freeing it change the world shared by every wrapper.
 
-  lilv_node_free(lv2_connectionOptional);
-  lilv_node_free(lv2_ControlPort);
-  lilv_node_free(lv2_AtomPort);
-  lilv_node_free(lv2_AudioPort);
-  lilv_node_free(lv2_OutputPort);
-  lilv_node_free(lv2_InputPort);
-}
+  std::scoped_lock<std::mutex> lock(world->get_mutex());
 
-auto Lv2Wrapper::create_instance(const uint& rate) -> bool {
   this->rate = rate;
 
   if (instance != nullptr) {
@@ -370,85 +264,79 @@ void Lv2Wrapper::deactivate() {
   lilv_instance_deactivate(instance);
 }
 
-void Lv2Wrapper::set_control_port_value(const std::string& symbol, const float& value) {
-  auto found = false;
-
-  for (auto& p : ports) {
-    if (p.type == PortType::TYPE_CONTROL && p.symbol == symbol) {
-      if (!p.is_input) {
-        util::warning(plugin_uri + " port " + symbol + " is not an input!");
-
-        return;
-      }
+auto Lv2Wrapper::get_control_port(const std::string& symbol) -> ControlPort {
+  if (auto it = control_port_indices.find(symbol); it != control_port_indices.end()) {
+    return {.index = it->second};
+  }
 
-      ui_port_event(p.index, value);
+  if (found_plugin) {
+    util::error(plugin_uri + " port symbol not found: " + symbol);
+  }
 
-      // Check port bounds
-      if (value < p.min) {
-        // util::warning(plugin_uri + ": value " + util::to_string(value) + " is out of minimum limit for port " +
-        //               p.symbol + " (" + p.name + ")");
+  return {};
+}
 
-        p.value = p.min;
-      } else if (value > p.max) {
-        // util::warning(plugin_uri + ": value " + util::to_string(value) + " is out of maximum limit for port " +
-        //               p.symbol + " (" + p.name + ")");
+void Lv2Wrapper::set_control_port_value(const ControlPort& port, const float& value) {
+  if (!port.valid()) {
+    return;
+  }
 
-        p.value = p.max;
-      } else {
-        p.value = value;
-      }
+  auto& p = ports[port.index];
 
-      found = true;
+  if (!p.is_input) {
+    util::warning(plugin_uri + " port " + p.symbol + " is not an input!");
 
-      break;
-    }
+    return;
   }
 
-  if (!found) {
-    util::warning(plugin_uri + " port symbol not found: " + symbol);
-  }
-}
-auto Lv2Wrapper::get_control_port_value(const std::string& symbol) -> float {
-  size_t hash = std::hash<std::string>{}(symbol);
+  ui_port_event(p.index, value);
 
-  for (const auto& slot : control_ports_cache) {
-    // We use hash == 0 to mean the cache slot and all following are empty.
-    // We might get collisions with hash == 0, which is fine.
-    if (slot.first == 0)
-      break;
+  // Check port bounds
+  if (value < p.min) {
+    // util::warning(plugin_uri + ": value " + util::to_string(value) + " is out of minimum limit for port " +
+    //               p.symbol + " (" + p.name + ")");
 
-    if (slot.first != hash)
-      continue;
+    p.value = p.min;
+  } else if (value > p.max) {
+    // util::warning(plugin_uri + ": value " + util::to_string(value) + " is out of maximum limit for port " +
+    //               p.symbol + " (" + p.name + ")");
 
-    // Ignore false positives.
-    const Port& p = ports[slot.second];
-    if (p.type == PortType::TYPE_CONTROL && p.symbol == symbol)
-      return p.value;
+    p.value = p.max;
+  } else {
+    p.value = value;
   }
+}
 
-  for (const auto& p : ports) {
-    if (p.type == PortType::TYPE_CONTROL && p.symbol == symbol) {
-      // Add to cache.
-      for (size_t i = 0; i < control_ports_cache.size(); i++) {
-        if (control_ports_cache[i].first == 0) {
-          control_ports_cache[i] = std::pair<size_t, uint>(hash, p.index);
-          break;
-        }
-      }
+void Lv2Wrapper::set_control_port_value(const std::string& symbol, const float& value) {
+  assert(std::this_thread::get_id() == main_thread_id);
 
-      return p.value;
-    }
-  }
+  set_control_port_value(get_control_port(symbol), value);
+}
 
-  util::warning(plugin_uri + " port symbol not found: " + symbol);
+auto Lv2Wrapper::get_control_port_value(const std::string& symbol) -> float {
+  assert(std::this_thread::get_id() == main_thread_id);
 
-  return 0.0F;
+  return get_control_port_value(get_control_port(symbol));
 }
 
 auto Lv2Wrapper::has_instance() -> bool {
   return instance != nullptr;
 }
 
+auto Lv2Wrapper::get_plugin_uri() const -> const std::string& {
+  return plugin_uri;
+}
+
+void Lv2Wrapper::copy_control_values(const Lv2Wrapper& source) {
+  const auto n = std::min(ports.size(), source.ports.size());
+
+  for (size_t i = 0U; i < n; i++) {
+    if (ports[i].type == PortType::TYPE_CONTROL && ports[i].is_input) {
+      ports[i].value = source.ports[i].value;
+    }
+  }
+}
+
 auto Lv2Wrapper::map_urid(const std::string& uri) -> LV2_URID {
   if (map_uri_to_urid.contains(uri)) {
     return map_uri_to_urid[uri];
@@ -474,7 +362,13 @@ void Lv2Wrapper::load_ui() {
         return;
       }
 
-      LilvUIs* uis = lilv_plugin_get_uis(plugin);
+      LilvUIs* uis = nullptr;
+
+      {
+        std::scoped_lock<std::mutex> lock(world->get_mutex());
+
+        uis = lilv_plugin_get_uis(plugin);
+      }
 
       if (uis == nullptr) {
         return;
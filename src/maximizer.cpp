@@ -27,6 +27,7 @@
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 Maximizer::Maximizer(const std::string& tag,
@@ -49,6 +50,9 @@ Maximizer::Maximizer(const std::string& tag,
     util::debug(log_tag + "urn:zamaudio:ZaMaximX2 is not installed");
   }
 
+  port_lv2_latency = lv2_wrapper->get_control_port<"lv2_latency">();
+  port_gr = lv2_wrapper->get_control_port<"gr">();
+
   lv2_wrapper->bind_key_double<"thresh", "threshold">(settings);
 
   lv2_wrapper->bind_key_double<"rel", "release">(settings);
@@ -76,23 +80,11 @@ Maximizer::~Maximizer() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void Maximizer::setup() {
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (lv2_wrapper->get_rate() != rate) {
-    lv2_wrapper->create_instance(rate);
-  }
-}
-
 void Maximizer::process(std::span<float>& left_in,
                         std::span<float>& right_in,
                         std::span<float>& left_out,
                         std::span<float>& right_out) {
-  if (!lv2_wrapper->found_plugin || !lv2_wrapper->has_instance() || bypass) {
+  if (!lv2_wrapper->found_plugin || !lv2_ready || bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -115,24 +107,14 @@ void Maximizer::process(std::span<float>& left_in,
     This plugin gives the latency in number of samples
   */
 
-  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value("lv2_latency"));
+  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value(port_lv2_latency));
 
   if (latency_n_frames != lv) {
     latency_n_frames = lv;
 
     latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
-
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
-
-      latency.emit();
-    });
-
-    update_filter_params();
+    post_latency();
   }
 
   if (post_messages) {
@@ -141,9 +123,9 @@ void Maximizer::process(std::span<float>& left_in,
     if (send_notifications) {
       // reduction needed as double for levelbar widget ui, so we convert it here
 
-      reduction_port_value = static_cast<double>(lv2_wrapper->get_control_port_value("gr"));
+      reduction_port_value = static_cast<double>(lv2_wrapper->get_control_port_value(port_gr));
 
-      reduction.emit(reduction_port_value);
+      post_meter(reduction_meter, {static_cast<float>(reduction_port_value)});
 
       notify();
     }
@@ -153,3 +135,15 @@ void Maximizer::process(std::span<float>& left_in,
 auto Maximizer::get_latency_seconds() -> float {
   return latency_value;
 }
+
+void Maximizer::on_meter(const telemetry::Record& record) {
+  switch (record.id) {
+    case reduction_meter:
+      reduction.emit(record.values[0]);
+      break;
+
+    default:
+      PluginBase::on_meter(record);
+      break;
+  }
+}
@@ -23,6 +23,7 @@
 #include <glib.h>
 #include <sys/types.h>
 #include <algorithm>
+#include <array>
 #include <memory>
 #include <span>
 #include <string>
@@ -32,6 +33,7 @@
 #include "pipe_objects.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 MultibandGate::MultibandGate(const std::string& tag,
@@ -55,6 +57,20 @@ MultibandGate::MultibandGate(const std::string& tag,
     util::debug(log_tag + "http://lsp-plug.in/plugins/lv2/sc_mb_gate_stereo is not installed");
   }
 
+  port_out_latency = lv2_wrapper->get_control_port<"out_latency">();
+
+  for (uint n = 0U; n < n_bands; n++) {
+    const auto nstr = util::to_string(n);
+
+    port_fre.at(n) = lv2_wrapper->get_control_port("fre_" + nstr);
+    port_elm_l.at(n) = lv2_wrapper->get_control_port("elm_" + nstr + "l");
+    port_elm_r.at(n) = lv2_wrapper->get_control_port("elm_" + nstr + "r");
+    port_clm_l.at(n) = lv2_wrapper->get_control_port("clm_" + nstr + "l");
+    port_clm_r.at(n) = lv2_wrapper->get_control_port("clm_" + nstr + "r");
+    port_rlm_l.at(n) = lv2_wrapper->get_control_port("rlm_" + nstr + "l");
+    port_rlm_r.at(n) = lv2_wrapper->get_control_port("rlm_" + nstr + "r");
+  }
+
   gconnections.push_back(g_signal_connect(settings, "changed::sidechain-input-device",
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<MultibandGate*>(user_data);
@@ -87,25 +103,13 @@ MultibandGate::~MultibandGate() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void MultibandGate::setup() {
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (lv2_wrapper->get_rate() != rate) {
-    lv2_wrapper->create_instance(rate);
-  }
-}
-
 void MultibandGate::process(std::span<float>& left_in,
                             std::span<float>& right_in,
                             std::span<float>& left_out,
                             std::span<float>& right_out,
                             std::span<float>& probe_left,
                             std::span<float>& probe_right) {
-  if (!lv2_wrapper->found_plugin || !lv2_wrapper->has_instance() || bypass) {
+  if (!lv2_wrapper->found_plugin || !lv2_ready || bypass) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
@@ -127,24 +131,14 @@ void MultibandGate::process(std::span<float>& left_in,
    This plugin gives the latency in number of samples
  */
 
-  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value("out_latency"));
+  const auto lv = static_cast<uint>(lv2_wrapper->get_control_port_value(port_out_latency));
 
   if (latency_n_frames != lv) {
     latency_n_frames = lv;
 
     latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
-
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
-
-      latency.emit();
-    });
-
-    update_filter_params();
+    post_latency();
   }
 
   if (post_messages) {
@@ -152,24 +146,22 @@ void MultibandGate::process(std::span<float>& left_in,
 
     if (send_notifications) {
       for (uint n = 0U; n < n_bands; n++) {
-        const auto nstr = util::to_string(n);
-
-        frequency_range_end_port_array.at(n) = lv2_wrapper->get_control_port_value("fre_" + nstr);
+        frequency_range_end_port_array.at(n) = lv2_wrapper->get_control_port_value(port_fre.at(n));
 
-        envelope_port_array.at(n) = 0.5F * (lv2_wrapper->get_control_port_value("elm_" + nstr + "l") +
-                                            lv2_wrapper->get_control_port_value("elm_" + nstr + "r"));
+        envelope_port_array.at(n) = 0.5F * (lv2_wrapper->get_control_port_value(port_elm_l.at(n)) +
+                                            lv2_wrapper->get_control_port_value(port_elm_r.at(n)));
 
-        curve_port_array.at(n) = 0.5F * (lv2_wrapper->get_control_port_value("clm_" + nstr + "l") +
-                                         lv2_wrapper->get_control_port_value("clm_" + nstr + "r"));
+        curve_port_array.at(n) = 0.5F * (lv2_wrapper->get_control_port_value(port_clm_l.at(n)) +
+                                         lv2_wrapper->get_control_port_value(port_clm_r.at(n)));
 
-        reduction_port_array.at(n) = 0.5F * (lv2_wrapper->get_control_port_value("rlm_" + nstr + "l") +
-                                             lv2_wrapper->get_control_port_value("rlm_" + nstr + "r"));
+        reduction_port_array.at(n) = 0.5F * (lv2_wrapper->get_control_port_value(port_rlm_l.at(n)) +
+                                             lv2_wrapper->get_control_port_value(port_rlm_r.at(n)));
       }
 
-      frequency_range.emit(frequency_range_end_port_array);
-      envelope.emit(envelope_port_array);
-      curve.emit(curve_port_array);
-      reduction.emit(reduction_port_array);
+      post_meter(frequency_range_meter, frequency_range_end_port_array);
+      post_meter(envelope_meter, envelope_port_array);
+      post_meter(curve_meter, curve_port_array);
+      post_meter(reduction_meter, reduction_port_array);
 
       notify();
     }
@@ -177,6 +169,10 @@ void MultibandGate::process(std::span<float>& left_in,
 }
 
 void MultibandGate::update_sidechain_links(const std::string& key) {
+  if (pm == nullptr) {
+    return;
+  }
+
   auto external_sidechain_enabled = false;
 
   for (uint n = 0U; !external_sidechain_enabled && n < n_bands; n++) {
@@ -197,12 +193,8 @@ void MultibandGate::update_sidechain_links(const std::string& key) {
 
   NodeInfo input_device = pm->ee_source_node;
 
-  for (const auto& [serial, node] : pm->node_map) {
-    if (node.name == device_name) {
-      input_device = node;
-
-      break;
-    }
+  if (const auto* node = pm->find_node_by_name(device_name); node != nullptr) {
+    input_device = *node;
   }
 
   pm->destroy_links(list_proxies);
@@ -221,3 +213,33 @@ void MultibandGate::update_probe_links() {
 auto MultibandGate::get_latency_seconds() -> float {
   return 0.0F;
 }
+
+void MultibandGate::on_meter(const telemetry::Record& record) {
+  static_assert(n_bands <= telemetry::max_values);
+
+  std::array<float, n_bands> bands{};
+
+  std::copy_n(record.values.begin(), n_bands, bands.begin());
+
+  switch (record.id) {
+    case frequency_range_meter:
+      frequency_range.emit(bands);
+      break;
+
+    case envelope_meter:
+      envelope.emit(bands);
+      break;
+
+    case curve_meter:
+      curve.emit(bands);
+      break;
+
+    case reduction_meter:
+      reduction.emit(bands);
+      break;
+
+    default:
+      PluginBase::on_meter(record);
+      break;
+  }
+}
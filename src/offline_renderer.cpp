@@ -0,0 +1,465 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "offline_renderer.hpp"
+#include <glib.h>
+#include <sndfile.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <sndfile.hh>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include "effects_base.hpp"
+#include "pipeline_type.hpp"
+#include "plugin_base.hpp"
+#include "preset_type.hpp"
+#include "presets_manager.hpp"
+#include "resampler.hpp"
+#include "spectrum.hpp"
+#include "tags_app.hpp"
+#include "tags_plugin_name.hpp"
+#include "tags_schema.hpp"
+#include "util.hpp"
+
+namespace {
+
+constexpr auto warmup_cycles = 8U;
+
+constexpr auto resampler_block = 4096U;
+
+}  // namespace
+
+OfflineRenderer::OfflineRenderer(PipelineType pipe_type, const uint& quantum, const uint& sampling_rate)
+    : pipeline_type(pipe_type),
+      n_samples(quantum),
+      rate(sampling_rate),
+      presets_manager(std::make_unique<PresetsManager>()) {
+  schema_base_path =
+      "/" + std::string((pipeline_type == PipelineType::input) ? tags::schema::id_input : tags::schema::id_output) + "/";
+
+  std::replace(schema_base_path.begin(), schema_base_path.end(), '.', '/');
+
+  set_quantum(quantum);
+}
+
+OfflineRenderer::~OfflineRenderer() {
+  // Callbacks queued by the plugins still point to them
+
+  flush_main_context();
+
+  plugins.clear();
+
+  flush_main_context();
+}
+
+auto OfflineRenderer::load_preset(const std::filesystem::path& preset_file) -> bool {
+  const auto preset_type = (pipeline_type == PipelineType::input) ? PresetType::input : PresetType::output;
+
+  nlohmann::json json;
+
+  plugins_order.clear();
+
+  if (!presets_manager->read_effects_pipeline_from_preset(preset_type, preset_file, json, plugins_order) ||
+      !presets_manager->read_plugins_preset(preset_type, plugins_order, json)) {
+    util::warning(log_tag + "could not load the preset " + preset_file.string());
+
+    return false;
+  }
+
+  create_plugins();
+
+  util::debug(log_tag + "loaded " + util::to_string(plugins.size()) + " plugins from " + preset_file.string());
+
+  return true;
+}
+
+void OfflineRenderer::create_plugins() {
+  flush_main_context();
+
+  plugins.clear();
+
+  for (const auto& name : plugins_order) {
+    auto plugin = EffectsBase::create_plugin(name, log_tag, schema_base_path, nullptr, pipeline_type);
+
+    if (plugin == nullptr) {
+      util::warning(log_tag + "unknown plugin: " + name);
+
+      continue;
+    }
+
+    plugin->set_post_messages(false);
+
+    plugins.push_back(plugin);
+  }
+}
+
+void OfflineRenderer::set_quantum(const uint& quantum) {
+  n_samples = quantum;
+
+  left.resize(n_samples);
+  right.resize(n_samples);
+  left_out.resize(n_samples);
+  right_out.resize(n_samples);
+  probe_left.resize(n_samples);
+  probe_right.resize(n_samples);
+
+  std::ranges::fill(probe_left, 0.0F);
+  std::ranges::fill(probe_right, 0.0F);
+}
+
+void OfflineRenderer::flush_main_context() {
+  for (const auto& plugin : plugins) {
+    plugin->drain_telemetry();
+  }
+
+  while (g_main_context_iteration(nullptr, 0) != 0) {
+  }
+}
+
+void OfflineRenderer::prepare(const uint& sampling_rate) {
+  /*
+    Most plugins build their engines on the main thread after the first cycle with a new quantum or rate. We run a
+    few silent cycles and dispatch the pending callbacks so that the rendering starts with every engine in place.
+  */
+
+  for (uint n = 0U; n < warmup_cycles; n++) {
+    std::ranges::fill(left, 0.0F);
+    std::ranges::fill(right, 0.0F);
+
+    process_quantum(sampling_rate);
+
+    flush_main_context();
+  }
+}
+
+void OfflineRenderer::process_quantum(const uint& sampling_rate) {
+  for (const auto& plugin : plugins) {
+    std::span<float> l_in(left);
+    std::span<float> r_in(right);
+    std::span<float> l_out(left_out);
+    std::span<float> r_out(right_out);
+
+    plugin->begin_cycle(n_samples, sampling_rate);
+
+    if (plugin->enable_probe) {
+      std::span<float> l_probe(probe_left);
+      std::span<float> r_probe(probe_right);
+
+      plugin->process(l_in, r_in, l_out, r_out, l_probe, r_probe);
+    } else {
+      plugin->process(l_in, r_in, l_out, r_out);
+    }
+
+    plugin->end_cycle();
+
+    std::swap(left, left_out);
+    std::swap(right, right_out);
+  }
+}
+
+auto OfflineRenderer::get_latency_frames(const uint& sampling_rate) -> uint {
+  float latency = 0.0F;
+
+  for (const auto& plugin : plugins) {
+    latency += plugin->latency_value;
+  }
+
+  return static_cast<uint>(std::lround(latency * static_cast<float>(sampling_rate)));
+}
+
+auto OfflineRenderer::render(const std::filesystem::path& input_file, const std::filesystem::path& output_file)
+    -> bool {
+  // SndfileHandle might have issues with std::string, so we provide cstring
+  SndfileHandle input = SndfileHandle(input_file.c_str());
+
+  if (input.error() != 0 || input.frames() == 0) {
+    util::warning(log_tag + "could not read " + input_file.string() + ": " + input.strError());
+
+    return false;
+  }
+
+  const auto n_channels = static_cast<size_t>(input.channels());
+  const auto file_rate = static_cast<uint>(input.samplerate());
+  const auto n_frames = static_cast<size_t>(input.frames());
+
+  if (n_channels > 2U) {
+    util::warning(log_tag + input_file.string() + " has more than 2 channels. Only the first two are used");
+  }
+
+  std::vector<float> buffer(n_frames * n_channels);
+
+  input.readf(buffer.data(), static_cast<sf_count_t>(n_frames));
+
+  std::vector<float> in_l(n_frames);
+  std::vector<float> in_r(n_frames);
+
+  for (size_t n = 0U; n < n_frames; n++) {
+    in_l[n] = buffer[n * n_channels];
+    in_r[n] = buffer[(n * n_channels) + ((n_channels > 1U) ? 1U : 0U)];
+  }
+
+  const auto sampling_rate = (rate == 0U) ? file_rate : rate;
+
+  if (sampling_rate != file_rate) {
+    util::debug(log_tag + "resampling the input from " + util::to_string(file_rate) + " Hz to " +
+                util::to_string(sampling_rate) + " Hz");
+
+    auto resampler = std::make_unique<Resampler>(static_cast<int>(file_rate), static_cast<int>(sampling_rate), 2U,
+                                                 resampler_block, Resampler::Quality::polyphase);
+
+    std::vector<float> resampled_l;
+    std::vector<float> resampled_r;
+    std::vector<float> out_l(resampler->get_max_output_frames());
+    std::vector<float> out_r(resampler->get_max_output_frames());
+
+    // the zeros at the end flush the resampler delay line
+
+    in_l.resize(n_frames + resampler->get_latency_frames() + 1U, 0.0F);
+    in_r.resize(n_frames + resampler->get_latency_frames() + 1U, 0.0F);
+
+    for (size_t offset = 0U; offset < in_l.size(); offset += resampler_block) {
+      const auto count = std::min(static_cast<size_t>(resampler_block), in_l.size() - offset);
+
+      const auto n_out = resampler->process(std::span<const float>(in_l).subspan(offset, count),
+                                            std::span<const float>(in_r).subspan(offset, count), out_l, out_r);
+
+      resampled_l.insert(resampled_l.end(), out_l.begin(), out_l.begin() + static_cast<long>(n_out));
+      resampled_r.insert(resampled_r.end(), out_r.begin(), out_r.begin() + static_cast<long>(n_out));
+    }
+
+    // removing the resampler delay so that the output stays aligned with the input
+
+    const auto delay = std::min(static_cast<size_t>(resampler->get_latency_frames()), resampled_l.size());
+
+    in_l.assign(resampled_l.begin() + static_cast<long>(delay), resampled_l.end());
+    in_r.assign(resampled_r.begin() + static_cast<long>(delay), resampled_r.end());
+
+    const auto expected = static_cast<size_t>(std::llround(static_cast<double>(n_frames) * sampling_rate / file_rate));
+
+    in_l.resize(expected, 0.0F);
+    in_r.resize(expected, 0.0F);
+  }
+
+  const auto total_frames = in_l.size();
+
+  prepare(sampling_rate);
+
+  const auto latency = compensate_latency ? get_latency_frames(sampling_rate) : 0U;
+
+  util::debug(log_tag + "rendering " + util::to_string(total_frames) + " frames at " +
+              util::to_string(sampling_rate) + " Hz with quantum " + util::to_string(n_samples) +
+              ". Pipeline latency: " + util::to_string(latency) + " frames");
+
+  std::vector<float> output;
+
+  output.reserve(total_frames * 2U);
+
+  size_t skipped = 0U;
+
+  for (size_t offset = 0U; output.size() < total_frames * 2U; offset += n_samples) {
+    for (size_t n = 0U; n < n_samples; n++) {
+      const auto idx = offset + n;
+
+      left[n] = (idx < total_frames) ? in_l[idx] : 0.0F;
+      right[n] = (idx < total_frames) ? in_r[idx] : 0.0F;
+    }
+
+    process_quantum(sampling_rate);
+
+    // parameter changes and engine updates are published through the main loop, just like in the realtime path
+
+    flush_main_context();
+
+    for (size_t n = 0U; n < n_samples && output.size() < total_frames * 2U; n++) {
+      if (skipped < latency) {
+        skipped++;
+
+        continue;
+      }
+
+      output.push_back(left[n]);
+      output.push_back(right[n]);
+    }
+  }
+
+  auto format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+
+  if (output_file.extension() == ".flac") {
+    format = SF_FORMAT_FLAC | SF_FORMAT_PCM_24;
+  }
+
+  SndfileHandle out = SndfileHandle(output_file.c_str(), SFM_WRITE, format, 2, static_cast<int>(sampling_rate));
+
+  if (out.error() != 0) {
+    util::warning(log_tag + "could not create " + output_file.string() + ": " + out.strError());
+
+    return false;
+  }
+
+  out.command(SFC_SET_CLIPPING, nullptr, SF_TRUE);
+
+  out.writef(output.data(), static_cast<sf_count_t>(output.size() / 2U));
+
+  util::debug(log_tag + "saved " + output_file.string());
+
+  return true;
+}
+
+auto OfflineRenderer::compare(const std::filesystem::path& rendered_file,
+                              const std::filesystem::path& reference_file,
+                              const double& tolerance_db) -> bool {
+  SndfileHandle rendered = SndfileHandle(rendered_file.c_str());
+  SndfileHandle reference = SndfileHandle(reference_file.c_str());
+
+  if (rendered.error() != 0 || reference.error() != 0) {
+    util::warning(log_tag + "could not read " + rendered_file.string() + " or " + reference_file.string());
+
+    return false;
+  }
+
+  if (rendered.samplerate() != reference.samplerate() || rendered.channels() != reference.channels() ||
+      rendered.frames() != reference.frames()) {
+    util::warning(log_tag + rendered_file.string() + " and " + reference_file.string() +
+                  " differ in rate, channels or length");
+
+    return false;
+  }
+
+  const auto n_samples_total = static_cast<size_t>(rendered.frames()) * static_cast<size_t>(rendered.channels());
+
+  std::vector<float> a(n_samples_total);
+  std::vector<float> b(n_samples_total);
+
+  rendered.readf(a.data(), rendered.frames());
+  reference.readf(b.data(), reference.frames());
+
+  float max_difference = 0.0F;
+
+  for (size_t n = 0U; n < n_samples_total; n++) {
+    max_difference = std::max(max_difference, std::fabs(a[n] - b[n]));
+  }
+
+  const auto tolerance = util::db_to_linear(tolerance_db);
+
+  util::debug(log_tag + "largest difference from the reference: " + util::to_string(max_difference));
+
+  if (max_difference > tolerance) {
+    util::warning(log_tag + rendered_file.string() + " differs from " + reference_file.string() + " by " +
+                  util::to_string(max_difference) + ", more than the tolerance of " + util::to_string(tolerance));
+
+    return false;
+  }
+
+  return true;
+}
+
+auto OfflineRenderer::benchmark(const std::vector<uint>& quanta, const std::vector<uint>& rates, const double& seconds)
+    -> std::vector<BenchmarkResult> {
+  using namespace std::string_literals;
+
+  auto candidates = plugins;
+
+  if (candidates.empty()) {
+    for (const auto& base_name : tags::plugin_name::list) {
+      if (auto plugin = EffectsBase::create_plugin(base_name + "#0"s, log_tag, schema_base_path, nullptr, pipeline_type);
+          plugin != nullptr) {
+        candidates.push_back(plugin);
+      }
+    }
+
+    candidates.push_back(std::make_shared<Spectrum>(log_tag, tags::schema::spectrum::id,
+                                                    tags::app::path + "/spectrum/"s, nullptr, pipeline_type));
+  }
+
+  const auto chain = std::exchange(plugins, {});
+  const auto chain_quantum = n_samples;
+
+  std::vector<BenchmarkResult> results;
+
+  std::vector<float> noise;
+
+  for (const auto& plugin : candidates) {
+    // Level notifications are part of the realtime cost
+    plugin->set_post_messages(true);
+
+    plugins = {plugin};
+
+    for (const auto& sampling_rate : rates) {
+      for (const auto& quantum : quanta) {
+        set_quantum(quantum);
+
+        prepare(sampling_rate);
+
+        std::mt19937 generator(0U);
+        std::uniform_real_distribution<float> distribution(-0.5F, 0.5F);
+
+        noise.resize(2U * n_samples);
+
+        std::ranges::generate(noise, [&] { return distribution(generator); });
+
+        const auto n_cycles = std::max(1L, std::lround(seconds * sampling_rate / n_samples));
+
+        double total_ns = 0.0;
+        double worst_ns = 0.0;
+
+        for (long n = 0; n < n_cycles; n++) {
+          std::copy(noise.begin(), noise.begin() + n_samples, left.begin());
+          std::copy(noise.begin() + n_samples, noise.end(), right.begin());
+
+          const auto t0 = std::chrono::steady_clock::now();
+
+          process_quantum(sampling_rate);
+
+          const auto dt = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+
+          total_ns += dt;
+          worst_ns = std::max(worst_ns, dt);
+
+          flush_main_context();
+        }
+
+        const auto quantum_ns = 1e9 * static_cast<double>(n_samples) / sampling_rate;
+
+        results.push_back({.plugin = plugin->name,
+                           .quantum = n_samples,
+                           .rate = sampling_rate,
+                           .ns_per_sample = total_ns / (static_cast<double>(n_cycles) * n_samples),
+                           .worst_quantum_us = 0.001 * worst_ns,
+                           .worst_load = worst_ns / quantum_ns});
+      }
+    }
+
+    plugin->set_post_messages(false);
+  }
+
+  plugins = chain;
+
+  set_quantum(chain_quantum);
+
+  return results;
+}
@@ -41,7 +41,7 @@ OutputLevel::~OutputLevel() {
   util::debug(log_tag + name + " destroyed");
 }
 
-void OutputLevel::setup() {
+void OutputLevel::setup_engine(const uint& n_samples, const uint& rate) {
   util::debug(log_tag + name + ": PipeWire blocksize: " + util::to_string(n_samples, ""));
   util::debug(log_tag + name + ": PipeWire sampling rate: " + util::to_string(rate, ""));
 }
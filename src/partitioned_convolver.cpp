@@ -0,0 +1,322 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "partitioned_convolver.hpp"
+#include <fftw3.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include "fft_plans.hpp"
+#include "worker_pool.hpp"
+
+PartitionedConvolver::~PartitionedConvolver() {
+  free_stages();
+}
+
+void PartitionedConvolver::free_stages() {
+  // the plans belong to the shared cache
+
+  for (auto& s : stages) {
+    s->release();
+
+    if (s->frame != nullptr) {
+      fftwf_free(s->frame);
+    }
+
+    if (s->spectrum != nullptr) {
+      fftwf_free(s->spectrum);
+    }
+  }
+
+  stages.clear();
+}
+
+void PartitionedConvolver::set_kernel(std::span<const float> kernel, const uint& sampling_rate) {
+  free_stages();
+
+  kernel_size = kernel.size();
+  rate = sampling_rate;
+
+  head.assign(head_size, 0.0F);
+
+  for (size_t k = 0U; k < head_size && k < kernel.size(); k++) {
+    head[head_size - 1U - k] = kernel[k];
+  }
+
+  head_buffer.assign((2U * head_size) - 1U, 0.0F);
+
+  /*
+    The stage with block size B covers the impulse response until the next stage begins at 2 * 4 * B. That gives 7
+    partitions to the first stage and 6 to the others. The last stage takes everything that is left.
+  */
+
+  size_t offset = head_size;
+  uint block_size = head_size;
+
+  while (offset < kernel.size()) {
+    auto& s = *stages.emplace_back(std::make_unique<Stage>());
+
+    const auto remaining = kernel.size() - offset;
+
+    const auto needed = static_cast<uint>((remaining + block_size - 1U) / block_size);
+
+    const auto next_offset = 8U * static_cast<size_t>(block_size);
+
+    s.block_size = block_size;
+    s.offset = static_cast<uint>(offset);
+    s.n_partitions =
+        (block_size < max_block_size) ? std::min(static_cast<uint>((next_offset - offset) / block_size), needed) : needed;
+    s.n_bins = block_size + 1U;
+    s.async = block_size >= min_async_block_size;
+
+    s.frame = fftwf_alloc_real(2U * block_size);
+    s.spectrum = fftwf_alloc_complex(s.n_bins);
+
+    s.forward = fft_plans::r2c(2U * block_size, s.frame, s.spectrum);
+    s.backward = fft_plans::c2r(2U * block_size, s.spectrum, s.frame);
+
+    const auto size = static_cast<size_t>(s.n_partitions) * s.n_bins;
+
+    s.partitions_re.resize(size);
+    s.partitions_im.resize(size);
+    s.fdl_re.assign(size, 0.0F);
+    s.fdl_im.assign(size, 0.0F);
+    s.acc_re.resize(s.n_bins);
+    s.acc_im.resize(s.n_bins);
+
+    // fftw does not normalize. The inverse transform scale is folded into the partitions.
+
+    const auto scale = 1.0F / static_cast<float>(2U * block_size);
+
+    for (uint p = 0U; p < s.n_partitions; p++) {
+      std::fill(s.frame, s.frame + (2U * block_size), 0.0F);
+
+      const auto start = offset + (static_cast<size_t>(p) * block_size);
+
+      for (size_t n = 0U; n < block_size && start + n < kernel.size(); n++) {
+        s.frame[n] = scale * kernel[start + n];
+      }
+
+      fftwf_execute_dft_r2c(s.forward, s.frame, s.spectrum);
+
+      for (uint k = 0U; k < s.n_bins; k++) {
+        s.partitions_re[(p * s.n_bins) + k] = s.spectrum[k][0];
+        s.partitions_im[(p * s.n_bins) + k] = s.spectrum[k][1];
+      }
+    }
+
+    offset += static_cast<size_t>(s.n_partitions) * block_size;
+
+    block_size = std::min(4U * block_size, max_block_size);
+  }
+
+  // The largest stage reads 2 blocks of past input and writes up to its offset plus one block ahead
+
+  size_t input_size = 2U * head_size;
+  size_t output_size = 2U * head_size;
+
+  for (const auto& s : stages) {
+    input_size = std::max(input_size, 2U * static_cast<size_t>(s->block_size));
+    output_size = std::max(output_size, static_cast<size_t>(s->offset) + (2U * s->block_size));
+  }
+
+  input_ring.resize(std::bit_ceil(input_size));
+  output_ring.resize(std::bit_ceil(output_size));
+
+  input_mask = input_ring.size() - 1U;
+  output_mask = output_ring.size() - 1U;
+
+  reset();
+}
+
+void PartitionedConvolver::wait_pending() {
+  for (auto& s : stages) {
+    if (s->pending) {
+      s->wait();
+
+      s->pending = false;
+    }
+  }
+}
+
+void PartitionedConvolver::reset() {
+  wait_pending();
+
+  time = 0U;
+
+  std::ranges::fill(head_buffer, 0.0F);
+  std::ranges::fill(input_ring, 0.0F);
+  std::ranges::fill(output_ring, 0.0F);
+
+  for (auto& s : stages) {
+    s->fdl_index = 0U;
+
+    std::ranges::fill(s->fdl_re, 0.0F);
+    std::ranges::fill(s->fdl_im, 0.0F);
+  }
+}
+
+void PartitionedConvolver::process(std::span<float> data) {
+  if (kernel_size == 0U) {
+    return;
+  }
+
+  size_t offset = 0U;
+
+  while (offset < data.size()) {
+    // chunks never cross a head_size boundary, that is where the stages may run
+
+    const auto count = std::min(static_cast<size_t>(head_size - (time % head_size)), data.size() - offset);
+
+    auto chunk = data.subspan(offset, count);
+
+    std::ranges::copy(chunk, head_buffer.begin() + (head_size - 1U));
+
+    for (size_t n = 0U; n < count; n++) {
+      const auto t = time + n;
+
+      input_ring[t & input_mask] = chunk[n];
+
+      auto y = output_ring[t & output_mask];
+
+      output_ring[t & output_mask] = 0.0F;
+
+      const auto* x = head_buffer.data() + n;
+
+      for (uint k = 0U; k < head_size; k++) {
+        y += head[k] * x[k];
+      }
+
+      chunk[n] = y;
+    }
+
+    std::copy(head_buffer.begin() + static_cast<long>(count),
+              head_buffer.begin() + static_cast<long>(count + head_size - 1U), head_buffer.begin());
+
+    time += count;
+    offset += count;
+
+    if (time % head_size == 0U) {
+      // results due now are collected before the stage frames are reused
+
+      for (auto& s : stages) {
+        if (s->pending && s->output_start == time) {
+          collect_stage(*s);
+        }
+      }
+
+      for (auto& s : stages) {
+        if (time % s->block_size == 0U) {
+          start_stage(*s);
+        }
+      }
+    }
+  }
+}
+
+void PartitionedConvolver::start_stage(Stage& s) {
+  const auto block_size = static_cast<uint64_t>(s.block_size);
+
+  // overlap-save frame with the last 2 blocks of input. The unsigned wrap is harmless because the ring size is a
+  // power of 2.
+
+  const auto frame_start = time - (2U * block_size);
+
+  for (uint64_t n = 0U; n < 2U * block_size; n++) {
+    s.frame[n] = input_ring[(frame_start + n) & input_mask];
+  }
+
+  // the last block of the frame belongs to the frames [time - B, time) delayed by the stage offset
+
+  s.output_start = time - block_size + s.offset;
+
+  s.pending = true;
+
+  if (s.async && s.output_start > time && WorkerPool::get_n_threads() != 0U) {
+    const auto slack = std::chrono::nanoseconds((s.output_start - time) * 1000000000U / std::max(rate, 1U));
+
+    WorkerPool::submit(s, std::chrono::steady_clock::now() + slack);
+
+    return;
+  }
+
+  s.run();
+
+  collect_stage(s);
+}
+
+void PartitionedConvolver::collect_stage(Stage& s) {
+  s.wait();
+
+  const auto block_size = static_cast<uint64_t>(s.block_size);
+
+  for (uint64_t n = 0U; n < block_size; n++) {
+    output_ring[(s.output_start + n) & output_mask] += s.frame[block_size + n];
+  }
+
+  s.pending = false;
+}
+
+void PartitionedConvolver::Stage::run() {
+  fftwf_execute_dft_r2c(forward, frame, spectrum);
+
+  fdl_index = (fdl_index + 1U) % n_partitions;
+
+  auto* x_re = fdl_re.data() + (static_cast<size_t>(fdl_index) * n_bins);
+  auto* x_im = fdl_im.data() + (static_cast<size_t>(fdl_index) * n_bins);
+
+  for (uint k = 0U; k < n_bins; k++) {
+    x_re[k] = spectrum[k][0];
+    x_im[k] = spectrum[k][1];
+  }
+
+  // complex multiply-accumulate of the delay line with the partitions
+
+  std::ranges::fill(acc_re, 0.0F);
+  std::ranges::fill(acc_im, 0.0F);
+
+  auto* sum_re = acc_re.data();
+  auto* sum_im = acc_im.data();
+
+  for (uint p = 0U; p < n_partitions; p++) {
+    const auto slot = static_cast<size_t>((fdl_index + n_partitions - p) % n_partitions) * n_bins;
+
+    const auto* a_re = fdl_re.data() + slot;
+    const auto* a_im = fdl_im.data() + slot;
+    const auto* b_re = partitions_re.data() + (static_cast<size_t>(p) * n_bins);
+    const auto* b_im = partitions_im.data() + (static_cast<size_t>(p) * n_bins);
+
+    for (uint k = 0U; k < n_bins; k++) {
+      sum_re[k] += (a_re[k] * b_re[k]) - (a_im[k] * b_im[k]);
+      sum_im[k] += (a_re[k] * b_im[k]) + (a_im[k] * b_re[k]);
+    }
+  }
+
+  for (uint k = 0U; k < n_bins; k++) {
+    spectrum[k][0] = sum_re[k];
+    spectrum[k][1] = sum_im[k];
+  }
+
+  fftwf_execute_dft_c2r(backward, spectrum, frame);
+}
@@ -18,6 +18,7 @@
  */
 
 #include "pipe_manager.hpp"
+#include <gio/gio.h>
 #include <glib.h>
 #include <pipewire/client.h>
 #include <pipewire/context.h>
@@ -58,17 +59,23 @@
 #include <array>
 #include <cerrno>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
 #include <ctime>
+#include <functional>
+#include <mutex>
 #include <span>
+#include <sstream>
 #include <stdexcept>
 #include <string>
-#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "pipe_objects.hpp"
 #include "tags_app.hpp"
 #include "tags_pipewire.hpp"
+#include "tags_schema.hpp"
 #include "util.hpp"
 
 namespace {
@@ -96,6 +103,8 @@ struct proxy_data {
 
   uint id = SPA_ID_INVALID;
 
+  uint node_id = SPA_ID_INVALID;  // only set for ports
+
   uint64_t serial = SPA_ID_INVALID;
 };
 
@@ -176,7 +185,13 @@ auto port_info_from_props(const spa_dict* props) -> PortInfo {
 
   spa_dict_get_num(props, PW_KEY_NODE_ID, info.node_id);
 
-  spa_dict_get_string(props, PW_KEY_PORT_DIRECTION, info.direction);
+  if (std::string direction; spa_dict_get_string(props, PW_KEY_PORT_DIRECTION, direction)) {
+    if (direction == "in") {
+      info.direction = PortDirection::input;
+    } else if (direction == "out") {
+      info.direction = PortDirection::output;
+    }
+  }
 
   spa_dict_get_string(props, PW_KEY_AUDIO_CHANNEL, info.audio_channel);
 
@@ -216,6 +231,8 @@ void on_destroy_node_proxy(void* data) {
 
   spa_hook_remove(&nd->proxy_listener);
 
+  pm->unindex_node(node_it->second);
+
   pm->node_map.erase(node_it);
 
   if (!PipeManager::exiting) {
@@ -371,6 +388,8 @@ void on_node_info(void* object, const struct pw_node_info* info) {
 
     spa_hook_remove(&nd->proxy_listener);
 
+    pm->unindex_node(node_it->second);
+
     pm->node_map.erase(node_it);
 
     if (nd->nd_info->media_class == tags::pipewire::media_class::source) {
@@ -427,76 +446,43 @@ void on_node_info(void* object, const struct pw_node_info* info) {
 
   // Chech for node info updates
 
-  auto app_info_ui_changed = false;
-
-  if (info->state != nd->nd_info->state) {
-    nd->nd_info->state = info->state;
-
-    app_info_ui_changed = true;
-  }
-
-  nd->nd_info->n_input_ports = static_cast<int>(info->n_input_ports);
-  nd->nd_info->n_output_ports = static_cast<int>(info->n_output_ports);
-
-  spa_dict_get_num(info->props, PW_KEY_PRIORITY_SESSION, nd->nd_info->priority);
-
-  if (const auto* app_id = spa_dict_lookup(info->props, PW_KEY_APP_ID)) {
-    if (app_id != nd->nd_info->application_id) {
-      nd->nd_info->application_id = app_id;
-    }
-  }
-
-  // spa_dict_get_string(props, PW_KEY_APP_PROCESS_BINARY, app_process_binary);
-
-  if (const auto* app_name = spa_dict_lookup(info->props, PW_KEY_APP_NAME)) {
-    if (app_name != nd->nd_info->app_name) {
-      nd->nd_info->app_name = app_name;
-
-      app_info_ui_changed = true;
-    }
-  }
+  uint changes = 0U;
 
-  if (const auto* app_process_id = spa_dict_lookup(info->props, PW_KEY_APP_PROCESS_ID)) {
-    if (app_process_id != nd->nd_info->app_process_id) {
-      nd->nd_info->app_process_id = app_process_id;
+  const auto update = [&](auto& field, const auto& value, const uint& mask) {
+    if (field != value) {
+      field = value;
 
-      app_info_ui_changed = true;
+      changes |= mask;
     }
-  }
-
-  if (const auto* app_process_binary = spa_dict_lookup(info->props, PW_KEY_APP_PROCESS_BINARY)) {
-    if (app_process_binary != nd->nd_info->app_process_binary) {
-      nd->nd_info->app_process_binary = app_process_binary;
+  };
 
-      app_info_ui_changed = true;
+  const auto update_string = [&](std::string& field, const char* key, const uint& mask) {
+    if (const auto* value = spa_dict_lookup(info->props, key)) {
+      update(field, std::string(value), mask);
     }
-  }
+  };
 
-  if (const auto* app_icon_name = spa_dict_lookup(info->props, PW_KEY_APP_ICON_NAME)) {
-    if (app_icon_name != nd->nd_info->app_icon_name) {
-      nd->nd_info->app_icon_name = app_icon_name;
-
-      app_info_ui_changed = true;
-    }
-  }
+  update(nd->nd_info->state, info->state, node_change::state);
 
-  if (const auto* media_icon_name = spa_dict_lookup(info->props, PW_KEY_MEDIA_ICON_NAME)) {
-    if (media_icon_name != nd->nd_info->media_icon_name) {
-      nd->nd_info->media_icon_name = media_icon_name;
+  update(nd->nd_info->n_input_ports, static_cast<int>(info->n_input_ports), node_change::properties);
+  update(nd->nd_info->n_output_ports, static_cast<int>(info->n_output_ports), node_change::properties);
 
-      app_info_ui_changed = true;
-    }
+  if (auto priority = nd->nd_info->priority; spa_dict_get_num(info->props, PW_KEY_PRIORITY_SESSION, priority)) {
+    update(nd->nd_info->priority, priority, node_change::properties);
   }
 
-  spa_dict_get_string(info->props, PW_KEY_DEVICE_ICON_NAME, nd->nd_info->device_icon_name);
+  update_string(nd->nd_info->application_id, PW_KEY_APP_ID, node_change::properties);
 
-  if (const auto* media_name = spa_dict_lookup(info->props, PW_KEY_MEDIA_NAME)) {
-    if (media_name != nd->nd_info->media_name) {
-      nd->nd_info->media_name = media_name;
+  // spa_dict_get_string(props, PW_KEY_APP_PROCESS_BINARY, app_process_binary);
 
-      app_info_ui_changed = true;
-    }
-  }
+  update_string(nd->nd_info->app_name, PW_KEY_APP_NAME, node_change::app_info);
+  update_string(nd->nd_info->app_process_id, PW_KEY_APP_PROCESS_ID, node_change::app_info);
+  update_string(nd->nd_info->app_process_binary, PW_KEY_APP_PROCESS_BINARY, node_change::app_info);
+  update_string(nd->nd_info->app_icon_name, PW_KEY_APP_ICON_NAME, node_change::app_info);
+  update_string(nd->nd_info->media_icon_name, PW_KEY_MEDIA_ICON_NAME, node_change::app_info);
+  update_string(nd->nd_info->device_icon_name, PW_KEY_DEVICE_ICON_NAME, node_change::properties);
+  update_string(nd->nd_info->audio_position, SPA_KEY_AUDIO_POSITION, node_change::properties);
+  update_string(nd->nd_info->media_name, PW_KEY_MEDIA_NAME, node_change::app_info);
 
   if (const auto* node_latency = spa_dict_lookup(info->props, PW_KEY_NODE_LATENCY)) {
     const auto str = std::string(node_latency);
@@ -506,25 +492,19 @@ void on_node_info(void* object, const struct pw_node_info* info) {
     int rate = 1;
 
     if (util::str_to_num(str.substr(delimiter_pos + 1U), rate)) {
-      if (rate != nd->nd_info->rate) {
-        nd->nd_info->rate = rate;
-
-        app_info_ui_changed = true;
-      }
+      update(nd->nd_info->rate, rate, node_change::format);
     }
 
     float pw_lat = 0.0F;
 
     if (util::str_to_num(str.substr(0U, delimiter_pos), pw_lat)) {
-      if (auto latency = (pw_lat / static_cast<float>(nd->nd_info->rate)); latency != nd->nd_info->latency) {
-        nd->nd_info->latency = latency;
-
-        app_info_ui_changed = true;
-      }
+      update(nd->nd_info->latency, pw_lat / static_cast<float>(nd->nd_info->rate), node_change::format);
     }
   }
 
-  spa_dict_get_num(info->props, PW_KEY_DEVICE_ID, nd->nd_info->device_id);
+  if (auto device_id = nd->nd_info->device_id; spa_dict_get_num(info->props, PW_KEY_DEVICE_ID, device_id)) {
+    update(nd->nd_info->device_id, device_id, node_change::properties);
+  }
 
   if ((info->change_mask & PW_NODE_CHANGE_MASK_PARAMS) != 0U) {
     auto params = std::span(info->params, info->n_params);
@@ -540,62 +520,14 @@ void on_node_info(void* object, const struct pw_node_info* info) {
     }
   }
 
+  update(nd->nd_info->connected, pm->stream_is_connected(info->id, nd->nd_info->media_class), node_change::connected);
+
   // update NodeInfo inside map
 
   node_it->second = *nd->nd_info;
 
-  // sometimes PipeWire destroys the pointer before signal_idle is called,
-  // therefore we make a copy
-
-  if (nd->nd_info->connected != pm->stream_is_connected(info->id, nd->nd_info->media_class)) {
-    nd->nd_info->connected = !nd->nd_info->connected;
-
-    app_info_ui_changed = true;
-  }
-
-  if (app_info_ui_changed) {
-    const auto nd_info_copy = *nd->nd_info;
-
-    if (nd->nd_info->media_class == tags::pipewire::media_class::output_stream) {
-      util::idle_add([=]() {
-        if (PipeManager::exiting) {
-          return;
-        }
-
-        pm->stream_output_changed.emit(nd_info_copy);
-      });
-    } else if (nd->nd_info->media_class == tags::pipewire::media_class::input_stream) {
-      util::idle_add([=]() {
-        if (PipeManager::exiting) {
-          return;
-        }
-
-        pm->stream_input_changed.emit(nd_info_copy);
-      });
-    }
-  }
-
-  if (nd->nd_info->media_class == tags::pipewire::media_class::source) {
-    const auto nd_info_copy = *nd->nd_info;
-
-    util::idle_add([=]() {
-      if (PipeManager::exiting) {
-        return;
-      }
-
-      pm->source_changed.emit(nd_info_copy);
-    });
-  } else if (nd->nd_info->media_class == tags::pipewire::media_class::sink) {
-    const auto nd_info_copy = *nd->nd_info;
-
-    util::idle_add([=]() {
-      if (PipeManager::exiting) {
-        return;
-      }
+  pm->mark_node_changed(nd->nd_info->serial, changes);
 
-      pm->sink_changed.emit(nd_info_copy);
-    });
-  }
   // const struct spa_dict_item* item = nullptr;
   // spa_dict_for_each(item, info->props) printf("\t\t%s: \"%s\"\n", item->key, item->value);
 }
@@ -623,7 +555,7 @@ void on_node_event_param(void* object,
 
   const auto serial = nd->nd_info->serial;
 
-  auto notify = false;
+  uint changes = 0U;
 
   SPA_POD_OBJECT_FOREACH(obj, pod_prop) {
     switch (pod_prop->key) {
@@ -657,7 +589,7 @@ void on_node_event_param(void* object,
 
           nd->nd_info->format = format_str;
 
-          notify = true;
+          changes |= node_change::format;
         }
 
         break;
@@ -678,7 +610,7 @@ void on_node_event_param(void* object,
 
           nd->nd_info->rate = rate;
 
-          notify = true;
+          changes |= node_change::format;
         }
 
         break;
@@ -699,7 +631,7 @@ void on_node_event_param(void* object,
 
           nd->nd_info->mute = v;
 
-          notify = true;
+          changes |= node_change::mute;
         }
         break;
       }
@@ -728,7 +660,7 @@ void on_node_event_param(void* object,
           nd->nd_info->n_volume_channels = n_volumes;
           nd->nd_info->volume = max;
 
-          notify = true;
+          changes |= node_change::volume;
         }
 
         break;
@@ -738,59 +670,14 @@ void on_node_event_param(void* object,
     }
   }
 
-  if (notify) {
-    // sometimes PipeWire destroys the pointer before signal_idle is called,
-    // therefore we make a copy
-
-    if (nd->nd_info->media_class == tags::pipewire::media_class::output_stream) {
-      const auto nd_info_copy = *nd->nd_info;
-
-      util::idle_add([pm, nd_info_copy] {
-        if (PipeManager::exiting) {
-          return;
-        }
-
-        pm->stream_output_changed.emit(nd_info_copy);
-      });
-    } else if (nd->nd_info->media_class == tags::pipewire::media_class::input_stream) {
-      const auto nd_info_copy = *nd->nd_info;
-
-      util::idle_add([pm, nd_info_copy] {
-        if (PipeManager::exiting) {
-          return;
-        }
-
-        pm->stream_input_changed.emit(nd_info_copy);
-      });
-    } else if (nd->nd_info->media_class == tags::pipewire::media_class::virtual_source) {
-      const auto nd_info_copy = *nd->nd_info;
-
-      if (nd_info_copy.serial == pm->ee_source_node.serial) {
-        pm->ee_source_node = nd_info_copy;
-      }
-
-      util::idle_add([pm, nd_info_copy] {
-        if (PipeManager::exiting) {
-          return;
-        }
-
-        pm->source_changed.emit(nd_info_copy);
-      });
-    } else if (nd->nd_info->media_class == tags::pipewire::media_class::sink) {
-      const auto nd_info_copy = *nd->nd_info;
-
-      if (nd_info_copy.serial == pm->ee_sink_node.serial) {
-        pm->ee_sink_node = nd_info_copy;
-      }
-
-      util::idle_add([pm, nd_info_copy] {
-        if (PipeManager::exiting) {
-          return;
-        }
-
-        pm->sink_changed.emit(nd_info_copy);
-      });
+  if (changes != 0U) {
+    if (nd->nd_info->serial == pm->ee_source_node.serial) {
+      pm->ee_source_node = *nd->nd_info;
+    } else if (nd->nd_info->serial == pm->ee_sink_node.serial) {
+      pm->ee_sink_node = *nd->nd_info;
     }
+
+    pm->mark_node_changed(serial, changes);
   }
 }
 
@@ -798,26 +685,22 @@ void on_link_info(void* object, const struct pw_link_info* info) {
   auto* const ld = static_cast<proxy_data*>(object);
   auto* const pm = ld->pm;
 
-  LinkInfo link_copy;
+  if (auto it = pm->link_map.find(ld->id); it != pm->link_map.end()) {
+    auto& l = it->second;
 
-  for (auto& l : ld->pm->list_links) {
-    if (l.serial == ld->serial) {
-      l.state = info->state;
+    l.state = info->state;
 
-      link_copy = l;
-
-      util::idle_add([pm, link_copy] {
-        if (PipeManager::exiting) {
-          return;
-        }
+    const auto link_copy = l;
 
-        pm->link_changed.emit(link_copy);
-      });
+    util::idle_add([pm, link_copy] {
+      if (PipeManager::exiting) {
+        return;
+      }
 
-      // util::warning(pw_link_state_as_string(l.state));
+      pm->link_changed.emit(link_copy);
+    });
 
-      break;
-    }
+    // util::warning(pw_link_state_as_string(l.state));
   }
 
   // const struct spa_dict_item* item = nullptr;
@@ -829,9 +712,7 @@ void on_destroy_link_proxy(void* data) {
 
   spa_hook_remove(&ld->proxy_listener);
 
-  ld->pm->list_links.erase(std::remove_if(ld->pm->list_links.begin(), ld->pm->list_links.end(),
-                                          [=](const auto& n) { return n.serial == ld->serial; }),
-                           ld->pm->list_links.end());
+  ld->pm->unindex_link(ld->id);
 }
 
 void on_destroy_port_proxy(void* data) {
@@ -839,9 +720,15 @@ void on_destroy_port_proxy(void* data) {
 
   spa_hook_remove(&pd->proxy_listener);
 
-  pd->pm->list_ports.erase(std::remove_if(pd->pm->list_ports.begin(), pd->pm->list_ports.end(),
-                                          [=](const auto& n) { return n.serial == pd->serial; }),
-                           pd->pm->list_ports.end());
+  if (auto it = pd->pm->node_ports.find(pd->node_id); it != pd->pm->node_ports.end()) {
+    std::erase_if(it->second, [=](const auto& n) { return n.serial == pd->serial; });
+
+    if (it->second.empty()) {
+      pd->pm->node_ports.erase(it);
+    }
+  }
+
+  pd->pm->notify_graph_changed();
 }
 
 void on_module_info(void* object, const struct pw_module_info* info) {
@@ -1253,9 +1140,13 @@ void on_registry_global(void* data,
       return;
     }
 
+    pm->index_node(node_it->second);
+
     pw_proxy_add_object_listener(proxy, &nd->object_listener, &node_events, nd);
     pw_proxy_add_listener(proxy, &nd->proxy_listener, &node_proxy_events, nd);
 
+    pm->notify_graph_changed();
+
     // sometimes PipeWire destroys the pointer before signal_idle is called,
     // therefore we make a copy of NodeInfo
 
@@ -1331,7 +1222,7 @@ void on_registry_global(void* data,
     link_info.id = id;
     link_info.serial = serial;
 
-    pm->list_links.push_back(link_info);
+    pm->index_link(link_info);
 
     try {
       const auto input_node = pm->node_map_at_id(link_info.input_node_id);
@@ -1365,17 +1256,22 @@ void on_registry_global(void* data,
     pd->id = id;
     pd->serial = serial;
 
-    pw_proxy_add_listener(proxy, &pd->proxy_listener, &port_proxy_events, pd);
-
     auto port_info = port_info_from_props(props);
 
     port_info.id = id;
     port_info.serial = serial;
+    port_info.channel_id = pm->intern_channel(port_info.audio_channel);
+
+    pd->node_id = port_info.node_id;
+
+    pw_proxy_add_listener(proxy, &pd->proxy_listener, &port_proxy_events, pd);
 
     // std::cout << port_info.name << "\t" << port_info.audio_channel << "\t" << port_info.direction << "\t"
     //           << port_info.format_dsp << "\t" << port_info.port_id << "\t" << port_info.node_id << std::endl;
 
-    pm->list_ports.push_back(port_info);
+    pm->node_ports[port_info.node_id].push_back(port_info);
+
+    pm->notify_graph_changed();
 
     return;
   }
@@ -1613,6 +1509,27 @@ PipeManager::PipeManager() : header_version(pw_get_headers_version()), library_v
 
   pw_core_add_listener(core, &core_listener, &core_events, this);
 
+  // choosing the channel layout of our sink
+
+  auto* app_settings = g_settings_new(tags::app::id);
+
+  if (g_settings_get_boolean(app_settings, "surround-output") != 0) {
+    // two roundtrips so that the registry globals and then their info and metadata events arrive
+
+    sync_wait_unlock();
+    lock();
+    sync_wait_unlock();
+    lock();
+
+    if (auto channels = select_output_channels(); !channels.empty()) {
+      output_channels = std::move(channels);
+    }
+
+    util::debug("processing " + util::to_string(output_channels.size()) + " output channels");
+  }
+
+  g_object_unref(app_settings);
+
   // loading Easy Effects sink
 
   pw_properties* props_sink = pw_properties_new(nullptr, nullptr);
@@ -1624,7 +1541,13 @@ PipeManager::PipeManager() : header_version(pw_get_headers_version()), library_v
   pw_properties_set(props_sink, PW_KEY_NODE_PASSIVE, "out");
   pw_properties_set(props_sink, "factory.name", "support.null-audio-sink");
   pw_properties_set(props_sink, PW_KEY_MEDIA_CLASS, tags::pipewire::media_class::sink);
-  pw_properties_set(props_sink, "audio.position", "FL,FR");
+  std::string sink_position;
+
+  for (const auto& channel : output_channels) {
+    sink_position += (sink_position.empty() ? "" : ",") + channel;
+  }
+
+  pw_properties_set(props_sink, "audio.position", sink_position.c_str());
   pw_properties_set(props_sink, "monitor.channel-volumes", "false");
   pw_properties_set(props_sink, "monitor.passthrough", "true");
   pw_properties_set(props_sink, "priority.session", "0");
@@ -1658,9 +1581,9 @@ PipeManager::PipeManager() : header_version(pw_get_headers_version()), library_v
 
   using namespace std::string_literals;
 
-  do {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  // our virtual devices are ready once the registry has announced their nodes
 
+  const auto found_virtual_devices = [&]() {
     for (const auto& [serial, node] : node_map) {
       if (ee_sink_node.name.empty() && node.name == tags::pipewire::ee_sink_name) {
         ee_sink_node = node;
@@ -1674,7 +1597,84 @@ PipeManager::PipeManager() : header_version(pw_get_headers_version()), library_v
                     util::to_string(node.id) + " and serial " + util::to_string(node.serial));
       }
     }
-  } while (ee_sink_node.id == SPA_ID_INVALID || ee_source_node.id == SPA_ID_INVALID);
+
+    return ee_sink_node.id != SPA_ID_INVALID && ee_source_node.id != SPA_ID_INVALID;
+  };
+
+  while (!wait_for(found_virtual_devices, connection_timeout)) {
+    util::warning("the Easy Effects virtual devices are taking too long to appear in the graph");
+  }
+}
+
+auto PipeManager::select_output_channels() const -> std::vector<std::string> {
+  const std::vector<std::string> stereo = {"FL", "FR"};
+
+  auto* app_settings = g_settings_new(tags::app::id);
+
+  const auto surround = g_settings_get_boolean(app_settings, "surround-output") != 0;
+
+  g_object_unref(app_settings);
+
+  if (!surround) {
+    return stereo;
+  }
+
+  auto* soe_settings = g_settings_new(tags::schema::id_output);
+
+  const auto device_name = (g_settings_get_boolean(soe_settings, "use-default-output-device") != 0)
+                               ? default_output_device_name
+                               : util::gsettings_get_string(soe_settings, "output-device");
+
+  g_object_unref(soe_settings);
+
+  auto found = false;
+
+  std::string position;
+
+  for (const auto& [serial, node] : node_map) {
+    if (node.name == device_name && node.media_class == tags::pipewire::media_class::sink) {
+      found = true;
+
+      position = node.audio_position;
+
+      break;
+    }
+  }
+
+  if (!found) {
+    return {};
+  }
+
+  std::vector<std::string> channels;
+
+  auto has_fl = false, has_fr = false;
+
+  std::istringstream stream(position);
+
+  for (std::string channel; std::getline(stream, channel, ',');) {
+    std::erase(channel, ' ');
+
+    has_fl = has_fl || channel == "FL";
+    has_fr = has_fr || channel == "FR";
+
+    if (!channel.empty() && channel != "FL" && channel != "FR") {
+      channels.push_back(channel);
+    }
+  }
+
+  // our plugins expect the front pair in the first two ports
+
+  if (channels.empty() || !has_fl || !has_fr) {
+    util::debug("the output device " + device_name + " has no surround layout. Using stereo processing");
+
+    return stereo;
+  }
+
+  channels.insert(channels.begin(), {"FL", "FR"});
+
+  util::debug("the output device " + device_name + " has the surround layout " + position);
+
+  return channels;
 }
 
 PipeManager::~PipeManager() {
@@ -1714,24 +1714,115 @@ PipeManager::~PipeManager() {
 auto PipeManager::node_map_at_id(const uint& id) -> NodeInfo& {
   // Helper method to access easily a node by id, same functionality as map.at()
 
-  for (auto& [serial, node] : node_map) {
-    if (node.id == id) {
-      return node;
+  if (const auto it = node_serial_by_id.find(id); it != node_serial_by_id.end()) {
+    if (const auto node_it = node_map.find(it->second); node_it != node_map.end()) {
+      return node_it->second;
     }
   }
 
   throw std::out_of_range("No node with id " + util::to_string(id) + " in our node_map");
 }
 
+auto PipeManager::find_node_by_name(const std::string& name) -> NodeInfo* {
+  NodeInfo* node = nullptr;
+
+  const auto [first, last] = node_serials_by_name.equal_range(name);
+
+  for (auto it = first; it != last; ++it) {
+    if (auto node_it = node_map.find(it->second);
+        node_it != node_map.end() && (node == nullptr || node_it->second.serial < node->serial)) {
+      node = &node_it->second;
+    }
+  }
+
+  return node;
+}
+
+auto PipeManager::get_node_ports(const uint& node_id) const -> const std::vector<PortInfo>& {
+  const auto it = node_ports.find(node_id);
+
+  return (it != node_ports.end()) ? it->second : no_ports;
+}
+
+auto PipeManager::get_node_link_ids(const uint& node_id) const -> const std::vector<uint>& {
+  const auto it = node_links.find(node_id);
+
+  return (it != node_links.end()) ? it->second : no_links;
+}
+
+void PipeManager::index_node(const NodeInfo& node) {
+  node_serial_by_id[node.id] = node.serial;
+
+  node_serials_by_name.emplace(node.name, node.serial);
+}
+
+void PipeManager::unindex_node(const NodeInfo& node) {
+  // PipeWire reuses ids. The index may already point to a newer node.
+
+  if (const auto it = node_serial_by_id.find(node.id); it != node_serial_by_id.end() && it->second == node.serial) {
+    node_serial_by_id.erase(it);
+  }
+
+  const auto [first, last] = node_serials_by_name.equal_range(node.name);
+
+  for (auto it = first; it != last; ++it) {
+    if (it->second == node.serial) {
+      node_serials_by_name.erase(it);
+
+      break;
+    }
+  }
+}
+
+void PipeManager::index_link(const LinkInfo& link) {
+  link_map[link.id] = link;
+
+  node_links[link.output_node_id].push_back(link.id);
+
+  if (link.input_node_id != link.output_node_id) {
+    node_links[link.input_node_id].push_back(link.id);
+  }
+}
+
+void PipeManager::unindex_link(const uint& link_id) {
+  const auto it = link_map.find(link_id);
+
+  if (it == link_map.end()) {
+    return;
+  }
+
+  for (const auto& node_id : {it->second.output_node_id, it->second.input_node_id}) {
+    if (auto links_it = node_links.find(node_id); links_it != node_links.end()) {
+      std::erase(links_it->second, link_id);
+
+      if (links_it->second.empty()) {
+        node_links.erase(links_it);
+      }
+    }
+  }
+
+  link_map.erase(it);
+}
+
+auto PipeManager::intern_channel(const std::string& name) -> uint {
+  const auto [it, inserted] = channel_ids.try_emplace(name, next_channel_id);
+
+  if (inserted) {
+    next_channel_id++;
+  }
+
+  return it->second;
+}
+
 auto PipeManager::stream_is_connected(const uint& id, const std::string& media_class) -> bool {
-  if (media_class == tags::pipewire::media_class::output_stream) {
-    for (const auto& link : list_links) {
+  for (const auto& link_id : get_node_link_ids(id)) {
+    const auto& link = link_map.at(link_id);
+
+    if (media_class == tags::pipewire::media_class::output_stream) {
       if (link.output_node_id == id && link.input_node_id == ee_sink_node.id) {
         return true;
       }
-    }
-  } else if (media_class == tags::pipewire::media_class::input_stream) {
-    for (const auto& link : list_links) {
+    } else if (media_class == tags::pipewire::media_class::input_stream) {
       if (link.output_node_id == ee_source_node.id && link.input_node_id == id) {
         return true;
       }
@@ -1814,46 +1905,46 @@ void PipeManager::set_node_mute(pw_proxy* proxy, const bool& state) const {
 }
 
 auto PipeManager::count_node_ports(const uint& node_id) -> uint {
-  uint count = 0U;
-
-  for (const auto& port : list_ports) {
-    if (port.node_id == node_id) {
-      count++;
-    }
-  }
-
-  return count;
+  return static_cast<uint>(get_node_ports(node_id).size());
 }
 
 auto PipeManager::link_nodes(const uint& output_node_id,
                              const uint& input_node_id,
                              const bool& probe_link,
                              const bool& link_passive) -> std::vector<pw_proxy*> {
+  lock();
+
+  auto list = link_nodes_locked(output_node_id, input_node_id, probe_link, link_passive);
+
+  if (list.empty()) {
+    unlock();
+  } else {
+    sync_wait_unlock();
+  }
+
+  return list;
+}
+
+auto PipeManager::link_nodes_locked(const uint& output_node_id,
+                                    const uint& input_node_id,
+                                    const bool& probe_link,
+                                    const bool& link_passive) -> std::vector<pw_proxy*> {
   std::vector<pw_proxy*> list;
   std::vector<PortInfo> list_output_ports;
   std::vector<PortInfo> list_input_ports;
-  auto use_audio_channel = true;
 
-  for (const auto& port : list_ports) {
-    if (port.node_id == output_node_id && port.direction == "out") {
+  for (const auto& port : get_node_ports(output_node_id)) {
+    if (port.direction == PortDirection::output) {
       list_output_ports.push_back(port);
-
-      if (!probe_link) {
-        if (port.audio_channel != "FL" && port.audio_channel != "FR") {
-          use_audio_channel = false;
-        }
-      }
     }
+  }
 
-    if (port.node_id == input_node_id && port.direction == "in") {
+  for (const auto& port : get_node_ports(input_node_id)) {
+    if (port.direction == PortDirection::input) {
       if (!probe_link) {
         list_input_ports.push_back(port);
-
-        if (port.audio_channel != "FL" && port.audio_channel != "FR") {
-          use_audio_channel = false;
-        }
       } else {
-        if (port.audio_channel == "PROBE_FL" || port.audio_channel == "PROBE_FR") {
+        if (port.channel_id == port_channel::probe_fl || port.channel_id == port_channel::probe_fr) {
           list_input_ports.push_back(port);
         }
       }
@@ -1872,24 +1963,36 @@ auto PipeManager::link_nodes(const uint& output_node_id,
     return list;
   }
 
+  /*
+    Ports are matched by channel position when every port of the smaller side has a counterpart with the same
+    position on the other side. This covers stereo and surround layouts alike. Otherwise we fall back to the port
+    index.
+  */
+
+  const auto has_channel = [](const std::vector<PortInfo>& ports, const uint& channel_id) {
+    return std::ranges::any_of(ports, [&](const PortInfo& p) { return p.channel_id == channel_id; });
+  };
+
+  const auto& smaller = (list_output_ports.size() <= list_input_ports.size()) ? list_output_ports : list_input_ports;
+  const auto& larger = (list_output_ports.size() <= list_input_ports.size()) ? list_input_ports : list_output_ports;
+
+  const auto use_audio_channel = std::ranges::all_of(smaller, [&](const PortInfo& p) {
+    return p.channel_id != port_channel::unknown && has_channel(larger, p.channel_id);
+  });
+
   for (const auto& outp : list_output_ports) {
     for (const auto& inp : list_input_ports) {
       bool ports_match = false;
 
       if (!probe_link) {
         if (use_audio_channel) {
-          ports_match = outp.audio_channel == inp.audio_channel;
+          ports_match = outp.channel_id == inp.channel_id;
         } else {
           ports_match = outp.port_id == inp.port_id;
         }
       } else {
-        if (outp.audio_channel == "FL" && inp.audio_channel == "PROBE_FL") {
-          ports_match = true;
-        }
-
-        if (outp.audio_channel == "FR" && inp.audio_channel == "PROBE_FR") {
-          ports_match = true;
-        }
+        ports_match = (outp.channel_id == port_channel::fl && inp.channel_id == port_channel::probe_fl) ||
+                      (outp.channel_id == port_channel::fr && inp.channel_id == port_channel::probe_fr);
       }
 
       if (ports_match) {
@@ -1902,8 +2005,6 @@ auto PipeManager::link_nodes(const uint& output_node_id,
         pw_properties_set(props, PW_KEY_LINK_INPUT_NODE, util::to_string(input_node_id).c_str());
         pw_properties_set(props, PW_KEY_LINK_INPUT_PORT, util::to_string(inp.id).c_str());
 
-        lock();
-
         auto* proxy = static_cast<pw_proxy*>(
             pw_core_create_object(core, "link-factory", PW_TYPE_INTERFACE_Link, PW_VERSION_LINK, &props->dict, 0));
 
@@ -1913,13 +2014,9 @@ auto PipeManager::link_nodes(const uint& output_node_id,
           util::warning("failed to link the node " + util::to_string(output_node_id) + " to " +
                         util::to_string(input_node_id));
 
-          unlock();
-
           return list;
         }
 
-        sync_wait_unlock();
-
         list.push_back(proxy);
       }
     }
@@ -1936,6 +2033,90 @@ void PipeManager::unlock() const {
   pw_thread_loop_unlock(thread_loop);
 }
 
+auto PipeManager::wait_for(const std::function<bool()>& ready, const std::chrono::milliseconds& timeout) const
+    -> bool {
+  struct LoopLock {
+    const PipeManager* pm;
+
+    void lock() const { pm->lock(); }
+
+    void unlock() const { pm->unlock(); }
+  } loop_lock{this};
+
+  std::unique_lock<LoopLock> guard(loop_lock);
+
+  return graph_changed.wait_for(guard, timeout, ready);
+}
+
+void PipeManager::notify_graph_changed() const {
+  graph_changed.notify_all();
+}
+
+void PipeManager::mark_node_changed(const uint64_t& serial, const uint& changes) {
+  if (changes == 0U) {
+    return;
+  }
+
+  std::scoped_lock<std::mutex> lock(changes_mutex);
+
+  pending_changes[serial] |= changes;
+
+  if (flush_scheduled) {
+    return;
+  }
+
+  flush_scheduled = true;
+
+  util::idle_add([this] { flush_node_changes(); });
+}
+
+void PipeManager::flush_node_changes() {
+  std::unordered_map<uint64_t, uint> changes;
+
+  {
+    std::scoped_lock<std::mutex> lock(changes_mutex);
+
+    changes.swap(pending_changes);
+
+    flush_scheduled = false;
+  }
+
+  if (PipeManager::exiting) {
+    return;
+  }
+
+  // The node_map is written by the PipeWire thread. We take the snapshots we are going to emit while holding its lock.
+
+  std::vector<std::pair<NodeInfo, uint>> snapshots;
+
+  snapshots.reserve(changes.size());
+
+  lock();
+
+  for (const auto& [serial, node_changes] : changes) {
+    // Nodes removed in the meantime were already announced by the *_removed signals.
+
+    if (auto it = node_map.find(serial); it != node_map.end()) {
+      snapshots.emplace_back(it->second, node_changes);
+    }
+  }
+
+  unlock();
+
+  for (const auto& [node, node_changes] : snapshots) {
+    if (node.media_class == tags::pipewire::media_class::output_stream) {
+      stream_output_changed.emit(node, node_changes);
+    } else if (node.media_class == tags::pipewire::media_class::input_stream) {
+      stream_input_changed.emit(node, node_changes);
+    } else if (node.media_class == tags::pipewire::media_class::source ||
+               node.media_class == tags::pipewire::media_class::virtual_source) {
+      source_changed.emit(node, node_changes);
+    } else if (node.media_class == tags::pipewire::media_class::sink) {
+      sink_changed.emit(node, node_changes);
+    }
+  }
+}
+
 void PipeManager::sync_wait_unlock() const {
   pw_core_sync(core, PW_ID_CORE, 0);
 
@@ -1961,13 +2142,21 @@ void PipeManager::destroy_object(const int& id) const {
 }
 
 void PipeManager::destroy_links(const std::vector<pw_proxy*>& list) const {
+  if (list.empty()) {
+    return;
+  }
+
+  lock();
+
+  destroy_links_locked(list);
+
+  sync_wait_unlock();
+}
+
+void PipeManager::destroy_links_locked(const std::vector<pw_proxy*>& list) {
   for (auto* proxy : list) {
     if (proxy != nullptr) {
-      lock();
-
       pw_proxy_destroy(proxy);
-
-      sync_wait_unlock();
     }
   }
 }
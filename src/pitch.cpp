@@ -25,12 +25,15 @@
 #include <glib.h>
 #include <algorithm>
 #include <cstddef>
-#include <mutex>
+#include <memory>
 #include <span>
 #include <string>
+#include <utility>
+#include "block_adapter.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 Pitch::Pitch(const std::string& tag,
@@ -45,6 +48,8 @@ Pitch::Pitch(const std::string& tag,
                  schema_path,
                  pipe_manager,
                  pipe_type) {
+  data.reserve(2U * max_quantum);
+
   quick_seek = g_settings_get_boolean(settings, "quick-seek") != 0;
   anti_alias = g_settings_get_boolean(settings, "anti-alias") != 0;
 
@@ -57,27 +62,15 @@ Pitch::Pitch(const std::string& tag,
 
   semitones = g_settings_get_double(settings, "semitones");
 
+  publish_params();
+
   // resetting soundtouch when bypass is pressed so its internal data is discarded
 
   gconnections.push_back(g_signal_connect(settings, "changed::bypass",
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<Pitch*>(user_data);
 
-                                            util::idle_add([&, self] {
-                                              self->data_mutex.lock();
-
-                                              self->soundtouch_ready = false;
-
-                                              self->data_mutex.unlock();
-
-                                              self->init_soundtouch();
-
-                                              self->data_mutex.lock();
-
-                                              self->soundtouch_ready = true;
-
-                                              self->data_mutex.unlock();
-                                            });
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -87,11 +80,7 @@ Pitch::Pitch(const std::string& tag,
 
                                             self->quick_seek = g_settings_get_boolean(settings, key) != 0;
 
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-
-                                            self->set_quick_seek();
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -101,11 +90,7 @@ Pitch::Pitch(const std::string& tag,
 
                                             self->anti_alias = g_settings_get_boolean(settings, key) != 0;
 
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-
-                                            self->set_quick_seek();
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -115,11 +100,7 @@ Pitch::Pitch(const std::string& tag,
 
                                             self->sequence_length_ms = g_settings_get_int(settings, key);
 
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-
-                                            self->set_sequence_length();
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -129,11 +110,7 @@ Pitch::Pitch(const std::string& tag,
 
                                             self->seek_window_ms = g_settings_get_int(settings, key);
 
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-
-                                            self->set_seek_window();
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -143,11 +120,7 @@ Pitch::Pitch(const std::string& tag,
 
                                             self->overlap_length_ms = g_settings_get_int(settings, key);
 
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-
-                                            self->set_overlap_length();
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -157,11 +130,7 @@ Pitch::Pitch(const std::string& tag,
 
                                             self->tempo_difference = g_settings_get_double(settings, key);
 
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-
-                                            self->set_tempo_difference();
+                                            self->publish_params();
                                           }),
                                           this));
 
@@ -171,11 +140,7 @@ Pitch::Pitch(const std::string& tag,
 
                                             self->rate_difference = g_settings_get_double(settings, key);
 
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-
-                                            self->set_rate_difference();
+                                            self->publish_params();
                                           }),
                                           this));
 
@@ -183,10 +148,7 @@ Pitch::Pitch(const std::string& tag,
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<Pitch*>(user_data);
                                             self->cents = g_settings_get_double(settings, key);
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-                                            self->update_pitch();
+                                            self->publish_params();
                                           }),
                                           this));
 
@@ -194,10 +156,7 @@ Pitch::Pitch(const std::string& tag,
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<Pitch*>(user_data);
                                             self->semitones = g_settings_get_double(settings, key);
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-                                            self->update_pitch();
+                                            self->publish_params();
                                           }),
                                           this));
 
@@ -205,10 +164,7 @@ Pitch::Pitch(const std::string& tag,
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<Pitch*>(user_data);
                                             self->octaves = g_settings_get_double(settings, key);
-                                            if (!self->soundtouch_ready) {
-                                              return;
-                                            }
-                                            self->update_pitch();
+                                            self->publish_params();
                                           }),
                                           this));
 
@@ -224,43 +180,42 @@ Pitch::~Pitch() {
 }
 
 void Pitch::setup() {
-  soundtouch_ready = false;
-
   latency_n_frames = 0U;
 
   if (data.size() != static_cast<size_t>(n_samples) * 2) {
     data.resize(2U * static_cast<size_t>(n_samples));
   }
+}
 
-  deque_out_L.resize(0U);
-  deque_out_R.resize(0U);
-
-  util::idle_add([&, this] {
-    if (soundtouch_ready) {
-      return;
-    }
-
-    init_soundtouch();
-
-    std::scoped_lock<std::mutex> lock(data_mutex);
-
-    soundtouch_ready = true;
-  });
+void Pitch::setup_engine(const uint& n_samples, const uint& rate) {
+  init_soundtouch(n_samples, rate);
 }
 
 void Pitch::process(std::span<float>& left_in,
                     std::span<float>& right_in,
                     std::span<float>& left_out,
                     std::span<float>& right_out) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  const auto e = engine.read();
 
-  if (bypass || !soundtouch_ready) {
+  if (bypass || !e || e->n_samples != n_samples || e->rate != rate) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
     return;
   }
 
+  if (const auto p = params.read(); p && (p.generation() != params_generation || e.generation() != engine_generation)) {
+    e->snd_touch.setPitchSemiTones(p->total_semitones);
+    e->snd_touch.setTempoChange(p->tempo_difference);
+    e->snd_touch.setRateChange(p->rate_difference);
+
+    params_generation = p.generation();
+  }
+
+  engine_generation = e.generation();
+
+  auto* snd_touch = &e->snd_touch;
+
   if (input_gain != 1.0F) {
     apply_gain(left_in, right_in, input_gain);
   }
@@ -278,45 +233,21 @@ void Pitch::process(std::span<float>& left_in,
     n_received = snd_touch->receiveSamples(data.data(), n_samples);
 
     for (size_t n = 0U; n < n_received; n++) {
-      deque_out_L.push_back(data[n * 2U]);
-      deque_out_R.push_back(data[n * 2U + 1U]);
+      e->received_L[n] = data[n * 2U];
+      e->received_R[n] = data[n * 2U + 1U];
     }
 
+    e->fifo_out_L.push(std::span(e->received_L).first(n_received));
+    e->fifo_out_R.push(std::span(e->received_R).first(n_received));
   } while (n_received != 0);
 
-  if (deque_out_L.size() >= left_out.size()) {
-    for (float& v : left_out) {
-      v = deque_out_L.front();
+  e->fifo_out_R.pop_or_pad(right_out);
 
-      deque_out_L.pop_front();
-    }
-
-    for (float& v : right_out) {
-      v = deque_out_R.front();
-
-      deque_out_R.pop_front();
-    }
-  } else {
-    const uint offset = left_out.size() - deque_out_L.size();
+  if (const auto offset = static_cast<uint>(e->fifo_out_L.pop_or_pad(left_out));
+      offset != 0U && offset != latency_n_frames) {
+    latency_n_frames = offset;
 
-    if (offset != latency_n_frames) {
-      latency_n_frames = offset;
-
-      notify_latency = true;
-    }
-
-    for (uint n = 0U; !deque_out_L.empty() && n < left_out.size(); n++) {
-      if (n < offset) {
-        left_out[n] = 0.0F;
-        right_out[n] = 0.0F;
-      } else {
-        left_out[n] = deque_out_L.front();
-        right_out[n] = deque_out_R.front();
-
-        deque_out_R.pop_front();
-        deque_out_L.pop_front();
-      }
-    }
+    notify_latency = true;
   }
 
   if (output_gain != 1.0F) {
@@ -326,17 +257,7 @@ void Pitch::process(std::span<float>& left_in,
   if (notify_latency) {
     latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
-
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
-
-      latency.emit();
-    });
-
-    update_filter_params();
+    post_latency();
 
     notify_latency = false;
   }
@@ -350,101 +271,54 @@ void Pitch::process(std::span<float>& left_in,
   }
 }
 
-void Pitch::set_sequence_length() {
-  if (snd_touch == nullptr) {
+void Pitch::init_soundtouch(const uint& n_samples, const uint& rate) {
+  if (n_samples == 0U || rate == 0U) {
     return;
   }
 
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  /*
+    The structural settings reallocate the internal buffers of soundtouch. So they are only applied to a new instance
+    that is built here in the main thread. Pitch, tempo and rate changes are cheap and are applied by the realtime
+    thread.
+  */
 
-  snd_touch->setSetting(SETTING_SEQUENCE_MS, sequence_length_ms);
-}
+  auto new_engine = std::make_unique<Engine>();
 
-void Pitch::set_seek_window() {
-  if (snd_touch == nullptr) {
-    return;
-  }
-
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  snd_touch->setSetting(SETTING_SEEKWINDOW_MS, seek_window_ms);
-}
+  new_engine->n_samples = n_samples;
+  new_engine->rate = rate;
 
-void Pitch::set_overlap_length() {
-  if (snd_touch == nullptr) {
-    return;
-  }
+  new_engine->received_L.resize(n_samples);
+  new_engine->received_R.resize(n_samples);
 
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  // Tempo and rate changes make the output size differ from the input one. The FIFO has room for that.
 
-  snd_touch->setSetting(SETTING_OVERLAP_MS, overlap_length_ms);
-}
+  new_engine->fifo_out_L.resize(8U * static_cast<size_t>(n_samples));
+  new_engine->fifo_out_R.resize(8U * static_cast<size_t>(n_samples));
 
-void Pitch::set_quick_seek() {
-  if (snd_touch == nullptr) {
-    return;
-  }
+  auto& st = new_engine->snd_touch;
 
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  st.setSampleRate(rate);
+  st.setChannels(2);
+  st.setSetting(SETTING_USE_QUICKSEEK, static_cast<int>(quick_seek));
+  st.setSetting(SETTING_USE_AA_FILTER, static_cast<int>(anti_alias));
+  st.setSetting(SETTING_SEQUENCE_MS, sequence_length_ms);
+  st.setSetting(SETTING_SEEKWINDOW_MS, seek_window_ms);
+  st.setSetting(SETTING_OVERLAP_MS, overlap_length_ms);
 
-  snd_touch->setSetting(SETTING_USE_QUICKSEEK, static_cast<int>(quick_seek));
+  engine.publish(std::move(new_engine));
 }
 
-void Pitch::set_anti_alias() {
-  if (snd_touch == nullptr) {
-    return;
-  }
-
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  snd_touch->setSetting(SETTING_USE_AA_FILTER, static_cast<int>(anti_alias));
-}
-
-void Pitch::set_tempo_difference() {
-  if (snd_touch == nullptr) {
-    return;
-  }
-
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  snd_touch->setTempoChange(tempo_difference);
-}
-
-void Pitch::set_rate_difference() {
-  if (snd_touch == nullptr) {
-    return;
-  }
-
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  snd_touch->setRateChange(rate_difference);
-}
-
-void Pitch::init_soundtouch() {
-  delete snd_touch;
-  snd_touch = new soundtouch::SoundTouch();
-  snd_touch->setSampleRate(rate);
-  snd_touch->setChannels(2);
-  update_pitch();
-  set_quick_seek();
-  set_anti_alias();
-  set_sequence_length();
-  set_seek_window();
-  set_overlap_length();
-  set_tempo_difference();
-  set_rate_difference();
+void Pitch::publish_params() {
+  params.publish(std::make_unique<Params>(
+      Params{.total_semitones = semitones + (octaves * 12.0) + (cents / 100.0),
+             .tempo_difference = tempo_difference,
+             .rate_difference = rate_difference}));
 }
 
 auto Pitch::get_latency_seconds() -> float {
   return latency_value;
 }
 
-void Pitch::update_pitch() {
-  if (snd_touch == nullptr) {
-    return;
-  }
-  double total_semitones = semitones + (octaves * 12.0) + (cents / 100.0);
-  std::scoped_lock<std::mutex> lock(data_mutex);
-  snd_touch->setPitchSemiTones(total_semitones);
+void Pitch::rebuild() {
+  init_soundtouch(n_samples, rate);
 }
-
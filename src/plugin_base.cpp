@@ -41,15 +41,19 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <span>
 #include <string>
-#include <thread>
 #include <utility>
+#include <vector>
 #include "pipe_manager.hpp"
+#include "pipeline_type.hpp"
 #include "tags_app.hpp"
 #include "tags_plugin_name.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 namespace {
@@ -64,88 +68,61 @@ void on_process(void* userdata, spa_io_position* position) {
     return;
   }
 
-  if (rate != d->pb->rate || n_samples != d->pb->n_samples) {
-    d->pb->rate = rate;
-    d->pb->n_samples = n_samples;
-
-    d->pb->dummy_left.resize(n_samples);
-    d->pb->dummy_right.resize(n_samples);
-
-    std::ranges::fill(d->pb->dummy_left, 0.0F);
-    std::ranges::fill(d->pb->dummy_right, 0.0F);
-
-    d->pb->clock_start = std::chrono::system_clock::now();
-
-    d->pb->setup();
-  }
-
-  d->pb->delta_t = 0.001F * static_cast<float>(std::chrono::duration_cast<std::chrono::milliseconds>(
-                                                   std::chrono::system_clock::now() - d->pb->clock_start)
-                                                   .count());
-
-  d->pb->send_notifications = d->pb->delta_t >= d->pb->notification_time_window;
+  d->pb->begin_cycle(n_samples, rate);
 
   // util::warning("processing: " + util::to_string(n_samples));
 
-  auto* in_left = static_cast<float*>(pw_filter_get_dsp_buffer(d->in_left, n_samples));
-  auto* in_right = static_cast<float*>(pw_filter_get_dsp_buffer(d->in_right, n_samples));
+  auto* pb = d->pb;
 
-  auto* out_left = static_cast<float*>(pw_filter_get_dsp_buffer(d->out_left, n_samples));
-  auto* out_right = static_cast<float*>(pw_filter_get_dsp_buffer(d->out_right, n_samples));
+  const auto n_channels = pb->channels.size();
 
-  std::span<float> left_in;
-  std::span<float> right_in;
-  std::span<float> left_out;
-  std::span<float> right_out;
+  for (size_t n = 0U; n < n_channels; n++) {
+    auto* in = static_cast<float*>(pw_filter_get_dsp_buffer(d->in[n], n_samples));
+    auto* out = static_cast<float*>(pw_filter_get_dsp_buffer(d->out[n], n_samples));
 
-  if (in_left != nullptr) {
-    left_in = std::span(in_left, n_samples);
-  } else {
-    left_in = d->pb->dummy_left;
-  }
+    std::span<float> dummy;
 
-  if (in_right != nullptr) {
-    right_in = std::span(in_right, n_samples);
-  } else {
-    right_in = d->pb->dummy_right;
-  }
+    if (n == 0U) {
+      dummy = pb->dummy_left;
+    } else if (n == 1U) {
+      dummy = pb->dummy_right;
+    } else {
+      dummy = std::span(pb->dummy_surround).subspan((n - 2U) * n_samples, n_samples);
+    }
 
-  if (out_left != nullptr) {
-    left_out = std::span(out_left, n_samples);
-  } else {
-    left_out = d->pb->dummy_left;
+    pb->in_spans[n] = (in != nullptr) ? std::span(in, n_samples) : dummy;
+    pb->out_spans[n] = (out != nullptr) ? std::span(out, n_samples) : dummy;
   }
 
-  if (out_right != nullptr) {
-    right_out = std::span(out_right, n_samples);
-  } else {
-    right_out = d->pb->dummy_right;
-  }
+  auto& left_in = pb->in_spans[0];
+  auto& right_in = pb->in_spans[1];
+  auto& left_out = pb->out_spans[0];
+  auto& right_out = pb->out_spans[1];
 
-  if (!d->pb->enable_probe) {
-    d->pb->process(left_in, right_in, left_out, right_out);
+  if (!pb->enable_probe) {
+    if (n_channels == 2U) {
+      pb->run(left_in, right_in, left_out, right_out);
+    } else {
+      pb->run_channels(pb->in_spans, pb->out_spans);
+    }
   } else {
     auto* probe_left = static_cast<float*>(pw_filter_get_dsp_buffer(d->probe_left, n_samples));
     auto* probe_right = static_cast<float*>(pw_filter_get_dsp_buffer(d->probe_right, n_samples));
 
     if (probe_left == nullptr || probe_right == nullptr) {
-      std::span l(d->pb->dummy_left.data(), n_samples);
-      std::span r(d->pb->dummy_right.data(), n_samples);
+      std::span l(pb->dummy_left.data(), n_samples);
+      std::span r(pb->dummy_right.data(), n_samples);
 
-      d->pb->process(left_in, right_in, left_out, right_out, l, r);
+      pb->run(pb->in_spans, pb->out_spans, l, r);
     } else {
       std::span l(probe_left, n_samples);
       std::span r(probe_right, n_samples);
 
-      d->pb->process(left_in, right_in, left_out, right_out, l, r);
+      pb->run(pb->in_spans, pb->out_spans, l, r);
     }
   }
 
-  if (d->pb->send_notifications) {
-    d->pb->clock_start = std::chrono::system_clock::now();
-
-    d->pb->send_notifications = false;
-  }
+  d->pb->end_cycle();
 }
 
 auto update_filter(struct spa_loop* loop, bool async, uint32_t seq, const void* data, size_t size, void* user_data)
@@ -193,6 +170,10 @@ void on_filter_state_changed(void* userdata, pw_filter_state old, pw_filter_stat
     default:
       break;
   }
+
+  if (d->pm != nullptr) {
+    d->pm->notify_graph_changed();
+  }
 }
 
 const struct pw_filter_events filter_events = {.state_changed = on_filter_state_changed, .process = on_process};
@@ -212,31 +193,75 @@ PluginBase::PluginBase(std::string tag,
       package(std::move(package)),
       pipeline_type(pipe_type),
       enable_probe(enable_probe),
-      settings(g_settings_new_with_path(schema.c_str(), schema_path.c_str())),
+      channels((pipe_manager != nullptr && pipe_type == PipelineType::output) ? pipe_manager->output_channels
+                                                                               : std::vector<std::string>{"FL", "FR"}),
+      settings(schema.empty() ? nullptr : g_settings_new_with_path(schema.c_str(), schema_path.c_str())),
       global_settings(g_settings_new(tags::app::id)),
       pm(pipe_manager) {
-  std::string description;
-
-  if (name != "output_level" && name != "spectrum") {
-    description = tags::plugin_name::get_translated()[name];
+  if (settings == nullptr) {
+    node_description = _("Effects Chain");
+  } else if (name != "output_level" && name != "spectrum") {
+    node_description = tags::plugin_name::get_translated()[name];
 
     bypass = g_settings_get_boolean(settings, "bypass") != 0;
 
+    bypass_requested = bypass.load();
+
+    routed_around = bypass && !enable_probe;
+
     gconnections.push_back(g_signal_connect(settings, "changed::bypass",
                                             G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                               auto* self = static_cast<PluginBase*>(user_data);
 
-                                              self->bypass = g_settings_get_boolean(settings, "bypass") != 0;
+                                              self->bypass_requested = g_settings_get_boolean(settings, "bypass") != 0;
+
+                                              // offline instances are processed without the ramp
+
+                                              if (self->pm == nullptr) {
+                                                self->bypass = self->bypass_requested.load();
+
+                                                return;
+                                              }
+
+                                              self->bypass_request_time = g_get_monotonic_time();
+
+                                              self->update_bypass();
                                             }),
                                             this));
   } else if (name == "output_level") {
-    description = _("Output Level Meter");
+    node_description = _("Output Level Meter");
   } else if (name == "spectrum") {
-    description = _("Spectrum");
+    node_description = _("Spectrum");
   }
 
   pf_data.pb = this;
+  pf_data.pm = pm;
+
+  n_ports = 2U * static_cast<uint>(channels.size());
+
+  in_spans.resize(channels.size());
+  out_spans.resize(channels.size());
+
+  dummy_left.reserve(max_quantum);
+  dummy_right.reserve(max_quantum);
+  dummy_surround.reserve((channels.size() - 2U) * max_quantum);
+
+  delayed_dry.reserve(channels.size() * max_quantum);
+
+  dry_spans.resize(channels.size());
+
+  if (enable_probe) {
+    n_ports += 2;
+  }
+
+  /*
+    The PipeWire filter is only created when we are connected to the graph for the first time. Offline instances, like
+    the ones created by OfflineRenderer, and the plugins that only run inside a fused chain never have one. Their host
+    calls begin_cycle, process and end_cycle directly.
+  */
+}
 
+void PluginBase::create_filter() {
   const auto filter_name = "ee_" + log_tag.substr(0U, log_tag.size() - 2U) + "_" + name;
 
   pm->lock();
@@ -246,7 +271,7 @@ PluginBase::PluginBase(std::string tag,
   pw_properties_set(props_filter, PW_KEY_APP_ID, tags::app::id);
   pw_properties_set(props_filter, PW_KEY_NODE_NAME, filter_name.c_str());
   pw_properties_set(props_filter, PW_KEY_NODE_NICK, name.c_str());
-  pw_properties_set(props_filter, PW_KEY_NODE_DESCRIPTION, description.c_str());
+  pw_properties_set(props_filter, PW_KEY_NODE_DESCRIPTION, node_description.c_str());
   pw_properties_set(props_filter, PW_KEY_MEDIA_TYPE, "Audio");
   pw_properties_set(props_filter, PW_KEY_MEDIA_CATEGORY, "Filter");
   pw_properties_set(props_filter, PW_KEY_MEDIA_ROLE, "DSP");
@@ -254,53 +279,29 @@ PluginBase::PluginBase(std::string tag,
 
   filter = pw_filter_new(pm->core, filter_name.c_str(), props_filter);
 
-  // left channel input
-
-  auto* props_in_left = pw_properties_new(nullptr, nullptr);
-
-  pw_properties_set(props_in_left, PW_KEY_FORMAT_DSP, "32 bit float mono audio");
-  pw_properties_set(props_in_left, PW_KEY_PORT_NAME, "input_FL");
-  pw_properties_set(props_in_left, "audio.channel", "FL");
-
-  pf_data.in_left = static_cast<port*>(pw_filter_add_port(filter, PW_DIRECTION_INPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS,
-                                                          sizeof(port), props_in_left, nullptr, 0));
-
-  // right channel input
-
-  auto* props_in_right = pw_properties_new(nullptr, nullptr);
-
-  pw_properties_set(props_in_right, PW_KEY_FORMAT_DSP, "32 bit float mono audio");
-  pw_properties_set(props_in_right, PW_KEY_PORT_NAME, "input_FR");
-  pw_properties_set(props_in_right, "audio.channel", "FR");
-
-  pf_data.in_right = static_cast<port*>(pw_filter_add_port(filter, PW_DIRECTION_INPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS,
-                                                           sizeof(port), props_in_right, nullptr, 0));
-
-  // left channel output
-
-  auto* props_out_left = pw_properties_new(nullptr, nullptr);
-
-  pw_properties_set(props_out_left, PW_KEY_FORMAT_DSP, "32 bit float mono audio");
-  pw_properties_set(props_out_left, PW_KEY_PORT_NAME, "output_FL");
-  pw_properties_set(props_out_left, "audio.channel", "FL");
+  for (const auto& channel : channels) {
+    auto* props_in = pw_properties_new(nullptr, nullptr);
 
-  pf_data.out_left = static_cast<port*>(pw_filter_add_port(filter, PW_DIRECTION_OUTPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS,
-                                                           sizeof(port), props_out_left, nullptr, 0));
+    pw_properties_set(props_in, PW_KEY_FORMAT_DSP, "32 bit float mono audio");
+    pw_properties_set(props_in, PW_KEY_PORT_NAME, ("input_" + channel).c_str());
+    pw_properties_set(props_in, "audio.channel", channel.c_str());
 
-  // right channel output
+    pf_data.in.push_back(static_cast<port*>(pw_filter_add_port(
+        filter, PW_DIRECTION_INPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS, sizeof(port), props_in, nullptr, 0)));
+  }
 
-  auto* props_out_right = pw_properties_new(nullptr, nullptr);
+  for (const auto& channel : channels) {
+    auto* props_out = pw_properties_new(nullptr, nullptr);
 
-  pw_properties_set(props_out_right, PW_KEY_FORMAT_DSP, "32 bit float mono audio");
-  pw_properties_set(props_out_right, PW_KEY_PORT_NAME, "output_FR");
-  pw_properties_set(props_out_right, "audio.channel", "FR");
+    pw_properties_set(props_out, PW_KEY_FORMAT_DSP, "32 bit float mono audio");
+    pw_properties_set(props_out, PW_KEY_PORT_NAME, ("output_" + channel).c_str());
+    pw_properties_set(props_out, "audio.channel", channel.c_str());
 
-  pf_data.out_right = static_cast<port*>(pw_filter_add_port(
-      filter, PW_DIRECTION_OUTPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS, sizeof(port), props_out_right, nullptr, 0));
+    pf_data.out.push_back(static_cast<port*>(pw_filter_add_port(
+        filter, PW_DIRECTION_OUTPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS, sizeof(port), props_out, nullptr, 0)));
+  }
 
   if (enable_probe) {
-    n_ports += 2;
-
     // probe left input
 
     auto* props_left = pw_properties_new(nullptr, nullptr);
@@ -330,15 +331,29 @@ PluginBase::PluginBase(std::string tag,
 PluginBase::~PluginBase() {
   post_messages = false;
 
-  pm->lock();
+  if (rebuild_source_id != 0U) {
+    g_source_remove(rebuild_source_id);
+  }
 
-  if (listener.link.next != nullptr || listener.link.prev != nullptr) {
-    spa_hook_remove(&listener);
+  if (pm != nullptr && filter != nullptr) {
+    pm->lock();
+
+    if (listener.link.next != nullptr || listener.link.prev != nullptr) {
+      spa_hook_remove(&listener);
+    }
+
+    pw_filter_destroy(filter);
+
+    pm->sync_wait_unlock();
   }
 
-  pw_filter_destroy(filter);
+  for (auto& v : frozen_values) {
+    g_variant_unref(v.value);
+  }
 
-  pm->sync_wait_unlock();
+  if (settings == nullptr) {
+    return;
+  }
 
   for (auto& handler_id : gconnections) {
     g_signal_handler_disconnect(settings, handler_id);
@@ -354,14 +369,28 @@ void PluginBase::set_post_messages(const bool& state) {
 }
 
 void PluginBase::reset_settings() {
-  util::reset_all_keys_except(settings);
+  if (settings != nullptr) {
+    util::reset_all_keys_except(settings);
+  }
 }
 
 auto PluginBase::connect_to_pw() -> bool {
+  return begin_connect_to_pw() && finish_connect_to_pw();
+}
+
+auto PluginBase::begin_connect_to_pw() -> bool {
   connected_to_pw = false;
   can_get_node_id = false;
   state = PW_FILTER_STATE_UNCONNECTED;
 
+  if (pm == nullptr) {
+    return false;
+  }
+
+  if (filter == nullptr) {
+    create_filter();
+  }
+
   pm->lock();
 
   if (pw_filter_connect(filter, PW_FILTER_FLAG_RT_PROCESS, nullptr, 0) != 0) {
@@ -374,31 +403,47 @@ auto PluginBase::connect_to_pw() -> bool {
 
   initialize_listener();
 
-  pm->sync_wait_unlock();
-
-  while (!can_get_node_id) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  pm->unlock();
 
-    if (state == PW_FILTER_STATE_ERROR) {
-      util::warning(log_tag + name + " is in an error");
+  return true;
+}
 
-      return false;
-    }
+auto PluginBase::finish_connect_to_pw() -> bool {
+  if (pm == nullptr) {
+    return false;
   }
 
-  pm->lock();
-
-  node_id = pw_filter_get_node_id(filter);
-
-  pm->sync_wait_unlock();
-
   /*
     The filter we link in our pipeline have at least 4 ports. Some have six. Before we try to link filters we have to
-    wait until the information about their ports is available in PipeManager's list_ports vector.
+    wait until the information about their ports is available in PipeManager's port index.
   */
 
-  while (pm->count_node_ports(node_id) != n_ports) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  const auto ready = pm->wait_for(
+      [this]() {
+        if (state == PW_FILTER_STATE_ERROR) {
+          return true;
+        }
+
+        if (!can_get_node_id) {
+          return false;
+        }
+
+        node_id = pw_filter_get_node_id(filter);
+
+        return pm->count_node_ports(node_id) == n_ports;
+      },
+      PipeManager::connection_timeout);
+
+  if (state == PW_FILTER_STATE_ERROR) {
+    util::warning(log_tag + name + " is in an error");
+
+    return false;
+  }
+
+  if (!ready) {
+    util::warning(log_tag + name + " ports are taking too long to be available");
+
+    return false;
   }
 
   connected_to_pw = true;
@@ -417,10 +462,18 @@ auto PluginBase::get_node_id() const -> uint {
 }
 
 void PluginBase::set_active(const bool& state) const {
+  if (filter == nullptr) {
+    return;
+  }
+
   pw_filter_set_active(filter, state);
 }
 
 void PluginBase::disconnect_from_pw() {
+  if (pm == nullptr || filter == nullptr) {
+    return;
+  }
+
   pm->lock();
 
   set_active(false);
@@ -439,8 +492,241 @@ void PluginBase::disconnect_from_pw() {
   node_id = SPA_ID_INVALID;
 }
 
+void PluginBase::begin_cycle(const uint& quantum, const uint& sampling_rate) {
+  cycle_start = std::chrono::steady_clock::now();
+
+  if (lv2_wrapper != nullptr) {
+    lv2_in_use.store(true);
+  }
+
+  if (sampling_rate != rate || quantum != n_samples) {
+    rate = sampling_rate;
+    n_samples = quantum;
+
+    // the capacity was reserved for max_quantum. So these resizes do not allocate.
+
+    dummy_left.resize(n_samples);
+    dummy_right.resize(n_samples);
+
+    dummy_surround.resize((channels.size() - 2U) * n_samples);
+
+    std::ranges::fill(dummy_left, 0.0F);
+    std::ranges::fill(dummy_right, 0.0F);
+    std::ranges::fill(dummy_surround, 0.0F);
+
+    clock_start = cycle_start;
+
+    setup();
+
+    const auto request = (static_cast<uint64_t>(n_samples) << 32U) | rate;
+
+    pending_setup.store(request, std::memory_order_release);
+
+    if (lv2_wrapper != nullptr) {
+      pending_lv2_setup.store(request, std::memory_order_release);
+    }
+  }
+
+  if (lv2_wrapper != nullptr) {
+    lv2_ready = lv2_ready_for.load() == ((static_cast<uint64_t>(n_samples) << 32U) | rate);
+  }
+
+  delta_t = 0.001F *
+            static_cast<float>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(cycle_start - clock_start)
+                    .count());
+
+  send_notifications = delta_t >= notification_time_window;
+}
+
+void PluginBase::prepare(const uint& quantum, const uint& sampling_rate) {
+  begin_cycle(quantum, sampling_rate);
+
+  lv2_in_use.store(false);  // no thread processes this plugin yet
+
+  run_pending_setup();
+}
+
+auto PluginBase::is_ready() -> bool {
+  return lv2_wrapper == nullptr || !lv2_wrapper->found_plugin ||
+         lv2_ready_for.load() == ((static_cast<uint64_t>(n_samples) << 32U) | rate);
+}
+
+void PluginBase::end_cycle() {
+  if (lv2_wrapper != nullptr) {
+    lv2_in_use.store(false, std::memory_order_release);
+  }
+
+  const auto elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - cycle_start).count();
+
+  record_load(elapsed * static_cast<float>(rate) / static_cast<float>(n_samples));
+
+  if (send_notifications) {
+    publish_load();
+
+    clock_start = std::chrono::steady_clock::now();
+
+    send_notifications = false;
+  }
+}
+
+void PluginBase::record_load(const float& load) {
+  const auto bin = std::min(static_cast<uint>(load * 100.0F), load_histogram_size - 1U);
+
+  load_histogram[bin]++;
+
+  load_min = (load_cycles == 0U) ? load : std::min(load_min, load);
+  load_max = std::max(load_max, load);
+  load_sum += load;
+
+  load_cycles++;
+
+  if (load > 1.0F) {
+    load_overruns.fetch_add(1U, std::memory_order_relaxed);
+  }
+
+  if (load > load_peak_value.load(std::memory_order_relaxed)) {
+    load_peak_value.store(load, std::memory_order_relaxed);
+  }
+}
+
+void PluginBase::publish_load() {
+  if (load_cycles == 0U) {
+    return;
+  }
+
+  // the 99th percentile is the upper edge of the bin where the cumulative count reaches 99% of the cycles
+
+  const auto target = static_cast<uint>(std::ceil(0.99F * static_cast<float>(load_cycles)));
+
+  uint count = 0U;
+  uint bin = 0U;
+
+  for (; bin < load_histogram_size - 1U; bin++) {
+    count += load_histogram[bin];
+
+    if (count >= target) {
+      break;
+    }
+  }
+
+  load_min_value.store(load_min, std::memory_order_relaxed);
+  load_avg_value.store(load_sum / static_cast<float>(load_cycles), std::memory_order_relaxed);
+  load_max_value.store(load_max, std::memory_order_relaxed);
+  load_p99_value.store(std::min(0.01F * static_cast<float>(bin + 1U), load_max), std::memory_order_relaxed);
+
+  if (post_messages) {
+    post_meter(telemetry::dsp_load_meter);
+  }
+
+  load_histogram.fill(0U);
+
+  load_cycles = 0U;
+  load_sum = 0.0F;
+  load_max = 0.0F;
+}
+
+auto PluginBase::get_dsp_load() const -> DspLoad {
+  return {.min = load_min_value.load(std::memory_order_relaxed),
+          .avg = load_avg_value.load(std::memory_order_relaxed),
+          .max = load_max_value.load(std::memory_order_relaxed),
+          .p99 = load_p99_value.load(std::memory_order_relaxed),
+          .peak = load_peak_value.load(std::memory_order_relaxed),
+          .overruns = load_overruns.load(std::memory_order_relaxed)};
+}
+
 void PluginBase::setup() {}
 
+void PluginBase::setup_engine(const uint& n_samples, const uint& rate) {}
+
+void PluginBase::run_pending_setup() {
+  setup_lv2();
+
+  const auto request = pending_setup.exchange(0U, std::memory_order_acq_rel);
+
+  if (request != 0U) {
+    const auto quantum = static_cast<uint>(request >> 32U);
+    const auto sampling_rate = static_cast<uint>(request & 0xFFFFFFFFU);
+
+    setup_engine(quantum, sampling_rate);
+
+    setup_surround_lv2(quantum, sampling_rate);
+
+    setup_latency_delay();
+  }
+}
+
+void PluginBase::setup_lv2() {
+  if (pending_lv2_setup.load(std::memory_order_acquire) == 0U) {
+    return;
+  }
+
+  /*
+    The realtime thread stops using the instance once lv2_ready_for does not match its cycle. If a cycle had already
+    passed that check, lv2_in_use is still set and the setup is tried again in the next drain.
+  */
+
+  lv2_ready_for.store(0U);
+
+  if (lv2_in_use.load()) {
+    return;
+  }
+
+  const auto request = pending_lv2_setup.exchange(0U, std::memory_order_acq_rel);
+
+  const auto sampling_rate = static_cast<uint>(request & 0xFFFFFFFFU);
+
+  if (lv2_wrapper->found_plugin) {
+    lv2_wrapper->set_n_samples(static_cast<uint>(request >> 32U));
+
+    if (lv2_wrapper->get_rate() != sampling_rate) {
+      lv2_wrapper->create_instance(sampling_rate);
+    }
+  }
+
+  if (lv2_wrapper->has_instance()) {
+    lv2_ready_for.store(request, std::memory_order_release);
+  }
+}
+
+void PluginBase::setup_surround_lv2(const uint& n_samples, const uint& rate) {
+  if (lv2_wrapper == nullptr || !lv2_wrapper->found_plugin || channels.size() <= 2U) {
+    return;
+  }
+
+  auto s = std::make_unique<SurroundLv2>();
+
+  s->n_samples = n_samples;
+  s->rate = rate;
+
+  s->silence.resize(n_samples, 0.0F);
+  s->discard.resize(n_samples, 0.0F);
+
+  for (size_t n = 2U; n < channels.size(); n++) {
+    SurroundLv2::Unit unit{.instance = std::make_unique<lv2::Lv2Wrapper>(lv2_wrapper->get_plugin_uri()),
+                           .left = n,
+                           .right = n};
+
+    if (n + 1U < channels.size() && channels[n].ends_with('L') && channels[n + 1U].ends_with('R')) {
+      unit.right = ++n;
+    }
+
+    unit.instance->set_n_samples(n_samples);
+
+    if (!unit.instance->create_instance(rate)) {
+      surround_lv2.publish(nullptr);
+
+      return;
+    }
+
+    s->units.push_back(std::move(unit));
+  }
+
+  util::debug(log_tag + name + ": " + util::to_string(s->units.size()) + " extra instances for the surround channels");
+
+  surround_lv2.publish(std::move(s));
+}
+
 void PluginBase::process(std::span<float>& left_in,
                          std::span<float>& right_in,
                          std::span<float>& left_out,
@@ -453,10 +739,324 @@ void PluginBase::process(std::span<float>& left_in,
                          std::span<float>& probe_left,
                          std::span<float>& probe_right) {}
 
+void PluginBase::process_channels(std::span<std::span<float>> in, std::span<std::span<float>> out) {
+  process(in[0], in[1], out[0], out[1]);
+
+  const auto s = surround_lv2.read();
+
+  if (bypass || !s || s->rate != rate || s->n_samples != n_samples || !lv2_ready) {
+    pass_through_surround(in, out);
+
+    return;
+  }
+
+  std::span<float> silence(s->silence);
+  std::span<float> discard(s->discard);
+
+  for (auto& unit : s->units) {
+    auto& left_in = in[unit.left];
+    auto& left_out = out[unit.left];
+    auto& right_in = (unit.right != unit.left) ? in[unit.right] : silence;
+    auto& right_out = (unit.right != unit.left) ? out[unit.right] : discard;
+
+    if (input_gain != 1.0F) {
+      apply_gain(left_in, right_in, input_gain);
+    }
+
+    // the sidechain of the surround channels is their own input
+
+    unit.instance->copy_control_values(*lv2_wrapper);
+    unit.instance->connect_data_ports(left_in, right_in, left_out, right_out, left_in, right_in);
+    unit.instance->run();
+
+    if (output_gain != 1.0F) {
+      apply_gain(left_out, right_out, output_gain);
+    }
+  }
+}
+
+void PluginBase::run(std::span<float> left_in,
+                     std::span<float> right_in,
+                     std::span<float> left_out,
+                     std::span<float> right_out) {
+  std::array<std::span<float>, 2U> in = {left_in, right_in};
+  std::array<std::span<float>, 2U> out = {left_out, right_out};
+
+  if (begin_bypass_ramp(in, out)) {
+    return;
+  }
+
+  process(left_in, right_in, left_out, right_out);
+
+  end_bypass_ramp(out);
+}
+
+void PluginBase::run(std::span<std::span<float>> in,
+                     std::span<std::span<float>> out,
+                     std::span<float> probe_left,
+                     std::span<float> probe_right) {
+  if (begin_bypass_ramp(in, out)) {
+    return;
+  }
+
+  process(in[0], in[1], out[0], out[1], probe_left, probe_right);
+
+  // the sidechain plugins only know about the front pair
+
+  pass_through_surround(in, out);
+
+  end_bypass_ramp(out);
+}
+
+void PluginBase::run_channels(std::span<std::span<float>> in, std::span<std::span<float>> out) {
+  if (begin_bypass_ramp(in, out)) {
+    return;
+  }
+
+  process_channels(in, out);
+
+  end_bypass_ramp(out);
+}
+
+auto PluginBase::begin_bypass_ramp(std::span<std::span<float>> in, std::span<std::span<float>> out) -> bool {
+  // Returns true when the plugin is bypassed and the output already holds the delayed input.
+
+  const auto d = latency_delay.read();
+
+  const auto bypassed = bypass.load(std::memory_order_relaxed);
+
+  if (bypassed) {
+    bypass_mix = 0.0F;
+  }
+
+  bypass_ramping = !bypassed && (bypass_requested.load(std::memory_order_relaxed) || bypass_mix < 1.0F);
+
+  const auto has_delay = d && d->n_frames > 0U && d->lines.size() >= in.size();
+
+  dry_ready = false;
+
+  if (!bypassed && !bypass_ramping && !has_delay) {
+    return false;
+  }
+
+  /*
+    With latency the lines are fed in every cycle, so that they hold the recent input when a ramp starts. Each sample
+    is written before the delayed one is read, what allows in and out to be the same buffer.
+  */
+
+  const auto n = in[0].size();
+
+  delayed_dry.resize(in.size() * n);
+
+  for (size_t c = 0U; c < in.size(); c++) {
+    dry_spans[c] = std::span(delayed_dry).subspan(c * n, n);
+
+    if (!has_delay) {
+      std::ranges::copy(in[c], dry_spans[c].begin());
+
+      continue;
+    }
+
+    auto& line = d->lines[c];
+
+    auto p = d->position;
+
+    for (size_t i = 0U; i < n; i++) {
+      const auto v = in[c][i];
+
+      dry_spans[c][i] = line[p];
+      line[p] = v;
+
+      p = (p + 1U == line.size()) ? 0U : p + 1U;
+    }
+  }
+
+  if (has_delay) {
+    d->position = (d->position + n) % d->n_frames;
+  }
+
+  dry_ready = true;
+
+  if (bypassed) {
+    for (size_t c = 0U; c < out.size(); c++) {
+      std::ranges::copy(dry_spans[c], out[c].begin());
+    }
+  }
+
+  return bypassed;
+}
+
+void PluginBase::end_bypass_ramp(std::span<std::span<float>> out) {
+  if (!bypass_ramping) {
+    return;
+  }
+
+  const auto target = bypass_requested.load(std::memory_order_relaxed) ? 0.0F : 1.0F;
+
+  const auto step = 1000.0F / static_cast<float>(bypass_ramp_ms * rate);
+
+  auto mix = bypass_mix;
+
+  for (size_t c = 0U; c < out.size(); c++) {
+    mix = bypass_mix;
+
+    for (size_t i = 0U; i < out[c].size(); i++) {
+      mix = (target > mix) ? std::min(mix + step, target) : std::max(mix - step, target);
+
+      out[c][i] = dry_spans[c][i] + mix * (out[c][i] - dry_spans[c][i]);
+    }
+  }
+
+  bypass_mix = mix;
+
+  if (target == 0.0F && mix == 0.0F) {
+    bypass.store(true);
+
+    bypass_settled.store(true, std::memory_order_release);
+  }
+}
+
+void PluginBase::update_bypass() {
+  /*
+    Main thread. Turning the bypass off does not wait for the realtime thread. Turning it on waits for the end of the
+    ramp, unless no thread runs us, like a filter that PipeWire does not schedule. It is then applied directly.
+  */
+
+  auto changed = bypass_settled.exchange(false, std::memory_order_acquire);
+
+  if (!bypass_requested && bypass) {
+    bypass = false;
+
+    changed = true;
+  } else if (bypass_requested && !bypass && bypass_request_time != 0 &&
+             g_get_monotonic_time() - bypass_request_time > G_USEC_PER_SEC) {
+    bypass = true;
+
+    changed = true;
+  }
+
+  if (!changed) {
+    return;
+  }
+
+  bypass_request_time = 0;
+
+  update_routing();
+
+  bypass_changed.emit();
+}
+
+void PluginBase::update_routing() {
+  const auto* d = latency_delay.peek();
+
+  routed_around = bypass && !enable_probe && (d == nullptr || d->n_frames == 0U);
+}
+
+void PluginBase::pass_through_surround(std::span<std::span<float>> in, std::span<std::span<float>> out) {
+  // The channels beyond the front pair are already in the delay lines when the plugin has latency
+
+  for (size_t n = 2U; n < in.size(); n++) {
+    std::ranges::copy(dry_ready ? dry_spans[n] : in[n], out[n].begin());
+  }
+}
+
+void PluginBase::setup_latency_delay() {
+  // the fused chains have no bypass and their plugins delay their own surround channels
+
+  if (settings == nullptr || rate == 0U) {
+    return;
+  }
+
+  const auto n_frames = static_cast<uint>(std::round(latency_value * static_cast<float>(rate)));
+
+  const auto* current = latency_delay.peek();
+
+  if ((current != nullptr && current->n_frames == n_frames) || (current == nullptr && n_frames == 0U)) {
+    return;
+  }
+
+  auto d = std::make_unique<LatencyDelay>();
+
+  d->n_frames = n_frames;
+
+  d->lines.resize(channels.size(), std::vector<float>(n_frames, 0.0F));
+
+  util::debug(log_tag + name + ": the input is delayed by " + util::to_string(n_frames) + " frames when bypassed");
+
+  latency_delay.publish(std::move(d));
+
+  update_routing();
+}
+
 auto PluginBase::get_latency_seconds() -> float {
   return 0.0F;
 }
 
+auto PluginBase::parameter_settings() -> std::vector<GSettings*> {
+  if (settings == nullptr) {
+    return {};
+  }
+
+  return {settings};
+}
+
+void PluginBase::freeze_settings() {
+  if (settings_frozen) {
+    return;
+  }
+
+  settings_frozen = true;
+
+  const auto changed_id = g_signal_lookup("changed", G_TYPE_SETTINGS);
+
+  for (auto* s : parameter_settings()) {
+    GSettingsSchema* schema = nullptr;
+
+    g_object_get(s, "settings-schema", &schema, nullptr);
+
+    auto* keys = g_settings_schema_list_keys(schema);
+
+    for (auto* key = keys; *key != nullptr; key++) {
+      frozen_values.push_back({.settings = s, .key = *key, .value = g_settings_get_value(s, *key)});
+    }
+
+    g_strfreev(keys);
+
+    g_settings_schema_unref(schema);
+
+    g_signal_handlers_block_matched(s, G_SIGNAL_MATCH_ID, changed_id, 0, nullptr, nullptr, nullptr);
+  }
+}
+
+void PluginBase::thaw_settings() {
+  if (!settings_frozen) {
+    return;
+  }
+
+  settings_frozen = false;
+
+  const auto changed_id = g_signal_lookup("changed", G_TYPE_SETTINGS);
+
+  for (auto* s : parameter_settings()) {
+    g_signal_handlers_unblock_matched(s, G_SIGNAL_MATCH_ID, changed_id, 0, nullptr, nullptr, nullptr);
+  }
+
+  // the handlers only see the keys that really changed, so heavy ones like the convolver kernel are not reloaded
+
+  for (auto& v : frozen_values) {
+    auto* current = g_settings_get_value(v.settings, v.key.c_str());
+
+    if (g_variant_equal(current, v.value) == 0) {
+      g_signal_emit_by_name(v.settings, ("changed::" + v.key).c_str(), v.key.c_str());
+    }
+
+    g_variant_unref(current);
+    g_variant_unref(v.value);
+  }
+
+  frozen_values.clear();
+}
+
 void PluginBase::show_native_ui() {
   if (lv2_wrapper == nullptr) {
     return;
@@ -545,8 +1145,8 @@ void PluginBase::notify() {
   const auto output_peak_db_l = util::linear_to_db(output_peak_left);
   const auto output_peak_db_r = util::linear_to_db(output_peak_right);
 
-  input_level.emit(input_peak_db_l, input_peak_db_r);
-  output_level.emit(output_peak_db_l, output_peak_db_r);
+  post_meter(telemetry::input_level_meter, {input_peak_db_l, input_peak_db_r});
+  post_meter(telemetry::output_level_meter, {output_peak_db_l, output_peak_db_r});
 
   input_peak_left = util::minimum_linear_level;
   input_peak_right = util::minimum_linear_level;
@@ -554,8 +1154,102 @@ void PluginBase::notify() {
   output_peak_right = util::minimum_linear_level;
 }
 
+void PluginBase::post_meter(const uint16_t& id, std::span<const float> values) {
+  telemetry::Record record{.id = id, .size = static_cast<uint16_t>(std::min(values.size(), telemetry::max_values))};
+
+  std::copy_n(values.begin(), record.size, record.values.begin());
+
+  // A full ring means the main thread is not draining it. Losing a meter update is harmless.
+
+  telemetry_ring.push(record);
+}
+
+void PluginBase::post_latency() {
+  latency_changed.store(true, std::memory_order_release);
+}
+
+void PluginBase::drain_telemetry() {
+  std::array<bool, telemetry::max_meters> updated{};
+
+  telemetry::Record record;
+
+  while (telemetry_ring.pop(record)) {
+    if (record.id >= telemetry::max_meters) {
+      continue;
+    }
+
+    telemetry_snapshot[record.id] = record;
+
+    updated[record.id] = true;
+  }
+
+  for (uint16_t id = 0U; id < telemetry::max_meters; id++) {
+    if (updated[id]) {
+      on_meter(telemetry_snapshot[id]);
+    }
+  }
+
+  run_pending_setup();
+
+  update_bypass();
+
+  if (latency_changed.exchange(false, std::memory_order_acq_rel)) {
+    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
+
+    update_filter_params();
+
+    setup_latency_delay();
+
+    if (post_messages && !latency.empty()) {
+      latency.emit();
+    }
+  }
+}
+
+void PluginBase::on_meter(const telemetry::Record& record) {
+  switch (record.id) {
+    case telemetry::input_level_meter:
+      input_level.emit(record.values[0], record.values[1]);
+      break;
+
+    case telemetry::output_level_meter:
+      output_level.emit(record.values[0], record.values[1]);
+      break;
+
+    case telemetry::dsp_load_meter:
+      dsp_load.emit(get_dsp_load());
+      break;
+
+    default:
+      break;
+  }
+}
+
+void PluginBase::schedule_rebuild() {
+  if (rebuild_source_id != 0U) {
+    return;
+  }
+
+  rebuild_source_id = g_idle_add(
+      (GSourceFunc) +
+          [](PluginBase* self) {
+            self->rebuild_source_id = 0U;
+
+            self->rebuild();
+
+            return G_SOURCE_REMOVE;
+          },
+      this);
+}
+
+void PluginBase::rebuild() {}
+
 void PluginBase::update_probe_links() {}
 
 void PluginBase::update_filter_params() {
+  if (pm == nullptr || filter == nullptr) {
+    return;
+  }
+
   pw_loop_invoke(pw_thread_loop_get_loop(pm->thread_loop), update_filter, 1, nullptr, 0, false, this);
 }
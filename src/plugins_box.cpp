@@ -800,6 +800,9 @@ void setup(PluginsBox* self, app::Application* application, PipelineType pipelin
           }),
           self));
 
+      self->data->connections.push_back(application->sie->plugins_replaced.connect(
+          [=]() { add_plugins_to_stack<PipelineType::input>(self); }));
+
       gtk_image_set_from_icon_name(self->startpoint_icon, "audio-input-microphone-symbolic");
       gtk_image_set_from_icon_name(self->endpoint_icon, "ee-applications-multimedia-symbolic");
 
@@ -821,6 +824,9 @@ void setup(PluginsBox* self, app::Application* application, PipelineType pipelin
           }),
           self));
 
+      self->data->connections.push_back(application->soe->plugins_replaced.connect(
+          [=]() { add_plugins_to_stack<PipelineType::output>(self); }));
+
       gtk_image_set_from_icon_name(self->startpoint_icon, "ee-applications-multimedia-symbolic");
       gtk_image_set_from_icon_name(self->endpoint_icon, "audio-speakers-symbolic");
 
@@ -40,9 +40,10 @@ struct _PreferencesGeneral {
 
   GtkSwitch *enable_autostart, *process_all_inputs, *process_all_outputs, *theme_switch, *shutdown_on_window_close,
       *use_cubic_volumes, *inactivity_timer_enable, *autohide_popovers, *exclude_monitor_streams,
-      *show_native_plugin_ui;
+      *show_native_plugin_ui, *fuse_effects_chain, *crossfade_chain_switch, *surround_output;
 
-  GtkSpinButton *inactivity_timeout, *meters_update_interval, *lv2ui_update_frequency;
+  GtkSpinButton *inactivity_timeout, *meters_update_interval, *lv2ui_update_frequency, *chain_crossfade_time,
+      *convolution_threads;
 
   GSettings* settings;
 };
@@ -127,6 +128,11 @@ void preferences_general_class_init(PreferencesGeneralClass* klass) {
   gtk_widget_class_bind_template_child(widget_class, PreferencesGeneral, meters_update_interval);
   gtk_widget_class_bind_template_child(widget_class, PreferencesGeneral, lv2ui_update_frequency);
   gtk_widget_class_bind_template_child(widget_class, PreferencesGeneral, show_native_plugin_ui);
+  gtk_widget_class_bind_template_child(widget_class, PreferencesGeneral, fuse_effects_chain);
+  gtk_widget_class_bind_template_child(widget_class, PreferencesGeneral, crossfade_chain_switch);
+  gtk_widget_class_bind_template_child(widget_class, PreferencesGeneral, chain_crossfade_time);
+  gtk_widget_class_bind_template_child(widget_class, PreferencesGeneral, convolution_threads);
+  gtk_widget_class_bind_template_child(widget_class, PreferencesGeneral, surround_output);
 }
 
 void preferences_general_init(PreferencesGeneral* self) {
@@ -137,17 +143,20 @@ void preferences_general_init(PreferencesGeneral* self) {
   prepare_spinbuttons<"s">(self->inactivity_timeout);
   prepare_spinbuttons<"ms">(self->meters_update_interval);
   prepare_spinbuttons<"Hz">(self->lv2ui_update_frequency);
+  prepare_spinbuttons<"ms">(self->chain_crossfade_time);
 
   // initializing some widgets
 
   gsettings_bind_widgets<"process-all-inputs", "process-all-outputs", "use-dark-theme", "shutdown-on-window-close",
                          "use-cubic-volumes", "autohide-popovers", "exclude-monitor-streams", "inactivity-timer-enable",
                          "inactivity-timeout", "meters-update-interval", "lv2ui-update-frequency",
-                         "show-native-plugin-ui">(
+                         "show-native-plugin-ui", "fuse-effects-chain", "crossfade-chain-switch",
+                         "chain-crossfade-time", "convolution-threads", "surround-output">(
       self->settings, self->process_all_inputs, self->process_all_outputs, self->theme_switch,
       self->shutdown_on_window_close, self->use_cubic_volumes, self->autohide_popovers, self->exclude_monitor_streams,
       self->inactivity_timer_enable, self->inactivity_timeout, self->meters_update_interval,
-      self->lv2ui_update_frequency, self->show_native_plugin_ui);
+      self->lv2ui_update_frequency, self->show_native_plugin_ui, self->fuse_effects_chain,
+      self->crossfade_chain_switch, self->chain_crossfade_time, self->convolution_threads, self->surround_output);
 
 #ifdef ENABLE_LIBPORTAL
   libportal::init(self->enable_autostart, self->shutdown_on_window_close);
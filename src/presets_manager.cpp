@@ -670,15 +670,28 @@ auto PresetsManager::load_preset_file(const PresetType& preset_type, const std::
     return false;
   }
 
-  // After the plugin order list, load the blocklist and then
-  // apply the parameters of the loaded plugins.
-  if (load_blocklist(preset_type, json) && read_plugins_preset(preset_type, plugins, json)) {
-    util::debug("successfully loaded the preset: " + input_file.string());
+  /*
+    The blocklist and the parameters of the plugins are loaded before the new plugin list is set. The pipeline is
+    rebuilt only once and the plugins it creates start with the values of the preset.
+  */
 
-    return true;
+  preset_load_started.emit(preset_type);
+
+  if (!load_blocklist(preset_type, json) || !read_plugins_preset(preset_type, plugins, json)) {
+    preset_load_finished.emit(preset_type);
+
+    return false;
   }
 
-  return false;
+  GSettings* settings = (preset_type == PresetType::input) ? sie_settings : soe_settings;
+
+  g_settings_set_strv(settings, "plugins", util::make_gchar_pointer_vector(plugins).data());
+
+  preset_load_finished.emit(preset_type);
+
+  util::debug("successfully loaded the preset: " + input_file.string());
+
+  return true;
 }
 
 auto PresetsManager::read_effects_pipeline_from_preset(const PresetType& preset_type,
@@ -687,8 +700,6 @@ auto PresetsManager::read_effects_pipeline_from_preset(const PresetType& preset_
                                                        std::vector<std::string>& plugins) -> bool {
   const auto* preset_type_str = (preset_type == PresetType::input) ? "input" : "output";
 
-  GSettings* settings = (preset_type == PresetType::input) ? sie_settings : soe_settings;
-
   try {
     std::ifstream is(input_file);
 
@@ -724,19 +735,26 @@ auto PresetsManager::read_effects_pipeline_from_preset(const PresetType& preset_
     return false;
   }
 
-  g_settings_set_strv(settings, "plugins", util::make_gchar_pointer_vector(plugins).data());
-
   return true;
 }
 
 auto PresetsManager::read_plugins_preset(const PresetType& preset_type,
                                          const std::vector<std::string>& plugins,
                                          const nlohmann::json& json) -> bool {
+  /*
+    The values of every plugin are staged first and applied together only if all of them could be read. So a broken
+    preset changes nothing and a good one reaches each plugin as a single batch of keys.
+  */
+
+  std::vector<std::unique_ptr<PluginPresetBase>> staged;
+
   for (const auto& name : plugins) {
     if (auto wrapper = create_wrapper(preset_type, name); wrapper != std::nullopt) {
       try {
         if (wrapper.has_value()) {
-          wrapper.value()->read(json);
+          wrapper.value()->stage(json);
+
+          staged.push_back(std::move(wrapper.value()));
         }
       } catch (const nlohmann::json::exception& e) {
         notify_error(PresetError::plugin_format, name);
@@ -752,6 +770,10 @@ auto PresetsManager::read_plugins_preset(const PresetType& preset_type,
     }
   }
 
+  for (const auto& wrapper : staged) {
+    wrapper->apply();
+  }
+
   return true;
 }
 
@@ -19,6 +19,34 @@
 
 #include "resampler.hpp"
 #include <samplerate.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <numeric>
+#include <span>
+#include "util.hpp"
+
+namespace {
+
+// The polyphase path is only worth it when the number of phases is small.
+constexpr uint max_polyphase_factor = 512U;
+
+auto to_converter_type(const Resampler::Quality& quality) -> int {
+  switch (quality) {
+    case Resampler::Quality::best:
+      return SRC_SINC_BEST_QUALITY;
+    case Resampler::Quality::medium:
+    case Resampler::Quality::polyphase:
+      return SRC_SINC_MEDIUM_QUALITY;
+    default:
+      return SRC_SINC_FASTEST;
+  }
+}
+
+}  // namespace
 
 Resampler::Resampler(const int& input_rate, const int& output_rate) : output(1, 0) {
   resample_ratio = static_cast<double>(output_rate) / static_cast<double>(input_rate);
@@ -26,8 +54,214 @@ Resampler::Resampler(const int& input_rate, const int& output_rate) : output(1,
   src_state = src_new(SRC_SINC_FASTEST, 1, nullptr);
 }
 
+Resampler::Resampler(const int& input_rate,
+                     const int& output_rate,
+                     const uint& channels,
+                     const uint& max_input_frames,
+                     const Quality& quality)
+    : n_channels(std::max(channels, 1U)), max_input_frames(max_input_frames) {
+  resample_ratio = static_cast<double>(output_rate) / static_cast<double>(input_rate);
+
+  // libsamplerate may give a few more frames than the ratio says in a single call
+
+  max_output_frames = static_cast<size_t>(std::ceil(1.5 * resample_ratio * static_cast<double>(max_input_frames))) + 2U;
+
+  if (quality == Quality::polyphase) {
+    init_polyphase(input_rate, output_rate);
+  }
+
+  if (!polyphase) {
+    int error = 0;
+
+    src_state = src_new(to_converter_type(quality), static_cast<int>(n_channels), &error);
+
+    if (src_state == nullptr) {
+      util::warning("failed to create the libsamplerate state: " + std::string(src_strerror(error)));
+    }
+  }
+
+  output.reserve(max_output_frames);
+
+  interleaved_in.resize(static_cast<size_t>(n_channels) * max_input_frames);
+  interleaved_out.resize(static_cast<size_t>(n_channels) * max_output_frames);
+}
+
 Resampler::~Resampler() {
   if (src_state != nullptr) {
     src_delete(src_state);
   }
 }
+
+void Resampler::init_polyphase(const int& input_rate, const int& output_rate) {
+  const auto d = std::gcd(input_rate, output_rate);
+
+  if (d <= 0) {
+    return;
+  }
+
+  const auto up = static_cast<uint>(output_rate / d);
+  const auto down = static_cast<uint>(input_rate / d);
+
+  if (up > max_polyphase_factor || down > max_polyphase_factor) {
+    util::debug("the ratio " + util::to_string(input_rate) + " -> " + util::to_string(output_rate) +
+                " is not suited to the polyphase resampler. Using libsamplerate.");
+
+    return;
+  }
+
+  up_factor = up;
+  down_factor = down;
+
+  /*
+    Windowed sinc lowpass designed at the upsampled rate. The cutoff is placed a little below the lowest Nyquist
+    frequency. The gain compensates the zeros inserted by the upsampling.
+  */
+
+  const size_t length = static_cast<size_t>(taps_per_phase) * up_factor;
+
+  const double cutoff = 0.5 * 0.92 / static_cast<double>(std::max(up_factor, down_factor));
+
+  const double center = 0.5 * static_cast<double>(length - 1U);
+
+  coefficients.resize(length);
+
+  for (size_t n = 0U; n < length; n++) {
+    const double x = static_cast<double>(n) - center;
+
+    const double sinc = (x == 0.0) ? 2.0 * cutoff : std::sin(2.0 * std::numbers::pi * cutoff * x) / (std::numbers::pi * x);
+
+    // Blackman-Harris window
+
+    const double w = 2.0 * std::numbers::pi * static_cast<double>(n) / static_cast<double>(length - 1U);
+
+    const double window = 0.35875 - 0.48829 * std::cos(w) + 0.14128 * std::cos(2.0 * w) - 0.01168 * std::cos(3.0 * w);
+
+    // The coefficients of each phase are stored contiguously
+
+    const size_t p = n % up_factor;
+    const size_t k = n / up_factor;
+
+    coefficients[p * taps_per_phase + k] = static_cast<float>(static_cast<double>(up_factor) * sinc * window);
+  }
+
+  /*
+    Room for two blocks. A call whose output is too short to take all the input keeps the rest for the next call, and
+    that call still has space for a whole new block.
+  */
+
+  history.resize(static_cast<size_t>(n_channels) * (taps_per_phase - 1U + 2U * max_input_frames));
+
+  n_buffered = taps_per_phase - 1U;
+
+  position = taps_per_phase - 1U;
+
+  phase = 0U;
+
+  polyphase = true;
+}
+
+auto Resampler::process_polyphase(const float* input, const size_t& n_frames, float* out, const size_t& out_capacity)
+    -> size_t {
+  const size_t n_history = taps_per_phase - 1U;
+
+  const size_t n_free = history.size() / n_channels - n_buffered;
+
+  // The input is only dropped if the caller kept giving outputs shorter than get_max_output_frames()
+
+  assert(n_frames <= n_free);
+
+  const size_t n_input = std::min(n_frames, n_free);
+
+  const size_t total = n_buffered + n_input;
+
+  std::copy_n(input, n_input * n_channels, history.begin() + static_cast<long>(n_buffered * n_channels));
+
+  size_t n_out = 0U;
+
+  while (position < total && n_out < out_capacity) {
+    const float* h = coefficients.data() + static_cast<size_t>(phase) * taps_per_phase;
+
+    for (uint c = 0U; c < n_channels; c++) {
+      float sum = 0.0F;
+
+      for (uint k = 0U; k < taps_per_phase; k++) {
+        sum += h[k] * history[(position - k) * n_channels + c];
+      }
+
+      out[n_out * n_channels + c] = sum;
+    }
+
+    n_out++;
+
+    phase += down_factor;
+    position += phase / up_factor;
+    phase %= up_factor;
+  }
+
+  /*
+    Keeping the samples the next output needs. When the output was full before the input ran out this is more than
+    the filter history, and the unused input is processed by the next call.
+  */
+
+  const size_t first = std::min(position, total) - n_history;
+
+  std::copy(history.begin() + static_cast<long>(first * n_channels),
+            history.begin() + static_cast<long>(total * n_channels), history.begin());
+
+  n_buffered = total - first;
+
+  position -= first;
+
+  return n_out;
+}
+
+auto Resampler::process_interleaved(std::span<const float> input, std::span<float> output) -> size_t {
+  const size_t n_frames = std::min(input.size() / n_channels, max_input_frames);
+
+  const size_t out_capacity = std::min(output.size() / n_channels, max_output_frames);
+
+  if (polyphase) {
+    return process_polyphase(input.data(), n_frames, output.data(), out_capacity);
+  }
+
+  if (src_state == nullptr) {
+    return 0U;
+  }
+
+  src_data.input_frames = static_cast<long>(n_frames);
+  src_data.data_in = input.data();
+  src_data.output_frames = static_cast<long>(out_capacity);
+  src_data.data_out = output.data();
+  src_data.src_ratio = resample_ratio;
+  src_data.end_of_input = 0;
+
+  src_process(src_state, &src_data);
+
+  return static_cast<size_t>(src_data.output_frames_gen);
+}
+
+auto Resampler::process(std::span<const float> left_in,
+                        std::span<const float> right_in,
+                        std::span<float> left_out,
+                        std::span<float> right_out) -> size_t {
+  if (n_channels != 2U) {
+    return 0U;
+  }
+
+  const size_t n_frames = std::min({left_in.size(), right_in.size(), max_input_frames});
+
+  for (size_t n = 0U; n < n_frames; n++) {
+    interleaved_in[2U * n] = left_in[n];
+    interleaved_in[2U * n + 1U] = right_in[n];
+  }
+
+  const size_t n_out = std::min({process_interleaved(std::span(interleaved_in).first(2U * n_frames), interleaved_out),
+                                 left_out.size(), right_out.size()});
+
+  for (size_t n = 0U; n < n_out; n++) {
+    left_out[n] = interleaved_out[2U * n];
+    right_out[n] = interleaved_out[2U * n + 1U];
+  }
+
+  return n_out;
+}
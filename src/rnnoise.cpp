@@ -26,17 +26,21 @@
 #endif
 #include <sys/types.h>
 #include <algorithm>
+#include <climits>
 #include <cmath>
+#include <cstddef>
 #include <cstdio>
 #include <memory>
-#include <mutex>
 #include <span>
 #include <string>
+#include <utility>
+#include "block_adapter.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "resampler.hpp"
 #include "tags_plugin_name.hpp"
 #include "tags_resources.hpp"
+#include "telemetry.hpp"
 #include "util.hpp"
 
 RNNoise::RNNoise(const std::string& tag,
@@ -52,12 +56,8 @@ RNNoise::RNNoise(const std::string& tag,
                  pipe_manager,
                  pipe_type),
       enable_vad(g_settings_get_boolean(settings, "enable-vad")),
-      vad_thres(g_settings_get_double(settings, "vad-thres") / 100.0F),
-      data_L(0),
-      data_R(0) {
-  data_L.reserve(blocksize);
-  data_R.reserve(blocksize);
-  data_tmp.reserve(blocksize);
+      vad_thres(g_settings_get_double(settings, "vad-thres") / 100.0F) {
+  data_tmp.resize(blocksize);
 
   // Initialize directories for local and community models
   local_dir_rnnoise = std::string{g_get_user_config_dir()} + "/easyeffects/rnnoise";
@@ -84,24 +84,7 @@ RNNoise::RNNoise(const std::string& tag,
                                           G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
                                             auto* self = static_cast<RNNoise*>(user_data);
 
-                                            self->data_mutex.lock();
-
-                                            self->rnnoise_ready = false;
-
-                                            self->data_mutex.unlock();
-
-#ifdef ENABLE_RNNOISE
-                                            self->free_rnnoise();
-
-                                            auto* m = self->get_model_from_name();
-
-                                            self->model = m;
-
-                                            self->state_left = rnnoise_create(self->model);
-                                            self->state_right = rnnoise_create(self->model);
-
-                                            self->rnnoise_ready = true;
-#endif
+                                            self->schedule_rebuild();
                                           }),
                                           this));
 
@@ -141,19 +124,10 @@ RNNoise::RNNoise(const std::string& tag,
                    }),
                    this);
 
-  auto* m = get_model_from_name();
-
-  model = m;
-
-  state_left = rnnoise_create(model);
-  state_right = rnnoise_create(model);
-
   vad_prob_left = 1.0F;
   vad_prob_right = 1.0F;
   vad_grace_left = release;
   vad_grace_right = release;
-
-  rnnoise_ready = true;
 #else
   util::warning("The RNNoise library was not available at compilation time. The noise reduction filter won't work");
 
@@ -166,129 +140,86 @@ RNNoise::~RNNoise() {
     disconnect_from_pw();
   }
 
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  resampler_ready = false;
-
-#ifdef ENABLE_RNNOISE
-  free_rnnoise();
-#endif
-
   util::debug(log_tag + name + " destroyed");
 }
 
 void RNNoise::setup() {
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  resampler_ready = false;
-
-  latency_n_frames = 0U;
-
   resample = rate != rnnoise_rate;
+}
 
-  data_L.resize(0U);
-  data_R.resize(0U);
-
-  deque_out_L.resize(0U);
-  deque_out_R.resize(0U);
-
-  resampler_inL = std::make_unique<Resampler>(rate, rnnoise_rate);
-  resampler_inR = std::make_unique<Resampler>(rate, rnnoise_rate);
+void RNNoise::setup_engine(const uint& n_samples, const uint& rate) {
+  init_engine(n_samples, rate);
+}
 
-  resampler_outL = std::make_unique<Resampler>(rnnoise_rate, rate);
-  resampler_outR = std::make_unique<Resampler>(rnnoise_rate, rate);
+auto RNNoise::is_ready() -> bool {
+#ifdef ENABLE_RNNOISE
+  const auto* e = engine.peek();
 
-  resampler_ready = true;
+  return e != nullptr && e->n_samples == n_samples && e->rate == rate;
+#else
+  return true;
+#endif
 }
 
 void RNNoise::process(std::span<float>& left_in,
                       std::span<float>& right_in,
                       std::span<float>& left_out,
                       std::span<float>& right_out) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  const auto e = engine.read();
 
-  if (bypass || !rnnoise_ready) {
+  if (bypass || !e || e->n_samples != n_samples || e->rate != rate) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
     return;
   }
 
+  if (e.generation() != engine_generation) {
+    latency_n_frames = e->adapter.get_latency_frames();
+
+    notify_latency = true;
+
+    engine_generation = e.generation();
+  }
+
   if (input_gain != 1.0F) {
     apply_gain(left_in, right_in, input_gain);
   }
 
-  if (resample) {
-    if (resampler_ready) {
-      const auto resampled_inL = resampler_inL->process(left_in, false);
-      const auto resampled_inR = resampler_inR->process(right_in, false);
-
-      resampled_data_L.resize(0U);
-      resampled_data_R.resize(0U);
-
 #ifdef ENABLE_RNNOISE
-      remove_noise(resampled_inL, resampled_inR, resampled_data_L, resampled_data_R);
-#endif
+  const auto denoise = [&](std::span<float> block_L, std::span<float> block_R) {
+    remove_noise(e->state_left, block_L, vad_prob_left, vad_grace_left);
+    remove_noise(e->state_right, block_R, vad_prob_right, vad_grace_right);
+  };
 
-      auto resampled_outL = resampler_outL->process(resampled_data_L, false);
-      auto resampled_outR = resampler_outR->process(resampled_data_R, false);
+  if (resample) {
+    const auto n_resampled = e->resampler_in->process(left_in, right_in, e->resampled_L, e->resampled_R);
 
-      for (const auto& v : resampled_outL) {
-        deque_out_L.push_back(v);
-      }
+    e->adapter.push(std::span(e->resampled_L).first(n_resampled), std::span(e->resampled_R).first(n_resampled),
+                    denoise);
 
-      for (const auto& v : resampled_outR) {
-        deque_out_R.push_back(v);
-      }
-    } else {
-      for (const auto& v : left_in) {
-        deque_out_L.push_back(v);
-      }
-
-      for (const auto& v : right_in) {
-        deque_out_R.push_back(v);
-      }
-    }
-  } else {
-#ifdef ENABLE_RNNOISE
-    remove_noise(left_in, right_in, deque_out_L, deque_out_R);
-#endif
-  }
+    const auto denoised_L = std::span(e->denoised_L).first(std::min(e->adapter.available(), e->denoised_L.size()));
+    const auto denoised_R = std::span(e->denoised_R).first(denoised_L.size());
 
-  if (deque_out_L.size() >= left_out.size()) {
-    for (float& v : left_out) {
-      v = deque_out_L.front();
+    e->adapter.pull(denoised_L, denoised_R);
 
-      deque_out_L.pop_front();
-    }
+    const auto n_out = e->resampler_out->process(denoised_L, denoised_R, e->output_L, e->output_R);
 
-    for (float& v : right_out) {
-      v = deque_out_R.front();
+    e->fifo_out_L.push(std::span(e->output_L).first(n_out));
+    e->fifo_out_R.push(std::span(e->output_R).first(n_out));
 
-      deque_out_R.pop_front();
-    }
-  } else {
-    const uint offset = 2U * (left_out.size() - deque_out_L.size());
+    e->fifo_out_R.pop_or_pad(right_out);
 
-    if (offset != latency_n_frames) {
+    if (const auto offset = static_cast<uint>(e->fifo_out_L.pop_or_pad(left_out));
+        offset != 0U && offset != latency_n_frames) {
       latency_n_frames = offset;
 
       notify_latency = true;
     }
-
-    for (uint n = 0U; !deque_out_L.empty() && n < left_out.size(); n++) {
-      if (n < offset) {
-        left_out[n] = 0.0F;
-        right_out[n] = 0.0F;
-      } else {
-        left_out[n] = deque_out_L.front();
-        right_out[n] = deque_out_R.front();
-
-        deque_out_R.pop_front();
-        deque_out_L.pop_front();
-      }
-    }
+  } else {
+    e->adapter.process(left_in, right_in, left_out, right_out, denoise);
   }
+#endif
 
   if (output_gain != 1.0F) {
     apply_gain(left_out, right_out, output_gain);
@@ -297,17 +228,7 @@ void RNNoise::process(std::span<float>& left_in,
   if (notify_latency) {
     latency_value = static_cast<float>(latency_n_frames) / static_cast<float>(rate);
 
-    util::debug(log_tag + name + " latency: " + util::to_string(latency_value, "") + " s");
-
-    util::idle_add([this]() {
-      if (!post_messages || latency.empty()) {
-        return;
-      }
-
-      latency.emit();
-    });
-
-    update_filter_params();
+    post_latency();
 
     notify_latency = false;
   }
@@ -403,9 +324,101 @@ auto RNNoise::get_model_from_name() -> RNNModel* {
   return m;
 }
 
-void RNNoise::free_rnnoise() {
-  rnnoise_ready = false;
+#endif
+
+void RNNoise::init_engine(const uint& n_samples, const uint& rate) {
+#ifdef ENABLE_RNNOISE
+  if (n_samples == 0U || rate == 0U) {
+    return;
+  }
+
+  /*
+    Loading a model reads a file and allocates the denoise states. So the whole engine is built here in the main thread
+    and then published to the realtime thread.
+  */
+
+  auto new_engine = std::make_unique<Engine>();
+
+  new_engine->n_samples = n_samples;
+  new_engine->rate = rate;
+
+  if (rate == rnnoise_rate) {
+    new_engine->adapter.setup(blocksize, n_samples);
+  } else {
+    // The resampled quantum changes in size. So there is no priming and the output FIFO absorbs the jitter.
+
+    new_engine->resampler_in =
+        std::make_unique<Resampler>(rate, rnnoise_rate, 2U, n_samples, Resampler::Quality::polyphase);
+
+    const auto max_resampled = static_cast<uint>(new_engine->resampler_in->get_max_output_frames());
+
+    new_engine->resampler_out =
+        std::make_unique<Resampler>(rnnoise_rate, rate, 2U, max_resampled + blocksize, Resampler::Quality::polyphase);
+
+    new_engine->adapter.setup(blocksize, 0U, max_resampled);
+
+    new_engine->resampled_L.resize(max_resampled);
+    new_engine->resampled_R.resize(max_resampled);
+
+    new_engine->denoised_L.resize(max_resampled + blocksize);
+    new_engine->denoised_R.resize(max_resampled + blocksize);
+
+    new_engine->output_L.resize(new_engine->resampler_out->get_max_output_frames());
+    new_engine->output_R.resize(new_engine->resampler_out->get_max_output_frames());
+
+    const auto fifo_size = 4U * (static_cast<size_t>(n_samples) + blocksize);
+
+    new_engine->fifo_out_L.resize(fifo_size);
+    new_engine->fifo_out_R.resize(fifo_size);
+  }
+
+  new_engine->model = get_model_from_name();
+
+  new_engine->state_left = rnnoise_create(new_engine->model);
+  new_engine->state_right = rnnoise_create(new_engine->model);
+
+  engine.publish(std::move(new_engine));
+#endif
+}
+
+#ifdef ENABLE_RNNOISE
+
+void RNNoise::remove_noise(DenoiseState* state, std::span<float> data, float& vad_prob, int& vad_grace) {
+  if (state == nullptr) {
+    return;
+  }
+
+  std::ranges::for_each(data, [](auto& v) { v *= static_cast<float>(SHRT_MAX + 1); });
+
+  std::ranges::copy(data, data_tmp.begin());
+
+  vad_prob = rnnoise_process_frame(state, data.data(), data.data());
+
+  if (enable_vad) {
+    if (vad_prob >= vad_thres) {
+      vad_grace = release;
+    }
+
+    if (vad_grace < 0) {
+      std::ranges::fill(data, 0.0F);
+
+      return;
+    }
+
+    --vad_grace;
+  }
+
+  for (size_t i = 0U; i < data.size(); i++) {
+    data[i] = data[i] * wet_ratio + data_tmp[i] * (1.0F - wet_ratio);
+
+    data[i] *= inv_short_max;
+  }
+}
+
+#endif
 
+RNNoise::Engine::~Engine() {
+#ifdef ENABLE_RNNOISE
   if (state_left != nullptr) {
     rnnoise_destroy(state_left);
   }
@@ -417,13 +430,8 @@ void RNNoise::free_rnnoise() {
   if (model != nullptr) {
     rnnoise_model_free(model);
   }
-
-  state_left = nullptr;
-  state_right = nullptr;
-  model = nullptr;
-}
-
 #endif
+}
 
 auto RNNoise::get_latency_seconds() -> float {
   return latency_value;
@@ -446,3 +454,7 @@ void RNNoise::init_release() {
 
 #endif
 }
+
+void RNNoise::rebuild() {
+  init_engine(n_samples, rate);
+}
@@ -24,14 +24,15 @@
 #include <glib.h>
 #include <sys/types.h>
 #include <algorithm>
-#include <cassert>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
-#include <cstring>
-#include <mutex>
+#include <cstdint>
 #include <numbers>
 #include <span>
 #include <string>
+#include <vector>
+#include "fft_plans.hpp"
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
@@ -42,19 +43,17 @@ Spectrum::Spectrum(const std::string& tag,
                    const std::string& schema_path,
                    PipeManager* pipe_manager,
                    PipelineType pipe_type)
-    : PluginBase(tag, "spectrum", tags::plugin_package::ee, schema, schema_path, pipe_manager, pipe_type),
-      fftw_ready(true) {
-  // Precompute the Hann window, which is an expensive operation.
-  // https://en.wikipedia.org/wiki/Hann_function
-  for (size_t n = 0; n < n_bands; n++) {
-    hann_window[n] =
-        0.5F *
-        (1.0F - std::cos(2.0F * std::numbers::pi_v<float> * static_cast<float>(n) / static_cast<float>(n_bands - 1)));
-  }
+    : PluginBase(tag, "spectrum", tags::plugin_package::ee, schema, schema_path, pipe_manager, pipe_type) {
+  uint size = 8192U;
+
+  util::str_to_num(util::gsettings_get_string(settings, "fft-size"), size);
 
-  complex_output = fftwf_alloc_complex(n_bands);
+  log_binning = g_settings_get_boolean(settings, "log-binning") != 0;
 
-  plan = fftwf_plan_dft_r2c_1d(static_cast<int>(n_bands), real_input.data(), complex_output, FFTW_ESTIMATE);
+  init_fft(size);
+
+  left_delayed_vector.reserve(max_quantum);
+  right_delayed_vector.reserve(max_quantum);
 
   lv2_wrapper = std::make_unique<lv2::Lv2Wrapper>("http://lsp-plug.in/plugins/lv2/comp_delay_x2_stereo");
 
@@ -84,6 +83,38 @@ Spectrum::Spectrum(const std::string& tag,
                      self->bypass = g_settings_get_boolean(settings, key) == 0;
                    }),
                    this);
+
+  // the analysis runs in the GUI thread, so its settings can be applied right away
+
+  gconnections.push_back(g_signal_connect(settings, "changed::fft-size",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
+                                            auto* self = static_cast<Spectrum*>(user_data);
+
+                                            uint size = 8192U;
+
+                                            util::str_to_num(util::gsettings_get_string(settings, key), size);
+
+                                            self->init_fft(size);
+                                          }),
+                                          this));
+
+  gconnections.push_back(g_signal_connect(settings, "changed::overlap",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
+                                            auto* self = static_cast<Spectrum*>(user_data);
+
+                                            self->update_hop(g_settings_get_int(settings, key));
+                                          }),
+                                          this));
+
+  gconnections.push_back(g_signal_connect(settings, "changed::log-binning",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
+                                            auto* self = static_cast<Spectrum*>(user_data);
+
+                                            self->log_binning = g_settings_get_boolean(settings, key) != 0;
+
+                                            self->map_fft_size = 0U;
+                                          }),
+                                          this));
 }
 
 Spectrum::~Spectrum() {
@@ -91,37 +122,51 @@ Spectrum::~Spectrum() {
     disconnect_from_pw();
   }
 
-  fftw_ready = false;
+  fftwf_free(real_input);
+  fftwf_free(complex_output);
+
+  util::debug(log_tag + name + " destroyed");
+}
+
+void Spectrum::init_fft(const uint& size) {
+  fftwf_free(real_input);
+  fftwf_free(complex_output);
+
+  fft_size = std::clamp(size, 1024U, max_fft_size);
+
+  real_input = fftwf_alloc_real(fft_size);
+  complex_output = fftwf_alloc_complex(fft_size / 2U + 1U);
+
+  plan = fft_plans::r2c(fft_size, real_input, complex_output);
 
-  if (complex_output != nullptr) {
-    fftwf_free(complex_output);
+  // Precompute the Hann window, which is an expensive operation.
+  // https://en.wikipedia.org/wiki/Hann_function
+
+  hann_window.resize(fft_size);
+
+  for (size_t n = 0; n < fft_size; n++) {
+    hann_window[n] =
+        0.5F *
+        (1.0F - std::cos(2.0F * std::numbers::pi_v<float> * static_cast<float>(n) / static_cast<float>(fft_size - 1)));
   }
 
-  fftwf_destroy_plan(plan);
+  power.resize(fft_size / 2U + 1U);
 
-  util::debug(log_tag + name + " destroyed");
+  map_fft_size = 0U;
+
+  update_hop(g_settings_get_int(settings, "overlap"));
 }
 
-void Spectrum::setup() {
-  std::ranges::fill(real_input, 0.0F);
-  std::ranges::fill(latest_samples_mono, 0.0F);
+void Spectrum::update_hop(const int& overlap) {
+  hop = std::max(1U, fft_size * static_cast<uint>(100 - overlap) / 100U);
+}
 
+void Spectrum::setup() {
   left_delayed_vector.resize(n_samples, 0.0F);
   right_delayed_vector.resize(n_samples, 0.0F);
 
   left_delayed = std::span<float>(left_delayed_vector);
   right_delayed = std::span<float>(right_delayed_vector);
-
-  lv2_wrapper->set_n_samples(n_samples);
-
-  if (!lv2_wrapper->found_plugin) {
-    return;
-  }
-
-  if (lv2_wrapper->get_rate() != rate) {
-    util::debug(log_tag + " creating instance of comp delay x2 stereo for spectrum A/V sync");
-    lv2_wrapper->create_instance(rate);
-  }
 }
 
 void Spectrum::process(std::span<float>& left_in,
@@ -131,140 +176,158 @@ void Spectrum::process(std::span<float>& left_in,
   std::copy(left_in.begin(), left_in.end(), left_out.begin());
   std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
-  if (bypass || !fftw_ready) {
+  if (bypass) {
     return;
   }
 
+  std::span<float> left = left_in;
+  std::span<float> right = right_in;
+
   // delay the visualization of the spectrum by the reported latency
   // of the output device, so that the spectrum is visually in sync
   // with the audio as experienced by the user. (A/V sync)
-  if (lv2_wrapper->found_plugin && lv2_wrapper->has_instance()) {
+  if (lv2_wrapper->found_plugin && lv2_ready) {
     lv2_wrapper->connect_data_ports(left_in, right_in, left_delayed, right_delayed);
     lv2_wrapper->run();
 
-    // Downmix the latest n_bands samples from the delayed signal.
-    if (n_samples < n_bands) {
-      // Drop the oldest quantum.
-      std::memmove(&latest_samples_mono[0], &latest_samples_mono[n_samples], (n_bands - n_samples) * sizeof(float));
+    left = left_delayed;
+    right = right_delayed;
+  }
 
-      // Copy the new quantum.
-      for (size_t n = 0; n < n_samples; n++) {
-        latest_samples_mono[n_bands - n_samples + n] = 0.5F * (left_delayed[n] + right_delayed[n]);
-      }
-    } else {
-      // Copy the latest n_bands samples.
-      for (size_t n = 0; n < n_bands; n++)
-        latest_samples_mono[n] =
-            0.5F * (left_delayed[n_samples - n_bands + n] + right_delayed[n_samples - n_bands + n]);
+  /*
+    The downmixed samples go to a ring buffer that is twice as large as the largest FFT. The GUI thread copies the
+    latest window from it whenever it wants and checks afterwards that we did not overwrite the part it was reading.
+    Neither side waits for the other and no data has to be moved.
+  */
+
+  const auto written = ring_written.load(std::memory_order_relaxed);
+
+  // announcing the block before overwriting it. The fence keeps the sample stores after this one.
+
+  ring_claimed.store(written + n_samples, std::memory_order_relaxed);
+
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (size_t n = 0; n < n_samples; n++) {
+    ring[(written + n) & (ring_size - 1U)].store(0.5F * (left[n] + right[n]), std::memory_order_relaxed);
+  }
+
+  ring_written.store(written + n_samples, std::memory_order_release);
+}
+
+void Spectrum::set_display_axis(const std::vector<double>& frequencies) {
+  display_axis = frequencies;
+
+  map_rate = 0U;
+}
+
+void Spectrum::build_display_map(const uint& sampling_rate) {
+  const auto n_bins = fft_size / 2U + 1U;
+
+  const auto bin_width = static_cast<double>(sampling_rate) / static_cast<double>(fft_size);
+
+  display_map.resize(display_axis.size());
+
+  for (size_t n = 0U; n < display_axis.size(); n++) {
+    auto& point = display_map[n];
+
+    const auto f = display_axis[n];
+
+    const auto position = std::clamp(f / bin_width, 0.0, static_cast<double>(n_bins - 2U));
+
+    point.first = static_cast<uint>(position);
+    point.last = point.first + 1U;
+    point.fraction = static_cast<float>(position - static_cast<double>(point.first));
+    point.band = false;
+
+    if (!log_binning || display_axis.size() < 2U) {
+      continue;
     }
-  } else {
-    // Downmix the latest n_bands samples from the non-delayed signal.
-    if (n_samples < n_bands) {
-      // Drop the oldest quantum.
-      std::memmove(&latest_samples_mono[0], &latest_samples_mono[n_samples], (n_bands - n_samples) * sizeof(float));
-
-      // Copy the new quantum.
-      for (size_t n = 0; n < n_samples; n++) {
-        latest_samples_mono[n_bands - n_samples + n] = 0.5F * (left_in[n] + right_in[n]);
-      }
-    } else {
-      // Copy the latest n_bands samples.
-      for (size_t n = 0; n < n_bands; n++)
-        latest_samples_mono[n] = 0.5F * (left_in[n_samples - n_bands + n] + right_in[n_samples - n_bands + n]);
+
+    // the band edges are the geometric means between neighboring points
+
+    const auto lower = (n > 0U) ? std::sqrt(display_axis[n - 1U] * f) : f * std::sqrt(f / display_axis[n + 1U]);
+
+    const auto upper = (n + 1U < display_axis.size()) ? std::sqrt(f * display_axis[n + 1U])
+                                                       : f * std::sqrt(f / display_axis[n - 1U]);
+
+    const auto first_bin = static_cast<uint>(std::ceil(lower / bin_width));
+    const auto last_bin = std::min(static_cast<uint>(std::floor(upper / bin_width)), n_bins - 1U);
+
+    // where the bins are sparser than the points interpolating gives a smoother curve
+
+    if (last_bin > first_bin) {
+      point.first = first_bin;
+      point.last = last_bin;
+      point.band = true;
     }
   }
 
-  /*
-   * OK, we have the latest_samples_mono array that contains n_bands samples. We
-   * want to export it to the GUI thread. We don't wakeup the GUI thread from
-   * realtime, we only want to update the buffer and let the GUI thread follow
-   * its scheduling and have access to our new buffer. We accept losing old data.
-   *
-   * For that, we want to synchronise both threads. Realtime shouldn't have to
-   * wait (ie loop or syscall). It is fine if GUI waits a little.
-   *
-   * The overall concept is to use two buffers. When realtime comes in, it
-   * writes into one. When GUI arrives, it waits for realtime to be done
-   * writing (if it is busy) and it switches the active buffer to become the
-   * other one. As GUI is the one doing the toggle, it knows it can read at its
-   * pace the inactive buffer. Realtime will always have a buffer to write
-   * into, and it is fine if it overwrites data.
-   *
-   * We use an atomic integer (db_control) that contains three bits:
-   *  - DB_BIT_IDX: the current buffer index.
-   *  - DB_BIT_NEWDATA: indicates if realtime wrote new data.
-   *  - DB_BIT_BUSY: indicates if realtime is currently busy writing data.
-   *
-   * Realtime does this:
-   *  - Grab db_control and enable its BUSY bit.
-   *  - Write data into the correct buffer based on the IDX bit.
-   *  - Write db_control with same index as before, BUSY bit disabled and
-   *    NEWDATA bit enabled.
-   *
-   * GUI does this:
-   *  - Early return if NEWDATA is not enabled. It means realtime hasn't ran
-   *    since the last time GUI ran.
-   *  - Then it tries toggling the IDX bit. "Tries" because the operation fails
-   *    as long as the BUSY bit is active.
-   *  - From now on it can read the previous buffer knowing realtime cannot be
-   *    writing into it.
-   *
-   * This is single-producer single-consumer double-buffering. The
-   * implementation is inspired from the "Real-time 101" ADC19 talk
-   * (David Rowland & Fabian Renn-Giles).
-   *
-   * Talk part 1 & 2, slides (page 74 onwards) and illustrating library:
-   * https://www.youtube.com/watch?v=Q0vrQFyAdWI
-   * https://www.youtube.com/watch?v=PoZAo2Vikbo
-   * https://github.com/drowaudio/presentations/blob/master/ADC%202019%20-%20Real-time%20101/Real-time%20101.pdf
-   * https://github.com/hogliux/farbot
-   */
-
-  // Grab the current index AND mark as busy at the same time.
-  int index = db_control.fetch_or(DB_BIT_BUSY) & DB_BIT_IDX;
-
-  // Fill the buffer.
-  db_buffers[index] = latest_samples_mono;
-
-  // Mark new data available AND mark as not busy anymore.
-  db_control.store(index | DB_BIT_NEWDATA);
+  map_rate = sampling_rate;
+  map_fft_size = fft_size;
 }
 
-std::tuple<uint, uint, double*> Spectrum::compute_magnitudes() {
-  // Early return if no new data is available, ie if process() has not been
-  // called since our last compute_magnitudes() call.
-  int curr_control = db_control.load();
-  if (!(curr_control & DB_BIT_NEWDATA)) {
-    return std::tuple<uint, uint, double*>(0, 0, nullptr);
+auto Spectrum::compute_magnitudes(std::vector<double>& magnitudes) -> bool {
+  const auto sampling_rate = rate;
+
+  const auto written = ring_written.load(std::memory_order_acquire);
+
+  if (sampling_rate == 0U || written < fft_size || written - last_analyzed < hop) {
+    return false;
   }
 
-  // CAS loop to toggle the buffer used and remove NEWDATA flag, waiting for !BUSY.
-  int next_control;
-  do {
-    curr_control &= ~DB_BIT_BUSY;
-    next_control = (curr_control ^ DB_BIT_IDX) & DB_BIT_IDX;
-  } while (!db_control.compare_exchange_weak(curr_control, next_control));
+  const auto start = written - fft_size;
 
-  // Buffer with data is at the index which was found inside db_control.
-  int index = curr_control & DB_BIT_IDX;
-  float* buf = db_buffers[index].data();
+  for (size_t n = 0; n < fft_size; n++) {
+    real_input[n] = ring[(start + n) & (ring_size - 1U)].load(std::memory_order_relaxed) * hann_window[n];
+  }
 
-  // https://en.wikipedia.org/wiki/Hann_function
-  for (size_t n = 0; n < n_bands; n++) {
-    real_input[n] = buf[n] * hann_window[n];
+  /*
+    The fence keeps the relaxed sample loads above before the check. If any of them saw a sample of a newer block,
+    the check sees the claim made for that block.
+  */
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  if (ring_claimed.load(std::memory_order_relaxed) - start > ring_size) {
+    return false;  // the processing thread overwrote the beginning of our window
   }
 
-  fftwf_execute(plan);
+  last_analyzed = written;
+
+  fftwf_execute_dft_r2c(plan, real_input, complex_output);
 
-  for (uint i = 0U; i < output.size(); i++) {
-    float sqr = complex_output[i][0] * complex_output[i][0] + complex_output[i][1] * complex_output[i][1];
+  const auto norm = static_cast<float>(power.size() * power.size());
 
-    sqr /= static_cast<float>(output.size() * output.size());
+  for (size_t i = 0U; i < power.size(); i++) {
+    const auto sqr = complex_output[i][0] * complex_output[i][0] + complex_output[i][1] * complex_output[i][1];
 
-    output[i] = static_cast<double>(sqr);
+    power[i] = static_cast<double>(sqr / norm);
+  }
+
+  if (map_rate != sampling_rate || map_fft_size != fft_size) {
+    build_display_map(sampling_rate);
+  }
+
+  magnitudes.resize(display_map.size());
+
+  for (size_t n = 0U; n < display_map.size(); n++) {
+    const auto& point = display_map[n];
+
+    if (point.band) {
+      double sum = 0.0;
+
+      for (uint i = point.first; i <= point.last; i++) {
+        sum += power[i];
+      }
+
+      magnitudes[n] = sum / static_cast<double>(point.last - point.first + 1U);
+    } else {
+      magnitudes[n] = (1.0 - point.fraction) * power[point.first] + point.fraction * power[point.last];
+    }
   }
 
-  return std::tuple<uint, uint, double*>(rate, output.size(), output.data());
+  return true;
 }
 
 auto Spectrum::get_latency_seconds() -> float {
@@ -25,9 +25,10 @@
 #include <algorithm>
 #include <climits>
 #include <cstddef>
-#include <mutex>
+#include <memory>
 #include <span>
 #include <string>
+#include <utility>
 #include "pipe_manager.hpp"
 #include "plugin_base.hpp"
 #include "tags_plugin_name.hpp"
@@ -52,117 +53,63 @@ Speex::Speex(const std::string& tag,
       vad_probability_start(g_settings_get_int(settings, "vad-probability-start")),
       vad_probability_continue(g_settings_get_int(settings, "vad-probability-continue")),
       enable_dereverb(g_settings_get_boolean(settings, "enable-dereverb")) {
-  gconnections.push_back(g_signal_connect(
-      settings, "changed::enable-denoise", G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
-        std::scoped_lock<std::mutex> lock(self->data_mutex);
+  publish_params();
 
-        self->enable_denoise = g_settings_get_boolean(settings, key);
+  gconnections.push_back(g_signal_connect(settings, "changed::enable-denoise",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
+                                            self->enable_denoise = g_settings_get_boolean(settings, key);
 
-        if (self->state_left) {
-          speex_preprocess_ctl(self->state_left, SPEEX_PREPROCESS_SET_DENOISE, &self->enable_denoise);
-        }
+                                            self->publish_params();
+                                          }),
+                                          this));
 
-        if (self->state_right) {
-          speex_preprocess_ctl(self->state_right, SPEEX_PREPROCESS_SET_DENOISE, &self->enable_denoise);
-        }
-      }),
-      this));
+  gconnections.push_back(g_signal_connect(settings, "changed::noise-suppression",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
+                                            self->noise_suppression = g_settings_get_int(settings, key);
 
-  gconnections.push_back(g_signal_connect(
-      settings, "changed::noise-suppression", G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
-        std::scoped_lock<std::mutex> lock(self->data_mutex);
+                                            self->publish_params();
+                                          }),
+                                          this));
 
-        self->noise_suppression = g_settings_get_int(settings, key);
+  gconnections.push_back(g_signal_connect(settings, "changed::enable-agc",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
+                                            self->enable_agc = g_settings_get_boolean(settings, key);
 
-        if (self->state_left) {
-          speex_preprocess_ctl(self->state_left, SPEEX_PREPROCESS_SET_NOISE_SUPPRESS, &self->noise_suppression);
-        }
+                                            self->publish_params();
+                                          }),
+                                          this));
 
-        if (self->state_right) {
-          speex_preprocess_ctl(self->state_right, SPEEX_PREPROCESS_SET_NOISE_SUPPRESS, &self->noise_suppression);
-        }
-      }),
-      this));
+  gconnections.push_back(g_signal_connect(settings, "changed::enable-vad",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
+                                            self->enable_vad = g_settings_get_boolean(settings, key);
 
-  gconnections.push_back(
-      g_signal_connect(settings, "changed::enable-agc", G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
-                         std::scoped_lock<std::mutex> lock(self->data_mutex);
+                                            self->publish_params();
+                                          }),
+                                          this));
 
-                         self->enable_agc = g_settings_get_boolean(settings, key);
+  gconnections.push_back(g_signal_connect(settings, "changed::vad-probability-start",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
+                                            self->vad_probability_start = g_settings_get_int(settings, key);
 
-                         if (self->state_left) {
-                           speex_preprocess_ctl(self->state_left, SPEEX_PREPROCESS_SET_AGC, &self->enable_agc);
-                         }
+                                            self->publish_params();
+                                          }),
+                                          this));
 
-                         if (self->state_right) {
-                           speex_preprocess_ctl(self->state_right, SPEEX_PREPROCESS_SET_AGC, &self->enable_agc);
-                         }
-                       }),
-                       this));
+  gconnections.push_back(g_signal_connect(settings, "changed::vad-probability-continue",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
+                                            self->vad_probability_continue = g_settings_get_int(settings, key);
 
-  gconnections.push_back(
-      g_signal_connect(settings, "changed::enable-vad", G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
-                         std::scoped_lock<std::mutex> lock(self->data_mutex);
+                                            self->publish_params();
+                                          }),
+                                          this));
 
-                         self->enable_vad = g_settings_get_boolean(settings, key);
+  gconnections.push_back(g_signal_connect(settings, "changed::enable-dereverb",
+                                          G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
+                                            self->enable_dereverb = g_settings_get_boolean(settings, key);
 
-                         if (self->state_left) {
-                           speex_preprocess_ctl(self->state_left, SPEEX_PREPROCESS_SET_VAD, &self->enable_vad);
-                         }
-
-                         if (self->state_right) {
-                           speex_preprocess_ctl(self->state_right, SPEEX_PREPROCESS_SET_VAD, &self->enable_vad);
-                         }
-                       }),
-                       this));
-
-  gconnections.push_back(g_signal_connect(
-      settings, "changed::vad-probability-start", G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
-        std::scoped_lock<std::mutex> lock(self->data_mutex);
-
-        self->vad_probability_start = g_settings_get_int(settings, key);
-
-        if (self->state_left) {
-          speex_preprocess_ctl(self->state_left, SPEEX_PREPROCESS_SET_PROB_START, &self->vad_probability_start);
-        }
-
-        if (self->state_right) {
-          speex_preprocess_ctl(self->state_right, SPEEX_PREPROCESS_SET_PROB_START, &self->vad_probability_start);
-        }
-      }),
-      this));
-
-  gconnections.push_back(g_signal_connect(
-      settings, "changed::vad-probability-continue", G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
-        std::scoped_lock<std::mutex> lock(self->data_mutex);
-
-        self->vad_probability_continue = g_settings_get_int(settings, key);
-
-        if (self->state_left) {
-          speex_preprocess_ctl(self->state_left, SPEEX_PREPROCESS_SET_PROB_CONTINUE, &self->vad_probability_continue);
-        }
-
-        if (self->state_right) {
-          speex_preprocess_ctl(self->state_right, SPEEX_PREPROCESS_SET_PROB_CONTINUE, &self->vad_probability_continue);
-        }
-      }),
-      this));
-
-  gconnections.push_back(g_signal_connect(
-      settings, "changed::enable-dereverb", G_CALLBACK(+[](GSettings* settings, char* key, Speex* self) {
-        std::scoped_lock<std::mutex> lock(self->data_mutex);
-
-        self->enable_dereverb = g_settings_get_boolean(settings, key);
-
-        if (self->state_left) {
-          speex_preprocess_ctl(self->state_left, SPEEX_PREPROCESS_SET_DEREVERB, &self->enable_dereverb);
-        }
-
-        if (self->state_right) {
-          speex_preprocess_ctl(self->state_right, SPEEX_PREPROCESS_SET_DEREVERB, &self->enable_dereverb);
-        }
-      }),
-      this));
+                                            self->publish_params();
+                                          }),
+                                          this));
 
   setup_input_output_gain();
 }
@@ -172,76 +119,97 @@ Speex::~Speex() {
     disconnect_from_pw();
   }
 
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
-  free_speex();
-
   util::debug(log_tag + name + " destroyed");
 }
 
 void Speex::setup() {
-  std::scoped_lock<std::mutex> lock(data_mutex);
-
   latency_n_frames = 0U;
+}
 
-  speex_ready = false;
+void Speex::setup_engine(const uint& n_samples, const uint& rate) {
+  /*
+    Creating the speex states allocates memory. So we do it in the main thread and let the realtime thread pick them
+    up once they are published.
+  */
 
-  data_L.resize(n_samples);
-  data_R.resize(n_samples);
+  auto new_engine = std::make_unique<Engine>();
 
-  if (state_left != nullptr) {
-    speex_preprocess_state_destroy(state_left);
-  }
+  new_engine->n_samples = n_samples;
+  new_engine->rate = rate;
 
-  if (state_right != nullptr) {
-    speex_preprocess_state_destroy(state_right);
-  }
+  new_engine->data_L.resize(n_samples);
+  new_engine->data_R.resize(n_samples);
 
-  state_left = speex_preprocess_state_init(static_cast<int>(n_samples), static_cast<int>(rate));
-  state_right = speex_preprocess_state_init(static_cast<int>(n_samples), static_cast<int>(rate));
+  new_engine->state_left = speex_preprocess_state_init(static_cast<int>(n_samples), static_cast<int>(rate));
+  new_engine->state_right = speex_preprocess_state_init(static_cast<int>(n_samples), static_cast<int>(rate));
 
-  if (state_left != nullptr) {
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_DENOISE, &enable_denoise);
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_NOISE_SUPPRESS, &noise_suppression);
+  if (new_engine->state_left == nullptr || new_engine->state_right == nullptr) {
+    util::warning(log_tag + name + " failed to create the speex preprocessor");
+
+    return;
+  }
 
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_AGC, &enable_agc);
+  engine.publish(std::move(new_engine));
+}
 
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_VAD, &enable_vad);
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_PROB_START, &vad_probability_start);
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_PROB_CONTINUE, &vad_probability_continue);
+void Speex::publish_params() {
+  params.publish(std::make_unique<Params>(Params{.enable_denoise = enable_denoise,
+                                                 .noise_suppression = noise_suppression,
+                                                 .enable_agc = enable_agc,
+                                                 .enable_vad = enable_vad,
+                                                 .vad_probability_start = vad_probability_start,
+                                                 .vad_probability_continue = vad_probability_continue,
+                                                 .enable_dereverb = enable_dereverb}));
+}
 
-    speex_preprocess_ctl(state_left, SPEEX_PREPROCESS_SET_DEREVERB, &enable_dereverb);
-  }
+void Speex::Engine::apply(Params& p) const {
+  for (auto* state : {state_left, state_right}) {
+    speex_preprocess_ctl(state, SPEEX_PREPROCESS_SET_DENOISE, &p.enable_denoise);
+    speex_preprocess_ctl(state, SPEEX_PREPROCESS_SET_NOISE_SUPPRESS, &p.noise_suppression);
 
-  if (state_right != nullptr) {
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_DENOISE, &enable_denoise);
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_NOISE_SUPPRESS, &noise_suppression);
+    speex_preprocess_ctl(state, SPEEX_PREPROCESS_SET_AGC, &p.enable_agc);
 
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_AGC, &enable_agc);
+    speex_preprocess_ctl(state, SPEEX_PREPROCESS_SET_VAD, &p.enable_vad);
+    speex_preprocess_ctl(state, SPEEX_PREPROCESS_SET_PROB_START, &p.vad_probability_start);
+    speex_preprocess_ctl(state, SPEEX_PREPROCESS_SET_PROB_CONTINUE, &p.vad_probability_continue);
 
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_VAD, &enable_vad);
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_PROB_START, &vad_probability_start);
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_PROB_CONTINUE, &vad_probability_continue);
+    speex_preprocess_ctl(state, SPEEX_PREPROCESS_SET_DEREVERB, &p.enable_dereverb);
+  }
+}
 
-    speex_preprocess_ctl(state_right, SPEEX_PREPROCESS_SET_DEREVERB, &enable_dereverb);
+Speex::Engine::~Engine() {
+  if (state_left != nullptr) {
+    speex_preprocess_state_destroy(state_left);
   }
 
-  speex_ready = true;
+  if (state_right != nullptr) {
+    speex_preprocess_state_destroy(state_right);
+  }
 }
 
 void Speex::process(std::span<float>& left_in,
                     std::span<float>& right_in,
                     std::span<float>& left_out,
                     std::span<float>& right_out) {
-  std::scoped_lock<std::mutex> lock(data_mutex);
+  const auto e = engine.read();
 
-  if (bypass || !speex_ready) {
+  if (bypass || !e || e->n_samples != n_samples || e->rate != rate) {
     std::copy(left_in.begin(), left_in.end(), left_out.begin());
     std::copy(right_in.begin(), right_in.end(), right_out.begin());
 
     return;
   }
 
+  if (const auto p = params.read(); p && (p.generation() != params_generation || e.generation() != engine_generation)) {
+    e->apply(*p);
+
+    params_generation = p.generation();
+    engine_generation = e.generation();
+  }
+
+  auto& data_L = e->data_L;
+  auto& data_R = e->data_R;
+
   if (input_gain != 1.0F) {
     apply_gain(left_in, right_in, input_gain);
   }
@@ -252,7 +220,7 @@ void Speex::process(std::span<float>& left_in,
     data_R[i] = static_cast<spx_int16_t>(right_in[i] * (SHRT_MAX + 1));
   }
 
-  if (speex_preprocess_run(state_left, data_L.data()) == 1) {
+  if (speex_preprocess_run(e->state_left, data_L.data()) == 1) {
     for (size_t i = 0; i < n_samples; i++) {
       left_out[i] = static_cast<float>(data_L[i]) * inv_short_max;
     }
@@ -260,7 +228,7 @@ void Speex::process(std::span<float>& left_in,
     std::ranges::fill(left_out, 0.0F);
   }
 
-  if (speex_preprocess_run(state_right, data_R.data()) == 1) {
+  if (speex_preprocess_run(e->state_right, data_R.data()) == 1) {
     for (size_t i = 0; i < n_samples; i++) {
       right_out[i] = static_cast<float>(data_R[i]) * inv_short_max;
     }
@@ -281,19 +249,6 @@ void Speex::process(std::span<float>& left_in,
   }
 }
 
-void Speex::free_speex() {
-  if (state_left != nullptr) {
-    speex_preprocess_state_destroy(state_left);
-  }
-
-  if (state_right != nullptr) {
-    speex_preprocess_state_destroy(state_right);
-  }
-
-  state_left = nullptr;
-  state_right = nullptr;
-}
-
 auto Speex::get_latency_seconds() -> float {
   return latency_value;
 }
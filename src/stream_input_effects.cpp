@@ -26,16 +26,17 @@
 #include <sigc++/functors/mem_fun.h>
 #include <spa/utils/defs.h>
 #include <algorithm>
-#include <chrono>
 #include <cstdlib>
+#include <memory>
 #include <ranges>
 #include <set>
 #include <string>
-#include <thread>
+#include <utility>
 #include <vector>
 #include "effects_base.hpp"
 #include "pipe_manager.hpp"
 #include "pipe_objects.hpp"
+#include "plugin_base.hpp"
 #include "tags_pipewire.hpp"
 #include "tags_plugin_name.hpp"
 #include "tags_schema.hpp"
@@ -46,14 +47,10 @@ StreamInputEffects::StreamInputEffects(PipeManager* pipe_manager)
   auto* PULSE_SOURCE = std::getenv("PULSE_SOURCE");
 
   if (PULSE_SOURCE != nullptr && PULSE_SOURCE != tags::pipewire::ee_source_name) {
-    for (const auto& [serial, node] : pm->node_map) {
-      if (node.name == PULSE_SOURCE) {
-        pm->input_device = node;
+    if (const auto* node = pm->find_node_by_name(PULSE_SOURCE); node != nullptr) {
+      pm->input_device = *node;
 
-        g_settings_set_string(settings, "input-device", pm->input_device.name.c_str());
-
-        break;
-      }
+      g_settings_set_string(settings, "input-device", pm->input_device.name.c_str());
     }
   }
 
@@ -95,20 +92,16 @@ StreamInputEffects::StreamInputEffects(PipeManager* pipe_manager)
                                               return;
                                             }
 
-                                            for (const auto& [serial, node] : self->pm->node_map) {
-                                              if (node.name == name) {
-                                                self->pm->input_device = node;
-
-                                                if (g_settings_get_boolean(self->global_settings, "bypass") != 0) {
-                                                  g_settings_set_boolean(self->global_settings, "bypass", 0);
+                                            if (const auto* node = self->pm->find_node_by_name(name); node != nullptr) {
+                                              self->pm->input_device = *node;
 
-                                                  return;  // filter connected through update_bypass_state
-                                                }
+                                              if (g_settings_get_boolean(self->global_settings, "bypass") != 0) {
+                                                g_settings_set_boolean(self->global_settings, "bypass", 0);
 
-                                                self->set_bypass(false);
-
-                                                break;
+                                                return;  // filter connected through update_bypass_state
                                               }
+
+                                              self->set_bypass(false);
                                             }
                                           }),
                                           this));
@@ -123,9 +116,25 @@ StreamInputEffects::StreamInputEffects(PipeManager* pipe_manager)
                                               return;  // filter connected through update_bypass_state
                                             }
 
+                                            if (self->crossfade_chain()) {
+                                              return;
+                                            }
+
                                             self->set_bypass(false);
                                           }),
                                           this));
+
+  gconnections_global.push_back(g_signal_connect(global_settings, "changed::fuse-effects-chain",
+                                                 G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
+                                                   auto* self = static_cast<StreamInputEffects*>(user_data);
+
+                                                   if (g_settings_get_boolean(settings, "bypass") != 0) {
+                                                     return;
+                                                   }
+
+                                                   self->set_bypass(false);
+                                                 }),
+                                                 this));
 }
 
 StreamInputEffects::~StreamInputEffects() {
@@ -147,11 +156,20 @@ void StreamInputEffects::on_app_added(const NodeInfo node_info) {
 }
 
 auto StreamInputEffects::apps_want_to_play() -> bool {
-  return std::ranges::any_of(pm->list_links, [&](const auto& link) {
-    return (link.output_node_id == pm->ee_source_node.id) && (link.state == PW_LINK_STATE_ACTIVE);
+  // The link map is updated by the PipeWire thread
+
+  pm->lock();
+
+  const auto want_to_play = std::ranges::any_of(pm->get_node_link_ids(pm->ee_source_node.id), [&](const auto& link_id) {
+    const auto it = pm->link_map.find(link_id);
+
+    return (it != pm->link_map.end()) && (it->second.output_node_id == pm->ee_source_node.id) &&
+           (it->second.state == PW_LINK_STATE_ACTIVE);
   });
 
-  return false;
+  pm->unlock();
+
+  return want_to_play;
 }
 
 void StreamInputEffects::on_link_changed(const LinkInfo link_info) {
@@ -174,7 +192,7 @@ void StreamInputEffects::on_link_changed(const LinkInfo link_info) {
   }
 
   if (apps_want_to_play()) {
-    if (list_proxies.empty()) {
+    if (chain_hops.empty()) {
       util::debug("At least one app linked to our device wants to play. Linking our filters.");
 
       connect_filters();
@@ -185,7 +203,7 @@ void StreamInputEffects::on_link_changed(const LinkInfo link_info) {
       // if the timer is enabled, wait for the timeout, then unlink plugin pipeline
       int inactivity_timeout = g_settings_get_int(global_settings, "inactivity-timeout");
       g_timeout_add_seconds(inactivity_timeout, GSourceFunc(+[](StreamInputEffects* self) {
-                              if (!self->apps_want_to_play() && !self->list_proxies.empty()) {
+                              if (!self->apps_want_to_play() && !self->chain_hops.empty()) {
                                 util::debug("No app linked to our device wants to play. Unlinking our filters.");
 
                                 self->disconnect_filters();
@@ -197,7 +215,7 @@ void StreamInputEffects::on_link_changed(const LinkInfo link_info) {
 
     } else {
       // otherwise, do nothing
-      if (!list_proxies.empty()) {
+      if (!chain_hops.empty()) {
         util::debug(
             "No app linked to our device wants to play, but the inactivity timer is disabled. Leaving filters linked.");
       };
@@ -213,119 +231,91 @@ void StreamInputEffects::connect_filters(const bool& bypass) {
   if (input_device_name.empty()) {
     util::debug("No input device set. Aborting the link");
 
+    disconnect_filters();
+
     return;
   }
 
-  bool dev_exists = false;
-
-  for (const auto& [serial, node] : pm->node_map) {
-    if (node.name == input_device_name) {
-      dev_exists = true;
-
-      pm->input_device = node;
-
-      break;
-    }
-  }
+  const auto* device = pm->find_node_by_name(input_device_name);
 
-  if (!dev_exists) {
+  if (device == nullptr) {
     util::debug("The input device " + input_device_name + " is not available. Aborting the link");
 
+    disconnect_filters();
+
     return;
   }
 
+  pm->input_device = *device;
+
   const auto list =
       (bypass) ? std::vector<std::string>() : util::gchar_array_to_vector(g_settings_get_strv(settings, "plugins"));
 
-  auto mic_linked = false;
-
   // waiting for the input device ports information to be available.
 
-  int timeout = 0;
-
-  while (pm->count_node_ports(pm->input_device.id) < 1) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  const auto ports_ready = pm->wait_for([this]() { return pm->count_node_ports(pm->input_device.id) >= 1U; },
+                                         PipeManager::connection_timeout);
 
-    timeout++;
+  if (!ports_ready) {
+    util::warning("Information about the ports of the input device " + pm->input_device.name + " with id " +
+                  util::to_string(pm->input_device.id) + " are taking to long to be available. Aborting the link");
 
-    if (timeout > 10000) {
-      util::warning("Information about the ports of the input device " + pm->input_device.name + " with id " +
-                    util::to_string(pm->input_device.id) + " are taking to long to be available. Aborting the link");
+    disconnect_filters();
 
-      return;
-    }
+    return;
   }
 
-  uint prev_node_id = pm->input_device.id;
-  uint next_node_id = 0U;
+  cancel_chain_switch();
 
-  // link plugins
+  std::vector<uint> node_ids = {pm->input_device.id};
+  std::vector<std::pair<uint, uint>> probe_links;
 
-  if (!list.empty()) {
-    for (const auto& name : list) {
-      if (!plugins.contains(name)) {
-        continue;
-      }
+  std::vector<std::shared_ptr<PluginBase>> bypassed;
 
-      if (!plugins[name]->connected_to_pw ? plugins[name]->connect_to_pw() : true) {
-        next_node_id = plugins[name]->get_node_id();
+  const auto chain = build_node_chain(list, bypassed);
 
-        const auto links = pm->link_nodes(prev_node_id, next_node_id);
+  // Bypassed filters are kept in the graph without links and deactivated so PipeWire does not schedule them.
 
-        for (auto* link : links) {
-          list_proxies.push_back(link);
-        }
+  auto nodes = chain;
 
-        if (mic_linked && (links.size() == 2U)) {
-          prev_node_id = next_node_id;
-        } else if (!mic_linked && (!links.empty())) {
-          prev_node_id = next_node_id;
-          mic_linked = true;
-        } else {
-          util::warning(" link from node " + util::to_string(prev_node_id) + " to node " +
-                        util::to_string(next_node_id) + " failed");
-        }
-      }
-    }
+  nodes.insert(nodes.end(), bypassed.begin(), bypassed.end());
 
-    // checking if we have to link the echo_canceller probe to the output device
+  connect_nodes_to_pw(nodes);
 
-    for (const auto& name : list) {
-      if (!plugins.contains(name)) {
-        continue;
-      }
+  set_filters_active(chain, true);
 
-      if (name.starts_with(tags::plugin_name::echo_canceller)) {
-        if (plugins[name]->connected_to_pw) {
-          for (const auto& link : pm->link_nodes(pm->output_device.id, plugins[name]->get_node_id(), true)) {
-            list_proxies.push_back(link);
-          }
-        }
-      }
+  for (const auto& node : chain) {
+    if (node->connected_to_pw) {
+      node_ids.push_back(node->get_node_id());
+    }
+  }
 
-      plugins[name]->update_probe_links();
+  // checking if we have to link the echo_canceller probe to the output device
+
+  for (const auto& name : list) {
+    if (plugins.contains(name) && name.starts_with(tags::plugin_name::echo_canceller) &&
+        plugins[name]->connected_to_pw) {
+      probe_links.emplace_back(pm->output_device.id, plugins[name]->get_node_id());
     }
   }
 
-  // link spectrum, output level meter and source node
+  // spectrum, output level meter and source node
 
-  for (const auto node_id : {spectrum->get_node_id(), output_level->get_node_id(), pm->ee_source_node.id}) {
-    next_node_id = node_id;
+  node_ids.push_back(spectrum->get_node_id());
+  node_ids.push_back(output_level->get_node_id());
+  node_ids.push_back(pm->ee_source_node.id);
 
-    const auto links = pm->link_nodes(prev_node_id, next_node_id);
+  // Mono microphones have a single output port
 
-    for (auto* link : links) {
-      list_proxies.push_back(link);
-    }
+  relink_chain(node_ids, probe_links, 1U);
 
-    if (mic_linked && (links.size() == 2U)) {
-      prev_node_id = next_node_id;
-    } else if (!mic_linked && (!links.empty())) {
-      prev_node_id = next_node_id;
-      mic_linked = true;
-    } else {
-      util::warning(" link from node " + util::to_string(prev_node_id) + " to node " + util::to_string(next_node_id) +
-                    " failed");
+  set_filters_active(bypassed, false);
+
+  disconnect_unused_filters(nodes);
+
+  for (const auto& name : list) {
+    if (plugins.contains(name)) {
+      plugins[name]->update_probe_links();
     }
   }
 }
@@ -337,10 +327,8 @@ void StreamInputEffects::disconnect_filters() {
       (bypass) ? std::vector<std::string>() : util::gchar_array_to_vector(g_settings_get_strv(settings, "plugins"));
 
   for (const auto& plugin : plugins | std::views::values) {
-    for (const auto& link : pm->list_links) {
-      if (link.input_node_id == plugin->get_node_id() || link.output_node_id == plugin->get_node_id()) {
-        link_id_list.insert(link.id);
-      }
+    for (const auto& link_id : pm->get_node_link_ids(plugin->get_node_id())) {
+      link_id_list.insert(link_id);
     }
 
     if (plugin->connected_to_pw) {
@@ -352,10 +340,11 @@ void StreamInputEffects::disconnect_filters() {
     }
   }
 
-  for (const auto& link : pm->list_links) {
-    if (link.input_node_id == spectrum->get_node_id() || link.output_node_id == spectrum->get_node_id() ||
-        link.input_node_id == output_level->get_node_id() || link.output_node_id == output_level->get_node_id()) {
-      link_id_list.insert(link.id);
+  disconnect_fused_chains(link_id_list);
+
+  for (const auto& node_id : {spectrum->get_node_id(), output_level->get_node_id()}) {
+    for (const auto& link_id : pm->get_node_link_ids(node_id)) {
+      link_id_list.insert(link_id);
     }
   }
 
@@ -363,9 +352,7 @@ void StreamInputEffects::disconnect_filters() {
     pm->destroy_object(static_cast<int>(id));
   }
 
-  pm->destroy_links(list_proxies);
-
-  list_proxies.clear();
+  unlink_chain();
 
   // remove_unused_filters();
 }
@@ -373,8 +360,6 @@ void StreamInputEffects::disconnect_filters() {
 void StreamInputEffects::set_bypass(const bool& state) {
   bypass = state;
 
-  disconnect_filters();
-
   connect_filters(state);
 }
 
@@ -27,16 +27,17 @@
 #include <sigc++/functors/mem_fun.h>
 #include <spa/utils/defs.h>
 #include <algorithm>
-#include <chrono>
 #include <cstdlib>
+#include <memory>
 #include <ranges>
 #include <set>
 #include <string>
-#include <thread>
+#include <utility>
 #include <vector>
 #include "effects_base.hpp"
 #include "pipe_manager.hpp"
 #include "pipe_objects.hpp"
+#include "plugin_base.hpp"
 #include "tags_pipewire.hpp"
 #include "tags_plugin_name.hpp"
 #include "tags_schema.hpp"
@@ -47,14 +48,10 @@ StreamOutputEffects::StreamOutputEffects(PipeManager* pipe_manager)
   auto* PULSE_SINK = std::getenv("PULSE_SINK");
 
   if (PULSE_SINK != nullptr && PULSE_SINK != tags::pipewire::ee_sink_name) {
-    for (const auto& [serial, node] : pm->node_map) {
-      if (node.name == PULSE_SINK) {
-        pm->output_device = node;
+    if (const auto* node = pm->find_node_by_name(PULSE_SINK); node != nullptr) {
+      pm->output_device = *node;
 
-        g_settings_set_string(settings, "output-device", pm->output_device.name.c_str());
-
-        break;
-      }
+      g_settings_set_string(settings, "output-device", pm->output_device.name.c_str());
     }
   }
 
@@ -95,20 +92,16 @@ StreamOutputEffects::StreamOutputEffects(PipeManager* pipe_manager)
                                               return;
                                             }
 
-                                            for (const auto& [serial, node] : self->pm->node_map) {
-                                              if (node.name == name) {
-                                                self->pm->output_device = node;
-
-                                                if (g_settings_get_boolean(self->global_settings, "bypass") != 0) {
-                                                  g_settings_set_boolean(self->global_settings, "bypass", 0);
-
-                                                  return;  // filter connected through update_bypass_state
-                                                }
+                                            if (const auto* node = self->pm->find_node_by_name(name); node != nullptr) {
+                                              self->pm->output_device = *node;
 
-                                                self->set_bypass(false);
+                                              if (g_settings_get_boolean(self->global_settings, "bypass") != 0) {
+                                                g_settings_set_boolean(self->global_settings, "bypass", 0);
 
-                                                break;
+                                                return;  // filter connected through update_bypass_state
                                               }
+
+                                              self->set_bypass(false);
                                             }
                                           }),
                                           this));
@@ -123,9 +116,25 @@ StreamOutputEffects::StreamOutputEffects(PipeManager* pipe_manager)
                                               return;  // filter connected through update_bypass_state
                                             }
 
+                                            if (self->crossfade_chain()) {
+                                              return;
+                                            }
+
                                             self->set_bypass(false);
                                           }),
                                           this));
+
+  gconnections_global.push_back(g_signal_connect(global_settings, "changed::fuse-effects-chain",
+                                                 G_CALLBACK(+[](GSettings* settings, char* key, gpointer user_data) {
+                                                   auto* self = static_cast<StreamOutputEffects*>(user_data);
+
+                                                   if (g_settings_get_boolean(settings, "bypass") != 0) {
+                                                     return;
+                                                   }
+
+                                                   self->set_bypass(false);
+                                                 }),
+                                                 this));
 }
 
 StreamOutputEffects::~StreamOutputEffects() {
@@ -147,9 +156,20 @@ void StreamOutputEffects::on_app_added(const NodeInfo node_info) {
 }
 
 auto StreamOutputEffects::apps_want_to_play() -> bool {
-  return std::ranges::any_of(pm->list_links, [&](const auto& link) {
-    return (link.input_node_id == pm->ee_sink_node.id) && (link.state == PW_LINK_STATE_ACTIVE);
+  // The link map is updated by the PipeWire thread
+
+  pm->lock();
+
+  const auto want_to_play = std::ranges::any_of(pm->get_node_link_ids(pm->ee_sink_node.id), [&](const auto& link_id) {
+    const auto it = pm->link_map.find(link_id);
+
+    return (it != pm->link_map.end()) && (it->second.input_node_id == pm->ee_sink_node.id) &&
+           (it->second.state == PW_LINK_STATE_ACTIVE);
   });
+
+  pm->unlock();
+
+  return want_to_play;
 }
 
 void StreamOutputEffects::connect_filters(const bool& bypass) {
@@ -160,127 +180,87 @@ void StreamOutputEffects::connect_filters(const bool& bypass) {
   if (output_device_name.empty()) {
     util::debug("No output device set. Aborting the link");
 
+    disconnect_filters();
+
     return;
   }
 
-  bool dev_exists = false;
-
-  for (const auto& [serial, node] : pm->node_map) {
-    if (node.name == output_device_name) {
-      dev_exists = true;
-
-      pm->output_device = node;
+  const auto* device = pm->find_node_by_name(output_device_name);
 
-      break;
-    }
-  }
-
-  if (!dev_exists) {
+  if (device == nullptr) {
     util::debug("The output device " + output_device_name + " is not available. Aborting the link");
 
+    disconnect_filters();
+
     return;
   }
 
+  pm->output_device = *device;
+
   const auto list =
       (bypass) ? std::vector<std::string>() : util::gchar_array_to_vector(g_settings_get_strv(settings, "plugins"));
 
-  uint prev_node_id = pm->ee_sink_node.id;
-  uint next_node_id = 0U;
+  cancel_chain_switch();
 
-  // link plugins
+  std::vector<uint> node_ids = {pm->ee_sink_node.id};
+  std::vector<std::pair<uint, uint>> probe_links;
 
-  if (!list.empty()) {
-    for (const auto& name : list) {
-      if (!plugins.contains(name)) {
-        continue;
-      }
+  std::vector<std::shared_ptr<PluginBase>> bypassed;
 
-      if (!plugins[name]->connected_to_pw ? plugins[name]->connect_to_pw() : true) {
-        next_node_id = plugins[name]->get_node_id();
+  const auto chain = build_node_chain(list, bypassed);
 
-        const auto links = pm->link_nodes(prev_node_id, next_node_id);
+  // Bypassed filters are kept in the graph without links and deactivated so PipeWire does not schedule them.
 
-        for (auto* link : links) {
-          list_proxies.push_back(link);
-        }
+  auto nodes = chain;
 
-        if (links.size() == 2U) {
-          prev_node_id = next_node_id;
-        } else {
-          util::warning(" link from node " + util::to_string(prev_node_id) + " to node " +
-                        util::to_string(next_node_id) + " failed");
-        }
-      }
-    }
+  nodes.insert(nodes.end(), bypassed.begin(), bypassed.end());
 
-    // checking if we have to link the echo_canceller probe to the output device
+  connect_nodes_to_pw(nodes);
 
-    for (const auto& name : list) {
-      if (!plugins.contains(name)) {
-        continue;
-      }
+  set_filters_active(chain, true);
 
-      if (name.starts_with(tags::plugin_name::echo_canceller)) {
-        if (plugins[name]->connected_to_pw) {
-          for (const auto& link : pm->link_nodes(pm->output_device.id, plugins[name]->get_node_id(), true)) {
-            list_proxies.push_back(link);
-          }
-        }
-      }
-
-      plugins[name]->update_probe_links();
+  for (const auto& node : chain) {
+    if (node->connected_to_pw) {
+      node_ids.push_back(node->get_node_id());
     }
   }
 
-  // link spectrum and output level meter
+  // checking if we have to link the echo_canceller probe to the output device
 
-  for (const auto& node_id : {spectrum->get_node_id(), output_level->get_node_id()}) {
-    next_node_id = node_id;
-
-    const auto links = pm->link_nodes(prev_node_id, next_node_id);
-
-    for (auto* link : links) {
-      list_proxies.push_back(link);
-    }
-
-    if (links.size() == 2U) {
-      prev_node_id = next_node_id;
-    } else {
-      util::warning(" link from node " + util::to_string(prev_node_id) + " to node " + util::to_string(next_node_id) +
-                    " failed");
+  for (const auto& name : list) {
+    if (plugins.contains(name) && name.starts_with(tags::plugin_name::echo_canceller) &&
+        plugins[name]->connected_to_pw) {
+      probe_links.emplace_back(pm->output_device.id, plugins[name]->get_node_id());
     }
   }
 
-  // waiting for the output device ports information to be available.
-
-  int timeout = 0;
+  // spectrum and output level meter
 
-  while (pm->count_node_ports(pm->output_device.id) < 2) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  node_ids.push_back(spectrum->get_node_id());
+  node_ids.push_back(output_level->get_node_id());
 
-    timeout++;
+  // waiting for the output device ports information to be available.
 
-    if (timeout > 10000) {  // 10 seconds
-      util::warning("Information about the ports of the output device " + pm->output_device.name + " with id " +
-                    util::to_string(pm->output_device.id) + " are taking to long to be available. Aborting the link");
+  const auto ports_ready = pm->wait_for([this]() { return pm->count_node_ports(pm->output_device.id) >= 2U; },
+                                         PipeManager::connection_timeout);
 
-      return;
-    }
+  if (ports_ready) {
+    node_ids.push_back(pm->output_device.id);
+  } else {
+    util::warning("Information about the ports of the output device " + pm->output_device.name + " with id " +
+                  util::to_string(pm->output_device.id) + " are taking to long to be available. Aborting the link");
   }
 
-  // link output device
-
-  next_node_id = pm->output_device.id;
+  relink_chain(node_ids, probe_links);
 
-  const auto links = pm->link_nodes(prev_node_id, next_node_id);
+  set_filters_active(bypassed, false);
 
-  for (auto* link : links) {
-    list_proxies.push_back(link);
-  }
+  disconnect_unused_filters(nodes);
 
-  if (links.size() < 2U) {
-    util::warning(" link from node " + util::to_string(prev_node_id) + " to output device " +
-                  util::to_string(next_node_id) + " failed");
+  for (const auto& name : list) {
+    if (plugins.contains(name)) {
+      plugins[name]->update_probe_links();
+    }
   }
 }
 
@@ -291,10 +271,8 @@ void StreamOutputEffects::disconnect_filters() {
       (bypass) ? std::vector<std::string>() : util::gchar_array_to_vector(g_settings_get_strv(settings, "plugins"));
 
   for (const auto& plugin : plugins | std::views::values) {
-    for (const auto& link : pm->list_links) {
-      if (link.input_node_id == plugin->get_node_id() || link.output_node_id == plugin->get_node_id()) {
-        link_id_list.insert(link.id);
-      }
+    for (const auto& link_id : pm->get_node_link_ids(plugin->get_node_id())) {
+      link_id_list.insert(link_id);
     }
 
     if (plugin->connected_to_pw) {
@@ -306,10 +284,11 @@ void StreamOutputEffects::disconnect_filters() {
     }
   }
 
-  for (const auto& link : pm->list_links) {
-    if (link.input_node_id == spectrum->get_node_id() || link.output_node_id == spectrum->get_node_id() ||
-        link.input_node_id == output_level->get_node_id() || link.output_node_id == output_level->get_node_id()) {
-      link_id_list.insert(link.id);
+  disconnect_fused_chains(link_id_list);
+
+  for (const auto& node_id : {spectrum->get_node_id(), output_level->get_node_id()}) {
+    for (const auto& link_id : pm->get_node_link_ids(node_id)) {
+      link_id_list.insert(link_id);
     }
   }
 
@@ -317,9 +296,7 @@ void StreamOutputEffects::disconnect_filters() {
     pm->destroy_object(static_cast<int>(id));
   }
 
-  pm->destroy_links(list_proxies);
-
-  list_proxies.clear();
+  unlink_chain();
 
   // remove_unused_filters();
 }
@@ -327,7 +304,5 @@ void StreamOutputEffects::disconnect_filters() {
 void StreamOutputEffects::set_bypass(const bool& state) {
   bypass = state;
 
-  disconnect_filters();
-
   connect_filters(state);
 }
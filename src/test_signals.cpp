@@ -25,11 +25,9 @@
 #include <spa/node/io.h>
 #include <spa/utils/hook.h>
 #include <sys/types.h>
-#include <chrono>
 #include <cmath>
 #include <numbers>
 #include <span>
-#include <thread>
 #include "pipe_manager.hpp"
 #include "tags_app.hpp"
 #include "util.hpp"
@@ -130,6 +128,10 @@ void on_filter_state_changed(void* userdata, pw_filter_state old, pw_filter_stat
     default:
       break;
   }
+
+  if (d->pm != nullptr) {
+    d->pm->notify_graph_changed();
+  }
 }
 
 const struct pw_filter_events filter_events = {.state_changed = on_filter_state_changed, .process = on_process};
@@ -138,6 +140,7 @@ const struct pw_filter_events filter_events = {.state_changed = on_filter_state_
 
 TestSignals::TestSignals(PipeManager* pipe_manager) : pm(pipe_manager), random_generator(rd()) {
   pf_data.ts = this;
+  pf_data.pm = pm;
 
   const auto* filter_name = "ee_test_signals";
 
@@ -190,25 +193,23 @@ TestSignals::TestSignals(PipeManager* pipe_manager) : pm(pipe_manager), random_g
 
   pw_filter_add_listener(filter, &listener, &filter_events, &pf_data);
 
-  pm->sync_wait_unlock();
+  pm->unlock();
 
-  while (!can_get_node_id) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  pm->wait_for(
+      [this]() {
+        if (can_get_node_id) {
+          node_id = pw_filter_get_node_id(filter);
+        }
 
-    if (state == PW_FILTER_STATE_ERROR) {
-      using namespace std::string_literals;
+        return can_get_node_id || state == PW_FILTER_STATE_ERROR;
+      },
+      PipeManager::connection_timeout);
 
-      util::warning(filter_name + " is in an error"s);
+  if (!can_get_node_id) {
+    using namespace std::string_literals;
 
-      return;
-    }
+    util::warning(filter_name + " is in an error"s);
   }
-
-  pm->lock();
-
-  node_id = pw_filter_get_node_id(filter);
-
-  pm->sync_wait_unlock();
 }
 
 TestSignals::~TestSignals() {
@@ -0,0 +1,349 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "worker_pool.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <vector>
+#include "util.hpp"
+
+namespace {
+
+constexpr size_t queue_capacity = 1024U;
+
+constexpr auto max_spin_time = std::chrono::microseconds(50);
+
+/*
+  The deadline is copied into the entry. The job may be submitted again with another deadline while a stale entry is
+  still in the heap.
+*/
+
+struct Entry {
+  WorkerPoolJob* job = nullptr;
+
+  std::chrono::steady_clock::time_point deadline;
+};
+
+/*
+  Bounded multi producer and multi consumer queue, as described by Dmitry Vyukov. Pushing and popping never block.
+*/
+
+class JobQueue {
+ public:
+  JobQueue() {
+    for (size_t n = 0U; n < queue_capacity; n++) {
+      cells[n].sequence.store(n, std::memory_order_relaxed);
+    }
+  }
+
+  auto push(const Entry& entry) -> bool {
+    auto pos = enqueue_pos.load(std::memory_order_relaxed);
+
+    while (true) {
+      auto& cell = cells[pos & (queue_capacity - 1U)];
+
+      const auto seq = cell.sequence.load(std::memory_order_acquire);
+
+      if (seq == pos) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1U, std::memory_order_relaxed)) {
+          cell.entry = entry;
+
+          cell.sequence.store(pos + 1U, std::memory_order_release);
+
+          return true;
+        }
+      } else if (seq < pos) {
+        return false;  // full
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  auto pop(Entry& entry) -> bool {
+    auto pos = dequeue_pos.load(std::memory_order_relaxed);
+
+    while (true) {
+      auto& cell = cells[pos & (queue_capacity - 1U)];
+
+      const auto seq = cell.sequence.load(std::memory_order_acquire);
+
+      if (seq == pos + 1U) {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1U, std::memory_order_relaxed)) {
+          entry = cell.entry;
+
+          cell.sequence.store(pos + queue_capacity, std::memory_order_release);
+
+          return true;
+        }
+      } else if (seq < pos + 1U) {
+        return false;  // empty
+      } else {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+
+    Entry entry;
+  };
+
+  std::array<Cell, queue_capacity> cells;
+
+  alignas(64) std::atomic<size_t> enqueue_pos = 0U;
+
+  alignas(64) std::atomic<size_t> dequeue_pos = 0U;
+};
+
+JobQueue queue;
+
+std::counting_semaphore<> pending(0);  // one permit per submitted job
+
+std::mutex heap_mutex;  // only taken by the workers and by the main thread when the pool stops
+
+std::vector<Entry> heap;  // queued jobs ordered by deadline
+
+std::vector<std::thread> threads;
+
+std::atomic<bool> running = false;
+
+std::atomic<uint> n_threads = 0U;
+
+void setup_thread(const uint& index, const std::vector<int>& cpus) {
+  const auto tag = "worker pool thread " + util::to_string(index) + ": ";
+
+  if (!cpus.empty()) {
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+
+    for (const auto& cpu : cpus) {
+      CPU_SET(cpu, &set);
+    }
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+      util::warning(tag + "could not set the cpu affinity");
+    }
+  }
+
+  sched_param param{};
+
+  param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+
+  if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+    util::debug(tag + "SCHED_FIFO is not allowed. Running with the normal policy");
+  }
+}
+
+}  // namespace
+
+auto WorkerPoolJob::try_run() -> bool {
+  auto expected = State::queued;
+
+  if (!state.compare_exchange_strong(expected, State::running, std::memory_order_acq_rel)) {
+    return false;
+  }
+
+  run();
+
+  state.store(State::done, std::memory_order_release);
+
+  state.notify_all();
+
+  return true;
+}
+
+void WorkerPoolJob::finish_entry() {
+  n_entries.fetch_sub(1U, std::memory_order_acq_rel);
+}
+
+void WorkerPoolJob::wait() {
+  if (try_run()) {
+    return;
+  }
+
+  /*
+    A worker is computing it. The job can not be taken back anymore because run() updates the state kept by the job
+    between calls. The worker started before the deadline, so it should be close to the end. If it is not, the worker
+    may be sharing our core and only gets it when we sleep.
+  */
+
+  const auto spin_end = std::chrono::steady_clock::now() + max_spin_time;
+
+  while (state.load(std::memory_order_acquire) == State::running) {
+    if (std::chrono::steady_clock::now() > spin_end) {
+      state.wait(State::running, std::memory_order_acquire);
+    }
+  }
+}
+
+void WorkerPoolJob::release() {
+  auto expected = State::queued;
+
+  state.compare_exchange_strong(expected, State::done, std::memory_order_acq_rel);
+
+  while (n_entries.load(std::memory_order_acquire) != 0U || state.load(std::memory_order_acquire) == State::running) {
+    if (WorkerPool::get_n_threads() == 0U) {
+      WorkerPool::drain_queue();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void WorkerPool::submit(WorkerPoolJob& job, const std::chrono::steady_clock::time_point& deadline) {
+  job.state.store(WorkerPoolJob::State::queued, std::memory_order_release);
+
+  if (n_threads.load(std::memory_order_acquire) != 0U) {
+    job.n_entries.fetch_add(1U, std::memory_order_acq_rel);
+
+    if (queue.push({.job = &job, .deadline = deadline})) {
+      pending.release();
+
+      return;
+    }
+
+    job.finish_entry();
+  }
+
+  job.try_run();
+}
+
+void WorkerPool::work() {
+  const auto later = [](const Entry& a, const Entry& b) { return a.deadline > b.deadline; };
+
+  while (true) {
+    pending.acquire();
+
+    if (!running.load(std::memory_order_acquire)) {
+      break;
+    }
+
+    WorkerPoolJob* job = nullptr;
+
+    {
+      std::scoped_lock<std::mutex> lock(heap_mutex);
+
+      Entry queued;
+
+      while (queue.pop(queued)) {
+        heap.push_back(queued);
+
+        std::ranges::push_heap(heap, later);
+      }
+
+      if (!heap.empty()) {
+        std::ranges::pop_heap(heap, later);
+
+        job = heap.back().job;
+
+        heap.pop_back();
+      }
+    }
+
+    if (job != nullptr) {
+      job->try_run();  // it fails when the processing thread got to the deadline first or for stale entries
+
+      // After this the job may be destroyed
+
+      job->finish_entry();
+    }
+  }
+}
+
+void WorkerPool::drain_queue() {
+  std::scoped_lock<std::mutex> lock(heap_mutex);
+
+  Entry entry;
+
+  while (queue.pop(entry)) {
+    heap.push_back(entry);
+  }
+
+  for (const auto& e : heap) {
+    e.job->finish_entry();
+  }
+
+  heap.clear();
+}
+
+void WorkerPool::configure(const uint& n_threads, const std::vector<int>& cpus) {
+  stop();
+
+  if (n_threads == 0U) {
+    util::debug("worker pool disabled. Convolution tails are computed in the processing threads");
+
+    return;
+  }
+
+  heap.reserve(queue_capacity);
+
+  running.store(true, std::memory_order_release);
+
+  for (uint n = 0U; n < n_threads; n++) {
+    threads.emplace_back([n, cpus]() {
+      setup_thread(n, cpus);
+
+      work();
+    });
+  }
+
+  ::n_threads.store(n_threads, std::memory_order_release);
+
+  util::debug("worker pool started with " + util::to_string(n_threads) + " threads");
+}
+
+void WorkerPool::stop() {
+  n_threads.store(0U, std::memory_order_release);
+
+  if (threads.empty()) {
+    return;
+  }
+
+  running.store(false, std::memory_order_release);
+
+  pending.release(static_cast<std::ptrdiff_t>(threads.size()));
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  threads.clear();
+
+  // Jobs still queued are computed by their processing threads when their deadline comes.
+
+  drain_queue();
+}
+
+auto WorkerPool::get_n_threads() -> uint {
+  return n_threads.load(std::memory_order_acquire);
+}
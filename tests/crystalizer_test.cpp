@@ -0,0 +1,183 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fmt/core.h>
+#include <gio/gio.h>
+#include <glib.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+#include "crystalizer.hpp"
+#include "pipeline_type.hpp"
+#include "tags_schema.hpp"
+#include "test_utils.hpp"
+#include "util.hpp"
+
+/*
+  Runs the Crystalizer at quanta that are not powers of two and compares it with the algorithm it had before the
+  filter bank. That one filtered each band by itself, delayed it by one sample and subtracted its second derivative
+  scaled by the band intensity. Here it is computed in double precision with a direct convolution of each band
+  kernel. A muted and a bypassed band are included.
+*/
+
+namespace {
+
+constexpr size_t nbands = test::crystalizer_frequencies.size() - 1U;
+
+constexpr uint n_cycles = 12U;
+
+struct Case {
+  uint rate;
+  uint quantum;
+};
+
+constexpr size_t muted_band = 4U;
+
+constexpr size_t bypassed_band = 9U;
+
+auto intensity_db(const size_t& band) -> double {
+  return (2.0 * static_cast<double>(band)) - 8.0;
+}
+
+void write_settings(const std::string& path) {
+  auto* settings = g_settings_new_with_path(tags::schema::crystalizer::id, path.c_str());
+
+  for (size_t n = 0U; n < nbands; n++) {
+    const auto bandn = "band" + std::to_string(n);
+
+    g_settings_set_double(settings, ("intensity-" + bandn).c_str(), intensity_db(n));
+    g_settings_set_boolean(settings, ("mute-" + bandn).c_str(), static_cast<gboolean>(n == muted_band));
+    g_settings_set_boolean(settings, ("bypass-" + bandn).c_str(), static_cast<gboolean>(n == bypassed_band));
+  }
+
+  g_settings_sync();
+
+  g_object_unref(settings);
+}
+
+// The previous algorithm. The output is delayed by the one sample needed by the central difference.
+auto reference(std::span<const float> signal, const uint& rate) -> std::vector<double> {
+  const auto kernels = test::crystalizer_kernels(rate);
+
+  std::vector<double> output(signal.size(), 0.0);
+
+  for (size_t n = 0U; n < nbands; n++) {
+    if (n == muted_band) {
+      continue;
+    }
+
+    const auto intensity =
+        (n == bypassed_band) ? 0.0 : static_cast<double>(static_cast<float>(util::db_to_linear(intensity_db(n))));
+
+    const auto band = test::direct_fir(signal, kernels[n]);
+
+    for (size_t m = 0U; m < output.size(); m++) {
+      const auto x0 = band[m];
+      const auto x1 = (m >= 1U) ? band[m - 1U] : 0.0;
+      const auto x2 = (m >= 2U) ? band[m - 2U] : 0.0;
+
+      output[m] += x1 - intensity * (x0 - 2.0 * x1 + x2);
+    }
+  }
+
+  return output;
+}
+
+}  // namespace
+
+auto main() -> int {
+  // The preset values are written to a memory backend before the plugin reads them, like easyeffects-render does.
+
+  g_setenv("GSETTINGS_BACKEND", "memory", 1);
+
+  const auto path = std::string(tags::schema::crystalizer::output_path) + "0/";
+
+  write_settings(path);
+
+  // 1023 is not a product of small primes. The block adapter keeps it as the block size anyway.
+
+  constexpr auto cases = std::to_array<Case>({{44100U, 1000U}, {48000U, 1764U}, {48000U, 1023U}});
+
+  for (const auto& test_case : cases) {
+    const auto rate = test_case.rate;
+    const auto quantum = test_case.quantum;
+
+    Crystalizer crystalizer("test: ", tags::schema::crystalizer::id, path, nullptr, PipelineType::output);
+
+    crystalizer.set_post_messages(false);
+
+    crystalizer.prepare(quantum, rate);
+
+    const auto n_frames = n_cycles * quantum;
+
+    const auto input_left = test::noise(n_frames, 1U);
+    const auto input_right = test::noise(n_frames, 2U);
+
+    std::vector<float> left(quantum), right(quantum);
+    std::vector<float> output_left(n_frames), output_right(n_frames);
+
+    for (uint c = 0U; c < n_cycles; c++) {
+      std::copy_n(input_left.begin() + c * quantum, quantum, left.begin());
+      std::copy_n(input_right.begin() + c * quantum, quantum, right.begin());
+
+      std::span<float> l_in(left);
+      std::span<float> r_in(right);
+      std::span<float> l_out(output_left.data() + c * quantum, quantum);
+      std::span<float> r_out(output_right.data() + c * quantum, quantum);
+
+      crystalizer.begin_cycle(quantum, rate);
+
+      crystalizer.process(l_in, r_in, l_out, r_out);
+
+      crystalizer.end_cycle();
+    }
+
+    // The reported latency includes the sample of the central difference. The rest comes from the block adapter.
+
+    const auto latency = static_cast<uint>(std::lround(crystalizer.get_latency_seconds() * static_cast<float>(rate)));
+
+    test::check(latency >= 1U, fmt::format("rate {} quantum {:>4}: latency {} frames", rate, quantum, latency));
+
+    if (latency == 0U) {
+      continue;
+    }
+
+    const auto adapter_latency = latency - 1U;
+
+    auto compare = [&](const std::vector<float>& input, const std::vector<float>& output, const char* channel) {
+      const auto expected = reference(input, rate);
+
+      const auto error = test::max_relative_error(std::span(output).subspan(adapter_latency),
+                                                  std::span(expected).first(n_frames - adapter_latency));
+
+      test::check(error < 1e-4, fmt::format("rate {} quantum {:>4} {:<5}: relative error {:.2e}", rate, quantum,
+                                            channel, error));
+    };
+
+    compare(input_left, output_left, "left");
+    compare(input_right, output_right, "right");
+  }
+
+  return test::status();
+}
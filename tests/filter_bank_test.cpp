@@ -0,0 +1,117 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fmt/core.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "filter_bank.hpp"
+#include "test_utils.hpp"
+
+/*
+  Compares every band of FilterBank with a direct convolution of its kernel. The bank holds the Crystalizer kernels
+  and a few noise kernels whose sizes end exactly at, just after and far from a partition boundary. The two channels
+  get different signals and are processed alternately, so any state shared between them would show up. One band is
+  skipped in every block to check that it does not disturb the others.
+*/
+
+namespace {
+
+constexpr uint rate = 48000U;
+
+constexpr uint n_blocks = 8U;
+
+auto make_kernels(const uint& block_size) -> std::vector<std::vector<float>> {
+  auto kernels = test::crystalizer_kernels(rate);
+
+  for (const auto& size : {1U, 50U, block_size, block_size + 1U, (3U * block_size) + 17U}) {
+    auto kernel = test::noise(size, 100U + size);
+
+    for (size_t k = 0U; k < kernel.size(); k++) {
+      kernel[k] *= std::exp(-3.0F * static_cast<float>(k) / static_cast<float>(kernel.size()));
+    }
+
+    kernels.push_back(kernel);
+  }
+
+  return kernels;
+}
+
+}  // namespace
+
+auto main() -> int {
+  constexpr auto block_sizes = std::to_array<uint>({64U, 1000U, 1764U});
+
+  for (const auto& block_size : block_sizes) {
+    const auto kernels = make_kernels(block_size);
+
+    const auto n_bands = kernels.size();
+
+    const auto skipped_band = n_bands / 2U;
+
+    FilterBank bank;
+
+    bank.setup(block_size, 2U, kernels);
+
+    test::check(bank.get_n_bands() == n_bands && bank.get_block_size() == block_size,
+                fmt::format("block {:>4}: {} bands", block_size, n_bands));
+
+    const auto n_frames = n_blocks * block_size;
+
+    const std::array<std::vector<float>, 2U> signals = {test::noise(n_frames, 1U), test::noise(n_frames, 2U)};
+
+    std::array<std::vector<std::vector<float>>, 2U> bands;
+
+    std::vector<std::span<float>> outputs(n_bands);
+
+    for (auto& channel_bands : bands) {
+      channel_bands.assign(n_bands, std::vector<float>(n_frames, 0.0F));
+    }
+
+    for (uint b = 0U; b < n_blocks; b++) {
+      for (uint c = 0U; c < 2U; c++) {
+        for (size_t n = 0U; n < n_bands; n++) {
+          outputs[n] =
+              (n == skipped_band) ? std::span<float>() : std::span(bands[c][n]).subspan(b * block_size, block_size);
+        }
+
+        bank.process(c, std::span(signals[c]).subspan(b * block_size, block_size), outputs);
+      }
+    }
+
+    for (uint c = 0U; c < 2U; c++) {
+      for (size_t n = 0U; n < n_bands; n++) {
+        if (n == skipped_band) {
+          continue;
+        }
+
+        const auto error = test::max_relative_error(bands[c][n], test::direct_fir(signals[c], kernels[n]));
+
+        test::check(error < 1e-4, fmt::format("block {:>4} channel {} band {:>2} kernel {:>5}: relative error {:.2e}",
+                                              block_size, c, n, kernels[n].size(), error));
+      }
+    }
+  }
+
+  return test::status();
+}
@@ -0,0 +1,181 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fmt/core.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <vector>
+#include "loudness_meter.hpp"
+#include "test_utils.hpp"
+
+/*
+  Conformance signals of EBU Tech 3341 (integrated loudness) and EBU Tech 3342 (loudness range) at 44.1 and 48 kHz.
+  They are stereo 1 kHz sines made of segments of given level and duration. The meter is fed 100 frames at a time,
+  which does not divide the 100 ms steps. The last cases check that a limited history forgets the blocks that left it,
+  including the ones below the absolute gate.
+*/
+
+namespace {
+
+constexpr uint chunk_size = 100U;
+
+struct Segment {
+  double level;  // dBFS. Silence when it is below -100.
+  double seconds;
+};
+
+void feed(LoudnessMeter& meter, const uint& rate, std::span<const Segment> segments) {
+  std::vector<float> left(chunk_size), right(chunk_size);
+
+  const std::array<std::span<float>, 2U> channels = {left, right};
+
+  const auto phase_step = 2.0 * std::numbers::pi * 1000.0 / static_cast<double>(rate);
+
+  double phase = 0.0;
+
+  for (const auto& segment : segments) {
+    const auto amplitude = (segment.level < -100.0) ? 0.0 : std::pow(10.0, segment.level / 20.0);
+
+    auto n_frames = static_cast<size_t>(std::lround(segment.seconds * static_cast<double>(rate)));
+
+    while (n_frames != 0U) {
+      const auto count = std::min(static_cast<size_t>(chunk_size), n_frames);
+
+      for (size_t n = 0U; n < count; n++) {
+        left[n] = right[n] = static_cast<float>(amplitude * std::sin(phase));
+
+        phase = std::fmod(phase + phase_step, 2.0 * std::numbers::pi);
+      }
+
+      const std::array<std::span<float>, 2U> chunk = {channels[0].first(count), channels[1].first(count)};
+
+      meter.add_frames(chunk);
+
+      n_frames -= count;
+    }
+  }
+}
+
+void check_integrated(const uint& rate, const char* name, std::span<const Segment> segments, const double& expected) {
+  LoudnessMeter meter(rate, {1.0, 1.0}, false);
+
+  feed(meter, rate, segments);
+
+  test::check(std::fabs(meter.integrated() - expected) <= 0.1,
+              fmt::format("{} Hz {}: integrated {:.2f} LUFS, expected {:.1f}", rate, name, meter.integrated(),
+                          expected));
+}
+
+void check_range(const uint& rate, const char* name, std::span<const Segment> segments, const double& expected) {
+  LoudnessMeter meter(rate, {1.0, 1.0}, false);
+
+  feed(meter, rate, segments);
+
+  test::check(std::fabs(meter.loudness_range() - expected) <= 0.1,
+              fmt::format("{} Hz {}: range {:.2f} LU, expected {:.1f}", rate, name, meter.loudness_range(), expected));
+}
+
+void check_limited_history(const uint& rate) {
+  // The history holds 10 s. The first 20 s are older than that when the measurement ends.
+
+  {
+    LoudnessMeter meter(rate, {1.0, 1.0}, false, 10U);
+
+    feed(meter, rate, std::to_array<Segment>({{-30.0, 20.0}, {-23.0, 20.0}}));
+
+    test::check(std::fabs(meter.integrated() + 23.0) <= 0.1 && meter.loudness_range() <= 0.1,
+                fmt::format("{} Hz history of 10 s: integrated {:.2f} LUFS, range {:.2f} LU", rate, meter.integrated(),
+                            meter.loudness_range()));
+  }
+
+  // Shrinking the history removes the oldest blocks at once.
+
+  {
+    LoudnessMeter meter(rate, {1.0, 1.0}, false, 60U);
+
+    feed(meter, rate, std::to_array<Segment>({{-30.0, 20.0}, {-23.0, 20.0}}));
+
+    const auto full_integrated = meter.integrated();
+    const auto full_range = meter.loudness_range();
+
+    meter.set_max_history(10U);
+
+    test::check(full_integrated < -24.0 && full_range > 6.0 && std::fabs(meter.integrated() + 23.0) <= 0.1 &&
+                    meter.loudness_range() <= 0.1,
+                fmt::format("{} Hz history from 60 s to 10 s: integrated {:.2f} -> {:.2f} LUFS, "
+                            "range {:.2f} -> {:.2f} LU",
+                            rate, full_integrated, meter.integrated(), full_range, meter.loudness_range()));
+  }
+
+  // Blocks below the absolute gate leave the history too. Nothing is left to measure.
+
+  {
+    LoudnessMeter meter(rate, {1.0, 1.0}, false, 10U);
+
+    feed(meter, rate, std::to_array<Segment>({{-23.0, 20.0}, {-200.0, 20.0}}));
+
+    test::check(meter.integrated() == -std::numeric_limits<double>::infinity() && meter.loudness_range() == 0.0,
+                fmt::format("{} Hz silence after the history: integrated {:.2f} LUFS, range {:.2f} LU", rate,
+                            meter.integrated(), meter.loudness_range()));
+  }
+}
+
+}  // namespace
+
+auto main() -> int {
+  for (const auto& rate : {44100U, 48000U}) {
+    // EBU Tech 3341 test cases 1 to 5
+
+    check_integrated(rate, "3341 case 1", std::to_array<Segment>({{-23.0, 20.0}}), -23.0);
+
+    check_integrated(rate, "3341 case 2", std::to_array<Segment>({{-33.0, 20.0}}), -33.0);
+
+    check_integrated(rate, "3341 case 3", std::to_array<Segment>({{-36.0, 10.0}, {-23.0, 60.0}, {-36.0, 10.0}}),
+                     -23.0);
+
+    check_integrated(
+        rate, "3341 case 4",
+        std::to_array<Segment>({{-72.0, 10.0}, {-36.0, 10.0}, {-23.0, 60.0}, {-36.0, 10.0}, {-72.0, 10.0}}), -23.0);
+
+    check_integrated(rate, "3341 case 5", std::to_array<Segment>({{-26.0, 20.0}, {-20.0, 20.1}, {-26.0, 20.0}}),
+                     -23.0);
+
+    // EBU Tech 3342 test cases 1 to 4
+
+    check_range(rate, "3342 case 1", std::to_array<Segment>({{-20.0, 20.0}, {-30.0, 20.0}}), 10.0);
+
+    check_range(rate, "3342 case 2", std::to_array<Segment>({{-20.0, 20.0}, {-15.0, 20.0}}), 5.0);
+
+    check_range(rate, "3342 case 3", std::to_array<Segment>({{-40.0, 20.0}, {-20.0, 20.0}}), 20.0);
+
+    check_range(rate, "3342 case 4",
+                std::to_array<Segment>({{-50.0, 20.0}, {-35.0, 20.0}, {-20.0, 20.0}, {-35.0, 20.0}, {-50.0, 20.0}}),
+                15.0);
+
+    check_limited_history(rate);
+  }
+
+  return test::status();
+}
@@ -0,0 +1,99 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fmt/core.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "partitioned_convolver.hpp"
+#include "test_utils.hpp"
+#include "worker_pool.hpp"
+
+/*
+  Compares PartitionedConvolver with a direct FIR. The impulse responses end in the head and in each stage, whose
+  blocks grow from 64 to 4096 frames. The quanta include sizes that are not powers of two and one larger than the
+  biggest block. Every case runs without workers, where the tail stages are computed in the calling thread, and with
+  two workers.
+*/
+
+namespace {
+
+constexpr uint rate = 48000U;
+
+auto convolve(std::span<const float> signal, std::span<const float> kernel, const uint& quantum)
+    -> std::vector<float> {
+  PartitionedConvolver conv;
+
+  conv.set_kernel(kernel, rate);
+
+  std::vector<float> output(signal.begin(), signal.end());
+
+  for (size_t offset = 0U; offset < output.size(); offset += quantum) {
+    const auto count = std::min(static_cast<size_t>(quantum), output.size() - offset);
+
+    conv.process(std::span(output).subspan(offset, count));
+  }
+
+  return output;
+}
+
+}  // namespace
+
+auto main() -> int {
+  // 40 stays in the head. The others end in the stages of 64, 256, 1024 and 4096 frames.
+
+  constexpr auto kernel_sizes = std::to_array<size_t>({40U, 64U, 300U, 1500U, 6000U, 10000U});
+
+  constexpr auto quanta = std::to_array<uint>({64U, 1000U, 1764U, 8192U});
+
+  constexpr auto worker_threads = std::to_array<uint>({0U, 2U});
+
+  for (const auto& kernel_size : kernel_sizes) {
+    // an exponential decay keeps the tail relevant without making it dominate the error
+
+    auto kernel = test::noise(kernel_size, static_cast<unsigned>(kernel_size));
+
+    for (size_t k = 0U; k < kernel.size(); k++) {
+      kernel[k] *= std::exp(-3.0F * static_cast<float>(k) / static_cast<float>(kernel.size()));
+    }
+
+    const auto signal = test::noise((2U * kernel_size) + 20000U, 1U);
+
+    const auto reference = test::direct_fir(signal, kernel);
+
+    for (const auto& n_threads : worker_threads) {
+      WorkerPool::configure(n_threads, {});
+
+      for (const auto& quantum : quanta) {
+        const auto error = test::max_relative_error(convolve(signal, kernel, quantum), reference);
+
+        test::check(error < 1e-4, fmt::format("kernel {:>5} quantum {:>4} workers {}: relative error {:.2e}",
+                                              kernel_size, quantum, n_threads, error));
+      }
+    }
+  }
+
+  WorkerPool::stop();
+
+  return test::status();
+}
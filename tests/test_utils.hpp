@@ -0,0 +1,128 @@
+/*
+ *  Copyright © 2017-2025 Wellington Wallace
+ *
+ *  This file is part of Easy Effects.
+ *
+ *  Easy Effects is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Easy Effects is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Easy Effects. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <fmt/core.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+#include "fir_filter_bandpass.hpp"
+
+/*
+  Helpers shared by the unit tests. Every test is a plain executable that returns a non zero status when one of its
+  checks failed, which is what meson test expects.
+*/
+
+namespace test {
+
+inline int n_failures = 0;
+
+// White noise in [-1, 1). The seed makes every run see the same signal.
+inline auto noise(const size_t& size, const unsigned& seed) -> std::vector<float> {
+  std::mt19937 gen(seed);
+
+  std::uniform_real_distribution<float> dist(-1.0F, 1.0F);
+
+  std::vector<float> v(size);
+
+  std::ranges::generate(v, [&]() { return dist(gen); });
+
+  return v;
+}
+
+// Band edges of the Crystalizer. They have to follow the ones set in its constructor.
+inline constexpr auto crystalizer_frequencies = std::to_array<float>(
+    {20.0F, 520.0F, 1020.0F, 2020.0F, 3020.0F, 4020.0F, 5020.0F, 6020.0F, 7020.0F, 8020.0F, 9020.0F, 10020.0F,
+     15020.0F, 20020.0F});
+
+// The bandpass kernels built by the Crystalizer for the given rate.
+inline auto crystalizer_kernels(const uint& rate) -> std::vector<std::vector<float>> {
+  std::vector<std::vector<float>> kernels;
+
+  for (size_t n = 0U; n + 1U < crystalizer_frequencies.size(); n++) {
+    FirFilterBandpass filter("test: band" + std::to_string(n));
+
+    filter.set_kernel_only(true);
+    filter.set_rate(rate);
+    filter.set_min_frequency(crystalizer_frequencies[n]);
+    filter.set_max_frequency(crystalizer_frequencies[n + 1U]);
+
+    filter.setup();
+
+    kernels.push_back(filter.get_kernel());
+  }
+
+  return kernels;
+}
+
+// Reference convolution in double precision. The signal is preceded by silence.
+inline auto direct_fir(std::span<const float> signal, std::span<const float> kernel) -> std::vector<double> {
+  std::vector<double> output(signal.size(), 0.0);
+
+  for (size_t n = 0U; n < signal.size(); n++) {
+    const auto n_taps = std::min(kernel.size(), n + 1U);
+
+    double sum = 0.0;
+
+    for (size_t k = 0U; k < n_taps; k++) {
+      sum += static_cast<double>(kernel[k]) * static_cast<double>(signal[n - k]);
+    }
+
+    output[n] = sum;
+  }
+
+  return output;
+}
+
+// Largest difference between the two signals relative to the peak of the reference.
+inline auto max_relative_error(std::span<const float> output, std::span<const double> reference) -> double {
+  double peak = 0.0, error = 0.0;
+
+  for (size_t n = 0U; n < reference.size() && n < output.size(); n++) {
+    peak = std::max(peak, std::fabs(reference[n]));
+    error = std::max(error, std::fabs(static_cast<double>(output[n]) - reference[n]));
+  }
+
+  return (peak > 0.0) ? error / peak : error;
+}
+
+inline void check(const bool& ok, const std::string& description) {
+  if (!ok) {
+    n_failures++;
+  }
+
+  fmt::print("{} {}\n", ok ? "ok  " : "FAIL", description);
+}
+
+inline auto status() -> int {
+  if (n_failures != 0) {
+    fmt::print("{} checks failed\n", n_failures);
+  }
+
+  return (n_failures == 0) ? 0 : 1;
+}
+
+}  // namespace test